@@ -0,0 +1,300 @@
+/*********************************************************************
+ *
+ * bench_codec.c: Time the Get/Put wire codec against protobuf-c
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <time.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_binary-internal.h"
+#include "riak_config-internal.h"
+#include "riak_object-internal.h"
+#include "riak_operation-internal.h"
+
+// Each case runs this many times unless a count is given on the command line
+#define BENCH_DEFAULT_ITERATIONS 1000000
+#define BENCH_VALUE_LEN          1024
+
+#define BENCH_PB(F, B) { (F).data = riak_binary_data(B); (F).len = riak_binary_len(B); }
+
+typedef struct _bench_state {
+    riak_config       *cfg;
+    riak_connection   *cxn;
+    riak_binary       *bucket;
+    riak_binary       *key;
+    riak_binary       *vclock;
+    riak_get_options  *get_opts;
+    riak_put_options  *put_opts;
+    riak_object       *obj;
+    riak_uint8_t      *get_resp;     // Encoded RpbGetResp, message code first
+    riak_size_t        get_resp_len;
+} bench_state;
+
+typedef void (*bench_case)(bench_state *state);
+
+static riak_uint64_t
+bench_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (riak_uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static riak_float64_t
+bench_run(bench_state  *state,
+          bench_case    fn,
+          riak_uint32_t iterations) {
+    riak_uint32_t i;
+    // Warm the allocator and caches first
+    for(i = 0; i < iterations / 10; i++) {
+        (fn)(state);
+    }
+    riak_uint64_t start = bench_now_ns();
+    for(i = 0; i < iterations; i++) {
+        (fn)(state);
+    }
+    return (riak_float64_t)(bench_now_ns() - start) / iterations;
+}
+
+static void
+bench_report(const char    *name,
+             riak_float64_t wire_ns,
+             riak_float64_t pb_ns) {
+    printf("%-20s %10.1f ns/op %10.1f ns/op %8.2fx\n", name, wire_ns, pb_ns, pb_ns / wire_ns);
+}
+
+//
+// GET REQUEST
+//
+
+static void
+bench_get_request_wire(bench_state *state) {
+    riak_operation *rop = NULL;
+    riak_operation_new(state->cxn, &rop, NULL, NULL, NULL);
+    riak_get_request_encode(rop, state->bucket, state->key, state->get_opts, &(rop->pb_request));
+    riak_operation_free(&rop);
+}
+
+// What the encoder did before the wire codec
+static void
+bench_get_request_pb(bench_state *state) {
+    riak_operation *rop = NULL;
+    riak_operation_new(state->cxn, &rop, NULL, NULL, NULL);
+    riak_config      *cfg = riak_operation_get_config(rop);
+    riak_get_options *opt = state->get_opts;
+    riak_operation_set_bucket(rop, state->bucket);
+    riak_operation_set_key(rop, state->key);
+    RpbGetReq msg = RPB_GET_REQ__INIT;
+    riak_binary_copy_to_pb(&(msg.bucket), state->bucket);
+    riak_binary_copy_to_pb(&(msg.key), state->key);
+    msg.has_r             = opt->has_r;             msg.r             = opt->r;
+    msg.has_pr            = opt->has_pr;            msg.pr            = opt->pr;
+    msg.has_basic_quorum  = opt->has_basic_quorum;  msg.basic_quorum  = opt->basic_quorum;
+    msg.has_notfound_ok   = opt->has_notfound_ok;   msg.notfound_ok   = opt->notfound_ok;
+    msg.has_timeout       = opt->has_timeout;       msg.timeout       = opt->timeout;
+    msg.has_n_val         = opt->has_n_val;         msg.n_val         = opt->n_val;
+    riak_size_t   msglen = rpb_get_req__get_packed_size(&msg);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    rpb_get_req__pack(&msg, msgbuf);
+    rop->pb_request = riak_pb_message_new(cfg, MSG_RPBGETREQ, msglen, msgbuf);
+    riak_operation_free(&rop);
+}
+
+//
+// PUT REQUEST
+//
+
+static void
+bench_put_request_wire(bench_state *state) {
+    riak_operation *rop = NULL;
+    riak_operation_new(state->cxn, &rop, NULL, NULL, NULL);
+    riak_put_request_encode(rop, state->obj, state->put_opts, &(rop->pb_request));
+    riak_operation_free(&rop);
+}
+
+// What the encoder did before the wire codec
+static void
+bench_put_request_pb(bench_state *state) {
+    riak_operation *rop = NULL;
+    riak_operation_new(state->cxn, &rop, NULL, NULL, NULL);
+    riak_config      *cfg = riak_operation_get_config(rop);
+    riak_put_options *opt = state->put_opts;
+    RpbPutReq msg = RPB_PUT_REQ__INIT;
+    riak_binary_copy_to_pb(&(msg.bucket), riak_object_get_bucket(state->obj));
+    msg.has_key = RIAK_TRUE;
+    riak_binary_copy_to_pb(&(msg.key), riak_object_get_key(state->obj));
+    RpbContent content;
+    riak_object_to_pb_copy(cfg, &content, state->obj);
+    msg.content = &content;
+    msg.has_vclock      = opt->has_vclock;
+    riak_binary_copy_to_pb(&(msg.vclock), opt->vclock);
+    msg.has_w           = opt->has_w;           msg.w           = opt->w;
+    msg.has_dw          = opt->has_dw;          msg.dw          = opt->dw;
+    msg.has_return_body = opt->has_return_body; msg.return_body = opt->return_body;
+    riak_size_t   msglen = rpb_put_req__get_packed_size(&msg);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    rpb_put_req__pack(&msg, msgbuf);
+    riak_object_free_pb(cfg, &content);
+    rop->pb_request = riak_pb_message_new(cfg, MSG_RPBPUTREQ, msglen, msgbuf);
+    riak_operation_free(&rop);
+}
+
+//
+// GET RESPONSE
+//
+
+static void
+bench_get_response_wire(bench_state *state) {
+    riak_operation *rop = NULL;
+    riak_operation_new(state->cxn, &rop, NULL, NULL, NULL);
+    riak_pb_message pbresp;
+    pbresp.msgid = MSG_RPBGETRESP;
+    pbresp.len   = state->get_resp_len;
+    pbresp.data  = state->get_resp;
+    riak_get_response *response = NULL;
+    riak_boolean_t     done     = RIAK_FALSE;
+    riak_get_response_decode(rop, &pbresp, &response, &done);
+    riak_get_response_free(riak_operation_get_config(rop), &response);
+    riak_operation_free(&rop);
+}
+
+// Lazy decode, reading only the value
+static void
+bench_get_response_view(bench_state *state) {
+    riak_get_view *view = NULL;
+    riak_get_view_new(state->cfg, &view, NULL, NULL, state->get_resp + 1, state->get_resp_len - 1);
+    riak_object_view_get_value(riak_get_view_get_content(view, 0));
+    riak_get_view_free(state->cfg, &view);
+}
+
+// Unpacking alone, before any riak_object is built from it
+static void
+bench_get_response_pb(bench_state *state) {
+    RpbGetResp *resp = rpb_get_resp__unpack(state->cfg->pb_allocator, state->get_resp_len - 1, state->get_resp + 1);
+    rpb_get_resp__free_unpacked(resp, state->cfg->pb_allocator);
+}
+
+/**
+ * @brief Encode a one-sibling RpbGetResp shaped like a typical JSON fetch
+ */
+static void
+bench_build_get_resp(bench_state *state) {
+    riak_binary *value        = riak_object_get_value(state->obj);
+    riak_binary *content_type = riak_object_get_content_type(state->obj);
+    riak_binary *meta_key     = riak_binary_copy_from_string(state->cfg, "X-Riak-Meta-Owner");
+    riak_binary *meta_value   = riak_binary_copy_from_string(state->cfg, "benchmark");
+    RpbPair     meta = RPB_PAIR__INIT;
+    RpbPair    *metas[1] = { &meta };
+    BENCH_PB(meta.key, meta_key)
+    meta.has_value = RIAK_TRUE;
+    BENCH_PB(meta.value, meta_value)
+    RpbContent  content = RPB_CONTENT__INIT;
+    RpbContent *contents[1] = { &content };
+    BENCH_PB(content.value, value)
+    content.has_content_type = RIAK_TRUE;
+    BENCH_PB(content.content_type, content_type)
+    content.has_last_mod = RIAK_TRUE;
+    content.last_mod     = 1386540290;
+    content.n_usermeta   = 1;
+    content.usermeta     = metas;
+    RpbGetResp msg = RPB_GET_RESP__INIT;
+    msg.n_content  = 1;
+    msg.content    = contents;
+    msg.has_vclock = RIAK_TRUE;
+    BENCH_PB(msg.vclock, state->vclock)
+    state->get_resp_len = rpb_get_resp__get_packed_size(&msg) + 1;
+    state->get_resp     = (riak_uint8_t*)malloc(state->get_resp_len);
+    state->get_resp[0]  = MSG_RPBGETRESP;
+    rpb_get_resp__pack(&msg, state->get_resp + 1);
+    riak_binary_free(state->cfg, &meta_key);
+    riak_binary_free(state->cfg, &meta_value);
+}
+
+int
+main(int   argc,
+     char *argv[]) {
+    riak_uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    if (argc > 1) {
+        iterations = (riak_uint32_t)strtoul(argv[1], NULL, 10);
+    }
+    if (iterations == 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    bench_state state;
+    memset(&state, '\0', sizeof(state));
+    riak_error err = riak_config_new_default(&(state.cfg));
+    if (err) {
+        fprintf(stderr, "Could not create a configuration: %s\n", riak_strerror(err));
+        return 1;
+    }
+    // Nothing is sent, so the connection never needs to come up
+    riak_connection_new(state.cfg, &(state.cxn), "localhost", "1", NULL);
+    if (state.cxn == NULL) {
+        fprintf(stderr, "%s\n", "Could not create a connection");
+        return 1;
+    }
+    riak_config *cfg = state.cfg;
+    state.bucket = riak_binary_copy_from_string(cfg, "benchmark");
+    state.key    = riak_binary_copy_from_string(cfg, "user:000042");
+    state.vclock = riak_binary_copy_from_string(cfg, "a85hYGBgzGDKBVIcR8M2cgel2FtDfIEZTJmJeawMCbpzz/JlAQA=");
+
+    state.get_opts = riak_get_options_new(cfg);
+    riak_get_options_set_r(state.get_opts, 2);
+    riak_get_options_set_notfound_ok(state.get_opts, RIAK_TRUE);
+    riak_get_options_set_timeout(state.get_opts, 5000);
+
+    state.put_opts = riak_put_options_new(cfg);
+    riak_put_options_set_vclock(cfg, state.put_opts, state.vclock);
+    riak_put_options_set_w(state.put_opts, 2);
+    riak_put_options_set_dw(state.put_opts, 1);
+    riak_put_options_set_return_body(state.put_opts, RIAK_FALSE);
+
+    riak_uint8_t value[BENCH_VALUE_LEN];
+    memset(value, 'v', sizeof(value));
+    state.obj = riak_object_new(cfg);
+    riak_object_set_bucket(state.obj, riak_binary_copy(cfg, state.bucket));
+    riak_object_set_key(state.obj, riak_binary_copy(cfg, state.key));
+    riak_object_set_value(state.obj, riak_binary_new(cfg, sizeof(value), value));
+    riak_object_set_content_type(state.obj, riak_binary_copy_from_string(cfg, "application/json"));
+    bench_build_get_resp(&state);
+
+    printf("%d iterations, %d byte values\n", iterations, BENCH_VALUE_LEN);
+    printf("%-20s %16s %16s %9s\n", "case", "wire codec", "protobuf-c", "speedup");
+    bench_report("get request encode",
+                 bench_run(&state, bench_get_request_wire, iterations),
+                 bench_run(&state, bench_get_request_pb, iterations));
+    bench_report("put request encode",
+                 bench_run(&state, bench_put_request_wire, iterations),
+                 bench_run(&state, bench_put_request_pb, iterations));
+    riak_float64_t pb_ns = bench_run(&state, bench_get_response_pb, iterations);
+    bench_report("get response decode", bench_run(&state, bench_get_response_wire, iterations), pb_ns);
+    bench_report("get response view", bench_run(&state, bench_get_response_view, iterations), pb_ns);
+
+    free(state.get_resp);
+    riak_object_free(cfg, &(state.obj));
+    riak_put_options_free(cfg, &(state.put_opts));
+    riak_get_options_free(cfg, &(state.get_opts));
+    riak_binary_free(cfg, &(state.vclock));
+    riak_binary_free(cfg, &(state.key));
+    riak_binary_free(cfg, &(state.bucket));
+    riak_connection_free(&(state.cxn));
+    riak_config_free(&cfg);
+    return 0;
+}
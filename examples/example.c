@@ -81,6 +81,48 @@ example_log(void            *ptr,
 
 
 
+//********************************************************************/
+// Bulk load source
+//********************************************************************/
+typedef struct {
+    FILE       *fp;
+    const char *bucket;
+} example_bulk_data;
+
+// Read the next "key<TAB>value" line into a new object
+riak_error
+example_bulk_source(riak_config  *cfg,
+                    riak_object **object,
+                    void         *ptr) {
+    example_bulk_data *datum = (example_bulk_data*)ptr;
+    char line[4096];
+    *object = NULL;
+    while (fgets(line, sizeof(line), datum->fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *value = strchr(line, '\t');
+        if (value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        riak_object *obj = riak_object_new(cfg);
+        if (obj == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        riak_object_set_bucket(obj, riak_binary_copy_from_string(cfg, datum->bucket));
+        riak_object_set_key(obj, riak_binary_copy_from_string(cfg, line));
+        riak_object_set_value(obj, riak_binary_copy_from_string(cfg, value));
+        if (riak_object_get_bucket(obj) == NULL ||
+            riak_object_get_key(obj) == NULL ||
+            riak_object_get_value(obj) == NULL) {
+            riak_object_free(cfg, &obj);
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        *object = obj;
+        break;
+    }
+    return ERIAK_OK;
+}
+
 //********************************************************************/
 // main application
 //********************************************************************/
@@ -274,6 +316,34 @@ main(int   argc,
                 exit(1);
             }
             break;
+        case RIAK_COMMAND_BULKLOAD:
+            {
+                example_bulk_data bulk = { stdin, args.bucket };
+                if (strcmp(args.value, "-") != 0) {
+                    bulk.fp = fopen(args.value, "r");
+                    if (bulk.fp == NULL) {
+                        fprintf(stderr, "Could not open %s\n", args.value);
+                        exit(1);
+                    }
+                }
+                riak_connection_pool *pool = NULL;
+                err = riak_connection_pool_new(cfg, &pool, args.host, args.portnum, NULL, RIAK_BULK_DEFAULT_CONCURRENCY);
+                if (err == ERIAK_OK) {
+                    riak_bulk_stats stats;
+                    err = riak_bulk_load(pool, NULL, NULL, example_bulk_source, &bulk, &stats);
+                    riak_bulk_stats_print(&stats, output, sizeof(output));
+                    printf("%s\n", output);
+                    riak_connection_pool_free(&pool);
+                }
+                if (bulk.fp != stdin) {
+                    fclose(bulk.fp);
+                }
+            }
+            if (err) {
+                fprintf(stderr, "Bulk Load Problems [%s]\n", riak_strerror(err));
+                exit(1);
+            }
+            break;
         case RIAK_COMMAND_DEL:
             delete_options = riak_delete_options_new(cfg);
             if (delete_options == NULL) {
@@ -48,6 +48,8 @@ struct _riak_command {
 static riak_command s_commands[] = {
     // These options set a flag.
     {"2i",           "Secondary index query",        NULL, RIAK_COMMAND_INDEX,         RIAK_TRUE,  RIAK_FALSE, RIAK_TRUE,  RIAK_TRUE},
+    {"bulk-load",    "Store key<TAB>value lines from the --value file (- for stdin)",
+                                                     NULL, RIAK_COMMAND_BULKLOAD,      RIAK_TRUE,  RIAK_FALSE, RIAK_TRUE,  RIAK_FALSE},
     {"delete",       "Delete a key",                 NULL, RIAK_COMMAND_DEL,           RIAK_TRUE,  RIAK_TRUE,  RIAK_FALSE, RIAK_FALSE},
     {"get-bucket",   "Fetch bucket properties",      NULL, RIAK_COMMAND_GETBUCKET,     RIAK_TRUE,  RIAK_FALSE, RIAK_FALSE, RIAK_FALSE},
     {"get-clientid", "Fetch client identifier",      NULL, RIAK_COMMAND_GETCLIENTID,   RIAK_FALSE, RIAK_FALSE, RIAK_FALSE, RIAK_FALSE},
@@ -53,6 +53,7 @@ typedef enum {
     RIAK_COMMAND_DTFETCH,
     RIAK_COMMAND_DTUPDATE,
     RIAK_COMMAND_AUTH,
+    RIAK_COMMAND_BULKLOAD,
 } riak_command_msg;
 
 typedef struct _riak_command riak_command;
@@ -0,0 +1,561 @@
+/*********************************************************************
+ *
+ * riak_epoll.c: Built-in edge-triggered epoll reactor (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include "riak.h"
+#include "riak_network.h"
+#include "riak_epoll.h"
+#include "riak_utils-internal.h"
+#include "riak_epoll-internal.h"
+
+static void
+riak_epoll_pending_free(riak_epoll          *ep,
+                        riak_epoll_pending **entry) {
+    riak_operation_free(&((*entry)->rop));
+    riak_free(ep->config, entry);
+}
+
+/**
+ * @brief Schedule the timerfd for `deadline`, unless it fires sooner already
+ */
+static void
+riak_epoll_arm(riak_epoll   *ep,
+               riak_uint64_t deadline) {
+    if (deadline == 0 || (ep->next_deadline != 0 && ep->next_deadline <= deadline)) {
+        return;
+    }
+    riak_uint64_t now  = riak_get_time_ms();
+    riak_uint64_t wait = (deadline > now) ? deadline - now : 0;
+    struct itimerspec its;
+    memset(&its, '\0', sizeof(its));
+    its.it_value.tv_sec  = wait / 1000;
+    // A zero value would disarm the timer instead
+    its.it_value.tv_nsec = (wait % 1000) * 1000000 + 1;
+    if (timerfd_settime(ep->timerfd, 0, &its, NULL) == 0) {
+        ep->next_deadline = deadline;
+    }
+}
+
+static void
+riak_epoll_channel_detach(riak_epoll_channel *channel) {
+    if (channel->fd >= 0) {
+        epoll_ctl(channel->ep->epfd, EPOLL_CTL_DEL, channel->fd, NULL);
+        riak_set_blocking(channel->fd, RIAK_TRUE);
+        channel->fd = -1;
+    }
+    channel->out_start = channel->out_end = 0;
+    channel->generation++;
+}
+
+/**
+ * @brief Register the channel's socket with epoll, reconnecting if needed
+ * @note Reconnecting blocks for the connect
+ */
+static riak_error
+riak_epoll_channel_attach(riak_epoll_channel *channel) {
+    if (channel->broken || riak_connection_get_fd(channel->cxn) < 0) {
+        riak_error err = riak_connection_reconnect(channel->cxn);
+        if (err) {
+            return err;
+        }
+        channel->broken = RIAK_FALSE;
+    }
+    riak_socket_t fd = riak_connection_get_fd(channel->cxn);
+    riak_error err = riak_set_blocking(fd, RIAK_FALSE);
+    if (err) {
+        return err;
+    }
+    struct epoll_event event;
+    memset(&event, '\0', sizeof(event));
+    event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = ((riak_uint64_t)channel->index << 32) | channel->generation;
+    if (epoll_ctl(channel->ep->epfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        riak_log_error(channel->cxn, "epoll_ctl: %s", strerror(errno));
+        riak_set_blocking(fd, RIAK_TRUE);
+        return ERIAK_EVENT;
+    }
+    channel->fd = fd;
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Abandon a connection, failing everything queued on it
+ * @note The socket is reconnected lazily, on the channel's next send
+ */
+static void
+riak_epoll_channel_fail(riak_epoll_channel *channel,
+                        riak_error          err) {
+    riak_epoll_channel_detach(channel);
+    channel->broken = RIAK_TRUE;
+    // Detach the queue first; error callbacks may send again
+    riak_epoll_pending *entry = channel->head;
+    channel->head = channel->tail = NULL;
+    channel->n_pending = 0;
+    while (entry) {
+        riak_epoll_pending *next = entry->next;
+        riak_operation_report_error(entry->rop, err);
+        riak_epoll_pending_free(channel->ep, &entry);
+        entry = next;
+    }
+}
+
+static riak_ssize_t
+riak_epoll_read_cb(void       *ptr,
+                   void       *data,
+                   riak_size_t size) {
+    riak_epoll_channel *channel = (riak_epoll_channel*)ptr;
+    if (channel->fd < 0) {
+        return -1;
+    }
+    while (RIAK_TRUE) {
+        riak_ssize_t got = read(channel->fd, data, size);
+        if (got > 0) {
+            return got;
+        }
+        if (got == 0) {
+            return -1;  // Peer closed with replies outstanding
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+}
+
+/**
+ * @brief Append unsent bytes to the channel's write-back buffer
+ */
+static riak_error
+riak_epoll_buffer(riak_epoll_channel *channel,
+                  riak_uint8_t       *data,
+                  riak_size_t         len) {
+    if (channel->out_end + len > channel->out_size) {
+        riak_size_t live = channel->out_end - channel->out_start;
+        riak_size_t size = channel->out_size * 2;
+        if (size < live + len) size = live + len;
+        if (size < RIAK_EPOLL_MIN_OUTBUF) size = RIAK_EPOLL_MIN_OUTBUF;
+        riak_uint8_t *outbuf = (riak_uint8_t*)riak_config_allocate(channel->ep->config, size);
+        if (outbuf == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        if (live > 0) {
+            memcpy(outbuf, channel->outbuf + channel->out_start, live);
+        }
+        riak_free(channel->ep->config, &(channel->outbuf));
+        channel->outbuf    = outbuf;
+        channel->out_size  = size;
+        channel->out_start = 0;
+        channel->out_end   = live;
+    }
+    memcpy(channel->outbuf + channel->out_end, data, len);
+    channel->out_end += len;
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Write straight to the socket, keeping only what it refuses
+ */
+static riak_ssize_t
+riak_epoll_writev_cb(void         *ptr,
+                     struct iovec *iov,
+                     int           iovcnt) {
+    riak_epoll_channel *channel = (riak_epoll_channel*)ptr;
+    riak_ssize_t total = 0;
+    int i;
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    riak_ssize_t wrote = 0;
+    // Anything already buffered must go first
+    if (channel->out_start == channel->out_end) {
+        struct msghdr msg;
+        memset(&msg, '\0', sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = iovcnt;
+        do {
+            wrote = sendmsg(channel->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        } while (wrote < 0 && errno == EINTR);
+        if (wrote < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+            wrote = 0;
+        }
+    }
+    for (i = 0; i < iovcnt; i++) {
+        riak_size_t len = iov[i].iov_len;
+        if (wrote >= len) {
+            wrote -= len;
+            continue;
+        }
+        if (riak_epoll_buffer(channel, (riak_uint8_t*)iov[i].iov_base + wrote, len - wrote) != ERIAK_OK) {
+            return -1;
+        }
+        wrote = 0;
+    }
+    return total;
+}
+
+static riak_error
+riak_epoll_channel_flush(riak_epoll_channel *channel) {
+    while (channel->out_start < channel->out_end) {
+        riak_ssize_t wrote = send(channel->fd,
+                                  channel->outbuf + channel->out_start,
+                                  channel->out_end - channel->out_start,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (wrote < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return ERIAK_WRITE;
+        }
+        channel->out_start += wrote;
+    }
+    if (channel->out_start == channel->out_end) {
+        channel->out_start = channel->out_end = 0;
+    }
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Decode replies until the socket runs dry
+ */
+static void
+riak_epoll_channel_readable(riak_epoll_channel *channel) {
+    riak_epoll *ep = channel->ep;
+    while (channel->head && channel->fd >= 0) {
+        // Off the queue while its callbacks run, which may fail the channel
+        riak_epoll_pending *entry = channel->head;
+        channel->head = entry->next;
+        if (channel->head == NULL) {
+            channel->tail = NULL;
+        }
+        channel->n_pending--;
+
+        riak_boolean_t done = RIAK_FALSE;
+        riak_error err = riak_read(entry->rop, &done, riak_epoll_read_cb, (void*)channel);
+        // Server errors are per operation and leave the framing intact
+        if (err == ERIAK_OK && !done && channel->fd >= 0) {
+            entry->next = channel->head;
+            channel->head = entry;
+            if (channel->tail == NULL) {
+                channel->tail = entry;
+            }
+            channel->n_pending++;
+            return;  // Wait for the rest of this reply
+        }
+        if (err == ERIAK_OK && !done) {
+            err = ERIAK_READ;
+        }
+        if (err != ERIAK_OK && err != ERIAK_SERVER_ERROR) {
+            riak_operation_report_error(entry->rop, err);
+            riak_epoll_pending_free(ep, &entry);
+            riak_epoll_channel_fail(channel, err);
+            return;
+        }
+        riak_epoll_pending_free(ep, &entry);
+    }
+}
+
+/**
+ * @brief Fail every channel holding an operation past its deadline
+ */
+static void
+riak_epoll_expire(riak_epoll *ep) {
+    riak_uint64_t expirations;
+    while (read(ep->timerfd, &expirations, sizeof(expirations)) > 0) {}
+    riak_uint64_t now = riak_get_time_ms();
+    ep->next_deadline = 0;
+    riak_uint32_t i;
+    for (i = 0; i < ep->n_channels; i++) {
+        riak_epoll_channel *channel = &(ep->channels[i]);
+        riak_epoll_pending *entry;
+        for (entry = channel->head; entry; entry = entry->next) {
+            if (entry->deadline != 0 && entry->deadline <= now) {
+                riak_log_warn(channel->cxn, "%s", "Operation timed out");
+                // Replies are ordered, so everything behind it fails too
+                riak_epoll_channel_fail(channel, ERIAK_TIMEOUT);
+                break;
+            }
+        }
+    }
+    for (i = 0; i < ep->n_channels; i++) {
+        riak_epoll_pending *entry;
+        for (entry = ep->channels[i].head; entry; entry = entry->next) {
+            riak_epoll_arm(ep, entry->deadline);
+        }
+    }
+}
+
+riak_error
+riak_epoll_new(riak_config          *cfg,
+               riak_epoll          **ep_target,
+               riak_connection_pool *pool,
+               riak_uint32_t         n_channels) {
+    if (n_channels == 0) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_epoll *ep = (riak_epoll*)riak_config_clean_allocate(cfg, sizeof(riak_epoll));
+    if (ep == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_epoll");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    ep->config  = cfg;
+    ep->pool    = pool;
+    ep->timeout = RIAK_EPOLL_DEFAULT_TIMEOUT_MS;
+    ep->epfd    = epoll_create1(EPOLL_CLOEXEC);
+    ep->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    ep->channels = (riak_epoll_channel*)riak_config_clean_allocate(cfg, n_channels * sizeof(riak_epoll_channel));
+    *ep_target = ep;
+    if (ep->epfd < 0 || ep->timerfd < 0 || ep->channels == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not set up epoll");
+        riak_epoll_free(ep_target);
+        return ERIAK_EVENT;
+    }
+    struct epoll_event event;
+    memset(&event, '\0', sizeof(event));
+    event.events   = EPOLLIN;
+    event.data.u64 = RIAK_EPOLL_TIMER_TAG;
+    if (epoll_ctl(ep->epfd, EPOLL_CTL_ADD, ep->timerfd, &event) != 0) {
+        riak_epoll_free(ep_target);
+        return ERIAK_EVENT;
+    }
+    riak_uint32_t i;
+    for (i = 0; i < n_channels; i++) {
+        riak_epoll_channel *channel = &(ep->channels[i]);
+        channel->ep    = ep;
+        channel->fd    = -1;
+        channel->index = i;
+        ep->n_channels++;
+        riak_error err = riak_connection_pool_checkout(pool, &(channel->cxn));
+        if (err == ERIAK_OK) {
+            err = riak_epoll_channel_attach(channel);
+        }
+        if (err) {
+            riak_log_error_config(cfg, "Could not open channel %d: %s", i, riak_strerror(err));
+            riak_epoll_free(ep_target);
+            return err;
+        }
+    }
+    return ERIAK_OK;
+}
+
+void
+riak_epoll_free(riak_epoll **ep_target) {
+    if (ep_target == NULL || *ep_target == NULL) {
+        return;
+    }
+    riak_epoll  *ep  = *ep_target;
+    riak_config *cfg = ep->config;
+    riak_uint32_t i;
+    for (i = 0; i < ep->n_channels; i++) {
+        riak_epoll_channel *channel = &(ep->channels[i]);
+        if (channel->head) {
+            riak_epoll_channel_fail(channel, ERIAK_EVENT);
+        }
+        riak_epoll_channel_detach(channel);
+        riak_free(cfg, &(channel->outbuf));
+        if (channel->cxn == NULL) {
+            continue;
+        }
+        // Replies to failed operations may still be on the wire
+        if (channel->broken || riak_connection_get_fd(channel->cxn) < 0) {
+            riak_connection_pool_evict(ep->pool, &(channel->cxn));
+        } else {
+            riak_connection_pool_checkin(ep->pool, &(channel->cxn));
+        }
+    }
+    if (ep->timerfd >= 0) close(ep->timerfd);
+    if (ep->epfd >= 0) close(ep->epfd);
+    riak_free(cfg, &(ep->channels));
+    riak_free(cfg, ep_target);
+}
+
+void
+riak_epoll_set_timeout(riak_epoll   *ep,
+                       riak_uint32_t timeout) {
+    ep->timeout = timeout;
+}
+
+int
+riak_epoll_get_fd(riak_epoll *ep) {
+    return ep->epfd;
+}
+
+riak_uint32_t
+riak_epoll_get_n_channels(riak_epoll *ep) {
+    return ep->n_channels;
+}
+
+riak_connection*
+riak_epoll_get_connection(riak_epoll   *ep,
+                          riak_uint32_t index) {
+    return ep->channels[index].cxn;
+}
+
+riak_uint32_t
+riak_epoll_get_n_pending(riak_epoll *ep) {
+    riak_uint32_t n = 0;
+    riak_uint32_t i;
+    for (i = 0; i < ep->n_channels; i++) {
+        n += ep->channels[i].n_pending;
+    }
+    return n;
+}
+
+riak_error
+riak_epoll_operation_new(riak_epoll             *ep,
+                         riak_operation        **rop,
+                         riak_response_callback  response_cb,
+                         riak_response_callback  error_cb,
+                         void                   *cb_data) {
+    riak_epoll_channel *best = &(ep->channels[0]);
+    riak_uint32_t i;
+    for (i = 1; i < ep->n_channels; i++) {
+        if (ep->channels[i].n_pending < best->n_pending) {
+            best = &(ep->channels[i]);
+        }
+    }
+    return riak_operation_new(best->cxn, rop, response_cb, error_cb, cb_data);
+}
+
+riak_error
+riak_epoll_send(riak_epoll     *ep,
+                riak_operation *rop) {
+    riak_connection    *cxn     = riak_operation_get_connection(rop);
+    riak_epoll_channel *channel = NULL;
+    riak_uint32_t i;
+    for (i = 0; i < ep->n_channels; i++) {
+        if (ep->channels[i].cxn == cxn) {
+            channel = &(ep->channels[i]);
+            break;
+        }
+    }
+    if (channel == NULL) {
+        riak_log_error_config(ep->config, "%s", "Operation does not belong to this reactor");
+        riak_operation_free(&rop);
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_error err = ERIAK_OK;
+    if (channel->fd < 0) {
+        err = riak_epoll_channel_attach(channel);
+        if (err) {
+            riak_operation_free(&rop);
+            return err;
+        }
+    }
+    riak_epoll_pending *entry = (riak_epoll_pending*)riak_config_clean_allocate(ep->config, sizeof(riak_epoll_pending));
+    if (entry == NULL) {
+        riak_operation_free(&rop);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    entry->rop = rop;
+    riak_uint32_t timeout = riak_operation_get_timeout(rop);
+    if (timeout == 0) {
+        timeout = ep->timeout;
+    }
+    if (timeout > 0) {
+        entry->deadline = riak_get_time_ms() + timeout;
+    }
+    err = riak_writev(rop, riak_epoll_writev_cb, (void*)channel);
+    if (err) {
+        riak_epoll_pending_free(ep, &entry);
+        // A partial frame poisons everything queued behind it
+        riak_epoll_channel_fail(channel, err);
+        return err;
+    }
+    if (channel->tail) {
+        channel->tail->next = entry;
+    } else {
+        channel->head = entry;
+    }
+    channel->tail = entry;
+    channel->n_pending++;
+    riak_epoll_arm(ep, entry->deadline);
+    return ERIAK_OK;
+}
+
+riak_error
+riak_epoll_run_once(riak_epoll *ep,
+                    int         timeout) {
+    struct epoll_event events[RIAK_EPOLL_MAX_EVENTS];
+    int n = epoll_wait(ep->epfd, events, RIAK_EPOLL_MAX_EVENTS, timeout);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return ERIAK_OK;
+        }
+        riak_log_error_config(ep->config, "epoll_wait: %s", strerror(errno));
+        return ERIAK_EVENT;
+    }
+    int i;
+    for (i = 0; i < n; i++) {
+        riak_uint64_t tag = events[i].data.u64;
+        if (tag == RIAK_EPOLL_TIMER_TAG) {
+            riak_epoll_expire(ep);
+            continue;
+        }
+        riak_uint32_t index = (riak_uint32_t)(tag >> 32);
+        if (index >= ep->n_channels) {
+            continue;
+        }
+        riak_epoll_channel *channel = &(ep->channels[index]);
+        // Reported for a socket this channel has since dropped
+        if (channel->fd < 0 || (riak_uint32_t)tag != channel->generation) {
+            continue;
+        }
+        riak_uint32_t what = events[i].events;
+        if ((what & EPOLLOUT) && riak_epoll_channel_flush(channel) != ERIAK_OK) {
+            riak_epoll_channel_fail(channel, ERIAK_WRITE);
+            continue;
+        }
+        if (what & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            riak_epoll_channel_readable(channel);
+        }
+        if (channel->fd >= 0 && (what & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+            if (channel->head) {
+                riak_epoll_channel_fail(channel, ERIAK_READ);
+            } else {
+                // Idle socket closed by the server; reconnect on next use
+                riak_epoll_channel_detach(channel);
+                channel->broken = RIAK_TRUE;
+            }
+        }
+    }
+    return ERIAK_OK;
+}
+
+riak_error
+riak_epoll_run(riak_epoll *ep) {
+    while (riak_epoll_get_n_pending(ep) > 0) {
+        riak_error err = riak_epoll_run_once(ep, -1);
+        if (err) {
+            return err;
+        }
+    }
+    return ERIAK_OK;
+}
+
+#endif // __linux__
@@ -0,0 +1,150 @@
+/*********************************************************************
+ *
+ * riak_epoll.h: Built-in edge-triggered epoll reactor (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_EPOLL_H
+#define _RIAK_EPOLL_H
+
+#ifdef __linux__
+
+#include "riak.h"
+
+typedef struct _riak_epoll riak_epoll;
+
+#define RIAK_EPOLL_DEFAULT_TIMEOUT_MS 5000
+
+/**
+ * @brief Construct a reactor over pooled connections
+ * @param cfg Riak Configuration
+ * @param ep Riak Epoll reactor (out)
+ * @param pool Connections are checked out for the reactor's lifetime
+ * @param n_channels Number of connections to multiplex operations over
+ * @returns Error code
+ * @note Sockets are switched to non-blocking mode until the reactor is freed
+ */
+riak_error
+riak_epoll_new(riak_config          *cfg,
+               riak_epoll          **ep,
+               riak_connection_pool *pool,
+               riak_uint32_t         n_channels);
+
+/**
+ * @brief Release the reactor, failing any operations still in flight
+ * @param ep Riak Epoll reactor (NULLed on return)
+ * @note Must not be called from inside an operation's callback
+ */
+void
+riak_epoll_free(riak_epoll **ep);
+
+/**
+ * @brief Default bound on each operation's round trip
+ * @param ep Riak Epoll reactor
+ * @param timeout Milliseconds, used when the operation sets none (0 for no limit)
+ */
+void
+riak_epoll_set_timeout(riak_epoll   *ep,
+                       riak_uint32_t timeout);
+
+/**
+ * @brief File descriptor to embed the reactor in another event loop
+ * @param ep Riak Epoll reactor
+ * @returns An epoll fd; when it polls readable, call `riak_epoll_run_once(ep, 0)`
+ */
+int
+riak_epoll_get_fd(riak_epoll *ep);
+
+/**
+ * @brief Number of connections operations are spread over
+ * @param ep Riak Epoll reactor
+ * @returns Channel count
+ */
+riak_uint32_t
+riak_epoll_get_n_channels(riak_epoll *ep);
+
+/**
+ * @brief One of the reactor's connections, to build operations on directly
+ * @param ep Riak Epoll reactor
+ * @param index Channel number, below `riak_epoll_get_n_channels`
+ * @returns Riak Connection, fixed for the reactor's lifetime
+ * @note Safe to call from any thread, unlike the rest of this API
+ */
+riak_connection*
+riak_epoll_get_connection(riak_epoll   *ep,
+                          riak_uint32_t index);
+
+/**
+ * @brief Number of operations sent but not yet completed
+ * @param ep Riak Epoll reactor
+ * @returns Count across every channel
+ */
+riak_uint32_t
+riak_epoll_get_n_pending(riak_epoll *ep);
+
+/**
+ * @brief Construct an operation on the reactor's least busy channel
+ * @param ep Riak Epoll reactor
+ * @param rop Riak Operation (out)
+ * @param response_cb Called with the response once it has fully arrived
+ * @param error_cb Called on server, network or timeout errors
+ * @param cb_data Passed to both callbacks
+ * @returns Error code
+ * @note Register the request (e.g. `riak_async_register_get`) before sending
+ */
+riak_error
+riak_epoll_operation_new(riak_epoll             *ep,
+                         riak_operation        **rop,
+                         riak_response_callback  response_cb,
+                         riak_response_callback  error_cb,
+                         void                   *cb_data);
+
+/**
+ * @brief Write an operation's request without waiting for its reply
+ * @param ep Riak Epoll reactor
+ * @param rop Operation made by `riak_epoll_operation_new`
+ * @returns Error code
+ * @note The reactor owns and frees `rop`, even on error; exactly one of
+ * its callbacks runs from `riak_epoll_run_once` unless this returns an error
+ */
+riak_error
+riak_epoll_send(riak_epoll     *ep,
+                riak_operation *rop);
+
+/**
+ * @brief Handle whatever I/O and timers are ready
+ * @param ep Riak Epoll reactor
+ * @param timeout Milliseconds to wait for an event (0 to poll, -1 to block)
+ * @returns Error code (ERIAK_EVENT if epoll itself failed)
+ */
+riak_error
+riak_epoll_run_once(riak_epoll *ep,
+                    int         timeout);
+
+/**
+ * @brief Drive the reactor until no operations are pending
+ * @param ep Riak Epoll reactor
+ * @returns Error code
+ */
+riak_error
+riak_epoll_run(riak_epoll *ep);
+
+#endif // __linux__
+
+#endif // _RIAK_EPOLL_H
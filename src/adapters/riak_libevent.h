@@ -125,8 +125,11 @@ riak_libevent_result_cb(struct bufferevent *bev,
                                &done_streaming,
                                riak_libevent_read_cb,
                                (void*)event);
-    // TODO: How do we communicate back a read error?
-    (void)err;
+    // Server errors already reached the error callback
+    if (err != ERIAK_OK && err != ERIAK_SERVER_ERROR) {
+        riak_operation_report_error(rop, err);
+        done_streaming = RIAK_TRUE;
+    }
 
 #ifdef _RIAK_DEBUG
     // What has been queued up
@@ -136,6 +139,7 @@ riak_libevent_result_cb(struct bufferevent *bev,
 
     if (done_streaming) {
         bufferevent_free(bev);
+        event->bevent = NULL;
     }
 }
 
@@ -210,3 +214,439 @@ riak_libevent_send(riak_operation *rop,
                       riak_libevent_write_cb,
                       (void*)rev);
 }
+
+// Persistent engine: many operations in flight per event base, each
+// pooled connection keeping its own bufferevent and ordered reply queue
+
+#define RIAK_LIBEVENT_DEFAULT_TIMEOUT_MS 5000
+
+typedef struct _riak_libevent_engine riak_libevent_engine;
+typedef struct _riak_libevent_channel riak_libevent_channel;
+
+typedef struct _riak_libevent_pending {
+    riak_operation                *rop;
+    struct event                  *timer;
+    riak_libevent_channel         *channel;
+    struct _riak_libevent_pending *next;
+} riak_libevent_pending;
+
+struct _riak_libevent_channel {
+    riak_libevent_engine  *engine;
+    riak_connection       *cxn;
+    struct bufferevent    *bevent;   // NULL until first send or after a failure
+    riak_libevent_pending *head;     // Replies arrive in this order
+    riak_libevent_pending *tail;
+    riak_uint32_t          n_pending;
+    riak_uint32_t          n_failures; // Bumped each time the queue is abandoned
+    riak_boolean_t         broken;   // Reconnect before the next send
+};
+
+void
+riak_libevent_engine_free(riak_libevent_engine **engine_target);
+
+struct _riak_libevent_engine {
+    riak_config           *config;
+    struct event_base     *base;
+    riak_connection_pool  *pool;
+    riak_libevent_channel *channels;
+    riak_uint32_t          n_channels;
+    riak_uint32_t          timeout;  // Default per-operation timeout, in ms
+};
+
+/**
+ * @brief Free an operation the engine no longer tracks
+ * @param entry Pending entry, whose timer is also released
+ */
+void
+riak_libevent_pending_free(riak_libevent_pending **entry_target) {
+    riak_libevent_pending *entry = *entry_target;
+    riak_config *cfg = entry->channel->engine->config;
+    if (entry->timer) {
+        event_free(entry->timer);
+    }
+    riak_operation_free(&(entry->rop));
+    riak_free(cfg, entry_target);
+}
+
+/**
+ * @brief Abandon a connection, failing everything queued on it
+ * @param channel Engine channel
+ * @param err Error code reported to each operation's error callback
+ * @note The socket is reconnected lazily, on the channel's next send
+ */
+void
+riak_libevent_channel_fail(riak_libevent_channel *channel,
+                           riak_error             err) {
+    if (channel->bevent) {
+        bufferevent_free(channel->bevent);
+        channel->bevent = NULL;
+    }
+    channel->broken = RIAK_TRUE;
+    channel->n_failures++;
+    // Detach the queue first; error callbacks may send again
+    riak_libevent_pending *entry = channel->head;
+    channel->head = channel->tail = NULL;
+    channel->n_pending = 0;
+    while (entry) {
+        riak_libevent_pending *next = entry->next;
+        riak_operation_report_error(entry->rop, err);
+        riak_libevent_pending_free(&entry);
+        entry = next;
+    }
+}
+
+riak_ssize_t
+riak_libevent_channel_read_cb(void       *ptr,
+                              void       *data,
+                              riak_size_t size) {
+    riak_libevent_channel *channel = (riak_libevent_channel*)ptr;
+    return bufferevent_read(channel->bevent, data, size);
+}
+
+riak_ssize_t
+riak_libevent_channel_writev_cb(void         *ptr,
+                                struct iovec *iov,
+                                int           iovcnt) {
+    riak_libevent_channel *channel = (riak_libevent_channel*)ptr;
+    riak_ssize_t wrote = 0;
+    int i;
+    for (i = 0; i < iovcnt; i++) {
+        if (bufferevent_write(channel->bevent, iov[i].iov_base, iov[i].iov_len) != 0) {
+            return -1;
+        }
+        wrote += iov[i].iov_len;
+    }
+    return wrote;
+}
+
+/**
+ * @brief Called by libevent when replies arrive on a channel
+ * @param bev Libevent Bufferevent
+ * @param ptr Engine channel
+ */
+void
+riak_libevent_channel_result_cb(struct bufferevent *bev,
+                                void               *ptr) {
+    riak_libevent_channel *channel = (riak_libevent_channel*)ptr;
+    while (channel->head && channel->bevent) {
+        // Off the queue while its callbacks run, which may fail the channel
+        riak_libevent_pending *entry = channel->head;
+        channel->head = entry->next;
+        if (channel->head == NULL) {
+            channel->tail = NULL;
+        }
+        channel->n_pending--;
+
+        riak_uint32_t n_failures = channel->n_failures;
+        riak_boolean_t done = RIAK_FALSE;
+        riak_error err = riak_read(entry->rop,
+                                   &done,
+                                   riak_libevent_channel_read_cb,
+                                   (void*)channel);
+        riak_boolean_t failed = (channel->n_failures != n_failures);
+        if (err == ERIAK_OK && !done && !failed) {
+            entry->next = channel->head;
+            channel->head = entry;
+            if (channel->tail == NULL) {
+                channel->tail = entry;
+            }
+            channel->n_pending++;
+            return;  // Wait for the rest of this reply
+        }
+        if (err == ERIAK_OK && !done) {
+            err = ERIAK_READ;
+        }
+        // Server errors are per operation and leave the framing intact
+        if (err != ERIAK_OK && err != ERIAK_SERVER_ERROR) {
+            riak_operation_report_error(entry->rop, err);
+            riak_libevent_pending_free(&entry);
+            if (!failed) {
+                riak_libevent_channel_fail(channel, err);
+            }
+            return;
+        }
+        riak_libevent_pending_free(&entry);
+        if (failed) {
+            return;  // A callback abandoned the connection under us
+        }
+    }
+}
+
+/**
+ * @brief Called by libevent when a channel's socket closes or errors
+ * @param bev Libevent Bufferevent
+ * @param events Bitvector of events
+ * @param ptr Engine channel
+ */
+void
+riak_libevent_channel_event_cb(struct bufferevent *bev,
+                               short               events,
+                               void               *ptr) {
+    riak_libevent_channel *channel = (riak_libevent_channel*)ptr;
+    if (events & (BEV_EVENT_ERROR|BEV_EVENT_EOF)) {
+        riak_log_debug(channel->cxn, "Channel closed [events %d]", events);
+        riak_libevent_channel_fail(channel, ERIAK_READ);
+    } else if (events & BEV_EVENT_TIMEOUT) {
+        riak_libevent_channel_fail(channel, ERIAK_TIMEOUT);
+    }
+}
+
+/**
+ * @brief Called by libevent when an operation has waited too long
+ * @note Replies are ordered, so the connection is reset and every
+ * operation behind the late one fails with it
+ */
+void
+riak_libevent_pending_timeout_cb(evutil_socket_t fd,
+                                 short           what,
+                                 void           *ptr) {
+    riak_libevent_pending *entry = (riak_libevent_pending*)ptr;
+    riak_log_warn(entry->channel->cxn, "%s", "Operation timed out");
+    riak_libevent_channel_fail(entry->channel, ERIAK_TIMEOUT);
+}
+
+/**
+ * @brief Attach a bufferevent to the channel's socket, reconnecting if needed
+ * @param channel Engine channel
+ * @returns Error code
+ * @note Reconnecting blocks the event loop for the connect
+ */
+riak_error
+riak_libevent_channel_open(riak_libevent_channel *channel) {
+    if (channel->broken || riak_connection_get_fd(channel->cxn) < 0) {
+        riak_error err = riak_connection_reconnect(channel->cxn);
+        if (err) {
+            return err;
+        }
+        channel->broken = RIAK_FALSE;
+    }
+    // The connection, not the bufferevent, owns the socket
+    channel->bevent = bufferevent_socket_new(channel->engine->base,
+                                             riak_connection_get_fd(channel->cxn),
+                                             BEV_OPT_DEFER_CALLBACKS);
+    if (channel->bevent == NULL) {
+        riak_log_critical(channel->cxn, "%s", "Could not create bufferevent");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    bufferevent_setcb(channel->bevent,
+                      riak_libevent_channel_result_cb,
+                      NULL,
+                      riak_libevent_channel_event_cb,
+                      channel);
+    if (bufferevent_enable(channel->bevent, EV_READ|EV_WRITE) != 0) {
+        bufferevent_free(channel->bevent);
+        channel->bevent = NULL;
+        return ERIAK_EVENT;
+    }
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Construct an async engine over pooled connections
+ * @param cfg Riak Configuration
+ * @param engine Riak Libevent Engine (out)
+ * @param base Libevent base driving every channel
+ * @param pool Connections are checked out for the engine's lifetime
+ * @param n_channels Number of connections to multiplex operations over
+ * @returns Error code
+ */
+riak_error
+riak_libevent_engine_new(riak_config           *cfg,
+                         riak_libevent_engine **engine_target,
+                         struct event_base     *base,
+                         riak_connection_pool  *pool,
+                         riak_uint32_t          n_channels) {
+    if (n_channels == 0) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_libevent_engine *engine = (riak_libevent_engine*)riak_config_clean_allocate(cfg, sizeof(riak_libevent_engine));
+    if (engine == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_libevent_engine");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    engine->channels = (riak_libevent_channel*)riak_config_clean_allocate(cfg, n_channels * sizeof(riak_libevent_channel));
+    if (engine->channels == NULL) {
+        riak_free(cfg, &engine);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    engine->config  = cfg;
+    engine->base    = base;
+    engine->pool    = pool;
+    engine->timeout = RIAK_LIBEVENT_DEFAULT_TIMEOUT_MS;
+    *engine_target  = engine;
+    riak_uint32_t i;
+    for (i = 0; i < n_channels; i++) {
+        riak_libevent_channel *channel = &(engine->channels[i]);
+        channel->engine = engine;
+        riak_error err = riak_connection_pool_checkout(pool, &(channel->cxn));
+        if (err == ERIAK_OK) {
+            err = riak_libevent_channel_open(channel);
+        }
+        engine->n_channels++;
+        if (err) {
+            riak_log_error_config(cfg, "Could not open channel %d: %s", i, riak_strerror(err));
+            riak_libevent_engine_free(engine_target);
+            return err;
+        }
+    }
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Release the engine, failing any operations still in flight
+ * @param engine Riak Libevent Engine (NULLed on return)
+ * @note Must not be called from inside an operation's callback
+ */
+void
+riak_libevent_engine_free(riak_libevent_engine **engine_target) {
+    if (engine_target == NULL || *engine_target == NULL) {
+        return;
+    }
+    riak_libevent_engine *engine = *engine_target;
+    riak_config *cfg = engine->config;
+    riak_uint32_t i;
+    for (i = 0; i < engine->n_channels; i++) {
+        riak_libevent_channel *channel = &(engine->channels[i]);
+        if (channel->head) {
+            riak_libevent_channel_fail(channel, ERIAK_EVENT);
+        }
+        if (channel->bevent) {
+            bufferevent_free(channel->bevent);
+            channel->bevent = NULL;
+        }
+        if (channel->cxn == NULL) {
+            continue;
+        }
+        // Replies to failed operations may still be on the wire
+        if (channel->broken || riak_connection_get_fd(channel->cxn) < 0) {
+            riak_connection_pool_evict(engine->pool, &(channel->cxn));
+        } else {
+            riak_connection_pool_checkin(engine->pool, &(channel->cxn));
+        }
+    }
+    riak_free(cfg, &(engine->channels));
+    riak_free(cfg, engine_target);
+}
+
+/**
+ * @brief Default bound on each operation's round trip
+ * @param engine Riak Libevent Engine
+ * @param timeout Milliseconds, used when the operation sets none (0 for no limit)
+ */
+void
+riak_libevent_engine_set_timeout(riak_libevent_engine *engine,
+                                 riak_uint32_t         timeout) {
+    engine->timeout = timeout;
+}
+
+/**
+ * @brief Number of operations sent but not yet completed
+ * @param engine Riak Libevent Engine
+ * @returns Count across every channel
+ */
+riak_uint32_t
+riak_libevent_engine_get_n_pending(riak_libevent_engine *engine) {
+    riak_uint32_t n = 0;
+    riak_uint32_t i;
+    for (i = 0; i < engine->n_channels; i++) {
+        n += engine->channels[i].n_pending;
+    }
+    return n;
+}
+
+/**
+ * @brief Construct an operation on the engine's least busy channel
+ * @param engine Riak Libevent Engine
+ * @param rop Riak Operation (out)
+ * @param response_cb Called with the response once it has fully arrived
+ * @param error_cb Called on server, network or timeout errors
+ * @param cb_data Passed to both callbacks
+ * @returns Error code
+ * @note Register the request (e.g. `riak_async_register_get`) before sending
+ */
+riak_error
+riak_libevent_engine_operation_new(riak_libevent_engine   *engine,
+                                   riak_operation        **rop,
+                                   riak_response_callback  response_cb,
+                                   riak_response_callback  error_cb,
+                                   void                   *cb_data) {
+    riak_libevent_channel *best = &(engine->channels[0]);
+    riak_uint32_t i;
+    for (i = 1; i < engine->n_channels; i++) {
+        if (engine->channels[i].n_pending < best->n_pending) {
+            best = &(engine->channels[i]);
+        }
+    }
+    return riak_operation_new(best->cxn, rop, response_cb, error_cb, cb_data);
+}
+
+/**
+ * @brief Queue an operation's request without waiting for its reply
+ * @param engine Riak Libevent Engine
+ * @param rop Operation made by `riak_libevent_engine_operation_new`
+ * @returns Error code
+ * @note The engine owns and frees `rop`, even on error; exactly one of
+ * its callbacks runs from the event loop unless this returns an error
+ */
+riak_error
+riak_libevent_engine_send(riak_libevent_engine *engine,
+                          riak_operation       *rop) {
+    riak_connection       *cxn     = riak_operation_get_connection(rop);
+    riak_libevent_channel *channel = NULL;
+    riak_uint32_t i;
+    for (i = 0; i < engine->n_channels; i++) {
+        if (engine->channels[i].cxn == cxn) {
+            channel = &(engine->channels[i]);
+            break;
+        }
+    }
+    if (channel == NULL) {
+        riak_log_error_config(engine->config, "%s", "Operation does not belong to this engine");
+        riak_operation_free(&rop);
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_error err = ERIAK_OK;
+    if (channel->bevent == NULL) {
+        err = riak_libevent_channel_open(channel);
+        if (err) {
+            riak_operation_free(&rop);
+            return err;
+        }
+    }
+    riak_libevent_pending *entry = (riak_libevent_pending*)riak_config_clean_allocate(engine->config, sizeof(riak_libevent_pending));
+    if (entry == NULL) {
+        riak_operation_free(&rop);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    entry->rop     = rop;
+    entry->channel = channel;
+    riak_uint32_t timeout = riak_operation_get_timeout(rop);
+    if (timeout == 0) {
+        timeout = engine->timeout;
+    }
+    if (timeout > 0) {
+        entry->timer = evtimer_new(engine->base, riak_libevent_pending_timeout_cb, entry);
+        struct timeval tv;
+        tv.tv_sec  = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        if (entry->timer == NULL || evtimer_add(entry->timer, &tv) != 0) {
+            riak_libevent_pending_free(&entry);
+            return ERIAK_EVENT;
+        }
+    }
+    err = riak_writev(rop, riak_libevent_channel_writev_cb, (void*)channel);
+    if (err) {
+        riak_libevent_pending_free(&entry);
+        // A partial frame poisons everything queued behind it
+        riak_libevent_channel_fail(channel, err);
+        return err;
+    }
+    if (channel->tail) {
+        channel->tail->next = entry;
+    } else {
+        channel->head = entry;
+    }
+    channel->tail = entry;
+    channel->n_pending++;
+    return ERIAK_OK;
+}
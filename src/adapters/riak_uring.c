@@ -0,0 +1,766 @@
+/*********************************************************************
+ *
+ * riak_uring.c: Optional io_uring transport (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifdef RIAK_USE_IO_URING
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include "riak.h"
+#include "riak_uring.h"
+#include "riak_utils-internal.h"
+#include "riak_uring-internal.h"
+
+#define riak_uring_load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define riak_uring_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static int
+riak_uring_enter(riak_uring   *ur,
+                 riak_uint32_t to_submit,
+                 riak_uint32_t min_complete,
+                 int           timeout) {
+    struct io_uring_getevents_arg arg;
+    struct timespec               ts;
+    memset(&arg, '\0', sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    riak_uint32_t flags = IORING_ENTER_EXT_ARG;
+    if (min_complete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout >= 0) {
+            ts.tv_sec  = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000L;
+            arg.ts = (riak_uint64_t)(uintptr_t)&ts;
+        }
+    }
+    return (int)syscall(__NR_io_uring_enter, ur->fd, to_submit, min_complete,
+                        flags, &arg, sizeof(arg));
+}
+
+/**
+ * @brief Hand every queued SQE to the kernel without waiting
+ */
+static riak_error
+riak_uring_submit(riak_uring *ur) {
+    while (ur->n_queued > 0) {
+        int n = riak_uring_enter(ur, ur->n_queued, 0, 0);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            riak_log_error_config(ur->config, "io_uring_enter: %s", strerror(errno));
+            return ERIAK_EVENT;
+        }
+        ur->n_queued -= n;
+    }
+    return ERIAK_OK;
+}
+
+static struct io_uring_sqe*
+riak_uring_get_sqe(riak_uring *ur) {
+    riak_uint32_t tail = *(ur->sq_tail);
+    riak_uint32_t head = riak_uring_load_acquire(ur->sq_head);
+    if (tail - head > *(ur->sq_mask)) {
+        // Full; flush the batch so far
+        if (riak_uring_submit(ur) != ERIAK_OK) {
+            return NULL;
+        }
+    }
+    riak_uint32_t index = tail & *(ur->sq_mask);
+    struct io_uring_sqe *sqe = &(ur->sqes[index]);
+    memset(sqe, '\0', sizeof(*sqe));
+    ur->sq_array[index] = index;
+    riak_uring_store_release(ur->sq_tail, tail + 1);
+    ur->n_queued++;
+    return sqe;
+}
+
+static riak_uint64_t
+riak_uring_tag(riak_uring_channel *channel,
+               riak_uint64_t       kind) {
+    return (kind << 56) | ((riak_uint64_t)channel->index << 32) | channel->generation;
+}
+
+static void
+riak_uring_recycle(riak_uring   *ur,
+                   riak_uint16_t bid) {
+    riak_uint16_t mask = RIAK_URING_N_BUFFERS - 1;
+    riak_uint16_t tail = ur->buf_ring->tail;
+    struct io_uring_buf *buf = &(ur->buf_ring->bufs[tail & mask]);
+    buf->addr = (riak_uint64_t)(uintptr_t)(ur->buffers + (riak_size_t)bid * RIAK_URING_BUFFER_SIZE);
+    buf->len  = RIAK_URING_BUFFER_SIZE;
+    buf->bid  = bid;
+    riak_uring_store_release(&(ur->buf_ring->tail), (riak_uint16_t)(tail + 1));
+}
+
+static riak_error
+riak_uring_arm_recv(riak_uring_channel *channel) {
+    struct io_uring_sqe *sqe = riak_uring_get_sqe(channel->ur);
+    if (sqe == NULL) {
+        return ERIAK_EVENT;
+    }
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = channel->fd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RIAK_URING_BGID;
+    sqe->user_data = riak_uring_tag(channel, RIAK_URING_RECV);
+    channel->n_recvs++;
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_uring_arm_send(riak_uring_channel *channel) {
+    struct io_uring_sqe *sqe = riak_uring_get_sqe(channel->ur);
+    if (sqe == NULL) {
+        return ERIAK_EVENT;
+    }
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = channel->fd;
+    sqe->addr      = (riak_uint64_t)(uintptr_t)(channel->sendbuf + channel->send_start);
+    sqe->len       = channel->send_end - channel->send_start;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = riak_uring_tag(channel, RIAK_URING_SEND);
+    channel->send_busy = RIAK_TRUE;
+    return ERIAK_OK;
+}
+
+static void
+riak_uring_pending_free(riak_uring          *ur,
+                        riak_uring_pending **entry) {
+    riak_operation_free(&((*entry)->rop));
+    riak_free(ur->config, entry);
+}
+
+/**
+ * @brief Stop using the channel's socket; the kernel finishes with it on its own
+ */
+static void
+riak_uring_channel_detach(riak_uring_channel *channel) {
+    if (channel->fd >= 0) {
+        // Ends the multishot receive; its last completion is then stale
+        shutdown(channel->fd, SHUT_RDWR);
+        channel->fd = -1;
+    }
+    channel->out_end = 0;
+    channel->broken  = RIAK_TRUE;
+    channel->generation++;
+}
+
+/**
+ * @brief Abandon a connection, failing everything queued on it
+ * @note The socket is reconnected lazily, on the channel's next send
+ */
+static void
+riak_uring_channel_fail(riak_uring_channel *channel,
+                        riak_error          err) {
+    riak_uring_channel_detach(channel);
+    // Detach the queue first; error callbacks may send again
+    riak_uring_pending *entry = channel->head;
+    channel->head = channel->tail = NULL;
+    channel->n_pending = 0;
+    while (entry) {
+        riak_uring_pending *next = entry->next;
+        riak_operation_report_error(entry->rop, err);
+        riak_uring_pending_free(channel->ur, &entry);
+        entry = next;
+    }
+}
+
+/**
+ * @brief Reconnect if needed and start receiving on the channel's socket
+ * @note Reconnecting blocks for the connect
+ */
+static riak_error
+riak_uring_channel_attach(riak_uring_channel *channel) {
+    if (channel->broken || riak_connection_get_fd(channel->cxn) < 0) {
+        riak_error err = riak_connection_reconnect(channel->cxn);
+        if (err) {
+            return err;
+        }
+        channel->broken = RIAK_FALSE;
+    }
+    channel->fd = riak_connection_get_fd(channel->cxn);
+    riak_error err = riak_uring_arm_recv(channel);
+    if (err) {
+        channel->fd = -1;
+    }
+    return err;
+}
+
+static riak_ssize_t
+riak_uring_read_cb(void       *ptr,
+                   void       *data,
+                   riak_size_t size) {
+    riak_uring_channel *channel = (riak_uring_channel*)ptr;
+    if (channel->fd < 0) {
+        return -1;
+    }
+    if (size > channel->rx_len) {
+        size = channel->rx_len;
+    }
+    memcpy(data, channel->rx_data, size);
+    channel->rx_data += size;
+    channel->rx_len  -= size;
+    return size;
+}
+
+/**
+ * @brief Collect a framed request for the next batched send
+ */
+static riak_ssize_t
+riak_uring_writev_cb(void         *ptr,
+                     struct iovec *iov,
+                     int           iovcnt) {
+    riak_uring_channel *channel = (riak_uring_channel*)ptr;
+    riak_config        *cfg     = channel->ur->config;
+    riak_size_t total = 0;
+    int i;
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (channel->out_end + total > channel->out_size) {
+        riak_size_t size = channel->out_size * 2;
+        if (size < channel->out_end + total) size = channel->out_end + total;
+        if (size < RIAK_URING_MIN_OUTBUF) size = RIAK_URING_MIN_OUTBUF;
+        riak_uint8_t *outbuf = (riak_uint8_t*)riak_config_allocate(cfg, size);
+        if (outbuf == NULL) {
+            return -1;
+        }
+        if (channel->out_end > 0) {
+            memcpy(outbuf, channel->outbuf, channel->out_end);
+        }
+        riak_free(cfg, &(channel->outbuf));
+        channel->outbuf   = outbuf;
+        channel->out_size = size;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        memcpy(channel->outbuf + channel->out_end, iov[i].iov_base, iov[i].iov_len);
+        channel->out_end += iov[i].iov_len;
+    }
+    return total;
+}
+
+/**
+ * @brief Move queued requests into the send buffer and submit them
+ * @note The two buffers swap, so new requests never touch memory the kernel is reading
+ */
+static riak_error
+riak_uring_channel_flush(riak_uring_channel *channel) {
+    if (channel->send_busy || channel->out_end == 0 || channel->fd < 0) {
+        return ERIAK_OK;
+    }
+    riak_uint8_t *buf  = channel->sendbuf;
+    riak_size_t   size = channel->send_size;
+    channel->sendbuf    = channel->outbuf;
+    channel->send_size  = channel->out_size;
+    channel->send_start = 0;
+    channel->send_end   = channel->out_end;
+    channel->outbuf     = buf;
+    channel->out_size   = size;
+    channel->out_end    = 0;
+    return riak_uring_arm_send(channel);
+}
+
+/**
+ * @brief Decode replies from the bytes just received
+ */
+static void
+riak_uring_channel_readable(riak_uring_channel *channel) {
+    riak_uring *ur = channel->ur;
+    while (channel->head && channel->fd >= 0) {
+        // Off the queue while its callbacks run, which may fail the channel
+        riak_uring_pending *entry = channel->head;
+        channel->head = entry->next;
+        if (channel->head == NULL) {
+            channel->tail = NULL;
+        }
+        channel->n_pending--;
+
+        riak_boolean_t done = RIAK_FALSE;
+        riak_error err = riak_read(entry->rop, &done, riak_uring_read_cb, (void*)channel);
+        // Server errors are per operation and leave the framing intact
+        if (err == ERIAK_OK && !done && channel->fd >= 0) {
+            entry->next = channel->head;
+            channel->head = entry;
+            if (channel->tail == NULL) {
+                channel->tail = entry;
+            }
+            channel->n_pending++;
+            return;  // Wait for the rest of this reply
+        }
+        if (err == ERIAK_OK && !done) {
+            err = ERIAK_READ;
+        }
+        if (err != ERIAK_OK && err != ERIAK_SERVER_ERROR) {
+            riak_operation_report_error(entry->rop, err);
+            riak_uring_pending_free(ur, &entry);
+            riak_uring_channel_fail(channel, err);
+            return;
+        }
+        riak_uring_pending_free(ur, &entry);
+    }
+}
+
+static void
+riak_uring_complete_recv(riak_uring_channel  *channel,
+                         struct io_uring_cqe *cqe,
+                         riak_boolean_t       current) {
+    riak_uring *ur = channel->ur;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        riak_uint16_t bid = (riak_uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        if (current && cqe->res > 0) {
+            channel->rx_data = ur->buffers + (riak_size_t)bid * RIAK_URING_BUFFER_SIZE;
+            channel->rx_len  = cqe->res;
+            riak_uring_channel_readable(channel);
+            if (channel->rx_len > 0) {
+                riak_log_debug(channel->cxn, "Dropped %d unexpected bytes", (int)channel->rx_len);
+            }
+            channel->rx_data = NULL;
+            channel->rx_len  = 0;
+        }
+        riak_uring_recycle(ur, bid);
+    }
+    if (cqe->flags & IORING_CQE_F_MORE) {
+        return;
+    }
+    channel->n_recvs--;
+    // Stale, or the channel was failed by a callback above
+    if (!current || channel->fd < 0) {
+        return;
+    }
+    // Out of buffers, or the kernel ended the multishot: receive again
+    if (cqe->res > 0 || cqe->res == -ENOBUFS) {
+        if (riak_uring_arm_recv(channel) != ERIAK_OK) {
+            riak_uring_channel_fail(channel, ERIAK_EVENT);
+        }
+        return;
+    }
+    if (channel->head) {
+        riak_uring_channel_fail(channel, ERIAK_READ);
+    } else {
+        // Idle socket closed by the server; reconnect on next use
+        riak_uring_channel_detach(channel);
+    }
+}
+
+static void
+riak_uring_complete_send(riak_uring_channel  *channel,
+                         struct io_uring_cqe *cqe,
+                         riak_boolean_t       current) {
+    channel->send_busy = RIAK_FALSE;
+    if (!current || channel->fd < 0) {
+        return;
+    }
+    if (cqe->res < 0) {
+        riak_uring_channel_fail(channel, ERIAK_WRITE);
+        return;
+    }
+    channel->send_start += cqe->res;
+    if (channel->send_start < channel->send_end) {
+        if (riak_uring_arm_send(channel) != ERIAK_OK) {
+            riak_uring_channel_fail(channel, ERIAK_WRITE);
+        }
+        return;
+    }
+    channel->send_start = channel->send_end = 0;
+}
+
+static void
+riak_uring_reap(riak_uring *ur) {
+    riak_uint32_t head = *(ur->cq_head);
+    while (head != riak_uring_load_acquire(ur->cq_tail)) {
+        struct io_uring_cqe cqe = ur->cqes[head & *(ur->cq_mask)];
+        head++;
+        riak_uring_store_release(ur->cq_head, head);
+        riak_uint32_t index = (riak_uint32_t)((cqe.user_data >> 32) & 0xffffff);
+        if (index >= ur->n_channels) {
+            continue;
+        }
+        riak_uring_channel *channel = &(ur->channels[index]);
+        riak_boolean_t current = ((riak_uint32_t)cqe.user_data == channel->generation);
+        switch (cqe.user_data >> 56) {
+        case RIAK_URING_RECV:
+            riak_uring_complete_recv(channel, &cqe, current);
+            break;
+        case RIAK_URING_SEND:
+            riak_uring_complete_send(channel, &cqe, current);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Fail every channel holding an operation past its deadline
+ */
+static void
+riak_uring_expire(riak_uring *ur) {
+    riak_uint64_t now = riak_get_time_ms();
+    if (ur->next_deadline == 0 || ur->next_deadline > now) {
+        return;
+    }
+    riak_uint32_t i;
+    for (i = 0; i < ur->n_channels; i++) {
+        riak_uring_channel *channel = &(ur->channels[i]);
+        riak_uring_pending *entry;
+        for (entry = channel->head; entry; entry = entry->next) {
+            if (entry->deadline != 0 && entry->deadline <= now) {
+                riak_log_warn(channel->cxn, "%s", "Operation timed out");
+                // Replies are ordered, so everything behind it fails too
+                riak_uring_channel_fail(channel, ERIAK_TIMEOUT);
+                break;
+            }
+        }
+    }
+    ur->next_deadline = 0;
+    for (i = 0; i < ur->n_channels; i++) {
+        riak_uring_pending *entry;
+        for (entry = ur->channels[i].head; entry; entry = entry->next) {
+            if (entry->deadline != 0 && (ur->next_deadline == 0 || entry->deadline < ur->next_deadline)) {
+                ur->next_deadline = entry->deadline;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Map the rings and provide the receive buffers
+ */
+static riak_error
+riak_uring_setup(riak_uring *ur) {
+    struct io_uring_params params;
+    memset(&params, '\0', sizeof(params));
+    ur->fd = (int)syscall(__NR_io_uring_setup, RIAK_URING_ENTRIES, &params);
+    if (ur->fd < 0) {
+        riak_log_error_config(ur->config, "io_uring_setup: %s", strerror(errno));
+        return ERIAK_EVENT;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        riak_log_error_config(ur->config, "%s", "io_uring lacks IORING_FEAT_EXT_ARG");
+        return ERIAK_EVENT;
+    }
+    ur->sq_size = params.sq_off.array + params.sq_entries * sizeof(riak_uint32_t);
+    ur->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ur->cq_size > ur->sq_size) ur->sq_size = ur->cq_size;
+        ur->cq_size = 0;
+    }
+    ur->sq_ptr = mmap(NULL, ur->sq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+    if (ur->sq_ptr == MAP_FAILED) {
+        ur->sq_ptr = NULL;
+        return ERIAK_EVENT;
+    }
+    ur->cq_ptr = ur->sq_ptr;
+    if (ur->cq_size > 0) {
+        ur->cq_ptr = mmap(NULL, ur->cq_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+        if (ur->cq_ptr == MAP_FAILED) {
+            ur->cq_ptr = NULL;
+            return ERIAK_EVENT;
+        }
+    }
+    ur->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ur->sqes = (struct io_uring_sqe*)mmap(NULL, ur->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ur->fd, IORING_OFF_SQES);
+    if (ur->sqes == MAP_FAILED) {
+        ur->sqes = NULL;
+        return ERIAK_EVENT;
+    }
+    riak_uint8_t *sq = (riak_uint8_t*)ur->sq_ptr;
+    riak_uint8_t *cq = (riak_uint8_t*)ur->cq_ptr;
+    ur->sq_head  = (riak_uint32_t*)(sq + params.sq_off.head);
+    ur->sq_tail  = (riak_uint32_t*)(sq + params.sq_off.tail);
+    ur->sq_mask  = (riak_uint32_t*)(sq + params.sq_off.ring_mask);
+    ur->sq_array = (riak_uint32_t*)(sq + params.sq_off.array);
+    ur->cq_head  = (riak_uint32_t*)(cq + params.cq_off.head);
+    ur->cq_tail  = (riak_uint32_t*)(cq + params.cq_off.tail);
+    ur->cq_mask  = (riak_uint32_t*)(cq + params.cq_off.ring_mask);
+    ur->cqes     = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    // The kernel picks a buffer per receive, so idle connections hold none
+    ur->buf_ring_size = RIAK_URING_N_BUFFERS * sizeof(struct io_uring_buf);
+    ur->buf_ring = (struct io_uring_buf_ring*)mmap(NULL, ur->buf_ring_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (ur->buf_ring == MAP_FAILED) {
+        ur->buf_ring = NULL;
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    ur->buffers = (riak_uint8_t*)riak_config_allocate(ur->config, (riak_size_t)RIAK_URING_N_BUFFERS * RIAK_URING_BUFFER_SIZE);
+    if (ur->buffers == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    struct io_uring_buf_reg reg;
+    memset(&reg, '\0', sizeof(reg));
+    reg.ring_addr    = (riak_uint64_t)(uintptr_t)ur->buf_ring;
+    reg.ring_entries = RIAK_URING_N_BUFFERS;
+    reg.bgid         = RIAK_URING_BGID;
+    if (syscall(__NR_io_uring_register, ur->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        riak_log_error_config(ur->config, "Could not register receive buffers: %s", strerror(errno));
+        return ERIAK_EVENT;
+    }
+    riak_uint16_t bid;
+    for (bid = 0; bid < RIAK_URING_N_BUFFERS; bid++) {
+        riak_uring_recycle(ur, bid);
+    }
+    return ERIAK_OK;
+}
+
+riak_error
+riak_uring_new(riak_config          *cfg,
+               riak_uring          **ur_target,
+               riak_connection_pool *pool,
+               riak_uint32_t         n_channels) {
+    if (n_channels == 0) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_uring *ur = (riak_uring*)riak_config_clean_allocate(cfg, sizeof(riak_uring));
+    if (ur == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_uring");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    ur->config  = cfg;
+    ur->pool    = pool;
+    ur->timeout = RIAK_URING_DEFAULT_TIMEOUT_MS;
+    *ur_target  = ur;
+    riak_error err = riak_uring_setup(ur);
+    if (err == ERIAK_OK) {
+        ur->channels = (riak_uring_channel*)riak_config_clean_allocate(cfg, n_channels * sizeof(riak_uring_channel));
+        if (ur->channels == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    if (err) {
+        riak_uring_free(ur_target);
+        return err;
+    }
+    riak_uint32_t i;
+    for (i = 0; i < n_channels; i++) {
+        riak_uring_channel *channel = &(ur->channels[i]);
+        channel->ur    = ur;
+        channel->fd    = -1;
+        channel->index = i;
+        ur->n_channels++;
+        err = riak_connection_pool_checkout(pool, &(channel->cxn));
+        if (err == ERIAK_OK) {
+            err = riak_uring_channel_attach(channel);
+        }
+        if (err) {
+            riak_log_error_config(cfg, "Could not open channel %d: %s", i, riak_strerror(err));
+            riak_uring_free(ur_target);
+            return err;
+        }
+    }
+    return riak_uring_submit(ur);
+}
+
+void
+riak_uring_free(riak_uring **ur_target) {
+    if (ur_target == NULL || *ur_target == NULL) {
+        return;
+    }
+    riak_uring  *ur  = *ur_target;
+    riak_config *cfg = ur->config;
+    riak_uint32_t i;
+    for (i = 0; i < ur->n_channels; i++) {
+        riak_uring_channel *channel = &(ur->channels[i]);
+        if (channel->head) {
+            riak_uring_channel_fail(channel, ERIAK_EVENT);
+        }
+        // Checked back in below, so stop the kernel reading it first
+        if (channel->fd >= 0) {
+            struct io_uring_sqe *sqe = riak_uring_get_sqe(ur);
+            if (sqe) {
+                sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+                sqe->fd        = -1;
+                sqe->addr      = riak_uring_tag(channel, RIAK_URING_RECV);
+                sqe->user_data = riak_uring_tag(channel, RIAK_URING_CANCEL);
+            }
+            channel->generation++;
+            channel->fd = -1;
+        }
+    }
+    // Let the kernel hand back every buffer it still holds
+    riak_uint64_t give_up = riak_get_time_ms() + 1000;
+    while (ur->fd >= 0 && riak_get_time_ms() < give_up) {
+        riak_uint32_t busy = 0;
+        for (i = 0; i < ur->n_channels; i++) {
+            busy += ur->channels[i].n_recvs + ur->channels[i].send_busy;
+        }
+        if (busy == 0) break;
+        riak_uring_submit(ur);
+        riak_uring_enter(ur, 0, 1, 10);
+        riak_uring_reap(ur);
+    }
+    for (i = 0; i < ur->n_channels; i++) {
+        riak_uring_channel *channel = &(ur->channels[i]);
+        riak_free(cfg, &(channel->outbuf));
+        riak_free(cfg, &(channel->sendbuf));
+        if (channel->cxn == NULL) {
+            continue;
+        }
+        // Replies to failed operations may still be on the wire
+        if (channel->broken || channel->n_recvs > 0 || channel->send_busy) {
+            riak_connection_pool_evict(ur->pool, &(channel->cxn));
+        } else {
+            riak_connection_pool_checkin(ur->pool, &(channel->cxn));
+        }
+    }
+    if (ur->fd >= 0) close(ur->fd);
+    if (ur->sqes) munmap(ur->sqes, ur->sqes_size);
+    if (ur->cq_ptr && ur->cq_ptr != ur->sq_ptr) munmap(ur->cq_ptr, ur->cq_size);
+    if (ur->sq_ptr) munmap(ur->sq_ptr, ur->sq_size);
+    if (ur->buf_ring) munmap(ur->buf_ring, ur->buf_ring_size);
+    riak_free(cfg, &(ur->buffers));
+    riak_free(cfg, &(ur->channels));
+    riak_free(cfg, ur_target);
+}
+
+void
+riak_uring_set_timeout(riak_uring   *ur,
+                       riak_uint32_t timeout) {
+    ur->timeout = timeout;
+}
+
+riak_uint32_t
+riak_uring_get_n_pending(riak_uring *ur) {
+    riak_uint32_t n = 0;
+    riak_uint32_t i;
+    for (i = 0; i < ur->n_channels; i++) {
+        n += ur->channels[i].n_pending;
+    }
+    return n;
+}
+
+riak_error
+riak_uring_operation_new(riak_uring             *ur,
+                         riak_operation        **rop,
+                         riak_response_callback  response_cb,
+                         riak_response_callback  error_cb,
+                         void                   *cb_data) {
+    riak_uring_channel *best = &(ur->channels[0]);
+    riak_uint32_t i;
+    for (i = 1; i < ur->n_channels; i++) {
+        if (ur->channels[i].n_pending < best->n_pending) {
+            best = &(ur->channels[i]);
+        }
+    }
+    return riak_operation_new(best->cxn, rop, response_cb, error_cb, cb_data);
+}
+
+riak_error
+riak_uring_send(riak_uring     *ur,
+                riak_operation *rop) {
+    riak_connection    *cxn     = riak_operation_get_connection(rop);
+    riak_uring_channel *channel = NULL;
+    riak_uint32_t i;
+    for (i = 0; i < ur->n_channels; i++) {
+        if (ur->channels[i].cxn == cxn) {
+            channel = &(ur->channels[i]);
+            break;
+        }
+    }
+    if (channel == NULL) {
+        riak_log_error_config(ur->config, "%s", "Operation does not belong to this transport");
+        riak_operation_free(&rop);
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_error err = ERIAK_OK;
+    if (channel->fd < 0) {
+        err = riak_uring_channel_attach(channel);
+        if (err) {
+            riak_operation_free(&rop);
+            return err;
+        }
+    }
+    riak_uring_pending *entry = (riak_uring_pending*)riak_config_clean_allocate(ur->config, sizeof(riak_uring_pending));
+    if (entry == NULL) {
+        riak_operation_free(&rop);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    entry->rop = rop;
+    riak_uint32_t timeout = riak_operation_get_timeout(rop);
+    if (timeout == 0) {
+        timeout = ur->timeout;
+    }
+    if (timeout > 0) {
+        entry->deadline = riak_get_time_ms() + timeout;
+        if (ur->next_deadline == 0 || entry->deadline < ur->next_deadline) {
+            ur->next_deadline = entry->deadline;
+        }
+    }
+    err = riak_writev(rop, riak_uring_writev_cb, (void*)channel);
+    if (err) {
+        riak_uring_pending_free(ur, &entry);
+        return err;
+    }
+    if (channel->tail) {
+        channel->tail->next = entry;
+    } else {
+        channel->head = entry;
+    }
+    channel->tail = entry;
+    channel->n_pending++;
+    return ERIAK_OK;
+}
+
+riak_error
+riak_uring_run_once(riak_uring *ur,
+                    int         timeout) {
+    riak_uint32_t i;
+    for (i = 0; i < ur->n_channels; i++) {
+        if (riak_uring_channel_flush(&(ur->channels[i])) != ERIAK_OK) {
+            riak_uring_channel_fail(&(ur->channels[i]), ERIAK_WRITE);
+        }
+    }
+    // Wake in time for the earliest deadline
+    if (ur->next_deadline != 0) {
+        riak_uint64_t now  = riak_get_time_ms();
+        int           wait = (ur->next_deadline > now) ? (int)(ur->next_deadline - now) : 0;
+        if (timeout < 0 || wait < timeout) {
+            timeout = wait;
+        }
+    }
+    // One syscall submits the whole batch and waits for completions
+    int n = riak_uring_enter(ur, ur->n_queued, (timeout == 0) ? 0 : 1, timeout);
+    if (n < 0 && errno != ETIME && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        riak_log_error_config(ur->config, "io_uring_enter: %s", strerror(errno));
+        return ERIAK_EVENT;
+    }
+    if (n > 0) {
+        ur->n_queued -= n;
+    }
+    riak_uring_reap(ur);
+    riak_uring_expire(ur);
+    return ERIAK_OK;
+}
+
+riak_error
+riak_uring_run(riak_uring *ur) {
+    while (riak_uring_get_n_pending(ur) > 0) {
+        riak_error err = riak_uring_run_once(ur, -1);
+        if (err) {
+            return err;
+        }
+    }
+    return ERIAK_OK;
+}
+
+#endif // RIAK_USE_IO_URING
@@ -0,0 +1,127 @@
+/*********************************************************************
+ *
+ * riak_uring.h: Optional io_uring transport (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_URING_H
+#define _RIAK_URING_H
+
+// The library only has these when built with ./configure --enable-io-uring,
+// which is also the only build that installs this header
+
+#include "riak.h"
+
+typedef struct _riak_uring riak_uring;
+
+#define RIAK_URING_DEFAULT_TIMEOUT_MS 5000
+// Submission queue depth
+#define RIAK_URING_ENTRIES            256
+// Receive buffers shared by every connection, and the size of each
+#define RIAK_URING_N_BUFFERS          256
+#define RIAK_URING_BUFFER_SIZE        16384
+
+/**
+ * @brief Construct an io_uring transport over pooled connections
+ * @param cfg Riak Configuration
+ * @param ur Riak io_uring transport (out)
+ * @param pool Connections are checked out for the transport's lifetime
+ * @param n_channels Number of connections to multiplex operations over
+ * @returns ERIAK_EVENT if the kernel lacks multishot receive or provided
+ * buffer rings (Linux 6.0 and later have both)
+ */
+riak_error
+riak_uring_new(riak_config          *cfg,
+               riak_uring          **ur,
+               riak_connection_pool *pool,
+               riak_uint32_t         n_channels);
+
+/**
+ * @brief Release the transport, failing any operations still in flight
+ * @param ur Riak io_uring transport (NULLed on return)
+ * @note Must not be called from inside an operation's callback
+ */
+void
+riak_uring_free(riak_uring **ur);
+
+/**
+ * @brief Default bound on each operation's round trip
+ * @param ur Riak io_uring transport
+ * @param timeout Milliseconds, used when the operation sets none (0 for no limit)
+ */
+void
+riak_uring_set_timeout(riak_uring   *ur,
+                       riak_uint32_t timeout);
+
+/**
+ * @brief Number of operations sent but not yet completed
+ * @param ur Riak io_uring transport
+ * @returns Count across every channel
+ */
+riak_uint32_t
+riak_uring_get_n_pending(riak_uring *ur);
+
+/**
+ * @brief Construct an operation on the transport's least busy channel
+ * @param ur Riak io_uring transport
+ * @param rop Riak Operation (out)
+ * @param response_cb Called with the response once it has fully arrived
+ * @param error_cb Called on server, network or timeout errors
+ * @param cb_data Passed to both callbacks
+ * @returns Error code
+ * @note Register the request (e.g. `riak_async_register_get`) before sending
+ */
+riak_error
+riak_uring_operation_new(riak_uring             *ur,
+                         riak_operation        **rop,
+                         riak_response_callback  response_cb,
+                         riak_response_callback  error_cb,
+                         void                   *cb_data);
+
+/**
+ * @brief Queue an operation's request; it is submitted by the next run
+ * @param ur Riak io_uring transport
+ * @param rop Operation made by `riak_uring_operation_new`
+ * @returns Error code
+ * @note The transport owns and frees `rop`, even on error; exactly one of
+ * its callbacks runs from `riak_uring_run_once` unless this returns an error
+ */
+riak_error
+riak_uring_send(riak_uring     *ur,
+                riak_operation *rop);
+
+/**
+ * @brief Submit queued sends in one batch and handle whatever completed
+ * @param ur Riak io_uring transport
+ * @param timeout Milliseconds to wait for a completion (0 to poll, -1 to block)
+ * @returns Error code (ERIAK_EVENT if io_uring itself failed)
+ */
+riak_error
+riak_uring_run_once(riak_uring *ur,
+                    int         timeout);
+
+/**
+ * @brief Drive the transport until no operations are pending
+ * @param ur Riak io_uring transport
+ * @returns Error code
+ */
+riak_error
+riak_uring_run(riak_uring *ur);
+
+#endif // _RIAK_URING_H
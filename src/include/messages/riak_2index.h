@@ -26,6 +26,20 @@
 typedef struct _riak_2index_response riak_2index_response;
 typedef struct _riak_2index_options riak_2index_options;
 typedef void (*riak_2index_response_callback)(riak_2index_response *response, void *ptr);
+// Receives ownership of `chunk`; release it with `riak_2index_response_free`
+typedef void (*riak_2index_stream_callback)(riak_2index_response *chunk, void *ptr);
+
+/**
+ * @brief Hand each streamed message to a callback instead of merging them
+ * @param rop Riak Operation for a 2i request
+ * @param cb Called with a response holding just that message's entries
+ * @param ptr Passed through to `cb`
+ * @note The final response then only carries counts, continuation and done
+ */
+void
+riak_2index_set_stream_cb(riak_operation             *rop,
+                          riak_2index_stream_callback cb,
+                          void                       *ptr);
 
 /**
  * @brief Free Secondary Index response
@@ -0,0 +1,206 @@
+/*********************************************************************
+ *
+ * riak_counter.h: Riak C Client Legacy Counter Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_COUNTER_MESSAGE_H
+#define _RIAK_COUNTER_MESSAGE_H
+
+typedef struct _riak_counter_update_options riak_counter_update_options;
+typedef struct _riak_counter_get_options riak_counter_get_options;
+typedef struct _riak_counter_update_response riak_counter_update_response;
+typedef struct _riak_counter_get_response riak_counter_get_response;
+
+/**
+ * @brief Print a summary of a `riak_counter_update_response`
+ * @param response Result from a Counter Update request
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ * @returns Number of bytes written
+ */
+int
+riak_counter_update_response_print(riak_counter_update_response *response,
+                                   char                         *target,
+                                   riak_int32_t                  len);
+
+/**
+ * @brief Free memory from response
+ * @param cfg Riak Configuration
+ * @param resp Counter Update response
+ */
+void
+riak_counter_update_response_free(riak_config                   *cfg,
+                                  riak_counter_update_response **resp);
+
+/**
+ * @brief Determine if the new value was returned
+ * @param response Counter Update response
+ * @returns True only if `returnvalue` was requested
+ */
+riak_boolean_t
+riak_counter_update_get_has_value(riak_counter_update_response *response);
+
+/**
+ * @brief Access the value of the counter after the update
+ * @param response Counter Update response
+ * @returns Counter value
+ */
+riak_int64_t
+riak_counter_update_get_value(riak_counter_update_response *response);
+
+/**
+ * @brief Construct new Counter Update options
+ * @param cfg Riak Configuration
+ * @returns Counter Update options
+ */
+riak_counter_update_options*
+riak_counter_update_options_new(riak_config *cfg);
+
+/**
+ * @brief Release Counter Update options
+ * @param cfg Riak Configuration
+ * @param opt Counter Update options to be freed
+ */
+void
+riak_counter_update_options_free(riak_config                  *cfg,
+                                 riak_counter_update_options **opt);
+
+/**
+ * @brief Set the Write Quorum
+ * @param opt Counter Update options
+ * @param value Write Quorum
+ */
+void
+riak_counter_update_options_set_w(riak_counter_update_options *opt,
+                                  riak_uint32_t                value);
+/**
+ * @brief Set the Durable Write Quorum
+ * @param opt Counter Update options
+ * @param value Durable Write Quorum
+ */
+void
+riak_counter_update_options_set_dw(riak_counter_update_options *opt,
+                                   riak_uint32_t                value);
+/**
+ * @brief Set the Primary Write Quorum
+ * @param opt Counter Update options
+ * @param value Primary Write Quorum
+ */
+void
+riak_counter_update_options_set_pw(riak_counter_update_options *opt,
+                                   riak_uint32_t                value);
+/**
+ * @brief Set whether to return the new value of the counter
+ * @param opt Counter Update options
+ * @param value Return Value flag
+ */
+void
+riak_counter_update_options_set_returnvalue(riak_counter_update_options *opt,
+                                            riak_boolean_t               value);
+
+/**
+ * @brief Print a summary of a `riak_counter_get_response`
+ * @param response Result from a Counter Get request
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ * @returns Number of bytes written
+ */
+int
+riak_counter_get_response_print(riak_counter_get_response *response,
+                                char                      *target,
+                                riak_int32_t               len);
+
+/**
+ * @brief Free memory from response
+ * @param cfg Riak Configuration
+ * @param resp Counter Get response
+ */
+void
+riak_counter_get_response_free(riak_config                *cfg,
+                               riak_counter_get_response **resp);
+
+/**
+ * @brief Determine if the counter was found
+ * @param response Counter Get response
+ * @returns False if the counter has never been updated
+ */
+riak_boolean_t
+riak_counter_get_get_has_value(riak_counter_get_response *response);
+
+/**
+ * @brief Access the value of the counter
+ * @param response Counter Get response
+ * @returns Counter value
+ */
+riak_int64_t
+riak_counter_get_get_value(riak_counter_get_response *response);
+
+/**
+ * @brief Construct new Counter Get options
+ * @param cfg Riak Configuration
+ * @returns Counter Get options
+ */
+riak_counter_get_options*
+riak_counter_get_options_new(riak_config *cfg);
+
+/**
+ * @brief Release Counter Get options
+ * @param cfg Riak Configuration
+ * @param opt Counter Get options to be freed
+ */
+void
+riak_counter_get_options_free(riak_config               *cfg,
+                              riak_counter_get_options **opt);
+
+/**
+ * @brief Set the Read Quorum
+ * @param opt Counter Get options
+ * @param value Read Quorum
+ */
+void
+riak_counter_get_options_set_r(riak_counter_get_options *opt,
+                               riak_uint32_t             value);
+/**
+ * @brief Set the Primary Read Quorum
+ * @param opt Counter Get options
+ * @param value Primary Read Quorum
+ */
+void
+riak_counter_get_options_set_pr(riak_counter_get_options *opt,
+                                riak_uint32_t             value);
+/**
+ * @brief Set the Basic Quorum flag
+ * @param opt Counter Get options
+ * @param value Basic Quorum flag
+ */
+void
+riak_counter_get_options_set_basic_quorum(riak_counter_get_options *opt,
+                                          riak_boolean_t            value);
+/**
+ * @brief Set the Not Found OK flag
+ * @param opt Counter Get options
+ * @param value Not Found OK flag
+ */
+void
+riak_counter_get_options_set_notfound_ok(riak_counter_get_options *opt,
+                                         riak_boolean_t            value);
+
+#endif
@@ -0,0 +1,199 @@
+/*********************************************************************
+ *
+ * riak_csbucket.h: Riak C Client Bucket Range Fold Message
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_CSBUCKET_MESSAGE_H
+#define _RIAK_CSBUCKET_MESSAGE_H
+
+// Each object in the range comes back as a riak_get_response
+#include "messages/riak_get.h"
+
+typedef struct _riak_csbucket_response riak_csbucket_response;
+typedef struct _riak_csbucket_options riak_csbucket_options;
+// Receives ownership of `chunk`; release it with `riak_csbucket_response_free`
+typedef void (*riak_csbucket_stream_callback)(riak_csbucket_response *chunk, void *ptr);
+
+/**
+ * @brief Hand each streamed message to a callback instead of merging them
+ * @param rop Riak Operation for a bucket range fold
+ * @param cb Called with a response holding just that message's objects
+ * @param ptr Passed through to `cb`
+ * @note The final response then only carries counts, continuation and done
+ */
+void
+riak_csbucket_set_stream_cb(riak_operation               *rop,
+                            riak_csbucket_stream_callback cb,
+                            void                         *ptr);
+
+/**
+ * @brief Print a summary of a `riak_csbucket_response`
+ * @param response Result from a bucket range fold
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ * @returns Number of bytes written
+ */
+int
+riak_csbucket_response_print(riak_csbucket_response *response,
+                             char                   *target,
+                             riak_int32_t            len);
+
+/**
+ * @brief Free memory from response
+ * @param cfg Riak Configuration
+ * @param resp Bucket range fold response
+ */
+void
+riak_csbucket_response_free(riak_config             *cfg,
+                            riak_csbucket_response **resp);
+
+/**
+ * @brief Access the number of objects in the range
+ * @param response Bucket range fold response
+ * @returns Number of keys and objects
+ */
+riak_uint32_t
+riak_csbucket_get_n_objects(riak_csbucket_response *response);
+
+/**
+ * @brief Access the keys, in the same order as the objects
+ * @param response Bucket range fold response
+ * @returns Array of keys
+ */
+riak_binary**
+riak_csbucket_get_keys(riak_csbucket_response *response);
+
+/**
+ * @brief Access the objects, each as a Get would have returned it
+ * @param response Bucket range fold response
+ * @returns Array of Get responses, including any siblings
+ */
+riak_get_response**
+riak_csbucket_get_objects(riak_csbucket_response *response);
+
+/**
+ * @brief Determine if there are more objects past this page
+ * @param response Bucket range fold response
+ * @returns True if a continuation is present
+ */
+riak_boolean_t
+riak_csbucket_get_has_continuation(riak_csbucket_response *response);
+
+/**
+ * @brief Access the position of the next page
+ * @param response Bucket range fold response
+ * @returns Continuation to pass to `riak_csbucket_options_set_continuation`
+ */
+riak_binary*
+riak_csbucket_get_continuation(riak_csbucket_response *response);
+
+/**
+ * @brief Determine if the server finished streaming
+ * @param response Bucket range fold response
+ * @returns Done flag
+ */
+riak_boolean_t
+riak_csbucket_get_done(riak_csbucket_response *response);
+
+/**
+ * @brief Construct new bucket range fold options
+ * @param cfg Riak Configuration
+ * @returns Bucket range fold options
+ */
+riak_csbucket_options*
+riak_csbucket_options_new(riak_config *cfg);
+
+/**
+ * @brief Release bucket range fold options
+ * @param cfg Riak Configuration
+ * @param opt Bucket range fold options to be freed
+ */
+void
+riak_csbucket_options_free(riak_config            *cfg,
+                           riak_csbucket_options **opt);
+
+/**
+ * @brief Set the last key of the range
+ * @param cfg Riak Configuration
+ * @param opt Bucket range fold options
+ * @param value End key (copied)
+ * @returns Error code
+ */
+riak_error
+riak_csbucket_options_set_end_key(riak_config           *cfg,
+                                  riak_csbucket_options *opt,
+                                  riak_binary           *value);
+/**
+ * @brief Set whether the start key is part of the range (default true)
+ * @param opt Bucket range fold options
+ * @param value Start Inclusive flag
+ */
+void
+riak_csbucket_options_set_start_incl(riak_csbucket_options *opt,
+                                     riak_boolean_t         value);
+/**
+ * @brief Set whether the end key is part of the range (default false)
+ * @param opt Bucket range fold options
+ * @param value End Inclusive flag
+ */
+void
+riak_csbucket_options_set_end_incl(riak_csbucket_options *opt,
+                                   riak_boolean_t         value);
+/**
+ * @brief Resume from a previous page
+ * @param cfg Riak Configuration
+ * @param opt Bucket range fold options
+ * @param value Continuation from the previous response (copied)
+ * @returns Error code
+ */
+riak_error
+riak_csbucket_options_set_continuation(riak_config           *cfg,
+                                       riak_csbucket_options *opt,
+                                       riak_binary           *value);
+/**
+ * @brief Set the most objects returned per page
+ * @param opt Bucket range fold options
+ * @param value Page size
+ */
+void
+riak_csbucket_options_set_max_results(riak_csbucket_options *opt,
+                                      riak_uint32_t          value);
+/**
+ * @brief Set the Timeout Value
+ * @param opt Bucket range fold options
+ * @param value Timeout in milliseconds
+ */
+void
+riak_csbucket_options_set_timeout(riak_csbucket_options *opt,
+                                  riak_uint32_t          value);
+/**
+ * @brief Set the bucket type
+ * @param cfg Riak Configuration
+ * @param opt Bucket range fold options
+ * @param value Bucket type (copied)
+ * @returns Error code
+ */
+riak_error
+riak_csbucket_options_set_type(riak_config           *cfg,
+                               riak_csbucket_options *opt,
+                               riak_binary           *value);
+
+#endif
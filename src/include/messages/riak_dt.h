@@ -0,0 +1,591 @@
+/*********************************************************************
+ *
+ * riak_dt.h: Riak C Client Data Type (CRDT) Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_DT_MESSAGE_H
+#define _RIAK_DT_MESSAGE_H
+
+typedef struct _riak_dt_fetch_options riak_dt_fetch_options;
+typedef struct _riak_dt_update_options riak_dt_update_options;
+typedef struct _riak_dt_fetch_response riak_dt_fetch_response;
+typedef struct _riak_dt_update_response riak_dt_update_response;
+typedef struct _riak_dt_value riak_dt_value;
+typedef struct _riak_dt_map_entry riak_dt_map_entry;
+typedef struct _riak_dt_op riak_dt_op;
+
+// Based on DtFetchResp.DataType
+typedef enum _riak_dt_type {
+    RIAK_DT_COUNTER = 1,
+    RIAK_DT_SET     = 2,
+    RIAK_DT_MAP     = 3
+} riak_dt_type;
+
+// Based on MapField.MapFieldType
+typedef enum _riak_dt_field_type {
+    RIAK_DT_FIELD_COUNTER  = 1,
+    RIAK_DT_FIELD_SET      = 2,
+    RIAK_DT_FIELD_REGISTER = 3,
+    RIAK_DT_FIELD_FLAG     = 4,
+    RIAK_DT_FIELD_MAP      = 5
+} riak_dt_field_type;
+
+//
+// O P E R A T I O N S
+//
+
+/**
+ * @brief Start an empty batch of operations on a data type
+ * @param cfg Riak Configuration
+ * @param type Counter, Set or Map
+ * @returns Riak Data Type Operation
+ * @note Operations are folded together locally, so one update sends them all
+ */
+riak_dt_op*
+riak_dt_op_new(riak_config *cfg,
+               riak_dt_type type);
+
+/**
+ * @brief Release a batch of operations, including every field operation
+ * @param cfg Riak Configuration
+ * @param op Riak Data Type Operation
+ */
+void
+riak_dt_op_free(riak_config *cfg,
+                riak_dt_op **op);
+
+/**
+ * @brief Forget all pending operations, usually after a successful update
+ * @param op Riak Data Type Operation
+ * @note Field operations returned by `riak_dt_op_map_update` are released
+ */
+void
+riak_dt_op_clear(riak_dt_op *op);
+
+/**
+ * @brief Number of operations folded in since creation or the last clear
+ * @param op Riak Data Type Operation
+ * @returns Count of calls applied, including those on map fields
+ */
+riak_uint32_t
+riak_dt_op_get_n_pending(riak_dt_op *op);
+
+/**
+ * @brief Add to a counter (negative to decrement)
+ * @param op Counter operation
+ * @param amount Change in value
+ * @returns ERIAK_DT_TYPE if `op` is not a counter
+ */
+riak_error
+riak_dt_op_counter_increment(riak_dt_op  *op,
+                             riak_int64_t amount);
+
+/**
+ * @brief Add a member to a set, cancelling an earlier pending remove
+ * @param op Set operation
+ * @param member Value to add (copied)
+ * @returns ERIAK_DT_TYPE if `op` is not a set
+ */
+riak_error
+riak_dt_op_set_add(riak_dt_op  *op,
+                   riak_binary *member);
+
+/**
+ * @brief Remove a member from a set, cancelling an earlier pending add
+ * @param op Set operation
+ * @param member Value to remove (copied)
+ * @returns ERIAK_DT_TYPE if `op` is not a set
+ * @note Removes need the context from a previous fetch
+ */
+riak_error
+riak_dt_op_set_remove(riak_dt_op  *op,
+                      riak_binary *member);
+
+/**
+ * @brief Update a counter, set or map stored in a map field
+ * @param op Map operation
+ * @param name Name of the field (copied)
+ * @param type Counter, Set or Map
+ * @param field_op Operation to apply to the field, owned by `op` (out)
+ * @returns ERIAK_DT_TYPE if `op` is not a map or `type` has no operation
+ * @note A field left without operations is created empty
+ */
+riak_error
+riak_dt_op_map_update(riak_dt_op         *op,
+                      riak_binary        *name,
+                      riak_dt_field_type  type,
+                      riak_dt_op        **field_op);
+
+/**
+ * @brief Set a register in a map; the last value set wins
+ * @param op Map operation
+ * @param name Name of the field (copied)
+ * @param value New value of the register (copied)
+ * @returns ERIAK_DT_TYPE if `op` is not a map
+ */
+riak_error
+riak_dt_op_map_set_register(riak_dt_op  *op,
+                            riak_binary *name,
+                            riak_binary *value);
+
+/**
+ * @brief Enable or disable a flag in a map; the last call wins
+ * @param op Map operation
+ * @param name Name of the field (copied)
+ * @param enable Whether the flag is set
+ * @returns ERIAK_DT_TYPE if `op` is not a map
+ */
+riak_error
+riak_dt_op_map_set_flag(riak_dt_op    *op,
+                        riak_binary   *name,
+                        riak_boolean_t enable);
+
+/**
+ * @brief Remove a field from a map, dropping its pending operations
+ * @param op Map operation
+ * @param name Name of the field (copied)
+ * @param type Type of the field
+ * @returns ERIAK_DT_TYPE if `op` is not a map
+ * @note Removes need the context from a previous fetch, and any field
+ * operation returned for the field is released
+ */
+riak_error
+riak_dt_op_map_remove(riak_dt_op         *op,
+                      riak_binary        *name,
+                      riak_dt_field_type  type);
+
+//
+// V A L U E S
+//
+
+/**
+ * @brief Determine if a counter value is present
+ * @param value Value of a data type or map field
+ * @returns True for counters
+ */
+riak_boolean_t
+riak_dt_value_get_has_counter(riak_dt_value *value);
+
+/**
+ * @brief Access a counter value
+ * @param value Value of a data type or map field
+ * @returns Counter
+ */
+riak_int64_t
+riak_dt_value_get_counter(riak_dt_value *value);
+
+/**
+ * @brief Number of members in a set value
+ * @param value Value of a data type or map field
+ * @returns Count of members
+ */
+riak_int32_t
+riak_dt_value_get_n_set(riak_dt_value *value);
+
+/**
+ * @brief Access the members of a set value
+ * @param value Value of a data type or map field
+ * @returns Array of members
+ */
+riak_binary**
+riak_dt_value_get_set(riak_dt_value *value);
+
+/**
+ * @brief Number of entries in a map value
+ * @param value Value of a data type or map field
+ * @returns Count of entries
+ */
+riak_int32_t
+riak_dt_value_get_n_map(riak_dt_value *value);
+
+/**
+ * @brief Access the entries of a map value
+ * @param value Value of a data type or map field
+ * @returns Array of map entries
+ */
+riak_dt_map_entry**
+riak_dt_value_get_map(riak_dt_value *value);
+
+/**
+ * @brief Look up a map entry by name and type
+ * @param value Map value
+ * @param name Name of the field
+ * @param type Type of the field
+ * @returns Matching entry or NULL
+ */
+riak_dt_map_entry*
+riak_dt_value_find(riak_dt_value      *value,
+                   riak_binary        *name,
+                   riak_dt_field_type  type);
+
+/**
+ * @brief Access the name of a map entry
+ * @param entry Map entry
+ * @returns Name of the field
+ */
+riak_binary*
+riak_dt_map_entry_get_name(riak_dt_map_entry *entry);
+
+/**
+ * @brief Access the type of a map entry
+ * @param entry Map entry
+ * @returns Type of the field
+ */
+riak_dt_field_type
+riak_dt_map_entry_get_type(riak_dt_map_entry *entry);
+
+/**
+ * @brief Access the counter, set or map held in a map entry
+ * @param entry Map entry
+ * @returns Value of the field
+ */
+riak_dt_value*
+riak_dt_map_entry_get_value(riak_dt_map_entry *entry);
+
+/**
+ * @brief Determine if a map entry holds a register
+ * @param entry Map entry
+ * @returns True for registers
+ */
+riak_boolean_t
+riak_dt_map_entry_get_has_register(riak_dt_map_entry *entry);
+
+/**
+ * @brief Access the register held in a map entry
+ * @param entry Map entry
+ * @returns Register value
+ */
+riak_binary*
+riak_dt_map_entry_get_register(riak_dt_map_entry *entry);
+
+/**
+ * @brief Determine if a map entry holds a flag
+ * @param entry Map entry
+ * @returns True for flags
+ */
+riak_boolean_t
+riak_dt_map_entry_get_has_flag(riak_dt_map_entry *entry);
+
+/**
+ * @brief Access the flag held in a map entry
+ * @param entry Map entry
+ * @returns Whether the flag is enabled
+ */
+riak_boolean_t
+riak_dt_map_entry_get_flag(riak_dt_map_entry *entry);
+
+//
+// F E T C H
+//
+
+/**
+ * @brief Print a summary of a `riak_dt_fetch_response`
+ * @param response Result from a Data Type Fetch request
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ * @returns Number of bytes written
+ */
+int
+riak_dt_fetch_response_print(riak_dt_fetch_response *response,
+                             char                   *target,
+                             riak_int32_t            len);
+
+/**
+ * @brief Free a Data Type Fetch response
+ * @param cfg Riak Configuration
+ * @param resp Data Type Fetch response
+ */
+void
+riak_dt_fetch_response_free(riak_config             *cfg,
+                            riak_dt_fetch_response **resp);
+
+/**
+ * @brief Determine if an opaque context was returned
+ * @param response Data Type Fetch response
+ * @returns True if a context is present
+ */
+riak_boolean_t
+riak_dt_fetch_get_has_context(riak_dt_fetch_response *response);
+
+/**
+ * @brief Access the context to send along with the next update
+ * @param response Data Type Fetch response
+ * @returns Opaque context
+ */
+riak_binary*
+riak_dt_fetch_get_context(riak_dt_fetch_response *response);
+
+/**
+ * @brief Access the type of the fetched data
+ * @param response Data Type Fetch response
+ * @returns Counter, Set or Map
+ */
+riak_dt_type
+riak_dt_fetch_get_type(riak_dt_fetch_response *response);
+
+/**
+ * @brief Access the fetched value
+ * @param response Data Type Fetch response
+ * @returns Value, or NULL when not found
+ */
+riak_dt_value*
+riak_dt_fetch_get_value(riak_dt_fetch_response *response);
+
+/**
+ * @brief Construct new Data Type Fetch options
+ * @param cfg Riak Configuration
+ * @returns Data Type Fetch options
+ */
+riak_dt_fetch_options*
+riak_dt_fetch_options_new(riak_config *cfg);
+
+/**
+ * @brief Release Data Type Fetch options
+ * @param cfg Riak Configuration
+ * @param opt Data Type Fetch options
+ */
+void
+riak_dt_fetch_options_free(riak_config            *cfg,
+                           riak_dt_fetch_options **opt);
+
+/**
+ * @brief Set the Read Quorum
+ * @param opt Data Type Fetch options
+ * @param value Read Quorum
+ */
+void
+riak_dt_fetch_options_set_r(riak_dt_fetch_options *opt,
+                            riak_uint32_t          value);
+/**
+ * @brief Set the Primary Read Quorum
+ * @param opt Data Type Fetch options
+ * @param value Primary Read Quorum
+ */
+void
+riak_dt_fetch_options_set_pr(riak_dt_fetch_options *opt,
+                             riak_uint32_t          value);
+/**
+ * @brief Set the Basic Quorum flag
+ * @param opt Data Type Fetch options
+ * @param value Basic Quorum flag
+ */
+void
+riak_dt_fetch_options_set_basic_quorum(riak_dt_fetch_options *opt,
+                                       riak_boolean_t         value);
+/**
+ * @brief Set the Not Found OK flag
+ * @param opt Data Type Fetch options
+ * @param value Not Found OK flag
+ */
+void
+riak_dt_fetch_options_set_notfound_ok(riak_dt_fetch_options *opt,
+                                      riak_boolean_t         value);
+/**
+ * @brief Set the Timeout
+ * @param opt Data Type Fetch options
+ * @param value Timeout in milliseconds
+ */
+void
+riak_dt_fetch_options_set_timeout(riak_dt_fetch_options *opt,
+                                  riak_uint32_t          value);
+/**
+ * @brief Set the Sloppy Quorum flag
+ * @param opt Data Type Fetch options
+ * @param value Sloppy Quorum flag
+ */
+void
+riak_dt_fetch_options_set_sloppy_quorum(riak_dt_fetch_options *opt,
+                                        riak_boolean_t         value);
+/**
+ * @brief Set the N Value
+ * @param opt Data Type Fetch options
+ * @param value N Value
+ */
+void
+riak_dt_fetch_options_set_n_val(riak_dt_fetch_options *opt,
+                                riak_uint32_t          value);
+/**
+ * @brief Set whether the context is returned (default true)
+ * @param opt Data Type Fetch options
+ * @param value Include Context flag
+ */
+void
+riak_dt_fetch_options_set_include_context(riak_dt_fetch_options *opt,
+                                          riak_boolean_t         value);
+
+//
+// U P D A T E
+//
+
+/**
+ * @brief Print a summary of a `riak_dt_update_response`
+ * @param response Result from a Data Type Update request
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ * @returns Number of bytes written
+ */
+int
+riak_dt_update_response_print(riak_dt_update_response *response,
+                              char                    *target,
+                              riak_int32_t             len);
+
+/**
+ * @brief Free a Data Type Update response
+ * @param cfg Riak Configuration
+ * @param resp Data Type Update response
+ */
+void
+riak_dt_update_response_free(riak_config              *cfg,
+                             riak_dt_update_response **resp);
+
+/**
+ * @brief Determine if the server assigned a key
+ * @param response Data Type Update response
+ * @returns True if a key is present
+ */
+riak_boolean_t
+riak_dt_update_get_has_key(riak_dt_update_response *response);
+
+/**
+ * @brief Access the key assigned by the server
+ * @param response Data Type Update response
+ * @returns Key
+ */
+riak_binary*
+riak_dt_update_get_key(riak_dt_update_response *response);
+
+/**
+ * @brief Determine if an opaque context was returned
+ * @param response Data Type Update response
+ * @returns True if a context is present
+ */
+riak_boolean_t
+riak_dt_update_get_has_context(riak_dt_update_response *response);
+
+/**
+ * @brief Access the context to send along with the next update
+ * @param response Data Type Update response
+ * @returns Opaque context
+ */
+riak_binary*
+riak_dt_update_get_context(riak_dt_update_response *response);
+
+/**
+ * @brief Access the updated value
+ * @param response Data Type Update response
+ * @returns Value, or NULL if none was returned
+ */
+riak_dt_value*
+riak_dt_update_get_value(riak_dt_update_response *response);
+
+/**
+ * @brief Construct new Data Type Update options
+ * @param cfg Riak Configuration
+ * @returns Data Type Update options
+ */
+riak_dt_update_options*
+riak_dt_update_options_new(riak_config *cfg);
+
+/**
+ * @brief Release Data Type Update options
+ * @param cfg Riak Configuration
+ * @param opt Data Type Update options
+ */
+void
+riak_dt_update_options_free(riak_config             *cfg,
+                            riak_dt_update_options **opt);
+
+/**
+ * @brief Set the context returned by a previous fetch or update
+ * @param cfg Riak Configuration
+ * @param opt Data Type Update options
+ * @param value Opaque context (copied)
+ */
+void
+riak_dt_update_options_set_context(riak_config            *cfg,
+                                   riak_dt_update_options *opt,
+                                   riak_binary            *value);
+/**
+ * @brief Set the Write Quorum
+ * @param opt Data Type Update options
+ * @param value Write Quorum
+ */
+void
+riak_dt_update_options_set_w(riak_dt_update_options *opt,
+                             riak_uint32_t           value);
+/**
+ * @brief Set the Durable Write Quorum
+ * @param opt Data Type Update options
+ * @param value Durable Write Quorum
+ */
+void
+riak_dt_update_options_set_dw(riak_dt_update_options *opt,
+                              riak_uint32_t           value);
+/**
+ * @brief Set the Primary Write Quorum
+ * @param opt Data Type Update options
+ * @param value Primary Write Quorum
+ */
+void
+riak_dt_update_options_set_pw(riak_dt_update_options *opt,
+                              riak_uint32_t           value);
+/**
+ * @brief Set the Return Body flag
+ * @param opt Data Type Update options
+ * @param value Return Body flag
+ */
+void
+riak_dt_update_options_set_return_body(riak_dt_update_options *opt,
+                                       riak_boolean_t          value);
+/**
+ * @brief Set the Timeout
+ * @param opt Data Type Update options
+ * @param value Timeout in milliseconds
+ */
+void
+riak_dt_update_options_set_timeout(riak_dt_update_options *opt,
+                                   riak_uint32_t           value);
+/**
+ * @brief Set the Sloppy Quorum flag
+ * @param opt Data Type Update options
+ * @param value Sloppy Quorum flag
+ */
+void
+riak_dt_update_options_set_sloppy_quorum(riak_dt_update_options *opt,
+                                         riak_boolean_t          value);
+/**
+ * @brief Set the N Value
+ * @param opt Data Type Update options
+ * @param value N Value
+ */
+void
+riak_dt_update_options_set_n_val(riak_dt_update_options *opt,
+                                 riak_uint32_t           value);
+/**
+ * @brief Set whether Return Body includes the context (default true)
+ * @param opt Data Type Update options
+ * @param value Include Context flag
+ */
+void
+riak_dt_update_options_set_include_context(riak_dt_update_options *opt,
+                                           riak_boolean_t          value);
+
+#endif
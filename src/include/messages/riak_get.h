@@ -23,8 +23,16 @@
 #ifndef _RIAK_GET_MESSAGE_H
 #define _RIAK_GET_MESSAGE_H
 
+/*
+ * Lifetime: the vclock, the objects in a Get response and every binary
+ * reached through them (value, content type, links, user metadata,
+ * indexes, ...) point into the encoded response instead of owning copies.
+ * They are valid only until `riak_get_response_free`; copy anything kept
+ * longer, e.g. with `riak_binary_copy`, before freeing the response.
+ */
 typedef struct _riak_get_response riak_get_response;
 typedef struct _riak_get_options riak_get_options;
+typedef struct _riak_get_template riak_get_template;
 typedef void (*riak_get_response_callback)(riak_get_response *response, void *ptr);
 
 /**
@@ -99,7 +107,7 @@ riak_get_get_n_content(riak_get_response *response);
 /**
  * @brief Access an array of Riak Objects in a Get response
  * @param response Riak Get Response
- * @returns Array of Riak Objects (siblings)
+ * @returns Array of Riak Objects (siblings), valid only until the response is freed
  */
 riak_object**
 riak_get_get_content(riak_get_response *response);
@@ -375,4 +383,29 @@ void
 riak_get_options_set_n_val(riak_get_options *opt,
                            riak_uint32_t     value);
 
+/**
+ * @brief Pre-encode the bucket and options shared by many Get requests
+ * @param cfg Riak Configuration
+ * @param tmpl Prepared Get template (out)
+ * @param bucket Name of Riak bucket
+ * @param opt Riak Get Options (NULL for defaults)
+ * @returns Error code
+ * @note Later changes to `bucket` or `opt` do not affect the template
+ */
+riak_error
+riak_get_template_new(riak_config        *cfg,
+                      riak_get_template **tmpl,
+                      riak_binary        *bucket,
+                      riak_get_options   *opt);
+
+/**
+ * @brief Release a prepared Get template
+ * @param cfg Riak Configuration
+ * @param tmpl Prepared Get template
+ * @note Operations using the template must be finished first
+ */
+void
+riak_get_template_free(riak_config        *cfg,
+                       riak_get_template **tmpl);
+
 #endif
@@ -25,6 +25,20 @@
 
 typedef struct _riak_listkeys_response riak_listkeys_response;
 typedef void (*riak_listkeys_response_callback)(riak_listkeys_response *response, void *ptr);
+// Keys are views into the received message, only valid during the call
+typedef void (*riak_listkeys_stream_callback)(riak_binary **keys, riak_uint32_t n_keys, void *ptr);
+
+/**
+ * @brief Hand keys to a callback as each chunk arrives instead of collecting them
+ * @param rop Riak Operation for a listkeys request
+ * @param cb Called once per non-empty chunk
+ * @param ptr Passed through to `cb`
+ * @note The final response then only carries the key count
+ */
+void
+riak_listkeys_set_stream_cb(riak_operation               *rop,
+                            riak_listkeys_stream_callback cb,
+                            void                         *ptr);
 
 /**
  * @brief Print a summary of a `riak_listkeys_response`
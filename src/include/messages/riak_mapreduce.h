@@ -26,6 +26,20 @@
 typedef struct _riak_mapreduce_response riak_mapreduce_response;
 typedef struct _riak_mapreduce_message riak_mapreduce_message;
 typedef void (*riak_mapreduce_response_callback)(riak_mapreduce_response *response, void *ptr);
+// Result is a view into the received message, only valid during the call
+typedef void (*riak_mapreduce_stream_callback)(riak_uint32_t phase, riak_binary *result, void *ptr);
+
+/**
+ * @brief Hand each phase result to a callback as it arrives instead of collecting them
+ * @param rop Riak Operation for a Map/Reduce request
+ * @param cb Called once per message that carries a result
+ * @param ptr Passed through to `cb`
+ * @note The final response then only carries the number of results
+ */
+void
+riak_mapreduce_set_stream_cb(riak_operation                *rop,
+                             riak_mapreduce_stream_callback cb,
+                             void                          *ptr);
 
 /**
  * @brief Free Map/Reduce response
@@ -49,6 +63,14 @@ riak_mapreduce_response_print(riak_mapreduce_response *response,
                               riak_int32_t            *len,
                               riak_int32_t            *total);
 
+/**
+ * @brief Access the number of map/reduce messages received
+ * @param response Riak Map/Reduce response
+ * @returns Number of messages (streamed results when streaming)
+ */
+riak_uint32_t
+riak_mapreduce_get_n_responses(riak_mapreduce_response *response);
+
 /**
  * @brief Access the array of received map/reduce messages
  * @param response Riak Map/Reduce response
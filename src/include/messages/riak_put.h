@@ -23,6 +23,13 @@
 #ifndef _RIAK_PUT_MESSAGE_H
 #define _RIAK_PUT_MESSAGE_H
 
+/*
+ * Lifetime: the vclock, the key, the objects in a Put response and every binary
+ * reached through them (value, content type, links, user metadata,
+ * indexes, ...) point into the encoded response instead of owning copies.
+ * They are valid only until `riak_put_response_free`; copy anything kept
+ * longer, e.g. with `riak_binary_copy`, before freeing the response.
+ */
 typedef struct _riak_put_response riak_put_response;
 typedef struct _riak_put_options riak_put_options;
 typedef void (*riak_put_response_callback)(riak_put_response *response, void *ptr);
@@ -119,7 +126,7 @@ riak_put_get_n_content(riak_put_response *response);
 /**
  * @brief Access an array of Riak Objects in a Put response
  * @param response Riak Put Response
- * @returns Array of Riak Objects (siblings)
+ * @returns Array of Riak Objects (siblings), valid only until the response is freed
  */
 riak_object**
 riak_put_get_content(riak_put_response *response);
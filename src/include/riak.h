@@ -31,6 +31,7 @@
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include "riak_types.h"
 #include "riak_log_config.h"
@@ -38,10 +39,19 @@
 #include "riak_config.h"
 #include "riak_binary.h"
 #include "riak_connection.h"
+#include "riak_connection_pool.h"
 #include "riak_operation.h"
 #include "riak_object.h"
 #include "riak_bucketprops.h"
 #include "riak_messages.h"
+#include "riak_cluster.h"
+#include "riak_2index_cursor.h"
+#include "riak_multiget.h"
+#include "riak_bulk.h"
+#include "riak_view.h"
+#include "riak_aggregator.h"
+#include "riak_cache.h"
+#include "riak_notfound_filter.h"
 #include "riak_log.h"
 
 //
@@ -82,6 +92,36 @@ riak_get(riak_connection           *cxn,
          riak_get_options          *opts,
          riak_get_response        **response);
 
+/**
+ * @brief Synchronous Fetch using a prepared bucket and options
+ * @param cxn Riak Connection
+ * @param tmpl Template from `riak_get_template_new`
+ * @param key Name of Riak key
+ * @param response Returned Fetched data
+ * @returns Error code
+ */
+riak_error
+riak_get_prepared(riak_connection    *cxn,
+                  riak_get_template  *tmpl,
+                  riak_binary        *key,
+                  riak_get_response **response);
+
+/**
+ * @brief Synchronous Fetch request, decoding fields only as they are read
+ * @param cxn Riak Connection
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Fetch options
+ * @param view Returned lazy response, freed with `riak_get_view_free`
+ * @returns Error code
+ */
+riak_error
+riak_get_lazy(riak_connection  *cxn,
+              riak_binary      *bucket,
+              riak_binary      *key,
+              riak_get_options *opts,
+              riak_get_view   **view);
+
 /**
  * @brief Synchronous Store request
  * @param cxn Riak Connection
@@ -110,6 +150,79 @@ riak_delete(riak_connection     *cxn,
             riak_binary         *key,
             riak_delete_options *opts);
 
+/**
+ * @brief Synchronous Data Type (counter, set or map) fetch
+ * @param cxn Riak Connection
+ * @param bucket_type Name of the bucket type holding the data type
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Data Type Fetch options
+ * @param response Returned value and context
+ * @returns Error code
+ */
+riak_error
+riak_dt_fetch(riak_connection         *cxn,
+              riak_binary             *bucket_type,
+              riak_binary             *bucket,
+              riak_binary             *key,
+              riak_dt_fetch_options   *opts,
+              riak_dt_fetch_response **response);
+
+/**
+ * @brief Synchronous Data Type update, sending every folded operation at once
+ * @param cxn Riak Connection
+ * @param bucket_type Name of the bucket type holding the data type
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key (NULL for a server-assigned key)
+ * @param op Operations built with `riak_dt_op_new`
+ * @param opts Data Type Update options
+ * @param response Returned key, value and context
+ * @returns Error code
+ * @note `op` is left as is; clear it once the update succeeds
+ */
+riak_error
+riak_dt_update(riak_connection          *cxn,
+               riak_binary              *bucket_type,
+               riak_binary              *bucket,
+               riak_binary              *key,
+               riak_dt_op               *op,
+               riak_dt_update_options   *opts,
+               riak_dt_update_response **response);
+
+/**
+ * @brief Synchronous legacy counter update
+ * @param cxn Riak Connection
+ * @param bucket Name of Riak bucket (must allow_mult)
+ * @param key Name of Riak key
+ * @param amount Signed amount to add to the counter
+ * @param opts Counter Update options
+ * @param response Returned counter value, if requested
+ * @returns Error code
+ */
+riak_error
+riak_counter_update(riak_connection               *cxn,
+                    riak_binary                   *bucket,
+                    riak_binary                   *key,
+                    riak_int64_t                   amount,
+                    riak_counter_update_options   *opts,
+                    riak_counter_update_response **response);
+
+/**
+ * @brief Synchronous legacy counter fetch
+ * @param cxn Riak Connection
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Counter Get options
+ * @param response Returned counter value
+ * @returns Error code
+ */
+riak_error
+riak_counter_get(riak_connection            *cxn,
+                 riak_binary                *bucket,
+                 riak_binary                *key,
+                 riak_counter_get_options   *opts,
+                 riak_counter_get_response **response);
+
 /**
  * @brief List all of the buckets on a server
  * @param cxn Riak Connection
@@ -134,6 +247,24 @@ riak_listkeys(riak_connection         *cxn,
               riak_uint32_t            timeout,
               riak_listkeys_response **repsonse);
 
+/**
+ * @brief List the keys in a bucket without holding them all in memory
+ * @param cxn Riak Connection
+ * @param bucket Name of bucket
+ * @param timeout How long to wait for a response
+ * @param cb Called with each chunk of keys as it arrives
+ * @param ptr Passed through to `cb`
+ * @param n_keys Returned total number of keys (optional)
+ * @return Error code
+ */
+riak_error
+riak_listkeys_stream(riak_connection              *cxn,
+                     riak_binary                  *bucket,
+                     riak_uint32_t                 timeout,
+                     riak_listkeys_stream_callback cb,
+                     void                         *ptr,
+                     riak_uint32_t                *n_keys);
+
 /**
  * @brief Synchronous setting of client ID request
  * @param cxn Riak Connection
@@ -209,6 +340,42 @@ riak_2index(riak_connection       *cxn,
             riak_2index_options   *opts,
             riak_2index_response **response);
 
+/**
+ * @brief Fetch keys and full objects in a key range, one page per call
+ * @param cxn Riak Connection
+ * @param bucket Name of bucket
+ * @param start_key First key of the range
+ * @param opts Range and paging options
+ * @param response Returned keys, objects and continuation
+ * @returns Error code
+ */
+riak_error
+riak_csbucket(riak_connection         *cxn,
+              riak_binary             *bucket,
+              riak_binary             *start_key,
+              riak_csbucket_options   *opts,
+              riak_csbucket_response **response);
+
+/**
+ * @brief Stream every object in a key range, following continuations
+ * @param cxn Riak Connection
+ * @param bucket Name of bucket
+ * @param start_key First key of the range
+ * @param opts Range options (NULL for defaults), left untouched
+ * @param page_size Objects asked for per request (0 lets the server decide)
+ * @param cb Receives each streamed chunk, which it then owns
+ * @param ptr Passed through to `cb`
+ * @returns First error encountered
+ */
+riak_error
+riak_csbucket_fold(riak_connection               *cxn,
+                   riak_binary                   *bucket,
+                   riak_binary                   *start_key,
+                   riak_csbucket_options         *opts,
+                   riak_uint32_t                  page_size,
+                   riak_csbucket_stream_callback  cb,
+                   void                          *ptr);
+
 /**
  * @brief Synchronous Map/Reduce request
  * @param cxn Riak Connection
@@ -222,6 +389,24 @@ riak_mapreduce(riak_connection          *cxn,
                riak_binary              *map_request,
                riak_mapreduce_response **response);
 
+/**
+ * @brief Map/Reduce without holding every phase result in memory
+ * @param cxn Riak Connection
+ * @param content_type MIME content encoding string
+ * @param map_request Erlang or JS Map Reduce job
+ * @param cb Called with each phase result as it arrives
+ * @param ptr Passed through to `cb`
+ * @param n_results Returned number of results delivered (optional)
+ * @returns Error code
+ */
+riak_error
+riak_mapreduce_stream(riak_connection               *cxn,
+                      riak_binary                   *content_type,
+                      riak_binary                   *map_request,
+                      riak_mapreduce_stream_callback cb,
+                      void                          *ptr,
+                      riak_uint32_t                 *n_results);
+
 /**
  * @brief Synchronous Riak Search request
  * @param cxn Riak Connection
@@ -263,6 +448,21 @@ riak_async_register_get(riak_operation        *rop,
                         riak_get_options      *get_options,
                         riak_response_callback cb);
 
+// `tmpl` must outlive the operation
+riak_error
+riak_async_register_get_prepared(riak_operation        *rop,
+                                 riak_get_template     *tmpl,
+                                 riak_binary           *key,
+                                 riak_response_callback cb);
+
+// `cb` receives a `riak_get_view`
+riak_error
+riak_async_register_get_lazy(riak_operation        *rop,
+                             riak_binary           *bucket,
+                             riak_binary           *key,
+                             riak_get_options      *get_options,
+                             riak_response_callback cb);
+
 riak_error
 riak_async_register_put(riak_operation        *rop,
                         riak_object           *riak_obj,
@@ -275,6 +475,39 @@ riak_async_register_delete(riak_operation        *rop,
                            riak_delete_options   *options,
                            riak_response_callback cb);
 
+riak_error
+riak_async_register_dt_fetch(riak_operation        *rop,
+                             riak_binary           *bucket_type,
+                             riak_binary           *bucket,
+                             riak_binary           *key,
+                             riak_dt_fetch_options *options,
+                             riak_response_callback cb);
+
+// `op` is encoded at once, so it may be cleared as soon as this returns
+riak_error
+riak_async_register_dt_update(riak_operation         *rop,
+                              riak_binary            *bucket_type,
+                              riak_binary            *bucket,
+                              riak_binary            *key,
+                              riak_dt_op             *op,
+                              riak_dt_update_options *options,
+                              riak_response_callback  cb);
+
+riak_error
+riak_async_register_counter_update(riak_operation              *rop,
+                                   riak_binary                 *bucket,
+                                   riak_binary                 *key,
+                                   riak_int64_t                 amount,
+                                   riak_counter_update_options *options,
+                                   riak_response_callback       cb);
+
+riak_error
+riak_async_register_counter_get(riak_operation           *rop,
+                                riak_binary              *bucket,
+                                riak_binary              *key,
+                                riak_counter_get_options *options,
+                                riak_response_callback    cb);
+
 riak_error
 riak_async_register_listbuckets(riak_operation        *rop,
                                 riak_response_callback cb);
@@ -313,9 +546,11 @@ riak_async_register_set_bucketprops(riak_operation        *rop,
  * @param rop Riak Operation
  * @param content_type MIME content encoding string
  * @param map_request Erlang or JS Map/Reduce job
- * @param streaming True if partial results should be returned
+ * @param streaming True to send results as they arrive to the callback
+ * given to `riak_mapreduce_set_stream_cb`; false drops any such callback
+ * and collects the results
  * @param cb User-defined callback for results
- * @returns Error Code
+ * @returns ERIAK_UNINITIALIZED if streaming without a stream callback
  */
 riak_error
 riak_async_register_mapreduce(riak_operation        *rop,
@@ -340,6 +575,22 @@ riak_async_register_2index(riak_operation        *rop,
                            riak_2index_options   *index_options,
                            riak_response_callback cb);
 
+/**
+ * @brief Register an asynchronous bucket range fold
+ * @param rop Riak Operation
+ * @param bucket Riak bucket name
+ * @param start_key First key of the range
+ * @param options Optional range and paging parameters
+ * @param cb User-defined callback for results
+ * @returns Error Code
+ */
+riak_error
+riak_async_register_csbucket(riak_operation        *rop,
+                             riak_binary           *bucket,
+                             riak_binary           *start_key,
+                             riak_csbucket_options *options,
+                             riak_response_callback cb);
+
 /**
  * @brief Register an asynchronous Riak Search job
  * @param rop Riak Operation
@@ -356,6 +607,47 @@ riak_async_register_search(riak_operation        *rop,
                            riak_search_options   *index_options,
                            riak_response_callback cb);
 
+//
+// P I P E L I N E D
+//
+
+/**
+ * @brief Queue a registered operation without waiting for its response
+ * @param rop Riak Operation, prepared with a `riak_async_register_*` call
+ * @returns Error code
+ * @note The connection owns `rop` from here on. Requests go out on the
+ * next `riak_pipeline_flush`; callbacks fire from `riak_pipeline_receive`
+ * in the order requests were queued
+ */
+riak_error
+riak_pipeline_send(riak_operation *rop);
+
+/**
+ * @brief Write every queued request on the connection, batching many per syscall
+ * @param cxn Riak Connection
+ * @returns Error code; a write error fails every pending request through
+ * its error callback
+ */
+riak_error
+riak_pipeline_flush(riak_connection *cxn);
+
+/**
+ * @brief Block until the oldest pipelined request is answered and dispatch it
+ * @param cxn Riak Connection
+ * @returns Error code; a network error fails every pending request through
+ * its error callback
+ */
+riak_error
+riak_pipeline_receive(riak_connection *cxn);
+
+/**
+ * @brief Receive responses until nothing is pending on the connection
+ * @param cxn Riak Connection
+ * @returns First error encountered
+ */
+riak_error
+riak_pipeline_drain(riak_connection *cxn);
+
 /**
   @param ptr Private data for user
   @param data pointer to a buffer that will store the data
@@ -377,4 +669,26 @@ riak_write(riak_operation *rop,
            riak_io_cb      write_cb,
            void           *write_cb_data);
 
+/**
+  @param ptr Private data for user
+  @param iov Buffers to write, in order
+  @param iovcnt Number of entries in `iov`
+  @returns The Number of bytes written, or -1 on error
+ */
+typedef riak_ssize_t (*riak_iov_cb)(void         *ptr,
+                                    struct iovec *iov,
+                                    int           iovcnt);
+
+/**
+ * @brief Frame a request and hand header and payload to one vectored write
+ * @param rop Riak Operation
+ * @param writev_cb Vectored write function, e.g. wrapping `writev`/`sendmsg`
+ * @param writev_cb_data Pointer passed to `writev_cb`
+ * @returns Error code
+ */
+riak_error
+riak_writev(riak_operation *rop,
+            riak_iov_cb     writev_cb,
+            void           *writev_cb_data);
+
 #endif // _RIAK_H
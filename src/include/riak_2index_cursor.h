@@ -0,0 +1,93 @@
+/*********************************************************************
+ *
+ * riak_2index_cursor.h: Paged Secondary Index queries
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_2INDEX_CURSOR_H
+#define _RIAK_2INDEX_CURSOR_H
+
+typedef struct _riak_2index_cursor riak_2index_cursor;
+
+/**
+ * @brief Construct a cursor that pages through a Secondary Index query
+ * @param cxn Riak Connection, dedicated to the cursor until it is freed
+ * @param cursor Riak Secondary Index Cursor (out)
+ * @param bucket Name of bucket
+ * @param index Name of Secondary Index
+ * @param opts Query options (NULL for defaults); the cursor turns on
+ * streaming and updates continuation and max results, so they must outlive it
+ * @param page_size Entries asked for per page (0 lets the server decide)
+ * @param cb Receives each streamed chunk, which it then owns
+ * @param ptr Passed through to `cb`
+ * @returns Error code
+ */
+riak_error
+riak_2index_cursor_new(riak_connection             *cxn,
+                       riak_2index_cursor         **cursor,
+                       riak_binary                 *bucket,
+                       riak_binary                 *index,
+                       riak_2index_options         *opts,
+                       riak_uint32_t                page_size,
+                       riak_2index_stream_callback  cb,
+                       void                        *ptr);
+
+/**
+ * @brief Receive one page and hand its chunks to the callback
+ * @param cursor Riak Secondary Index Cursor
+ * @returns Error code
+ * @note The request for the following page is sent before the callback
+ * runs, so the server works on it while the application consumes this one
+ */
+riak_error
+riak_2index_cursor_next(riak_2index_cursor *cursor);
+
+/**
+ * @brief Follow continuations until the query is exhausted
+ * @param cursor Riak Secondary Index Cursor
+ * @returns First error encountered
+ */
+riak_error
+riak_2index_cursor_run(riak_2index_cursor *cursor);
+
+/**
+ * @brief Determine if every page has been delivered
+ * @param cursor Riak Secondary Index Cursor
+ * @returns True when there is nothing left to fetch
+ */
+riak_boolean_t
+riak_2index_cursor_get_done(riak_2index_cursor *cursor);
+
+/**
+ * @brief Number of pages delivered so far
+ * @param cursor Riak Secondary Index Cursor
+ * @returns Page count
+ */
+riak_uint32_t
+riak_2index_cursor_get_n_pages(riak_2index_cursor *cursor);
+
+/**
+ * @brief Release the cursor, discarding any prefetched page
+ * @param cursor Riak Secondary Index Cursor (NULLed on return)
+ */
+void
+riak_2index_cursor_free(riak_2index_cursor **cursor);
+
+#endif // _RIAK_2INDEX_CURSOR_H
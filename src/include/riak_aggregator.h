@@ -0,0 +1,138 @@
+/*********************************************************************
+ *
+ * riak_aggregator.h: Local aggregation of legacy counter increments
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_AGGREGATOR_H
+#define _RIAK_AGGREGATOR_H
+
+/*
+ * Increments are summed per (bucket, key) in a fixed-size table that any
+ * number of threads may count into at once. A flush pipelines one
+ * RpbCounterUpdateReq per key on a single connection, each carrying
+ * everything added since the last flush, whether it runs on the background timer, because `threshold`
+ * increments arrived, or because the caller asked. A pair with nothing
+ * to send when a flush reaches it has seen no increment for a whole flush
+ * interval and is dropped, briefly holding up increments while the table
+ * is rebuilt.
+ */
+
+typedef struct _riak_aggregator riak_aggregator;
+
+/**
+ * @brief Construct an aggregator flushing through `pool`
+ * @param cfg Riak Configuration (must not use an arena)
+ * @param agg Riak Aggregator (out)
+ * @param pool Connection pool used by every flush
+ * @param max_keys Upper bound on bucket/key pairs tracked at once; idle
+ *        pairs are dropped by the flush, making room for new ones
+ * @param opts Counter Update options for every flush (NULL for defaults)
+ * @returns Error code
+ */
+riak_error
+riak_aggregator_new(riak_config                 *cfg,
+                    riak_aggregator            **agg,
+                    riak_connection_pool        *pool,
+                    riak_uint32_t                max_keys,
+                    riak_counter_update_options *opts);
+
+/**
+ * @brief Stop the background flush and release the aggregator
+ * @param agg Riak Aggregator (NULLed on return)
+ * @note Sends whatever is still pending first; sums that cannot be sent
+ *       then are logged and lost, so flush first to handle the error
+ */
+void
+riak_aggregator_free(riak_aggregator **agg);
+
+/**
+ * @brief Add to a counter without touching the network
+ * @param agg Riak Aggregator
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param amount Signed amount to add
+ * @returns ERIAK_AGGREGATOR_FULL if `max_keys` pairs are already tracked
+ *          and none has been idle long enough to be dropped
+ * @note Without a background flush, the increment reaching the threshold
+ * flushes on the calling thread
+ */
+riak_error
+riak_aggregator_increment(riak_aggregator *agg,
+                          riak_binary     *bucket,
+                          riak_binary     *key,
+                          riak_int64_t     amount);
+
+/**
+ * @brief Send every pending sum, one update per key, and wait for the replies
+ * @param agg Riak Aggregator
+ * @returns First error seen; sums lost to a network error stay pending,
+ *          while sums the server rejects are logged and dropped
+ */
+riak_error
+riak_aggregator_flush(riak_aggregator *agg);
+
+/**
+ * @brief Flush early once this many increments are pending
+ * @param agg Riak Aggregator
+ * @param threshold Number of increments (0 to flush on the timer only)
+ */
+void
+riak_aggregator_set_threshold(riak_aggregator *agg,
+                              riak_uint64_t    threshold);
+
+/**
+ * @brief Flush from a background thread every `interval_ms`
+ * @param agg Riak Aggregator
+ * @param interval_ms Milliseconds between flushes
+ * @returns Error code
+ */
+riak_error
+riak_aggregator_start(riak_aggregator *agg,
+                      riak_uint32_t    interval_ms);
+
+/**
+ * @brief Stop and join the background flush thread
+ * @param agg Riak Aggregator
+ */
+void
+riak_aggregator_stop(riak_aggregator *agg);
+
+/**
+ * @brief Sum not yet sent for one counter
+ * @param agg Riak Aggregator
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @returns Pending amount (0 if the pair is not tracked)
+ */
+riak_int64_t
+riak_aggregator_get_pending(riak_aggregator *agg,
+                            riak_binary     *bucket,
+                            riak_binary     *key);
+
+/**
+ * @brief Number of distinct bucket/key pairs tracked
+ * @param agg Riak Aggregator
+ * @returns Count of keys
+ */
+riak_uint32_t
+riak_aggregator_get_n_keys(riak_aggregator *agg);
+
+#endif // _RIAK_AGGREGATOR_H
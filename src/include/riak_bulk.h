@@ -0,0 +1,100 @@
+/*********************************************************************
+ *
+ * riak_bulk.h: Load many objects over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_BULK_H
+#define _RIAK_BULK_H
+
+typedef struct _riak_bulk_options {
+    riak_uint32_t concurrency;  // Connections (and threads) storing at once, at most the pool size
+    riak_uint32_t window;       // Puts in flight on each connection
+    riak_uint32_t retries;      // Extra attempts for an object that failed, except on
+                                // a failed if_none_match or if_not_modified
+    riak_uint32_t backoff_base; // Delay before the first retry, in ms
+    riak_uint32_t backoff_max;  // Retry delays double up to this cap
+} riak_bulk_options;
+
+// Stage timings are summed over every worker, in microseconds
+typedef struct _riak_bulk_stats {
+    riak_uint64_t  n_stored;
+    riak_uint64_t  n_failed;    // Gave up after every retry
+    riak_uint64_t  n_retries;
+    riak_uint64_t  elapsed_ms;
+    riak_float64_t objects_per_sec;
+    riak_uint64_t  read_us;     // Waiting on the source
+    riak_uint64_t  encode_us;   // Packing requests
+    riak_uint64_t  network_us;  // From writing a window until its last response
+} riak_bulk_stats;
+
+#define RIAK_BULK_DEFAULT_CONCURRENCY 4
+#define RIAK_BULK_DEFAULT_WINDOW      64
+#define RIAK_BULK_DEFAULT_RETRIES     3
+
+/**
+ * @brief Supply the next object to store
+ * @param cfg Riak Configuration to allocate the object with
+ * @param object Next object, or NULL once the source is exhausted (out)
+ * @param ptr User data given to `riak_bulk_load`
+ * @returns Error code; an error stops reading but not in-flight puts
+ * @note Never called from two threads at once. The loader frees each object
+ */
+typedef riak_error (*riak_bulk_source)(riak_config  *cfg,
+                                       riak_object **object,
+                                       void         *ptr);
+
+/**
+ * @brief Fill in the default bulk load options
+ * @param opts Options to initialize
+ */
+void
+riak_bulk_options_init(riak_bulk_options *opts);
+
+/**
+ * @brief Store every object a source yields
+ * @param pool Connection pool to spread the puts over
+ * @param put_opts Store options applied to every object (NULL for defaults)
+ * @param opts Concurrency, window and retry policy (NULL for defaults)
+ * @param source Called for more objects only when a window has room
+ * @param ptr Passed through to `source`
+ * @param stats Counts, throughput and stage timings (out, optional)
+ * @returns First error encountered; failed objects do not stop the load
+ */
+riak_error
+riak_bulk_load(riak_connection_pool *pool,
+               riak_put_options     *put_opts,
+               riak_bulk_options    *opts,
+               riak_bulk_source      source,
+               void                 *ptr,
+               riak_bulk_stats      *stats);
+
+/**
+ * @brief Print bulk load statistics
+ * @param stats Statistics from `riak_bulk_load`
+ * @param target Location of string to be formatted
+ * @param len Number of free bytes
+ */
+void
+riak_bulk_stats_print(riak_bulk_stats *stats,
+                      char            *target,
+                      riak_size_t      len);
+
+#endif // _RIAK_BULK_H
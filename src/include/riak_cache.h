@@ -0,0 +1,166 @@
+/*********************************************************************
+ *
+ * riak_cache.h: Client-side read-through object cache
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_CACHE_H
+#define _RIAK_CACHE_H
+
+/*
+ * Fetched objects are kept, still encoded, in shards each guarded by
+ * their own lock and bounded by entries and bytes. A copy younger than
+ * the TTL is answered without touching the network; an older one is
+ * revalidated by sending its vclock as `if_modified`, so an unchanged
+ * object costs a round trip but not its body. Stores and deletes made
+ * through the cache drop the local copy.
+ */
+
+typedef struct _riak_cache riak_cache;
+
+/**
+ * @brief Construct an empty object cache
+ * @param cfg Riak Configuration (must not use an arena)
+ * @param cache Riak Cache (out)
+ * @param n_shards Number of independently locked shards
+ * @param max_entries Most objects kept across all shards
+ * @param max_bytes Most encoded bytes kept across all shards
+ * @param ttl_ms Milliseconds a copy is served before revalidating (0 to always revalidate)
+ * @returns Error code
+ */
+riak_error
+riak_cache_new(riak_config   *cfg,
+               riak_cache   **cache,
+               riak_uint32_t  n_shards,
+               riak_uint32_t  max_entries,
+               riak_size_t    max_bytes,
+               riak_uint32_t  ttl_ms);
+
+/**
+ * @brief Release the cache and every object in it
+ * @param cache Riak Cache (NULLed on return)
+ */
+void
+riak_cache_free(riak_cache **cache);
+
+/**
+ * @brief Synchronous Fetch request, answered from the cache when possible
+ * @param cxn Riak Connection
+ * @param cache Riak Cache
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Fetch options (`head` or `if_modified` bypass the cache)
+ * @param response Returned Fetched data, owned by the caller and allocated
+ *        from the cache's configuration even when `cxn` uses an arena
+ * @returns Error code
+ */
+riak_error
+riak_cache_get(riak_connection    *cxn,
+               riak_cache         *cache,
+               riak_binary        *bucket,
+               riak_binary        *key,
+               riak_get_options   *opts,
+               riak_get_response **response);
+
+/**
+ * @brief Synchronous Store request, dropping any cached copy
+ * @param cxn Riak Connection
+ * @param cache Riak Cache
+ * @param obj Object to be stored in Riak
+ * @param opts Store options
+ * @param response Returned Fetched data
+ * @returns Error code
+ */
+riak_error
+riak_cache_put(riak_connection    *cxn,
+               riak_cache         *cache,
+               riak_object        *obj,
+               riak_put_options   *opts,
+               riak_put_response **response);
+
+/**
+ * @brief Synchronous Delete request, dropping any cached copy
+ * @param cxn Riak Connection
+ * @param cache Riak Cache
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Delete options
+ * @returns Error code
+ */
+riak_error
+riak_cache_delete(riak_connection     *cxn,
+                  riak_cache          *cache,
+                  riak_binary         *bucket,
+                  riak_binary         *key,
+                  riak_delete_options *opts);
+
+/**
+ * @brief Drop the cached copy of one object
+ * @param cache Riak Cache
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @note Fetches already in flight for the same shard will not be cached
+ */
+void
+riak_cache_invalidate(riak_cache  *cache,
+                      riak_binary *bucket,
+                      riak_binary *key);
+
+/**
+ * @brief Number of objects currently cached
+ * @param cache Riak Cache
+ * @returns Count of objects
+ */
+riak_uint32_t
+riak_cache_get_n_entries(riak_cache *cache);
+
+/**
+ * @brief Encoded bytes currently cached
+ * @param cache Riak Cache
+ * @returns Count of bytes
+ */
+riak_size_t
+riak_cache_get_n_bytes(riak_cache *cache);
+
+/**
+ * @brief Fetches answered without a round trip
+ * @param cache Riak Cache
+ * @returns Count of fetches
+ */
+riak_uint64_t
+riak_cache_get_hits(riak_cache *cache);
+
+/**
+ * @brief Fetches answered by a revalidation that found the copy unchanged
+ * @param cache Riak Cache
+ * @returns Count of fetches
+ */
+riak_uint64_t
+riak_cache_get_revalidated(riak_cache *cache);
+
+/**
+ * @brief Fetches that transferred the whole object
+ * @param cache Riak Cache
+ * @returns Count of fetches
+ */
+riak_uint64_t
+riak_cache_get_misses(riak_cache *cache);
+
+#endif // _RIAK_CACHE_H
@@ -0,0 +1,162 @@
+/*********************************************************************
+ *
+ * riak_cluster.h: Load balancing across several Riak nodes
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_CLUSTER_H
+#define _RIAK_CLUSTER_H
+
+typedef struct _riak_cluster riak_cluster;
+typedef struct _riak_cluster_node riak_cluster_node;
+
+typedef enum _riak_cluster_policy {
+    RIAK_CLUSTER_ROUND_ROBIN = 0,
+    RIAK_CLUSTER_LEAST_OUTSTANDING,
+    RIAK_CLUSTER_LATENCY_WEIGHTED
+} riak_cluster_policy;
+
+#define RIAK_CLUSTER_DEFAULT_RETRY_MS   5000
+
+/**
+ * @brief Construct an empty cluster
+ * @param cfg Riak config for memory allocation
+ * @param cluster Riak Cluster (out)
+ * @param policy How to choose a node for each operation
+ * @returns Error code
+ */
+riak_error
+riak_cluster_new(riak_config         *cfg,
+                 riak_cluster       **cluster,
+                 riak_cluster_policy  policy);
+
+/**
+ * @brief Release the cluster and every node's connection pool
+ * @param cluster Riak Cluster
+ */
+void
+riak_cluster_free(riak_cluster **cluster);
+
+/**
+ * @brief Add a node, backed by its own connection pool
+ * @param cluster Riak Cluster
+ * @param hostname Name of Riak server
+ * @param portnum Riak PBC port number
+ * @param resolver IP Address resolving function (NULL for default)
+ * @param max_connections Upper bound on open sockets to this node
+ * @returns Error code
+ */
+riak_error
+riak_cluster_add_node(riak_cluster      *cluster,
+                      const char        *hostname,
+                      const char        *portnum,
+                      riak_addr_resolver resolver,
+                      riak_uint32_t      max_connections);
+
+/**
+ * @brief How long a node that failed stays out of rotation
+ * @param cluster Riak Cluster
+ * @param retry_ms Milliseconds before the node is tried again
+ */
+void
+riak_cluster_set_retry_interval(riak_cluster *cluster,
+                                riak_uint32_t retry_ms);
+
+/**
+ * @brief Borrow a connection from the best available node
+ * @param cluster Riak Cluster
+ * @param node Node the connection belongs to (out)
+ * @param cxn Checked-out Riak Connection (out)
+ * @returns ERIAK_NO_NODES if every node is down or exhausted
+ * @note Nodes that fail to connect are marked down and skipped
+ */
+riak_error
+riak_cluster_checkout(riak_cluster       *cluster,
+                      riak_cluster_node **node,
+                      riak_connection   **cxn);
+
+/**
+ * @brief Return a connection, recording the outcome of its operation
+ * @param cluster Riak Cluster
+ * @param node Node returned by `riak_cluster_checkout`
+ * @param cxn Riak Connection (NULLed on return)
+ * @param result Error code of the operation run on `cxn`
+ * @note A network error evicts the connection and marks the node down
+ */
+void
+riak_cluster_checkin(riak_cluster      *cluster,
+                     riak_cluster_node *node,
+                     riak_connection  **cxn,
+                     riak_error         result);
+
+/**
+ * @brief Number of nodes currently in rotation
+ * @param cluster Riak Cluster
+ * @returns Count of nodes not marked down
+ */
+riak_uint32_t
+riak_cluster_get_n_up(riak_cluster *cluster);
+
+/**
+ * @brief Fetch, retrying on another node after a network error
+ * @param cluster Riak Cluster
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Fetch options
+ * @param response Returned Fetched data
+ * @returns Error code
+ */
+riak_error
+riak_cluster_get(riak_cluster       *cluster,
+                 riak_binary        *bucket,
+                 riak_binary        *key,
+                 riak_get_options   *opts,
+                 riak_get_response **response);
+
+/**
+ * @brief List keys, retrying on another node after a network error
+ * @param cluster Riak Cluster
+ * @param bucket Name of bucket
+ * @param timeout How long to wait for a response
+ * @param response Returned collection of key names
+ * @returns Error code
+ */
+riak_error
+riak_cluster_listkeys(riak_cluster            *cluster,
+                      riak_binary             *bucket,
+                      riak_uint32_t            timeout,
+                      riak_listkeys_response **response);
+
+/**
+ * @brief Secondary Index query, retrying on another node after a network error
+ * @param cluster Riak Cluster
+ * @param bucket Name of bucket
+ * @param index Name of Secondary Index
+ * @param opts Secondary Index options
+ * @param response Returned index entries
+ * @returns Error code
+ */
+riak_error
+riak_cluster_2index(riak_cluster          *cluster,
+                    riak_binary           *bucket,
+                    riak_binary           *index,
+                    riak_2index_options   *opts,
+                    riak_2index_response **response);
+
+#endif // _RIAK_CLUSTER_H
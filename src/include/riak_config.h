@@ -23,8 +23,9 @@
 #ifndef _RIAK_CONFIG_H
 #define _RIAK_CONFIG_H
 
-// per-thread
-// do we need a *shared* config to complement?
+// A config may be shared by every thread once it is set up: it is never
+// modified by operations. Anything threads do mutate (free lists, stats)
+// lives in a per-thread context hanging off the config.
 
 typedef void *(*riak_alloc_fn)(size_t sz);
 typedef void *(*riak_realloc_fn)(void *ptr, size_t size);
@@ -34,6 +35,11 @@ typedef void (*riak_pb_free_fn)(void *allocator_data, void *pointer);
 
 typedef struct _riak_config riak_config;
 
+typedef struct _riak_thread_stats {
+    riak_uint64_t operations;        // Operations started by this thread
+    riak_uint64_t operations_reused; // ... of which came off the free list
+} riak_thread_stats;
+
 /**
  * @brief Construct a Riak Configuration
  * @param cfg Spanking new `riak_config` struct
@@ -90,9 +96,55 @@ void*
 riak_config_clean_allocate(riak_config *cfg,
                            riak_size_t  bytes);
 
+// Size of each chunk an arena claims from its parent's allocator
+#define RIAK_CONFIG_ARENA_BLOCK_SIZE 8192
+
+/**
+ * @brief Construct an arena that bump-allocates out of large blocks
+ * @param parent Riak Config supplying the blocks and the logging setup
+ * @param arena Spanking new arena `riak_config` (out)
+ * @param block_size Bytes claimed per block (0 for RIAK_CONFIG_ARENA_BLOCK_SIZE)
+ * @returns Error code
+ * @note Everything allocated through the arena, protocol buffers included,
+ *       is released at once by `riak_config_arena_reset`; `riak_free` on
+ *       arena memory does nothing. An arena is not thread-safe.
+ */
+riak_error
+riak_config_new_arena(riak_config  *parent,
+                      riak_config **arena,
+                      riak_size_t   block_size);
+
+/**
+ * @brief Release everything allocated from an arena in one shot
+ * @param arena Riak Config built by `riak_config_new_arena`
+ * @note One block is kept around for the next operation
+ */
+void
+riak_config_arena_reset(riak_config *arena);
+
+/**
+ * @brief Bytes currently handed out by an arena
+ * @param arena Riak Config built by `riak_config_new_arena`
+ * @returns Bytes in use (0 for an ordinary config)
+ */
+riak_size_t
+riak_config_get_arena_used(riak_config *arena);
+
+/**
+ * @brief Counters kept by the calling thread
+ * @param cfg Riak Config
+ * @param stats Copy of this thread's counters (out)
+ * @returns Error code
+ */
+riak_error
+riak_config_get_thread_stats(riak_config       *cfg,
+                             riak_thread_stats *stats);
+
 /**
  * @brief Reclaim memory used by a `riak_config`
  * @param cfg Configuration struct
+ * @note Releases the contexts of every thread that used the config, so
+ *       no other thread may still be using it
  */
 void
 riak_config_free(riak_config **cfg);
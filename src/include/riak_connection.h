@@ -25,6 +25,20 @@
 
 typedef struct _riak_connection riak_connection;
 
+// All times in milliseconds; a zero timeout waits indefinitely
+typedef struct _riak_connection_options {
+    riak_uint32_t connect_timeout; // Across every address of the host
+    riak_uint32_t read_timeout;    // Longest wait for the next bytes of a response
+    riak_uint32_t write_timeout;   // Longest wait for room to send
+    riak_uint32_t connect_retries; // Extra attempts after the first fails
+    riak_uint32_t backoff_base;    // Delay before the first retry
+    riak_uint32_t backoff_max;     // Retry delays double up to this cap
+} riak_connection_options;
+
+#define RIAK_CONNECTION_DEFAULT_CONNECT_TIMEOUT 5000
+#define RIAK_CONNECTION_DEFAULT_BACKOFF_BASE    100
+#define RIAK_CONNECTION_DEFAULT_BACKOFF_MAX     10000
+
 /**
  * @brief Construct a Riak event
  * @param cfg Riak config for memory allocation
@@ -40,6 +54,51 @@ riak_connection_new(riak_config       *cfg,
                     const char        *hostname,
                     const char        *portnum,
                     riak_addr_resolver resolver);
+/**
+ * @brief Construct a Riak event with explicit timeouts and retries
+ * @param cfg Riak config for memory allocation
+ * @param cxn Riak Connection (out)
+ * @param hostname Name of Riak server
+ * @param portnum Riak PBC port number
+ * @param resolver IP Address resolving function (NULL for default)
+ * @param opts Timeouts and retry policy (NULL for defaults)
+ * @returns Error code
+ */
+riak_error
+riak_connection_new_with_options(riak_config             *cfg,
+                                 riak_connection        **cxn,
+                                 const char              *hostname,
+                                 const char              *portnum,
+                                 riak_addr_resolver       resolver,
+                                 riak_connection_options *opts);
+
+/**
+ * @brief Fill in the default connection options
+ * @param opts Options to initialize
+ */
+void
+riak_connection_options_init(riak_connection_options *opts);
+
+/**
+ * @brief Drop the socket and anything in flight, then connect again
+ * @param cxn Riak Connection
+ * @returns Error code
+ * @note Retries with exponential backoff and jitter, per the connection's options
+ */
+riak_error
+riak_connection_reconnect(riak_connection *cxn);
+
+/**
+ * @brief Change how long reads and writes may wait
+ * @param cxn Riak Connection
+ * @param read_timeout Milliseconds (0 waits indefinitely)
+ * @param write_timeout Milliseconds (0 waits indefinitely)
+ */
+void
+riak_connection_set_timeouts(riak_connection *cxn,
+                             riak_uint32_t    read_timeout,
+                             riak_uint32_t    write_timeout);
+
 /**
  * @brief Cleanup memory used by a Riak Connection
  * @param re Riak Connection
@@ -53,4 +112,22 @@ riak_connection_get_fd(riak_connection *cxn);
 riak_config*
 riak_connection_get_config(riak_connection *cxn);
 
+/**
+ * @brief Allocate every operation started on this connection from an arena
+ * @param cxn Riak Connection
+ * @param arena Riak Config built by `riak_config_new_arena` (NULL to stop)
+ * @note Free responses with the arena, then `riak_config_arena_reset` it
+ */
+void
+riak_connection_set_arena(riak_connection *cxn,
+                          riak_config     *arena);
+
+/**
+ * @brief Number of pipelined requests still waiting for a response
+ * @param cxn Riak Connection
+ * @returns Count of pending operations
+ */
+riak_uint32_t
+riak_connection_get_n_pending(riak_connection *cxn);
+
 #endif // _RIAK_CONNECTION_H
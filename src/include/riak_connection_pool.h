@@ -0,0 +1,153 @@
+/*********************************************************************
+ *
+ * riak_connection_pool.h: Pool of warm Riak Connections to one node
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_CONNECTION_POOL_H
+#define _RIAK_CONNECTION_POOL_H
+
+typedef struct _riak_connection_pool riak_connection_pool;
+
+// How long batch helpers wait for a pooled connection before giving up
+#define RIAK_CONNECTION_POOL_DEFAULT_WAIT_MS 5000
+
+/**
+ * @brief Construct a pool of connections to a single Riak node
+ * @param cfg Riak config for memory allocation
+ * @param pool Riak Connection Pool (out)
+ * @param hostname Name of Riak server
+ * @param portnum Riak PBC port number
+ * @param resolver IP Address resolving function (NULL for default)
+ * @param max_connections Upper bound on open sockets
+ * @returns Error code
+ * @note No sockets are opened here; see `riak_connection_pool_warm`
+ */
+riak_error
+riak_connection_pool_new(riak_config           *cfg,
+                         riak_connection_pool **pool,
+                         const char            *hostname,
+                         const char            *portnum,
+                         riak_addr_resolver     resolver,
+                         riak_uint32_t          max_connections);
+
+/**
+ * @brief Close every idle connection and release the pool
+ * @param pool Riak Connection Pool
+ * @note All connections must have been checked back in first
+ */
+void
+riak_connection_pool_free(riak_connection_pool **pool);
+
+/**
+ * @brief Open sockets ahead of time so they are ready for use
+ * @param pool Riak Connection Pool
+ * @param count Number of idle connections to have open
+ * @returns Error code of the first failed connect
+ */
+riak_error
+riak_connection_pool_warm(riak_connection_pool *pool,
+                          riak_uint32_t         count);
+
+/**
+ * @brief Borrow a connection, reconnecting lazily if none are idle
+ * @param pool Riak Connection Pool
+ * @param cxn Checked-out Riak Connection (out)
+ * @returns ERIAK_POOL_EXHAUSTED if `max_connections` are all in use
+ */
+riak_error
+riak_connection_pool_checkout(riak_connection_pool *pool,
+                              riak_connection     **cxn);
+
+/**
+ * @brief Borrow a connection, waiting for one to be returned if all are in use
+ * @param pool Riak Connection Pool
+ * @param cxn Checked-out Riak Connection (out)
+ * @param timeout_ms Longest to wait for a free slot
+ * @returns ERIAK_POOL_EXHAUSTED if nothing came back in time
+ */
+riak_error
+riak_connection_pool_checkout_wait(riak_connection_pool *pool,
+                                   riak_connection     **cxn,
+                                   riak_uint32_t         timeout_ms);
+
+/**
+ * @brief Return a healthy connection to the pool
+ * @param pool Riak Connection Pool
+ * @param cxn Riak Connection (NULLed on return)
+ * @note A connection the pool has no idle slot for, such as one that was
+ * not checked out of it, is closed instead of queued
+ */
+void
+riak_connection_pool_checkin(riak_connection_pool *pool,
+                             riak_connection     **cxn);
+
+/**
+ * @brief Close a connection that saw a network error instead of returning it
+ * @param pool Riak Connection Pool
+ * @param cxn Riak Connection (NULLed on return)
+ */
+void
+riak_connection_pool_evict(riak_connection_pool *pool,
+                           riak_connection     **cxn);
+
+/**
+ * @brief Ping every connection idle for longer than `idle_ms`, evicting the dead
+ * @param pool Riak Connection Pool
+ * @param idle_ms Only check connections unused for at least this long
+ * @returns Number of connections evicted
+ */
+riak_uint32_t
+riak_connection_pool_check_health(riak_connection_pool *pool,
+                                  riak_uint32_t         idle_ms);
+
+/**
+ * @brief Start a background thread calling `riak_connection_pool_check_health`
+ * @param pool Riak Connection Pool
+ * @param interval_ms How often to check idle connections
+ * @returns Error code
+ */
+riak_error
+riak_connection_pool_start_health_check(riak_connection_pool *pool,
+                                        riak_uint32_t         interval_ms);
+
+/**
+ * @brief Stop and join the background health check thread
+ * @param pool Riak Connection Pool
+ */
+void
+riak_connection_pool_stop_health_check(riak_connection_pool *pool);
+
+/**
+ * @brief Number of open connections, idle or checked out
+ * @param pool Riak Connection Pool
+ * @returns Open connection count
+ */
+riak_uint32_t
+riak_connection_pool_get_n_open(riak_connection_pool *pool);
+
+/**
+ * @brief Number of open connections waiting to be checked out
+ * @param pool Riak Connection Pool
+ * @returns Idle connection count
+ */
+riak_uint32_t
+riak_connection_pool_get_n_idle(riak_connection_pool *pool);
+
+#endif // _RIAK_CONNECTION_POOL_H
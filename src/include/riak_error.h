@@ -36,6 +36,11 @@ typedef enum riak_error_enum {
     ERIAK_UNINITIALIZED,
     ERIAK_SERVER_ERROR,
     ERIAK_MESSAGE_FORMAT,
+    ERIAK_POOL_EXHAUSTED,
+    ERIAK_NO_NODES,
+    ERIAK_TIMEOUT,
+    ERIAK_DT_TYPE,
+    ERIAK_AGGREGATOR_FULL,
     ERIAK_LAST_ERRORNUM
 } riak_error;
 
@@ -53,6 +58,11 @@ static const char* errmsgs[] = {
     "Uninitialized Value",
     "An error was returned from the server",
     "Message Format Error",
+    "No connections left in the pool",
+    "No Riak nodes available",
+    "Timed out",
+    "Operation does not match the data type",
+    "Counter aggregator is tracking too many keys",
     "SENTINEL FOR LAST ERROR MESSAGE"
 };
 #endif
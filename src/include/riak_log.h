@@ -82,13 +82,13 @@ riak_log_internal(riak_config         *cfg,
 #define riak_log_critical_config(cfg,format, ...) \
         riak_log_internal((cfg), RIAK_LOG_CRITICAL, __FILE__, sizeof(__FILE__)-1, \
         __func__, sizeof(__func__)-1, __LINE__, (format), __VA_ARGS__)
-#define riak_log_error_config(cxn,format, ...) \
+#define riak_log_error_config(cfg,format, ...) \
         riak_log_internal((cfg), RIAK_LOG_ERROR, __FILE__, sizeof(__FILE__)-1, \
         __func__, sizeof(__func__)-1, __LINE__, (format), __VA_ARGS__)
-#define riak_log_warn_config(cxn,format, ...) \
-        riak_log_internal(cfg), RIAK_LOG_WARN, __FILE__, sizeof(__FILE__)-1, \
+#define riak_log_warn_config(cfg,format, ...) \
+        riak_log_internal((cfg), RIAK_LOG_WARN, __FILE__, sizeof(__FILE__)-1, \
         __func__, sizeof(__func__)-1, __LINE__, (format), __VA_ARGS__)
-#define riak_log_notice_config(cxn,format, ...) \
+#define riak_log_notice_config(cfg,format, ...) \
         riak_log_internal((cfg), RIAK_LOG_NOTICE, __FILE__, sizeof(__FILE__)-1, \
         __func__, sizeof(__func__)-1, __LINE__, (format), __VA_ARGS__)
 #ifdef _RIAK_DEBUG
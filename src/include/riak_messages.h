@@ -21,7 +21,10 @@
  *********************************************************************/
 
 #include "messages/riak_2index.h"
+#include "messages/riak_counter.h"
+#include "messages/riak_csbucket.h"
 #include "messages/riak_delete.h"
+#include "messages/riak_dt.h"
 #include "messages/riak_error.h"
 #include "messages/riak_get.h"
 #include "messages/riak_get_bucketprops.h"
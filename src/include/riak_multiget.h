@@ -0,0 +1,92 @@
+/*********************************************************************
+ *
+ * riak_multiget.h: Fetch many keys over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_MULTIGET_H
+#define _RIAK_MULTIGET_H
+
+typedef struct _riak_multiget_options {
+    riak_uint32_t concurrency; // Connections (and threads) working at once, at most the pool size
+    riak_uint32_t depth;       // Requests in flight on each connection
+} riak_multiget_options;
+
+#define RIAK_MULTIGET_DEFAULT_CONCURRENCY 4
+#define RIAK_MULTIGET_DEFAULT_DEPTH       32
+
+// Owns `response` (NULL when `err` is set); calls never overlap
+typedef void (*riak_multiget_callback)(riak_uint32_t      index,
+                                       riak_error         err,
+                                       riak_get_response *response,
+                                       void              *ptr);
+
+/**
+ * @brief Fill in the default multi-get options
+ * @param opts Options to initialize
+ */
+void
+riak_multiget_options_init(riak_multiget_options *opts);
+
+/**
+ * @brief Fetch many keys from one bucket, results in key order
+ * @param pool Connection pool to spread the requests over
+ * @param bucket Name of Riak bucket
+ * @param keys Names of Riak keys
+ * @param n_keys Number of keys
+ * @param get_opts Fetch options applied to every key (NULL for defaults)
+ * @param opts Concurrency and pipeline depth (NULL for defaults)
+ * @param responses Array of `n_keys` fetched objects, NULL where a key failed (out)
+ * @param errors Array of `n_keys` per-key error codes (out, optional)
+ * @returns First error encountered; a failed key does not stop the others
+ */
+riak_error
+riak_multiget(riak_connection_pool   *pool,
+              riak_binary            *bucket,
+              riak_binary           **keys,
+              riak_uint32_t           n_keys,
+              riak_get_options       *get_opts,
+              riak_multiget_options  *opts,
+              riak_get_response     **responses,
+              riak_error             *errors);
+
+/**
+ * @brief Fetch many keys from one bucket, handing each result to a callback
+ * @param pool Connection pool to spread the requests over
+ * @param bucket Name of Riak bucket
+ * @param keys Names of Riak keys
+ * @param n_keys Number of keys
+ * @param get_opts Fetch options applied to every key (NULL for defaults)
+ * @param opts Concurrency and pipeline depth (NULL for defaults)
+ * @param cb Called once per key, in completion order, from any worker
+ * @param ptr Passed through to `cb`
+ * @returns First error encountered; a failed key does not stop the others
+ */
+riak_error
+riak_multiget_cb(riak_connection_pool   *pool,
+                 riak_binary            *bucket,
+                 riak_binary           **keys,
+                 riak_uint32_t           n_keys,
+                 riak_get_options       *get_opts,
+                 riak_multiget_options  *opts,
+                 riak_multiget_callback  cb,
+                 void                   *ptr);
+
+#endif // _RIAK_MULTIGET_H
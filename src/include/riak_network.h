@@ -23,6 +23,11 @@
 #ifndef _RIAK_NETWORK_H
 #define _RIAK_NETWORK_H
 
+// Addresses raced per connection attempt
+#define RIAK_CONNECT_MAX_ADDRS      16
+// Head start each address gets before the next one is tried (ms)
+#define RIAK_CONNECT_ATTEMPT_DELAY  250
+
 /**
  * @brief Turns ASCII host/port into addrinfo struct
  * @param cfg Riak Configuration
@@ -39,6 +44,22 @@ riak_resolve_address(riak_config      *cfg,
                      const char        *portnum,
                      riak_addrinfo    **addrinfo);
 
+/**
+ * @brief Connect to whichever resolved address answers first
+ * @param cfg Riak Configuration
+ * @param addrinfo Every address of the host, as returned by the resolver
+ * @param timeout Milliseconds to wait overall (0 waits for the kernel)
+ * @param sock Connected socket file descriptor (out)
+ * @returns ERIAK_TIMEOUT if nothing answered in time, ERIAK_CONNECT if all refused
+ * @note Addresses are tried RIAK_CONNECT_ATTEMPT_DELAY ms apart without
+ *       abandoning earlier attempts, alternating address families
+ */
+riak_error
+riak_connect_any(riak_config   *cfg,
+                 riak_addrinfo *addrinfo,
+                 riak_uint32_t  timeout,
+                 riak_socket_t *sock);
+
 /**
  * @brief Opens a socket and connects to a host
  * @param cfg Riak Configuration
@@ -49,6 +70,16 @@ riak_socket_t
 riak_just_open_a_socket(riak_config  *cfg,
                         riak_addrinfo *addrinfo);
 
+/**
+ * @brief Switch a socket between blocking and non-blocking mode
+ * @param sock Socket
+ * @param blocking Whether calls on it should block
+ * @returns Error code
+ */
+riak_error
+riak_set_blocking(riak_socket_t  sock,
+                  riak_boolean_t blocking);
+
 /**
  * @brief Prints a human-readable version of addrinfo
  * @param addrinfo Address to be printed
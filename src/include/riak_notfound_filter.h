@@ -0,0 +1,138 @@
+/*********************************************************************
+ *
+ * riak_notfound_filter.h: Negative-lookup cache for missing keys
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_NOTFOUND_FILTER_H
+#define _RIAK_NOTFOUND_FILTER_H
+
+/*
+ * Keys the cluster reported missing are remembered in a counting Bloom
+ * filter, so repeated probes for them are answered without a round
+ * trip. The filter is split into generations that are cleared in turn,
+ * which bounds both its memory and how long a key is remembered. Stores
+ * made through the filter forget the key. Like any Bloom filter it can
+ * report a key missing that was never seen (about 1% of lookups when
+ * `capacity` keys are remembered), and it cannot see keys written by
+ * other clients until they age out.
+ */
+
+typedef struct _riak_notfound_filter riak_notfound_filter;
+
+/**
+ * @brief Construct an empty negative-lookup filter
+ * @param cfg Riak Configuration (must not use an arena)
+ * @param filter Riak Not Found Filter (out)
+ * @param capacity Missing keys remembered at roughly 1% false positives
+ * @param ttl_ms Milliseconds a missing key is remembered, at most
+ * @returns Error code
+ */
+riak_error
+riak_notfound_filter_new(riak_config           *cfg,
+                         riak_notfound_filter **filter,
+                         riak_uint32_t          capacity,
+                         riak_uint32_t          ttl_ms);
+
+/**
+ * @brief Release the filter
+ * @param filter Riak Not Found Filter (NULLed on return)
+ */
+void
+riak_notfound_filter_free(riak_notfound_filter **filter);
+
+/**
+ * @brief Synchronous Fetch request, answered locally for keys known to be missing
+ * @param cxn Riak Connection
+ * @param filter Riak Not Found Filter
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Fetch options (`if_modified` or `deletedvclock` bypass the filter)
+ * @param response Returned Fetched data, with no content when not found
+ * @returns Error code
+ */
+riak_error
+riak_notfound_filter_get(riak_connection      *cxn,
+                         riak_notfound_filter *filter,
+                         riak_binary          *bucket,
+                         riak_binary          *key,
+                         riak_get_options     *opts,
+                         riak_get_response   **response);
+
+/**
+ * @brief Synchronous Store request, forgetting that the key was missing
+ * @param cxn Riak Connection
+ * @param filter Riak Not Found Filter
+ * @param obj Object to be stored in Riak
+ * @param opts Store options
+ * @param response Returned Fetched data
+ * @returns Error code
+ */
+riak_error
+riak_notfound_filter_put(riak_connection      *cxn,
+                         riak_notfound_filter *filter,
+                         riak_object          *obj,
+                         riak_put_options     *opts,
+                         riak_put_response   **response);
+
+/**
+ * @brief Remember a key as missing
+ * @param filter Riak Not Found Filter
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ */
+void
+riak_notfound_filter_add(riak_notfound_filter *filter,
+                         riak_binary          *bucket,
+                         riak_binary          *key);
+
+/**
+ * @brief Forget that a key was missing
+ * @param filter Riak Not Found Filter
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @note Fetches already in flight will not remember the key
+ */
+void
+riak_notfound_filter_remove(riak_notfound_filter *filter,
+                            riak_binary          *bucket,
+                            riak_binary          *key);
+
+/**
+ * @brief Whether a key is remembered as missing
+ * @param filter Riak Not Found Filter
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @returns True if the key is (probably) missing
+ */
+riak_boolean_t
+riak_notfound_filter_contains(riak_notfound_filter *filter,
+                              riak_binary          *bucket,
+                              riak_binary          *key);
+
+/**
+ * @brief Fetches answered without a round trip
+ * @param filter Riak Not Found Filter
+ * @returns Count of fetches
+ */
+riak_uint64_t
+riak_notfound_filter_get_hits(riak_notfound_filter *filter);
+
+#endif // _RIAK_NOTFOUND_FILTER_H
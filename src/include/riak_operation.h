@@ -70,6 +70,23 @@ void
 riak_operation_set_error_cb(riak_operation         *rop,
                             riak_response_callback  cb);
 
+/**
+ * @brief Bound how long this operation may wait on the network
+ * @param rop Riak Operation
+ * @param timeout Milliseconds per read or write, overriding the connection's (0 to inherit)
+ */
+void
+riak_operation_set_timeout(riak_operation *rop,
+                           riak_uint32_t   timeout);
+
+/**
+ * @brief How long this operation may wait on the network
+ * @param rop Riak Operation
+ * @returns Milliseconds, or 0 when it inherits the connection's timeout
+ */
+riak_uint32_t
+riak_operation_get_timeout(riak_operation *rop);
+
 /**
  * @brief Cleanup memory used by a Riak Operation
  * @param re Riak Operation
@@ -101,6 +118,17 @@ riak_operation_get_connection(riak_operation *rop);
 riak_server_error*
 riak_operation_get_server_error(riak_operation *rop);
 
+/**
+ * @brief Fail an operation with a local (network, timeout) error
+ * @param rop Riak Operation
+ * @param err Error code to report
+ * @note Records `err` as the operation's server error, then calls the
+ * error callback with a NULL response
+ */
+void
+riak_operation_report_error(riak_operation *rop,
+                            riak_error      err);
+
 /**
  * @brief Set the bucket on the current operation
  * @param rop Riak Operation
@@ -0,0 +1,224 @@
+/*********************************************************************
+ *
+ * riak_runtime.h: Per-core event loops shared by every thread (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_RUNTIME_H
+#define _RIAK_RUNTIME_H
+
+#ifdef __linux__
+
+#include "riak.h"
+#include "riak_epoll.h"
+
+/*
+ * Threading model
+ *
+ * A riak_config may be shared by every thread unless it uses an arena;
+ * each thread keeps its own operation cache and statistics. Connection
+ * pools and clusters lock internally. A riak_connection, and every
+ * operation built on it, belongs to one thread at a time.
+ *
+ * The runtime runs one riak_epoll per loop thread, each over its own
+ * connections. Requests are encoded on the submitting thread and handed
+ * to their loop through a lock-free queue. Completions run on the loop
+ * thread, or on whichever thread drains the riak_runtime_completions
+ * named at submission.
+ */
+
+typedef struct _riak_runtime riak_runtime;
+typedef struct _riak_runtime_completions riak_runtime_completions;
+
+typedef enum _riak_runtime_sharding {
+    RIAK_RUNTIME_ROUND_ROBIN = 0,
+    RIAK_RUNTIME_KEY_HASH           // Same bucket and key, same loop and connection
+} riak_runtime_sharding;
+
+typedef struct _riak_runtime_options {
+    riak_uint32_t         n_loops;     // 0 for one per online core
+    riak_uint32_t         n_channels;  // Connections per loop
+    riak_runtime_sharding sharding;
+    riak_uint32_t         timeout;     // Per-operation, in ms (0 for none)
+    riak_boolean_t        pin_loops;   // Bind loop i to core i
+} riak_runtime_options;
+
+#define RIAK_RUNTIME_DEFAULT_CHANNELS 2
+
+/**
+ * @brief Called once per submitted get
+ * @param err ERIAK_OK, ERIAK_SERVER_ERROR, or the local (network, timeout) error
+ * @param response Fetched data, owned by the callback (NULL on error)
+ * @param ptr User-supplied pointer
+ */
+typedef void (*riak_runtime_get_callback)(riak_error         err,
+                                          riak_get_response *response,
+                                          void              *ptr);
+
+/**
+ * @brief Called once per submitted put
+ * @param err ERIAK_OK, ERIAK_SERVER_ERROR, or the local (network, timeout) error
+ * @param response Stored data, owned by the callback (NULL on error)
+ * @param ptr User-supplied pointer
+ */
+typedef void (*riak_runtime_put_callback)(riak_error         err,
+                                          riak_put_response *response,
+                                          void              *ptr);
+
+/**
+ * @brief Code run on a loop thread by `riak_runtime_submit`
+ * @param ep The loop's reactor
+ * @param ptr User-supplied pointer
+ */
+typedef void (*riak_runtime_task_fn)(riak_epoll *ep,
+                                     void       *ptr);
+
+/**
+ * @brief Fill in runtime defaults
+ * @param opts Runtime options
+ */
+void
+riak_runtime_options_init(riak_runtime_options *opts);
+
+/**
+ * @brief Connect every loop and start its thread
+ * @param cfg Riak Configuration, shared by all loops (must not use an arena)
+ * @param rt Riak Runtime (out)
+ * @param hostname Name of Riak server
+ * @param portnum Riak PBC port number
+ * @param resolver IP Address resolving function (NULL for default)
+ * @param opts Runtime options (NULL for defaults)
+ * @returns Error code
+ */
+riak_error
+riak_runtime_new(riak_config          *cfg,
+                 riak_runtime        **rt,
+                 const char           *hostname,
+                 const char           *portnum,
+                 riak_addr_resolver    resolver,
+                 riak_runtime_options *opts);
+
+/**
+ * @brief Stop and join every loop, failing what is still in flight
+ * @param rt Riak Runtime (NULLed on return)
+ * @note Failed operations complete before this returns; drain any
+ * completion queues afterwards to see them
+ */
+void
+riak_runtime_free(riak_runtime **rt);
+
+/**
+ * @brief Number of loop threads
+ * @param rt Riak Runtime
+ * @returns Loop count
+ */
+riak_uint32_t
+riak_runtime_get_n_loops(riak_runtime *rt);
+
+/**
+ * @brief Fetch asynchronously, from any thread
+ * @param rt Riak Runtime
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param opts Fetch options (NULL for defaults); encoded before returning
+ * @param completions Queue the callback is delivered to (NULL to run it on the loop thread)
+ * @param cb Completion callback
+ * @param ptr Passed to `cb`
+ * @returns Error code; `cb` runs exactly once unless this fails
+ */
+riak_error
+riak_runtime_get(riak_runtime              *rt,
+                 riak_binary               *bucket,
+                 riak_binary               *key,
+                 riak_get_options          *opts,
+                 riak_runtime_completions  *completions,
+                 riak_runtime_get_callback  cb,
+                 void                      *ptr);
+
+/**
+ * @brief Store asynchronously, from any thread
+ * @param rt Riak Runtime
+ * @param object Object to store; encoded before returning
+ * @param opts Store options (NULL for defaults)
+ * @param completions Queue the callback is delivered to (NULL to run it on the loop thread)
+ * @param cb Completion callback
+ * @param ptr Passed to `cb`
+ * @returns Error code; `cb` runs exactly once unless this fails
+ */
+riak_error
+riak_runtime_put(riak_runtime              *rt,
+                 riak_object               *object,
+                 riak_put_options          *opts,
+                 riak_runtime_completions  *completions,
+                 riak_runtime_put_callback  cb,
+                 void                      *ptr);
+
+/**
+ * @brief Run code on a loop thread, e.g. to start any other operation there
+ * @param rt Riak Runtime
+ * @param shard Picks the loop as a key would (NULL for round-robin)
+ * @param fn Called on the loop thread with its reactor
+ * @param ptr Passed to `fn`
+ * @returns Error code
+ */
+riak_error
+riak_runtime_submit(riak_runtime         *rt,
+                    riak_binary          *shard,
+                    riak_runtime_task_fn  fn,
+                    void                 *ptr);
+
+/**
+ * @brief Construct a queue for delivering completions to a chosen thread
+ * @param cfg Riak Configuration
+ * @param completions Completion queue (out)
+ * @returns Error code
+ */
+riak_error
+riak_runtime_completions_new(riak_config               *cfg,
+                             riak_runtime_completions **completions);
+
+/**
+ * @brief Release a completion queue, dropping undelivered completions
+ * @param completions Completion queue (NULLed on return)
+ */
+void
+riak_runtime_completions_free(riak_runtime_completions **completions);
+
+/**
+ * @brief Descriptor that polls readable while completions are waiting
+ * @param completions Completion queue
+ * @returns An eventfd
+ */
+int
+riak_runtime_completions_get_fd(riak_runtime_completions *completions);
+
+/**
+ * @brief Run waiting completion callbacks on the calling thread
+ * @param completions Completion queue
+ * @param timeout Milliseconds to wait when none are ready (0 to poll, -1 to block)
+ * @returns Number of callbacks run
+ * @note Only one thread may drain a given queue
+ */
+riak_uint32_t
+riak_runtime_completions_drain(riak_runtime_completions *completions,
+                               int                       timeout);
+
+#endif // __linux__
+
+#endif // _RIAK_RUNTIME_H
@@ -0,0 +1,102 @@
+/*********************************************************************
+ *
+ * riak_view.h: Lazily decoded fetch responses
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_VIEW_H
+#define _RIAK_VIEW_H
+
+/*
+ * A riak_get_view keeps one copy of the RpbGetResp bytes and decodes
+ * fields only when they are asked for. Binaries returned by the accessors
+ * point into that copy and are valid until the view is freed; do not free
+ * them. Sibling contents are scanned on first access, and links, user
+ * metadata and indexes are only built if requested. The accessors of a
+ * content that turns out to be malformed read as empty, and turning that
+ * content into a riak_object fails with ERIAK_MESSAGE_FORMAT. Views are
+ * not safe to read from several threads at once.
+ */
+
+typedef struct _riak_get_view riak_get_view;
+typedef struct _riak_object_view riak_object_view;
+
+/**
+ * @brief Wrap an encoded RpbGetResp, without the message code
+ * @param cfg Riak Configuration
+ * @param view Lazy response (out)
+ * @param bucket Bucket reported by the contents (copied, may be NULL)
+ * @param key Key reported by the contents (copied, may be NULL)
+ * @param data Encoded message (copied)
+ * @param len Length of `data`
+ * @returns ERIAK_MESSAGE_FORMAT if the outer message is malformed
+ */
+riak_error
+riak_get_view_new(riak_config    *cfg,
+                  riak_get_view **view,
+                  riak_binary    *bucket,
+                  riak_binary    *key,
+                  riak_uint8_t   *data,
+                  riak_size_t     len);
+
+/**
+ * @brief Release a lazy response and everything decoded from it
+ * @param cfg Riak Configuration
+ * @param view Lazy response (NULLed on return)
+ */
+void
+riak_get_view_free(riak_config    *cfg,
+                   riak_get_view **view);
+
+riak_boolean_t    riak_get_view_get_has_vclock(riak_get_view *view);
+riak_binary      *riak_get_view_get_vclock(riak_get_view *view);
+riak_boolean_t    riak_get_view_get_has_unmodified(riak_get_view *view);
+riak_boolean_t    riak_get_view_get_unmodified(riak_get_view *view);
+riak_int32_t      riak_get_view_get_n_content(riak_get_view *view);
+riak_object_view *riak_get_view_get_content(riak_get_view *view,
+                                            riak_int32_t   index);
+
+// Same meaning as the matching `riak_object_get_*`
+riak_binary   *riak_object_view_get_bucket(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_key(riak_object_view *obj);
+riak_binary   *riak_object_view_get_key(riak_object_view *obj);
+riak_binary   *riak_object_view_get_value(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_charset(riak_object_view *obj);
+riak_binary   *riak_object_view_get_charset(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_last_mod(riak_object_view *obj);
+riak_uint32_t  riak_object_view_get_last_mod(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_last_mod_usecs(riak_object_view *obj);
+riak_uint32_t  riak_object_view_get_last_mod_usecs(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_content_type(riak_object_view *obj);
+riak_binary   *riak_object_view_get_content_type(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_content_encoding(riak_object_view *obj);
+riak_binary   *riak_object_view_get_encoding(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_deleted(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_deleted(riak_object_view *obj);
+riak_boolean_t riak_object_view_get_has_vtag(riak_object_view *obj);
+riak_binary   *riak_object_view_get_vtag(riak_object_view *obj);
+riak_int32_t   riak_object_view_get_n_links(riak_object_view *obj);
+riak_link    **riak_object_view_get_links(riak_object_view *obj);
+riak_int32_t   riak_object_view_get_n_usermeta(riak_object_view *obj);
+riak_pair    **riak_object_view_get_usermeta(riak_object_view *obj);
+riak_int32_t   riak_object_view_get_n_indexes(riak_object_view *obj);
+riak_pair    **riak_object_view_get_indexes(riak_object_view *obj);
+
+#endif // _RIAK_VIEW_H
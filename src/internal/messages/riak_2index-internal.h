@@ -64,6 +64,7 @@ struct _riak_2index_response
     riak_boolean_t done;
 
     riak_uint32_t  _n_responses;
+    riak_uint32_t  _capacity;
     RpbIndexResp **_internal;
 };
 
@@ -0,0 +1,125 @@
+/*********************************************************************
+ *
+ * riak_counter-internal.h: Riak C Client Legacy Counter Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_COUNTER_INTERNAL_H
+#define _RIAK_COUNTER_INTERNAL_H
+
+// Based on RpbCounterUpdateReq
+struct _riak_counter_update_options {
+    riak_boolean_t has_w;
+    riak_uint32_t  w;
+    riak_boolean_t has_dw;
+    riak_uint32_t  dw;
+    riak_boolean_t has_pw;
+    riak_uint32_t  pw;
+    riak_boolean_t has_returnvalue;
+    riak_boolean_t returnvalue;
+};
+
+// Based on RpbCounterGetReq
+struct _riak_counter_get_options {
+    riak_boolean_t has_r;
+    riak_uint32_t  r;
+    riak_boolean_t has_pr;
+    riak_uint32_t  pr;
+    riak_boolean_t has_basic_quorum;
+    riak_boolean_t basic_quorum;
+    riak_boolean_t has_notfound_ok;
+    riak_boolean_t notfound_ok;
+};
+
+// Based on RpbCounterUpdateResp
+struct _riak_counter_update_response {
+    riak_boolean_t has_value;
+    riak_int64_t   value;
+};
+
+// Based on RpbCounterGetResp
+struct _riak_counter_get_response {
+    riak_boolean_t has_value;
+    riak_int64_t   value;
+};
+
+/**
+ * @brief Create a Counter Update request
+ * @param rop Riak Operation
+ * @param bucket Name of Riak bucket (must allow_mult)
+ * @param key Name of Riak key
+ * @param amount Signed amount to add to the counter
+ * @param options Update parameters (NULL for defaults)
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_counter_update_request_encode(riak_operation              *rop,
+                                   riak_binary                 *bucket,
+                                   riak_binary                 *key,
+                                   riak_int64_t                 amount,
+                                   riak_counter_update_options *options,
+                                   riak_pb_message            **req);
+
+/**
+ * @brief Translate PBC message to a Counter Update response
+ * @param rop Riak Operation
+ * @param pbresp Protocol Buffer message
+ * @param resp Returned Counter Update response
+ * @param done Returned flag set to true if finished streaming
+ * @return Error if out of memory
+ */
+riak_error
+riak_counter_update_response_decode(riak_operation                *rop,
+                                    riak_pb_message               *pbresp,
+                                    riak_counter_update_response **resp,
+                                    riak_boolean_t                *done);
+
+/**
+ * @brief Create a Counter Get request
+ * @param rop Riak Operation
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param options Read parameters (NULL for defaults)
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_counter_get_request_encode(riak_operation           *rop,
+                                riak_binary              *bucket,
+                                riak_binary              *key,
+                                riak_counter_get_options *options,
+                                riak_pb_message         **req);
+
+/**
+ * @brief Translate PBC message to a Counter Get response
+ * @param rop Riak Operation
+ * @param pbresp Protocol Buffer message
+ * @param resp Returned Counter Get response
+ * @param done Returned flag set to true if finished streaming
+ * @return Error if out of memory
+ */
+riak_error
+riak_counter_get_response_decode(riak_operation             *rop,
+                                 riak_pb_message            *pbresp,
+                                 riak_counter_get_response **resp,
+                                 riak_boolean_t             *done);
+
+#endif // _RIAK_COUNTER_INTERNAL_H
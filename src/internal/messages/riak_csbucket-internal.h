@@ -0,0 +1,90 @@
+/*********************************************************************
+ *
+ * riak_csbucket-internal.h: Riak C Client Bucket Range Fold Message
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_CSBUCKET_INTERNAL_H
+#define _RIAK_CSBUCKET_INTERNAL_H
+
+// Based on RpbCSBucketReq
+struct _riak_csbucket_options {
+    riak_boolean_t has_end_key;
+    riak_binary   *end_key;
+    riak_boolean_t has_start_incl;
+    riak_boolean_t start_incl;
+    riak_boolean_t has_end_incl;
+    riak_boolean_t end_incl;
+    riak_boolean_t has_continuation;
+    riak_binary   *continuation;
+    riak_boolean_t has_max_results;
+    riak_uint32_t  max_results;
+    riak_boolean_t has_timeout;
+    riak_uint32_t  timeout;
+    riak_boolean_t has_type;
+    riak_binary   *type;
+};
+
+// Based on RpbCSBucketResp
+struct _riak_csbucket_response {
+    riak_uint32_t       n_objects;
+    riak_binary       **keys;
+    riak_get_response **objects;
+    riak_boolean_t      has_continuation;
+    riak_binary        *continuation;
+    riak_boolean_t      has_done;
+    riak_boolean_t      done;
+
+    riak_uint32_t       _n_responses;
+    riak_uint32_t       _capacity;
+    RpbCSBucketResp   **_internal;   // Keys and objects point into these
+};
+
+/**
+ * @brief Create a bucket range fold request
+ * @param rop Riak Operation
+ * @param bucket Name of Riak bucket
+ * @param start_key First key of the range
+ * @param options Range and paging parameters (NULL for defaults)
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_csbucket_request_encode(riak_operation         *rop,
+                             riak_binary            *bucket,
+                             riak_binary            *start_key,
+                             riak_csbucket_options  *options,
+                             riak_pb_message       **req);
+
+/**
+ * @brief Translate streamed PBC messages to a bucket range fold response
+ * @param rop Riak Operation
+ * @param pbresp Protocol Buffer message
+ * @param resp Returned response, merged across messages
+ * @param done Returned flag set to true if finished streaming
+ * @return Error if out of memory
+ */
+riak_error
+riak_csbucket_response_decode(riak_operation          *rop,
+                              riak_pb_message         *pbresp,
+                              riak_csbucket_response **resp,
+                              riak_boolean_t          *done);
+
+#endif // _RIAK_CSBUCKET_INTERNAL_H
@@ -0,0 +1,199 @@
+/*********************************************************************
+ *
+ * riak_dt-internal.h: Riak C Client Data Type (CRDT) Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_DT_INTERNAL_H
+#define _RIAK_DT_INTERNAL_H
+
+#include "riak_dt.pb-c.h"
+
+// Based on DtValue; also the counter, set or map inside a MapEntry
+struct _riak_dt_value {
+    riak_boolean_t      has_counter;
+    riak_int64_t        counter;
+    riak_int32_t        n_set;
+    riak_binary       **set;
+    riak_int32_t        n_map;
+    riak_dt_map_entry **map;
+};
+
+// Based on MapEntry
+struct _riak_dt_map_entry {
+    riak_binary       *name;
+    riak_dt_field_type type;
+    riak_dt_value     *value;
+    riak_boolean_t     has_register;
+    riak_binary       *reg;
+    riak_boolean_t     has_flag;
+    riak_boolean_t     flag;
+};
+
+// Based on DtFetchResp
+struct _riak_dt_fetch_response {
+    riak_boolean_t has_context;
+    riak_binary   *context;
+    riak_dt_type   type;
+    riak_dt_value *value;
+};
+
+// Based on DtUpdateResp
+struct _riak_dt_update_response {
+    riak_boolean_t has_key;
+    riak_binary   *key;
+    riak_boolean_t has_context;
+    riak_binary   *context;
+    riak_dt_value *value;
+};
+
+// Based on DtFetchReq
+struct _riak_dt_fetch_options {
+    riak_boolean_t has_r;
+    riak_uint32_t  r;
+    riak_boolean_t has_pr;
+    riak_uint32_t  pr;
+    riak_boolean_t has_basic_quorum;
+    riak_boolean_t basic_quorum;
+    riak_boolean_t has_notfound_ok;
+    riak_boolean_t notfound_ok;
+    riak_boolean_t has_timeout;
+    riak_uint32_t  timeout;
+    riak_boolean_t has_sloppy_quorum;
+    riak_boolean_t sloppy_quorum;
+    riak_boolean_t has_n_val;
+    riak_uint32_t  n_val;
+    riak_boolean_t has_include_context;
+    riak_boolean_t include_context;
+};
+
+// Based on DtUpdateReq
+struct _riak_dt_update_options {
+    riak_boolean_t has_context;
+    riak_binary   *context;
+    riak_boolean_t has_w;
+    riak_uint32_t  w;
+    riak_boolean_t has_dw;
+    riak_uint32_t  dw;
+    riak_boolean_t has_pw;
+    riak_uint32_t  pw;
+    riak_boolean_t has_return_body;
+    riak_boolean_t return_body;
+    riak_boolean_t has_timeout;
+    riak_uint32_t  timeout;
+    riak_boolean_t has_sloppy_quorum;
+    riak_boolean_t sloppy_quorum;
+    riak_boolean_t has_n_val;
+    riak_uint32_t  n_val;
+    riak_boolean_t has_include_context;
+    riak_boolean_t include_context;
+};
+
+// A set member or map field touched by a pending operation
+typedef struct _riak_dt_entry {
+    riak_binary    *name;
+    riak_uint32_t   type;      // Map field type; 0 for set members
+    riak_boolean_t  removed;   // Last operation on it was a remove
+    riak_dt_op     *op;        // Counter, set and map fields
+    riak_binary    *reg;       // Register fields
+    riak_boolean_t  enable;    // Flag fields
+} riak_dt_entry;
+
+// Folded operations, sent as one DtOp, CounterOp, SetOp or MapOp
+struct _riak_dt_op {
+    riak_config    *config;
+    riak_dt_op     *parent;    // Map holding this field; NULL at the top
+    riak_uint32_t   type;      // riak_dt_field_type being updated
+    riak_uint32_t   n_pending;
+    riak_int64_t    increment;
+    riak_dt_entry  *entries;
+    riak_uint32_t   n_entries;
+    riak_uint32_t   entries_capacity;
+    riak_uint32_t  *index;     // Entry number + 1 by hash of name and type
+    riak_uint32_t   index_size;
+};
+
+/**
+ * @brief Create a Data Type Fetch request
+ * @param rop Riak Operation
+ * @param bucket_type Name of the bucket type holding the data type
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key
+ * @param options Fetch parameters (NULL for defaults)
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_dt_fetch_request_encode(riak_operation         *rop,
+                             riak_binary            *bucket_type,
+                             riak_binary            *bucket,
+                             riak_binary            *key,
+                             riak_dt_fetch_options  *options,
+                             riak_pb_message       **req);
+
+/**
+ * @brief Translate PBC message to a Data Type Fetch response
+ * @param rop Riak Operation
+ * @param pbresp Protocol Buffer message
+ * @param resp Returned Data Type Fetch response
+ * @param done Returned flag set to true if finished streaming
+ * @return Error if out of memory
+ */
+riak_error
+riak_dt_fetch_response_decode(riak_operation          *rop,
+                              riak_pb_message         *pbresp,
+                              riak_dt_fetch_response **resp,
+                              riak_boolean_t          *done);
+
+/**
+ * @brief Create a Data Type Update request from folded operations
+ * @param rop Riak Operation
+ * @param bucket_type Name of the bucket type holding the data type
+ * @param bucket Name of Riak bucket
+ * @param key Name of Riak key (NULL for a server-assigned key)
+ * @param op Folded operations
+ * @param options Update parameters (NULL for defaults)
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_dt_update_request_encode(riak_operation          *rop,
+                              riak_binary             *bucket_type,
+                              riak_binary             *bucket,
+                              riak_binary             *key,
+                              riak_dt_op              *op,
+                              riak_dt_update_options  *options,
+                              riak_pb_message        **req);
+
+/**
+ * @brief Translate PBC message to a Data Type Update response
+ * @param rop Riak Operation
+ * @param pbresp Protocol Buffer message
+ * @param resp Returned Data Type Update response
+ * @param done Returned flag set to true if finished streaming
+ * @return Error if out of memory
+ */
+riak_error
+riak_dt_update_response_decode(riak_operation           *rop,
+                               riak_pb_message          *pbresp,
+                               riak_dt_update_response **resp,
+                               riak_boolean_t           *done);
+
+#endif // _RIAK_DT_INTERNAL_H
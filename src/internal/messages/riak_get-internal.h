@@ -30,7 +30,7 @@ struct _riak_get_response {
     riak_int32_t   n_content;
     riak_object  **content; // Array of pointers to allow expansion
 
-    RpbGetResp    *_internal;
+    riak_get_view *_internal;     // Owns the bytes every binary points into
 };
 
 // Based on RpbGetReq
@@ -57,6 +57,14 @@ struct _riak_get_options {
     riak_uint32_t  n_val;
 };
 
+// Constant part of a Get request, pre-encoded
+struct _riak_get_template {
+    riak_binary    bucket;      // Points into `encoded`
+    riak_uint8_t  *encoded;     // Bucket field, then the option fields
+    riak_size_t    bucket_len;
+    riak_size_t    options_len;
+};
+
 /**
  * @brief Create a get/fetch Request
  * @param rop Riak Operation
@@ -73,6 +81,20 @@ riak_get_request_encode(riak_operation   *rop,
                         riak_get_options *options,
                         riak_pb_message **req);
 
+/**
+ * @brief Create a get/fetch Request from a prepared template
+ * @param rop Riak Operation
+ * @param tmpl Pre-encoded bucket and options
+ * @param key Name of Riak key
+ * @param req Returned PBC request
+ * @return Error if out of memory
+ */
+riak_error
+riak_get_template_request_encode(riak_operation    *rop,
+                                 riak_get_template *tmpl,
+                                 riak_binary       *key,
+                                 riak_pb_message  **req);
+
 /**
  * @brief Translate PBC message to Riak message
  * @param rop Riak Operation
@@ -86,3 +108,15 @@ riak_get_response_decode(riak_operation     *rop,
                          riak_pb_message    *pbresp,
                          riak_get_response **resp,
                          riak_boolean_t     *done);
+
+/**
+ * @brief Build a Get response around a lazy response
+ * @param cfg Riak Configuration
+ * @param view Lazy response, owned by the response from here on (NULLed)
+ * @param resp Returned Get message
+ * @return Error if out of memory or the contents are malformed
+ */
+riak_error
+riak_get_response_new_from_view(riak_config        *cfg,
+                                riak_get_view     **view,
+                                riak_get_response **resp);
@@ -23,11 +23,9 @@
 // Based on RpbListKeysResp
 struct _riak_listkeys_response {
     riak_uint32_t     n_keys;
-    riak_binary     **keys; // Array of pointers to allow growth
+    riak_binary     **keys; // Array of pointers to allow growth; NULL when streamed
+    riak_uint32_t     keys_capacity;
     riak_boolean_t    done;
-
-    riak_uint32_t     n_responses;
-    RpbListKeysResp **_internal; // Array for many responses
 };
 
 /**
@@ -37,6 +37,7 @@ struct _riak_mapreduce_response
     // Arrays for many responses
     riak_mapreduce_message **msg;
     riak_uint32_t                     n_responses;
+    riak_uint32_t                     _capacity;
     RpbMapRedResp**                   _internal;
 };
 
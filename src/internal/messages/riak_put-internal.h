@@ -29,7 +29,7 @@ struct _riak_put_response {
     riak_boolean_t has_key;
     riak_binary   *key;
 
-    RpbPutResp   *_internal;
+    riak_get_view *_internal;    // Owns the bytes every binary points into
 };
 
 // Based on RpbPutReq
@@ -0,0 +1,52 @@
+/*********************************************************************
+ *
+ * riak_2index_cursor-internal.h: Paged Secondary Index queries
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_2INDEX_CURSOR_INTERNAL_H
+#define _RIAK_2INDEX_CURSOR_INTERNAL_H
+
+struct _riak_2index_cursor {
+    riak_connection             *connection;
+    riak_config                 *config;
+    riak_binary                 *bucket;
+    riak_binary                 *index;
+    riak_2index_options         *options;
+    riak_boolean_t               owns_options;
+    riak_2index_stream_callback  cb;
+    void                        *cb_data;
+
+    riak_boolean_t               in_flight;    // A page request is on the wire
+    riak_config                 *rop_config;   // Allocator of that request's responses
+
+    // Chunks of the page being received, held until it is complete
+    riak_2index_response       **page;
+    riak_config                 *page_config;  // Allocator of the held chunks
+    riak_uint32_t                n_page;
+    riak_uint32_t                page_capacity;
+    riak_boolean_t               page_failed;  // Ran out of room for a chunk
+
+    riak_binary                 *continuation; // From the last complete page
+    riak_uint32_t                n_pages;
+    riak_boolean_t               done;
+};
+
+#endif // _RIAK_2INDEX_CURSOR_INTERNAL_H
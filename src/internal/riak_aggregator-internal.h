@@ -0,0 +1,74 @@
+/*********************************************************************
+ *
+ * riak_aggregator-internal.h: Local aggregation of legacy counter increments
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_AGGREGATOR_INTERNAL_H
+#define _RIAK_AGGREGATOR_INTERNAL_H
+
+#include <pthread.h>
+
+// Published whole by a single compare-and-swap; only moved or freed while
+// `table_lock` is held for writing
+typedef struct _riak_aggregator_entry {
+    riak_uint64_t  hash;
+    riak_binary   *bucket;
+    riak_binary   *key;
+    riak_int64_t   delta;    // Sum not yet sent
+    riak_boolean_t idle;     // Nothing to send at the last flush (flush_lock)
+} riak_aggregator_entry;
+
+// One counter update in flight during a flush
+typedef struct _riak_aggregator_send {
+    riak_aggregator_entry *entry;
+    riak_int64_t           amount;
+    riak_config           *config;   // Operation's, for freeing the reply
+    riak_boolean_t         answered;
+    riak_boolean_t         rejected; // Answered with a server error
+} riak_aggregator_send;
+
+struct _riak_aggregator {
+    riak_config                 *config;
+    riak_connection_pool        *pool;
+    riak_counter_update_options  options;
+
+    // Open addressing with linear probing; at most half full
+    riak_aggregator_entry      **slots;
+    riak_uint32_t                n_slots;  // Power of two
+    riak_uint32_t                max_keys;
+    riak_uint32_t                n_keys;
+    riak_uint64_t                n_pending; // Increments since the last flush
+    riak_uint64_t                threshold;
+    riak_aggregator_send        *sends;    // max_keys of them, used under flush_lock
+
+    pthread_mutex_t              flush_lock; // One flush at a time
+    pthread_rwlock_t             table_lock; // Shared by increments, exclusive to drop idle pairs
+
+    // Background flushing
+    pthread_mutex_t              lock;
+    pthread_t                    thread;
+    pthread_cond_t               cond;
+    riak_boolean_t               running;
+    riak_boolean_t               flush_requested;
+    riak_uint32_t                interval;
+};
+
+#endif // _RIAK_AGGREGATOR_INTERNAL_H
@@ -0,0 +1,60 @@
+/*********************************************************************
+ *
+ * riak_bulk-internal.h: Load many objects over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_BULK_INTERNAL_H
+#define _RIAK_BULK_INTERNAL_H
+
+#include <pthread.h>
+
+// Shared by every worker of one load
+typedef struct _riak_bulk_load_state {
+    riak_connection_pool *pool;
+    riak_put_options     *put_opts;
+    riak_bulk_options     options;
+    riak_boolean_t        conditional; // Server errors are failed preconditions
+    riak_bulk_source      source;
+    void                 *source_data;
+
+    pthread_mutex_t       lock;
+    riak_boolean_t        exhausted;  // Source returned NULL or failed
+    riak_error            result;     // First error seen
+    riak_bulk_stats       stats;
+} riak_bulk_load_state;
+
+typedef struct _riak_bulk_slot {
+    riak_object   *object;
+    riak_uint32_t  attempts;
+    riak_boolean_t sent;
+    riak_error     result;
+    riak_config   *config;   // Config of the in-flight put, frees its reply
+} riak_bulk_slot;
+
+typedef struct _riak_bulk_worker {
+    riak_bulk_load_state *state;
+    riak_connection      *cxn;
+    riak_bulk_slot       *slots;      // options.window entries
+    riak_uint32_t         n_slots;    // Retries are carried at the front
+    pthread_t             thread;
+} riak_bulk_worker;
+
+#endif // _RIAK_BULK_INTERNAL_H
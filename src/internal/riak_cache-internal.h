@@ -0,0 +1,68 @@
+/*********************************************************************
+ *
+ * riak_cache-internal.h: Client-side read-through object cache
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_CACHE_INTERNAL_H
+#define _RIAK_CACHE_INTERNAL_H
+
+#include <pthread.h>
+
+// One allocation holds this, the bucket, the key and the encoded RpbGetResp
+typedef struct _riak_cache_entry {
+    struct _riak_cache_entry *chain;    // Next in the same hash bucket
+    struct _riak_cache_entry *newer;    // Recency list
+    struct _riak_cache_entry *older;
+    riak_uint64_t             hash;
+    riak_uint64_t             fetched;  // Milliseconds, monotonic clock
+    riak_size_t               size;     // Bytes charged to the shard
+    riak_binary               bucket;
+    riak_binary               key;
+    riak_boolean_t            has_vclock;
+    riak_binary               vclock;   // Points into `data`
+    riak_uint8_t             *data;
+    riak_size_t               len;
+} riak_cache_entry;
+
+typedef struct _riak_cache_shard {
+    pthread_mutex_t    lock;
+    riak_cache_entry **buckets;
+    riak_uint32_t      n_buckets;   // Power of two
+    riak_cache_entry  *newest;
+    riak_cache_entry  *oldest;
+    riak_uint32_t      n_entries;
+    riak_size_t        n_bytes;
+    riak_uint64_t      generation;  // Bumped by every invalidation
+} riak_cache_shard;
+
+struct _riak_cache {
+    riak_config      *config;
+    riak_cache_shard *shards;
+    riak_uint32_t     n_shards;
+    riak_uint32_t     shard_entries; // Per-shard share of the bounds
+    riak_size_t       shard_bytes;
+    riak_uint32_t     ttl;
+    riak_uint64_t     hits;
+    riak_uint64_t     revalidated;
+    riak_uint64_t     misses;
+};
+
+#endif // _RIAK_CACHE_INTERNAL_H
@@ -0,0 +1,49 @@
+/*********************************************************************
+ *
+ * riak_cluster-internal.h: Load balancing across several Riak nodes
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_CLUSTER_INTERNAL_H
+#define _RIAK_CLUSTER_INTERNAL_H
+
+#include <pthread.h>
+
+// Weight of the newest sample in the latency moving average
+#define RIAK_CLUSTER_EWMA_ALPHA 0.2
+
+struct _riak_cluster_node {
+    riak_connection_pool *pool;
+    riak_uint32_t         outstanding;  // Connections checked out
+    riak_float64_t        latency;      // Moving average in milliseconds
+    riak_uint64_t         down_until;   // Monotonic ms; 0 when up
+    riak_uint32_t         failures;     // Consecutive network errors
+};
+
+struct _riak_cluster {
+    riak_config         *config;
+    riak_cluster_policy  policy;
+    riak_cluster_node  **nodes;
+    riak_uint32_t        n_nodes;
+    riak_uint32_t        next;          // Round-robin cursor
+    riak_uint32_t        retry_interval;
+    pthread_mutex_t      lock;
+};
+
+#endif // _RIAK_CLUSTER_INTERNAL_H
@@ -23,17 +23,73 @@
 #ifndef _RIAK_CONFIG_INTERNAL_H
 #define _RIAK_CONFIG_INTERNAL_H
 
+#include <pthread.h>
+
+// Arena allocations are rounded up to keep every pointer suitably aligned
+#define RIAK_ARENA_ALIGN 16
+
+// One chunk of arena memory; allocations are carved out of the bytes following it
+typedef struct _riak_arena_block {
+    struct _riak_arena_block *next;
+    riak_size_t               size;
+    riak_size_t               used;
+} riak_arena_block;
+
+// Retired operations each thread keeps around for reuse
+#define RIAK_THREAD_FREE_OPS_MAX 64
+
+// Everything a thread mutates, so a shared config stays read-only
+typedef struct _riak_thread_context {
+    riak_config                 *config;
+    struct _riak_operation      *free_ops;
+    riak_uint32_t                n_free_ops;
+    riak_thread_stats            stats;
+    struct _riak_thread_context *prev;   // Siblings on riak_config.threads
+    struct _riak_thread_context *next;
+} riak_thread_context;
+
 struct _riak_config {
     riak_alloc_fn       malloc_fn;
     riak_realloc_fn     realloc_fn;
     riak_free_fn        free_fn;
     ProtobufCAllocator *pb_allocator;
+    ProtobufCAllocator  custom_pb_allocator;
+
+    // PER-THREAD STATE (riak_thread_context)
+    pthread_key_t       thread_key;
+    riak_boolean_t      has_thread_key;
+    pthread_mutex_t     thread_lock;   // Guards threads
+    riak_thread_context *threads;      // Every live context, freed with the config
 
     // LOGGING
     void*               log_data;
     riak_log_fn         log_fn;
     riak_log_init_fn    log_init_fn;
     riak_log_cleanup_fn log_cleanup_fn;
+
+    // ARENA (only set by riak_config_new_arena)
+    riak_config        *parent;
+    riak_arena_block   *arena;
+    riak_size_t         arena_block_size;
+    ProtobufCAllocator  arena_pb_allocator;
 };
 
+/**
+ * @brief Find (or lazily build) the calling thread's context
+ * @param cfg Riak Config; arenas share their parent's contexts
+ * @returns This thread's context, or NULL when out of memory
+ */
+riak_thread_context*
+riak_config_get_thread_context(riak_config *cfg);
+
+/**
+ * @brief Was this memory carved out of the config's arena?
+ * @param cfg Riak Config
+ * @param ptr Memory to look up
+ * @returns False for ordinary configs, or memory from the heap
+ */
+riak_boolean_t
+riak_config_arena_owns(riak_config *cfg,
+                       void        *ptr);
+
 #endif // _RIAK_CONFIG_INTERNAL_H
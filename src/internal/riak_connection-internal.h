@@ -24,6 +24,8 @@
 #define _RIAK_CONNECTION_INTERNAL_H
 
 #define RIAK_HOST_MAX_LEN   256
+// Starting size of the per-connection read buffer; grows to the largest frame
+#define RIAK_READ_BUFFER_INITIAL 4096
 
 struct _riak_connection {
     riak_config   *config;
@@ -31,6 +33,38 @@ struct _riak_connection {
     char           portnum[RIAK_HOST_MAX_LEN]; // Keep as a string for debugging
     riak_addrinfo *addrinfo;
     riak_socket_t  fd;
+    riak_connection_options options;
+    riak_uint64_t  checkout_time; // Set by riak_cluster to track node latency
+    riak_config   *arena;         // Optional allocator for new operations
+
+    // Bytes read but not yet decoded live in inbuf[inbuf_start, inbuf_end)
+    riak_uint8_t  *inbuf;
+    riak_size_t    inbuf_size;
+    riak_size_t    inbuf_start;
+    riak_size_t    inbuf_end;
+
+    // Pipelined operations awaiting a response, in the order they were sent
+    struct _riak_operation *pending_head;
+    struct _riak_operation *pending_tail;
+    struct _riak_operation *pending_unsent; // First one not yet flushed
+    riak_uint32_t           n_pending;
 };
 
+/**
+ * @brief Allocator the connection's next operation (and its response) will use
+ * @param cxn Riak Connection
+ * @returns The connection's arena if one is set, else its configuration
+ */
+riak_config*
+riak_connection_get_operation_config(riak_connection *cxn);
+
+/**
+ * @brief Fail and free every pipelined operation still waiting on this connection
+ * @param cxn Riak Connection
+ * @param err Error code reported to each operation's error callback
+ */
+void
+riak_connection_abort_pending(riak_connection *cxn,
+                              riak_error       err);
+
 #endif // _RIAK_CONNECTION_INTERNAL_H
@@ -0,0 +1,56 @@
+/*********************************************************************
+ *
+ * riak_connection_pool-internal.h: Pool of warm Riak Connections
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_CONNECTION_POOL_INTERNAL_H
+#define _RIAK_CONNECTION_POOL_INTERNAL_H
+
+#include <pthread.h>
+#include "riak_connection-internal.h"
+
+typedef struct _riak_pooled_connection {
+    riak_connection *cxn;
+    riak_uint64_t    last_used; // Milliseconds, monotonic clock
+} riak_pooled_connection;
+
+struct _riak_connection_pool {
+    riak_config            *config;
+    char                    hostname[RIAK_HOST_MAX_LEN];
+    char                    portnum[RIAK_HOST_MAX_LEN];
+    riak_addr_resolver      resolver;
+    riak_uint32_t           max_connections;
+    riak_uint32_t           n_open; // Idle + checked out
+
+    // Idle connections are a stack so the warmest socket is reused first
+    riak_uint32_t           n_idle;
+    riak_pooled_connection *idle;
+
+    pthread_mutex_t         lock;
+    pthread_cond_t          available; // Signalled whenever a slot frees up
+
+    // Background health checking
+    pthread_t               health_thread;
+    pthread_cond_t          health_cond;
+    riak_boolean_t          health_running;
+    riak_uint32_t           health_interval;
+};
+
+#endif // _RIAK_CONNECTION_POOL_INTERNAL_H
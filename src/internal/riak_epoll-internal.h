@@ -0,0 +1,66 @@
+/*********************************************************************
+ *
+ * riak_epoll-internal.h: Built-in edge-triggered epoll reactor (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_EPOLL_INTERNAL_H
+#define _RIAK_EPOLL_INTERNAL_H
+
+// Events handled per epoll_wait
+#define RIAK_EPOLL_MAX_EVENTS   64
+// Smallest write-back buffer a channel allocates
+#define RIAK_EPOLL_MIN_OUTBUF   4096
+// Event tag of the reactor's timerfd
+#define RIAK_EPOLL_TIMER_TAG    ((riak_uint64_t)-1)
+
+typedef struct _riak_epoll_pending {
+    riak_operation             *rop;
+    riak_uint64_t               deadline;  // Monotonic ms; 0 for none
+    struct _riak_epoll_pending *next;
+} riak_epoll_pending;
+
+typedef struct _riak_epoll_channel {
+    riak_epoll         *ep;
+    riak_connection    *cxn;
+    riak_socket_t       fd;          // Registered with epoll; -1 when detached
+    riak_uint32_t       index;
+    riak_uint32_t       generation;  // Tags events, so stale ones are dropped
+    riak_epoll_pending *head;        // Replies arrive in this order
+    riak_epoll_pending *tail;
+    riak_uint32_t       n_pending;
+    riak_uint8_t       *outbuf;      // Bytes the socket would not take yet
+    riak_size_t         out_start;
+    riak_size_t         out_end;
+    riak_size_t         out_size;
+    riak_boolean_t      broken;      // Reconnect before the next send
+} riak_epoll_channel;
+
+struct _riak_epoll {
+    riak_config          *config;
+    riak_connection_pool *pool;
+    int                   epfd;
+    int                   timerfd;
+    riak_uint64_t         next_deadline;  // When the timerfd fires; 0 if idle
+    riak_epoll_channel   *channels;
+    riak_uint32_t         n_channels;
+    riak_uint32_t         timeout;
+};
+
+#endif // _RIAK_EPOLL_INTERNAL_H
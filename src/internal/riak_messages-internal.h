@@ -116,7 +116,10 @@ riak_pb_message_free(riak_config     *cfg,
                      riak_pb_message **pb);
 
 #include "messages/riak_2index-internal.h"
+#include "messages/riak_counter-internal.h"
+#include "messages/riak_csbucket-internal.h"
 #include "messages/riak_delete-internal.h"
+#include "messages/riak_dt-internal.h"
 #include "messages/riak_get_bucketprops-internal.h"
 #include "messages/riak_get_clientid-internal.h"
 #include "messages/riak_get-internal.h"
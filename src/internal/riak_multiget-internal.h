@@ -0,0 +1,58 @@
+/*********************************************************************
+ *
+ * riak_multiget-internal.h: Fetch many keys over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_MULTIGET_INTERNAL_H
+#define _RIAK_MULTIGET_INTERNAL_H
+
+#include <pthread.h>
+
+// Shared by every worker of one batch
+typedef struct _riak_multiget_batch {
+    riak_connection_pool   *pool;
+    riak_binary            *bucket;
+    riak_binary           **keys;
+    riak_uint32_t           n_keys;
+    riak_get_options       *get_opts;
+    riak_uint32_t           depth;
+    riak_multiget_callback  cb;
+    void                   *cb_data;
+
+    pthread_mutex_t         lock;
+    riak_uint32_t           next;       // First key nobody has claimed
+    riak_error              result;     // First error seen
+} riak_multiget_batch;
+
+typedef struct _riak_multiget_worker {
+    riak_multiget_batch *batch;
+    riak_connection     *cxn;
+    riak_get_response   *response;      // Set by the pipelined response callback
+    pthread_t            thread;
+} riak_multiget_worker;
+
+// Hands results back in key order for riak_multiget
+typedef struct _riak_multiget_collector {
+    riak_get_response **responses;
+    riak_error         *errors;
+} riak_multiget_collector;
+
+#endif // _RIAK_MULTIGET_INTERNAL_H
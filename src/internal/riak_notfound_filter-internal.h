@@ -0,0 +1,49 @@
+/*********************************************************************
+ *
+ * riak_notfound_filter-internal.h: Negative-lookup cache for missing keys
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_NOTFOUND_FILTER_INTERNAL_H
+#define _RIAK_NOTFOUND_FILTER_INTERNAL_H
+
+#include <pthread.h>
+
+// Keys outlive at least (GENERATIONS - 1) / GENERATIONS of the TTL
+#define RIAK_NOTFOUND_GENERATIONS 4
+// Seven probes over ten counters per key give about 1% false positives
+#define RIAK_NOTFOUND_HASHES      7
+#define RIAK_NOTFOUND_PER_KEY     10
+// A saturated counter is never decremented again
+#define RIAK_NOTFOUND_SATURATED   255
+
+struct _riak_notfound_filter {
+    riak_config    *config;
+    riak_uint8_t   *counters;    // One block of `n_counters` per generation
+    riak_uint32_t   n_counters;  // Power of two
+    riak_uint32_t   current;     // Generation taking inserts
+    riak_uint64_t   rotate_at;   // Milliseconds, monotonic clock
+    riak_uint32_t   period;      // Milliseconds between rotations
+    riak_uint64_t   epoch;       // Bumped by every removal
+    riak_uint64_t   hits;
+    pthread_mutex_t lock;        // Held while rotating
+};
+
+#endif // _RIAK_NOTFOUND_FILTER_INTERNAL_H
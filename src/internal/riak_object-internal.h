@@ -106,6 +106,24 @@ int riak_object_to_pb_copy(riak_config *cfg,
                            RpbContent   *to,
                            riak_object  *from);
 
+/**
+ * @brief Encoded size of a Riak Object as an RpbContent
+ * @param obj Riak Object
+ * @returns Number of bytes written by `riak_object_wire_write`
+ */
+riak_size_t
+riak_object_wire_size(riak_object *obj);
+
+/**
+ * @brief Encode a Riak Object as an RpbContent, without building one
+ * @param obj Riak Object
+ * @param pos Output position, with room for `riak_object_wire_size` bytes
+ * @returns Position after the encoded object
+ */
+riak_uint8_t*
+riak_object_wire_write(riak_object  *obj,
+                       riak_uint8_t *pos);
+
 /**
  * @brief Release claimed memory used by PB Riak Object
  * @param cfg Riak Configuration
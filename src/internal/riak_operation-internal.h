@@ -23,28 +23,41 @@
 #ifndef _RIAK_OPERATION_INTERNAL_H
 #define _RIAK_OPERATION_INTERNAL_H
 
+// 4-byte big-endian length followed by the 1-byte message id
+#define RIAK_FRAME_HEADER_LEN 5
+// Header plus payload
+#define RIAK_FRAME_IOV_MAX    2
+
+// Per-chunk callback of a streaming operation; its real type depends on the request
+typedef void (*riak_stream_callback)(void);
+
 typedef riak_error (*riak_response_decoder)(struct _riak_operation  *rop,
                                             struct _riak_pb_message *pbresp,
                                             void                   **response,
                                             riak_boolean_t          *done);
 
+// Releases whatever the decoder has accumulated in `response`
+typedef void (*riak_response_free_fn)(riak_config *cfg,
+                                      void       **response);
+
 // Essentially the state of the current event
 struct _riak_operation {
     riak_connection         *connection;
+    riak_config             *config;      // Connection's arena, if it has one
     riak_response_decoder    decoder;
+    riak_response_free_fn    response_free;
     riak_response_callback   response_cb;
     riak_response_callback   error_cb;
     void                    *cb_data;
+    riak_stream_callback     stream_cb;   // Chunks go here instead of accumulating
+    void                    *stream_cb_data;
 
-    // Current message being decoded
-    riak_uint32_t            position;
-    riak_uint32_t            msglen;
-    riak_uint8_t            *msgbuf;
-    riak_boolean_t           msglen_complete;
-    riak_boolean_t           streaming;
+    riak_uint32_t            timeout;     // Overrides the connection's, in ms
+    riak_boolean_t           timed_out;
 
     // Results of message translation
     struct _riak_pb_message *pb_request;
+    riak_uint8_t             frame_header[RIAK_FRAME_HEADER_LEN];
     struct _riak_pb_message *pb_response;
 
     riak_server_error       *error;
@@ -57,6 +70,9 @@ struct _riak_operation {
         riak_binary *key;
         riak_binary *index;
     } request;
+
+    // Next operation pipelined on the same connection
+    struct _riak_operation  *next;
 };
 
 /**
@@ -68,5 +84,32 @@ void
 riak_operation_set_response_decoder(riak_operation       *rop,
                                     riak_response_decoder decoder);
 
+/**
+ * @brief Describe the framed request as an I/O vector, ready for `writev`
+ * @param rop Riak Operation with an encoded `pb_request`
+ * @param iov At least RIAK_FRAME_IOV_MAX entries to fill in
+ * @param length Incremented by the number of bytes described
+ * @returns Number of `iov` entries used
+ */
+/**
+ * @brief Set how a response produced by the decoder is released
+ * @param rop Riak Operation
+ * @param response_free Matching `riak_*_response_free` function
+ */
+void
+riak_operation_set_response_free(riak_operation       *rop,
+                                 riak_response_free_fn response_free);
+
+/**
+ * @brief Release a response the operation failed partway through
+ * @param rop Riak Operation; its `response` is NULL on return
+ */
+void
+riak_operation_discard_response(riak_operation *rop);
+
+int
+riak_frame_iov(riak_operation *rop,
+               struct iovec   *iov,
+               riak_ssize_t   *length);
 
 #endif //_RIAK_OPERATION_INTERNAL_H
@@ -0,0 +1,90 @@
+/*********************************************************************
+ *
+ * riak_runtime-internal.h: Per-core event loops shared by every thread (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_RUNTIME_INTERNAL_H
+#define _RIAK_RUNTIME_INTERNAL_H
+
+#include <pthread.h>
+
+// Intrusive multi-producer, single-consumer queue (after Vyukov)
+typedef struct _riak_mpsc_node {
+    struct _riak_mpsc_node *next;
+} riak_mpsc_node;
+
+typedef struct _riak_mpsc_queue {
+    riak_mpsc_node *head;      // Producers swap themselves in here
+    riak_uint8_t    pad[56];   // Keep producers and the consumer on separate cache lines
+    riak_mpsc_node *tail;      // Consumer side
+    riak_mpsc_node  stub;
+} riak_mpsc_queue;
+
+typedef enum _riak_runtime_task_kind {
+    RIAK_RUNTIME_TASK_GET = 0,
+    RIAK_RUNTIME_TASK_PUT,
+    RIAK_RUNTIME_TASK_FN
+} riak_runtime_task_kind;
+
+typedef struct _riak_runtime_task {
+    riak_mpsc_node            node;         // First, so a node is its task
+    riak_runtime_task_kind    kind;
+    riak_config              *config;
+    riak_operation           *rop;          // Encoded by the submitting thread
+    riak_runtime_completions *completions;
+    riak_runtime_get_callback get_cb;
+    riak_runtime_put_callback put_cb;
+    riak_runtime_task_fn      fn;
+    void                     *ptr;
+    riak_error                err;
+    void                     *response;
+} riak_runtime_task;
+
+typedef struct _riak_runtime_loop {
+    riak_runtime         *rt;
+    riak_uint32_t         index;
+    pthread_t             thread;
+    riak_boolean_t        started;
+    riak_connection_pool *pool;
+    riak_epoll           *ep;
+    int                   wakefd;          // eventfd
+    int                   wakeup_pending;  // Set while a wakeup is unread
+    riak_uint32_t         next_channel;
+    riak_mpsc_queue       submissions;
+} riak_runtime_loop;
+
+struct _riak_runtime {
+    riak_config           *config;
+    riak_runtime_loop     *loops;
+    riak_uint32_t          n_loops;
+    riak_uint32_t          n_channels;
+    riak_runtime_sharding  sharding;
+    riak_uint32_t          next_loop;
+    int                    stopping;
+};
+
+struct _riak_runtime_completions {
+    riak_config     *config;
+    int              fd;               // eventfd
+    int              wakeup_pending;
+    riak_mpsc_queue  queue;
+};
+
+#endif // _RIAK_RUNTIME_INTERNAL_H
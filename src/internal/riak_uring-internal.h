@@ -0,0 +1,97 @@
+/*********************************************************************
+ *
+ * riak_uring-internal.h: Optional io_uring transport (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifndef _RIAK_URING_INTERNAL_H
+#define _RIAK_URING_INTERNAL_H
+
+#include <linux/io_uring.h>
+
+// Smallest send buffer a channel allocates
+#define RIAK_URING_MIN_OUTBUF   4096
+// Buffer group the receive buffers are provided under
+#define RIAK_URING_BGID         0
+// Completion kinds, in the top byte of user_data
+#define RIAK_URING_RECV         1
+#define RIAK_URING_SEND         2
+#define RIAK_URING_CANCEL       3
+
+typedef struct _riak_uring_pending {
+    riak_operation             *rop;
+    riak_uint64_t               deadline;  // Monotonic ms; 0 for none
+    struct _riak_uring_pending *next;
+} riak_uring_pending;
+
+typedef struct _riak_uring_channel {
+    riak_uring         *ur;
+    riak_connection    *cxn;
+    riak_socket_t       fd;            // -1 while detached
+    riak_uint32_t       index;
+    riak_uint32_t       generation;    // Tags completions, so stale ones are dropped
+    riak_uring_pending *head;          // Replies arrive in this order
+    riak_uring_pending *tail;
+    riak_uint32_t       n_pending;
+    riak_uint32_t       n_recvs;       // Multishot receives the kernel still holds
+    riak_uint8_t       *rx_data;       // Received bytes riak_read has yet to take
+    riak_size_t         rx_len;
+    riak_uint8_t       *outbuf;        // Requests queued since the last submit
+    riak_size_t         out_end;
+    riak_size_t         out_size;
+    riak_uint8_t       *sendbuf;       // Owned by the kernel while send_busy
+    riak_size_t         send_start;
+    riak_size_t         send_end;
+    riak_size_t         send_size;
+    riak_boolean_t      send_busy;
+    riak_boolean_t      broken;        // Reconnect before the next send
+} riak_uring_channel;
+
+struct _riak_uring {
+    riak_config          *config;
+    riak_connection_pool *pool;
+    int                   fd;
+    // Submission ring
+    void                 *sq_ptr;
+    riak_size_t           sq_size;
+    riak_uint32_t        *sq_head;
+    riak_uint32_t        *sq_tail;
+    riak_uint32_t        *sq_mask;
+    riak_uint32_t        *sq_array;
+    struct io_uring_sqe  *sqes;
+    riak_size_t           sqes_size;
+    riak_uint32_t         n_queued;        // SQEs not yet handed to the kernel
+    // Completion ring
+    void                 *cq_ptr;
+    riak_size_t           cq_size;
+    riak_uint32_t        *cq_head;
+    riak_uint32_t        *cq_tail;
+    riak_uint32_t        *cq_mask;
+    struct io_uring_cqe  *cqes;
+    // Provided receive buffers
+    struct io_uring_buf_ring *buf_ring;
+    riak_size_t           buf_ring_size;
+    riak_uint8_t         *buffers;
+    riak_uint64_t         next_deadline;   // Earliest operation deadline; 0 if none
+    riak_uring_channel   *channels;
+    riak_uint32_t         n_channels;
+    riak_uint32_t         timeout;
+};
+
+#endif // _RIAK_URING_INTERNAL_H
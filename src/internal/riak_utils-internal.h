@@ -61,6 +61,24 @@ riak_array_realloc(riak_config *cfg,
                    riak_uint32_t oldnum,
                    riak_uint32_t newnum);
 
+/**
+ * @brief Make room for at least `needed` units, doubling the capacity as it grows
+ * @param cfg Riak Configuration
+ * @param from Location of array pointer (NULL to start a new array)
+ * @param size Size of one unit
+ * @param used Number of units in use, preserved across the move
+ * @param capacity Units allocated; updated when the array grows
+ * @param needed Units required
+ * @return Address of the (possibly moved) array or NULL on failure
+ */
+void**
+riak_array_reserve(riak_config   *cfg,
+                   void        ***from,
+                   riak_size_t    size,
+                   riak_uint32_t  used,
+                   riak_uint32_t *capacity,
+                   riak_uint32_t  needed);
+
 /**
  * @brief append a formatted string to a length-limited buffer
  * @param target pointer to end of the buffer, which will be updated
@@ -73,4 +91,52 @@ riak_snprintf_cat(char **target,
 		  const char *format,
 		  ...);
 
+// FNV-1a 64-bit offset basis
+#define RIAK_HASH_SEED 0xcbf29ce484222325ULL
+
+/**
+ * @brief Monotonic clock, suitable for measuring intervals
+ * @returns Current time in milliseconds
+ */
+riak_uint64_t
+riak_get_time_ms();
+
+/**
+ * @brief Monotonic clock with finer resolution, for per-stage timings
+ * @returns Current time in microseconds
+ */
+riak_uint64_t
+riak_get_time_us();
+
+/**
+ * @brief Delay before a retry: exponential, capped, with random jitter
+ * @param attempt Number of retries so far (0 for the first)
+ * @param base Delay in milliseconds before the first retry
+ * @param max Largest delay in milliseconds
+ * @returns Milliseconds to wait, between half and all of the capped delay
+ */
+riak_uint32_t
+riak_backoff_ms(riak_uint32_t attempt,
+                riak_uint32_t base,
+                riak_uint32_t max);
+
+/**
+ * @brief Sleep, resuming after signals
+ * @param ms Milliseconds to sleep
+ */
+void
+riak_sleep_ms(riak_uint32_t ms);
+
+/**
+ * @brief FNV-1a hash, chainable across several buffers
+ * @param data Bytes to hash
+ * @param len Length of `data`
+ * @param seed RIAK_HASH_SEED, or the result of hashing the preceding buffer
+ * @returns 64-bit hash
+ */
+riak_uint64_t
+riak_hash_bytes(const riak_uint8_t *data,
+                riak_size_t         len,
+                riak_uint64_t       seed);
+
 #endif // _RIAK_UTILS_INTERNAL_H
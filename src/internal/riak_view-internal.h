@@ -0,0 +1,123 @@
+/*********************************************************************
+ *
+ * riak_view-internal.h: Lazily decoded fetch responses
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_VIEW_INTERNAL_H
+#define _RIAK_VIEW_INTERNAL_H
+
+// Based off of RpbContent; filled in on first access
+struct _riak_object_view {
+    riak_get_view *parent;
+    riak_uint8_t  *data;         // Encoded RpbContent
+    riak_size_t    len;
+    riak_boolean_t scanned;
+    riak_boolean_t malformed;
+
+    riak_binary    value;
+    riak_boolean_t has_charset;
+    riak_binary    charset;
+    riak_boolean_t has_last_mod;
+    riak_uint32_t  last_mod;
+    riak_boolean_t has_last_mod_usecs;
+    riak_uint32_t  last_mod_usecs;
+    riak_boolean_t has_content_type;
+    riak_binary    content_type;
+    riak_boolean_t has_content_encoding;
+    riak_binary    encoding;
+    riak_boolean_t has_deleted;
+    riak_boolean_t deleted;
+    riak_boolean_t has_vtag;
+    riak_binary    vtag;
+
+    // Counted by the scan, built only when asked for
+    riak_int32_t   n_links;
+    riak_link    **links;
+    riak_int32_t   n_usermeta;
+    riak_pair    **usermeta;
+    riak_int32_t   n_indexes;
+    riak_pair    **indexes;
+};
+
+// Based off of RpbGetResp; one allocation holds this, the contents and the bytes
+struct _riak_get_view {
+    riak_config      *config;
+    riak_uint8_t     *data;         // Encoded message, as received
+    riak_size_t       len;
+    riak_binary       bucket;
+    riak_boolean_t    has_key;
+    riak_binary       key;
+    riak_boolean_t    has_vclock;
+    riak_binary       vclock;
+    riak_boolean_t    has_unmodified;
+    riak_boolean_t    unmodified;
+    riak_int32_t      n_content;
+    riak_object_view *content;
+};
+
+/**
+ * @brief Wrap an encoded RpbGetResp or RpbPutResp
+ * @param cfg Riak Configuration
+ * @param view Lazy response (out)
+ * @param bucket Bucket reported by the contents (copied, may be NULL)
+ * @param key Key reported by the contents (copied, may be NULL)
+ * @param data Encoded message (copied)
+ * @param len Length of `data`
+ * @param put_resp Whether `data` is an RpbPutResp, whose field 3 is the key
+ * @returns ERIAK_MESSAGE_FORMAT if the outer message is malformed
+ */
+riak_error
+riak_view_new(riak_config    *cfg,
+              riak_get_view **view,
+              riak_binary    *bucket,
+              riak_binary    *key,
+              riak_uint8_t   *data,
+              riak_size_t     len,
+              riak_boolean_t  put_resp);
+
+/**
+ * @brief Build a `riak_object` whose binaries point into the view
+ * @param cfg Riak Configuration
+ * @param ov Content of a lazy response
+ * @param obj Riak Object, valid only as long as the view (out)
+ * @returns ERIAK_MESSAGE_FORMAT if the content is malformed
+ * @note Links, user metadata and indexes move from `ov` to the object
+ */
+riak_error
+riak_object_view_to_object(riak_config       *cfg,
+                           riak_object_view  *ov,
+                           riak_object      **obj);
+
+/**
+ * @brief Response decoder producing a `riak_get_view`
+ * @param rop Riak Operation
+ * @param pbresp Encoded RpbGetResp, valid only during the call
+ * @param resp Lazy response (out)
+ * @param done Always set, fetches do not stream
+ * @returns Error code
+ */
+riak_error
+riak_get_view_decode(riak_operation   *rop,
+                     riak_pb_message  *pbresp,
+                     riak_get_view   **resp,
+                     riak_boolean_t   *done);
+
+#endif // _RIAK_VIEW_INTERNAL_H
@@ -0,0 +1,166 @@
+/*********************************************************************
+ *
+ * riak_wire-internal.h: Protocol buffer wire format scanning
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#ifndef _RIAK_WIRE_INTERNAL_H
+#define _RIAK_WIRE_INTERNAL_H
+
+// Protocol buffer wire types
+#define RIAK_WIRE_VARINT   0
+#define RIAK_WIRE_FIXED64  1
+#define RIAK_WIRE_BYTES    2
+#define RIAK_WIRE_FIXED32  5
+
+typedef struct _riak_wire_reader {
+    riak_uint8_t  *pos;
+    riak_uint8_t  *end;
+    riak_boolean_t failed;  // Set on truncated or unsupported input
+} riak_wire_reader;
+
+typedef struct _riak_wire_field {
+    riak_uint32_t  number;
+    riak_uint32_t  type;
+    riak_uint64_t  value;   // Varint and fixed fields
+    riak_uint8_t  *data;    // Length-delimited fields, pointing into the input
+    riak_size_t    len;
+} riak_wire_field;
+
+/**
+ * @brief Start scanning an encoded message in place
+ * @param reader Wire reader
+ * @param data Encoded message (not copied)
+ * @param len Length of `data`
+ */
+void
+riak_wire_reader_init(riak_wire_reader *reader,
+                      riak_uint8_t     *data,
+                      riak_size_t       len);
+
+/**
+ * @brief Decode a base-128 varint
+ * @param reader Wire reader
+ * @param value Decoded value (out)
+ * @returns RIAK_FALSE on truncated or overlong input
+ */
+riak_boolean_t
+riak_wire_read_varint(riak_wire_reader *reader,
+                      riak_uint64_t    *value);
+
+/**
+ * @brief Step to the next field without copying its contents
+ * @param reader Wire reader
+ * @param field Next field (out)
+ * @returns RIAK_FALSE at the end of input or on error (see `reader->failed`)
+ */
+riak_boolean_t
+riak_wire_next(riak_wire_reader *reader,
+               riak_wire_field  *field);
+
+/**
+ * @brief Count occurrences of one length-delimited field
+ * @param data Encoded message
+ * @param len Length of `data`
+ * @param number Field number
+ * @returns Number of occurrences, or -1 if the message is malformed
+ */
+riak_int32_t
+riak_wire_count(riak_uint8_t *data,
+                riak_size_t   len,
+                riak_uint32_t number);
+
+/**
+ * @brief Encoded size of a varint
+ * @param value Value to encode
+ * @returns Number of bytes
+ */
+riak_size_t
+riak_wire_varint_size(riak_uint64_t value);
+
+/**
+ * @brief Encoded size of a varint field, tag included
+ * @param number Field number
+ * @param value Value to encode
+ * @returns Number of bytes
+ */
+riak_size_t
+riak_wire_uint_size(riak_uint32_t number,
+                    riak_uint64_t value);
+
+/**
+ * @brief Encoded size of a length-delimited field, tag included
+ * @param number Field number
+ * @param len Length of the contents
+ * @returns Number of bytes
+ */
+riak_size_t
+riak_wire_bytes_size(riak_uint32_t number,
+                     riak_size_t   len);
+
+/**
+ * @brief Write a varint
+ * @param pos Output position, with room for the encoding
+ * @param value Value to encode
+ * @returns Position after the varint
+ */
+riak_uint8_t*
+riak_wire_put_varint(riak_uint8_t *pos,
+                     riak_uint64_t value);
+
+/**
+ * @brief Write a varint field
+ * @param pos Output position, with room for the encoding
+ * @param number Field number
+ * @param value Value to encode
+ * @returns Position after the field
+ */
+riak_uint8_t*
+riak_wire_put_uint(riak_uint8_t *pos,
+                   riak_uint32_t number,
+                   riak_uint64_t value);
+
+/**
+ * @brief Write a length-delimited field
+ * @param pos Output position, with room for the encoding
+ * @param number Field number
+ * @param data Contents (may be NULL when `len` is 0)
+ * @param len Length of the contents
+ * @returns Position after the field
+ */
+riak_uint8_t*
+riak_wire_put_bytes(riak_uint8_t *pos,
+                    riak_uint32_t number,
+                    riak_uint8_t *data,
+                    riak_size_t   len);
+
+/**
+ * @brief Write the tag and length of an embedded message
+ * @param pos Output position, with room for the encoding
+ * @param number Field number
+ * @param len Encoded length of the embedded message, which follows
+ * @returns Position of the embedded message
+ */
+riak_uint8_t*
+riak_wire_put_header(riak_uint8_t *pos,
+                     riak_uint32_t number,
+                     riak_size_t   len);
+
+#endif // _RIAK_WIRE_INTERNAL_H
@@ -95,10 +95,127 @@ riak_2index_request_encode(riak_operation      *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_2index_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_2index_response_free);
 
     return ERIAK_OK;
 }
 
+/**
+ * @brief Build the user-facing keys and results from every chunk received
+ * @param cfg Riak Configuration
+ * @param response Response holding the unpacked chunks in `_internal`
+ * @returns Error code
+ * @note Keys and results point into the chunks, which the response keeps
+ */
+static riak_error
+riak_2index_response_assemble(riak_config          *cfg,
+                              riak_2index_response *response) {
+    int i, j;
+    riak_uint32_t total_keys = 0;
+    riak_uint32_t total_results = 0;
+    for(i = 0; i < response->_n_responses; i++) {
+        total_keys    += response->_internal[i]->n_keys;
+        total_results += response->_internal[i]->n_results;
+    }
+    if (total_keys > 0) {
+        response->keys = (riak_binary**)riak_config_clean_allocate(cfg, sizeof(riak_binary*) * total_keys);
+        if (response->keys == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    if (total_results > 0) {
+        riak_error err = riak_pair_new_array(cfg, &(response->results), total_results);
+        if (err != ERIAK_OK) {
+            return err;
+        }
+    }
+    for(i = 0; i < response->_n_responses; i++) {
+        RpbIndexResp *rpb_response = response->_internal[i];
+        for(j = 0; j < rpb_response->n_keys; j++) {
+            riak_binary *key = riak_binary_copy_from_pb(cfg, &(rpb_response->keys[j]));
+            if (key == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+            response->keys[response->n_keys++] = key;
+        }
+        for(j = 0; j < rpb_response->n_results; j++) {
+            riak_error err = riak_pairs_copy_from_pb(cfg, &(response->results[response->n_results]), rpb_response->results[j]);
+            if (err != ERIAK_OK) {
+                return err;
+            }
+            response->n_results++;
+        }
+    }
+    // Only the last message of a page carries the continuation
+    RpbIndexResp *rpb_response = response->_internal[response->_n_responses-1];
+    response->has_continuation = rpb_response->has_continuation;
+    if (rpb_response->has_continuation) {
+        response->continuation = riak_binary_copy_from_pb(cfg, &(rpb_response->continuation));
+    }
+    response->has_done = rpb_response->has_done;
+    response->done = rpb_response->done;
+
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Turn one streamed message into a response of its own for the stream callback
+ * @param rop Riak Operation with a stream callback
+ * @param rpbresp Unpacked message, handed over to the chunk
+ * @param response Running summary: counts, continuation and done flag
+ * @returns Error code
+ */
+static riak_error
+riak_2index_stream_chunk(riak_operation       *rop,
+                         RpbIndexResp         *rpbresp,
+                         riak_2index_response *response) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    riak_2index_response *chunk = (riak_2index_response*)riak_config_clean_allocate(cfg, sizeof(riak_2index_response));
+    if (chunk == NULL) {
+        rpb_index_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    chunk->_internal = (RpbIndexResp **)riak_config_allocate(cfg, sizeof(RpbIndexResp*));
+    if (chunk->_internal == NULL) {
+        rpb_index_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        riak_free(cfg, &chunk);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    chunk->_internal[0]  = rpbresp;
+    chunk->_n_responses  = 1;
+    riak_error err = riak_2index_response_assemble(cfg, chunk);
+    if (err) {
+        riak_2index_response_free(cfg, &chunk);
+        return err;
+    }
+
+    // The summary outlives the chunk, so it needs its own continuation
+    response->n_keys    += chunk->n_keys;
+    response->n_results += chunk->n_results;
+    response->has_done   = chunk->has_done;
+    response->done       = chunk->done;
+    if (chunk->has_continuation) {
+        riak_binary_free(cfg, &(response->continuation));
+        response->has_continuation = RIAK_TRUE;
+        response->continuation = riak_binary_copy(cfg, chunk->continuation);
+        if (response->continuation == NULL) {
+            riak_2index_response_free(cfg, &chunk);
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    ((riak_2index_stream_callback)rop->stream_cb)(chunk, rop->stream_cb_data);
+
+    return ERIAK_OK;
+}
+
+void
+riak_2index_set_stream_cb(riak_operation             *rop,
+                          riak_2index_stream_callback cb,
+                          void                       *ptr) {
+    rop->stream_cb      = (riak_stream_callback)cb;
+    rop->stream_cb_data = ptr;
+}
+
 riak_error
 riak_2index_response_decode(riak_operation        *rop,
                             riak_pb_message       *pbresp,
@@ -117,92 +234,36 @@ riak_2index_response_decode(riak_operation        *rop,
     if (response == NULL) {
         response = (riak_2index_response*)riak_config_clean_allocate(cfg, sizeof(riak_2index_response));
         if (response == NULL) {
+            rpb_index_resp__free_unpacked(rpbresp, cfg->pb_allocator);
             return ERIAK_OUT_OF_MEMORY;
         }
+        *resp = response;
     }
     *done = RIAK_FALSE;
     if (rpbresp->has_done) {
         *done = rpbresp->done;
     }
+    if (rop->stream_cb) {
+        return riak_2index_stream_chunk(rop, rpbresp, response);
+    }
 
-    // Expand the vector of internal RpbListKeysResp links as necessary
+    // Hold on to every message until the last one arrives
     riak_uint32_t existing_pbs = response->_n_responses;
-    if (existing_pbs > 0) {
-        if (riak_array_realloc(cfg,
-                               (void***)&(response->_internal),
-                               sizeof(RpbIndexResp*),
-                               existing_pbs,
-                               (existing_pbs+1)) == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-    } else {
-        response->_internal = (RpbIndexResp **)riak_config_allocate(cfg, sizeof(RpbIndexResp*));
-        if (response->_internal == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
+    if (riak_array_reserve(cfg,
+                           (void***)&(response->_internal),
+                           sizeof(RpbIndexResp*),
+                           existing_pbs,
+                           &(response->_capacity),
+                           existing_pbs+1) == NULL) {
+        rpb_index_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
     }
     response->_internal[existing_pbs] = rpbresp;
     response->_n_responses++;
 
-    // If we are streaming, i.e., returning partial results or if we
-    // have the complete message, then assemble a user-consumable response
-    if (rop->streaming || *done) {
-        int i, j, chunk;
-        riak_uint32_t total_keys = 0;
-        riak_uint32_t total_results = 0;
-        for(i = 0; i < response->_n_responses; i++) {
-            total_keys    += response->_internal[i]->n_keys;
-            total_results += response->_internal[i]->n_results;
-        }
-        response->keys = (riak_binary**)riak_config_clean_allocate(cfg, sizeof(riak_binary*) * total_keys);
-        if (response->keys == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-        response->n_keys = total_keys;
-        riak_error err = riak_pair_new_array(cfg , &(response->results), total_results);
-        if (err != ERIAK_OK) {
-            return err;
-        }
-        response->n_results = total_results;
-
-        for(i = 0, j = 0, chunk = 0; i < response->n_keys; i++) {
-            RpbIndexResp *rpb_response = response->_internal[chunk];
-            response->keys[i] = riak_binary_copy_from_pb(cfg, &(rpb_response->keys[j]));
-            if (response->keys[i] == NULL) {
-                riak_free(cfg, &(response->keys));
-                return ERIAK_OUT_OF_MEMORY;
-            }
-            // If we have run out of keys in the current response,
-            // start working on the next response
-            if (++j >= response->_internal[chunk]->n_keys) {
-                chunk++;
-                j = 0;
-            }
-        }
-        for(i = 0, j = 0, chunk = 0; i < response->n_results; i++) {
-            RpbIndexResp *rpb_response = response->_internal[chunk];
-            err = riak_pairs_copy_from_pb(cfg, &(response->results[i]), rpb_response->results[j]);
-            if (err == ERIAK_OK) {
-                riak_free(cfg, &(response->results));
-                return ERIAK_OUT_OF_MEMORY;
-            }
-            // If we have run out of results in the current response,
-            // start working on the next response
-            if (++j >= response->_internal[chunk]->n_keys) {
-                chunk++;
-                j = 0;
-            }
-        }
+    if (*done) {
+        return riak_2index_response_assemble(cfg, response);
     }
-    // Is this correct?  This would only be from the last message
-    RpbIndexResp *rpb_response = response->_internal[response->_n_responses-1];
-    response->has_continuation = rpb_response->has_continuation;
-    response->continuation = riak_binary_copy_from_pb(cfg, &(rpb_response->continuation));
-    response->has_done = rpb_response->has_done;
-    response->done = rpb_response->done;
-
-    *resp = response;
-
     return ERIAK_OK;
 }
 
@@ -215,11 +276,13 @@ riak_2index_response_print(riak_2index_response *response,
 
     wrote += riak_print_int("n_keys", response->n_keys, target, len, total);
     int i;
-    for(i = 0; (*len > 0) && (i < response->n_keys); i++) {
+    for(i = 0; response->keys && (*len > 0) && (i < response->n_keys); i++) {
         wrote += riak_print_binary("key", response->keys[i], target, len, total);
     }
     wrote += riak_print_int("n_results", response->n_results, target, len, total);
-    wrote += riak_pairs_print(response->results, response->n_results, target, len, total);
+    if (response->results) {
+        wrote += riak_pairs_print(response->results, response->n_results, target, len, total);
+    }
     wrote += riak_print_bool("has_continuation", response->has_continuation, target, len, total);
     wrote += riak_print_binary("continuation", response->continuation, target, len, total);
     wrote += riak_print_bool("has_done", response->has_done, target, len, total);
@@ -236,12 +299,17 @@ riak_2index_response_free(riak_config           *cfg,
         return;
     }
     int i;
-    for(i = 0; i < response->n_keys; i++) {
-        riak_binary_free(cfg, &(response->keys[i]));
+    // Streamed summaries carry counts but no keys or results
+    if (response->keys) {
+        for(i = 0; i < response->n_keys; i++) {
+            riak_binary_free(cfg, &(response->keys[i]));
+        }
+        riak_free(cfg, &(response->keys));
+    }
+    if (response->results) {
+        riak_pairs_free(cfg, &(response->results), response->n_results);
     }
-    riak_free(cfg, &(response->keys));
-    riak_pairs_free(cfg, &(response->results), response->n_results);
-    riak_free(cfg, &(response->results));
+    riak_binary_free(cfg, &(response->continuation));
     for(i = 0; i < response->_n_responses; i++) {
         rpb_index_resp__free_unpacked(response->_internal[i], cfg->pb_allocator);
     }
@@ -306,12 +374,12 @@ riak_2index_options_free(riak_config          *cfg,
 
     riak_2index_options *opt = *options;
 
-    riak_free(cfg, &(opt->key));
-    riak_free(cfg, &(opt->range_min));
-    riak_free(cfg, &(opt->range_max));
-    riak_free(cfg, &(opt->type));
-    riak_free(cfg, &(opt->continuation));
-    riak_free(cfg, &(opt->term_regex));
+    riak_binary_free(cfg, &(opt->key));
+    riak_binary_free(cfg, &(opt->range_min));
+    riak_binary_free(cfg, &(opt->range_max));
+    riak_binary_free(cfg, &(opt->type));
+    riak_binary_free(cfg, &(opt->continuation));
+    riak_binary_free(cfg, &(opt->term_regex));
     riak_free(cfg, options);
 }
 
@@ -497,6 +565,7 @@ riak_2index_options_set_continuation(riak_config         *cfg,
                                      riak_2index_options *opt,
                                      riak_binary         *value) {
     opt->has_continuation = RIAK_TRUE;
+    riak_binary_free(cfg, &(opt->continuation));
     opt->continuation = riak_binary_copy(cfg, value);
     if (opt->continuation == NULL) {
         return ERIAK_OUT_OF_MEMORY;
@@ -0,0 +1,306 @@
+/*********************************************************************
+ *
+ * riak_counter.c: Riak C Client Legacy Counter Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+
+#include <unistd.h>
+#include "riak.h"
+#include "riak_messages.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_print-internal.h"
+
+//
+// U P D A T E
+//
+
+riak_error
+riak_counter_update_request_encode(riak_operation              *rop,
+                                   riak_binary                 *bucket,
+                                   riak_binary                 *key,
+                                   riak_int64_t                 amount,
+                                   riak_counter_update_options *options,
+                                   riak_pb_message            **req) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCounterUpdateReq updatereq = RPB_COUNTER_UPDATE_REQ__INIT;
+
+    riak_binary_copy_to_pb(&(updatereq.bucket), bucket);
+    riak_binary_copy_to_pb(&(updatereq.key), key);
+    riak_operation_set_bucket(rop, bucket);
+    riak_operation_set_key(rop, key);
+    updatereq.amount = amount;
+    if (options) {
+        updatereq.has_w           = options->has_w;
+        updatereq.w               = options->w;
+        updatereq.has_dw          = options->has_dw;
+        updatereq.dw              = options->dw;
+        updatereq.has_pw          = options->has_pw;
+        updatereq.pw              = options->pw;
+        updatereq.has_returnvalue = options->has_returnvalue;
+        updatereq.returnvalue     = options->returnvalue;
+    }
+    riak_size_t msglen = rpb_counter_update_req__get_packed_size(&updatereq);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    if (msgbuf == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    rpb_counter_update_req__pack(&updatereq, msgbuf);
+
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBCOUNTERUPDATEREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_counter_update_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_counter_update_response_free);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_counter_update_response_decode(riak_operation                *rop,
+                                    riak_pb_message               *pbresp,
+                                    riak_counter_update_response **resp,
+                                    riak_boolean_t                *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCounterUpdateResp *updateresp = rpb_counter_update_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
+    if (updateresp == NULL) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_counter_update_response *response = (riak_counter_update_response*)riak_config_clean_allocate(cfg, sizeof(riak_counter_update_response));
+    if (response == NULL) {
+        rpb_counter_update_resp__free_unpacked(updateresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    response->has_value = updateresp->has_value;
+    response->value     = updateresp->value;
+    rpb_counter_update_resp__free_unpacked(updateresp, cfg->pb_allocator);
+    *done = RIAK_TRUE;
+    *resp = response;
+
+    return ERIAK_OK;
+}
+
+int
+riak_counter_update_response_print(riak_counter_update_response *response,
+                                   char                         *target,
+                                   riak_int32_t                  len) {
+    riak_int32_t total = 0;
+    char buffer[32];
+    if (response->has_value) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)response->value);
+        riak_print_string("Counter", buffer, &target, &len, &total);
+    }
+    return total;
+}
+
+void
+riak_counter_update_response_free(riak_config                   *cfg,
+                                  riak_counter_update_response **resp) {
+    riak_free(cfg, resp);
+}
+
+riak_boolean_t
+riak_counter_update_get_has_value(riak_counter_update_response *response) {
+    return response->has_value;
+}
+
+riak_int64_t
+riak_counter_update_get_value(riak_counter_update_response *response) {
+    return response->value;
+}
+
+riak_counter_update_options*
+riak_counter_update_options_new(riak_config *cfg) {
+    riak_counter_update_options *o = (riak_counter_update_options*)riak_config_clean_allocate(cfg, sizeof(riak_counter_update_options));
+    return o;
+}
+
+void
+riak_counter_update_options_free(riak_config                  *cfg,
+                                 riak_counter_update_options **opt) {
+    riak_free(cfg, opt);
+}
+
+void
+riak_counter_update_options_set_w(riak_counter_update_options *opt,
+                                  riak_uint32_t                value) {
+    opt->has_w = RIAK_TRUE;
+    opt->w = value;
+}
+void
+riak_counter_update_options_set_dw(riak_counter_update_options *opt,
+                                   riak_uint32_t                value) {
+    opt->has_dw = RIAK_TRUE;
+    opt->dw = value;
+}
+void
+riak_counter_update_options_set_pw(riak_counter_update_options *opt,
+                                   riak_uint32_t                value) {
+    opt->has_pw = RIAK_TRUE;
+    opt->pw = value;
+}
+void
+riak_counter_update_options_set_returnvalue(riak_counter_update_options *opt,
+                                            riak_boolean_t               value) {
+    opt->has_returnvalue = RIAK_TRUE;
+    opt->returnvalue = value;
+}
+
+//
+// G E T
+//
+
+riak_error
+riak_counter_get_request_encode(riak_operation           *rop,
+                                riak_binary              *bucket,
+                                riak_binary              *key,
+                                riak_counter_get_options *options,
+                                riak_pb_message         **req) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCounterGetReq getreq = RPB_COUNTER_GET_REQ__INIT;
+
+    riak_binary_copy_to_pb(&(getreq.bucket), bucket);
+    riak_binary_copy_to_pb(&(getreq.key), key);
+    riak_operation_set_bucket(rop, bucket);
+    riak_operation_set_key(rop, key);
+    if (options) {
+        getreq.has_r            = options->has_r;
+        getreq.r                = options->r;
+        getreq.has_pr           = options->has_pr;
+        getreq.pr               = options->pr;
+        getreq.has_basic_quorum = options->has_basic_quorum;
+        getreq.basic_quorum     = options->basic_quorum;
+        getreq.has_notfound_ok  = options->has_notfound_ok;
+        getreq.notfound_ok      = options->notfound_ok;
+    }
+    riak_size_t msglen = rpb_counter_get_req__get_packed_size(&getreq);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    if (msgbuf == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    rpb_counter_get_req__pack(&getreq, msgbuf);
+
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBCOUNTERGETREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_counter_get_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_counter_get_response_free);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_counter_get_response_decode(riak_operation             *rop,
+                                 riak_pb_message            *pbresp,
+                                 riak_counter_get_response **resp,
+                                 riak_boolean_t             *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCounterGetResp *getresp = rpb_counter_get_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
+    if (getresp == NULL) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_counter_get_response *response = (riak_counter_get_response*)riak_config_clean_allocate(cfg, sizeof(riak_counter_get_response));
+    if (response == NULL) {
+        rpb_counter_get_resp__free_unpacked(getresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    response->has_value = getresp->has_value;
+    response->value     = getresp->value;
+    rpb_counter_get_resp__free_unpacked(getresp, cfg->pb_allocator);
+    *done = RIAK_TRUE;
+    *resp = response;
+
+    return ERIAK_OK;
+}
+
+int
+riak_counter_get_response_print(riak_counter_get_response *response,
+                                char                      *target,
+                                riak_int32_t               len) {
+    riak_int32_t total = 0;
+    char buffer[32];
+    if (response->has_value) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)response->value);
+        riak_print_string("Counter", buffer, &target, &len, &total);
+    } else {
+        riak_print_label("Not Found", &target, &len, &total);
+    }
+    return total;
+}
+
+void
+riak_counter_get_response_free(riak_config                *cfg,
+                               riak_counter_get_response **resp) {
+    riak_free(cfg, resp);
+}
+
+riak_boolean_t
+riak_counter_get_get_has_value(riak_counter_get_response *response) {
+    return response->has_value;
+}
+
+riak_int64_t
+riak_counter_get_get_value(riak_counter_get_response *response) {
+    return response->value;
+}
+
+riak_counter_get_options*
+riak_counter_get_options_new(riak_config *cfg) {
+    riak_counter_get_options *o = (riak_counter_get_options*)riak_config_clean_allocate(cfg, sizeof(riak_counter_get_options));
+    return o;
+}
+
+void
+riak_counter_get_options_free(riak_config               *cfg,
+                              riak_counter_get_options **opt) {
+    riak_free(cfg, opt);
+}
+
+void
+riak_counter_get_options_set_r(riak_counter_get_options *opt,
+                               riak_uint32_t             value) {
+    opt->has_r = RIAK_TRUE;
+    opt->r = value;
+}
+void
+riak_counter_get_options_set_pr(riak_counter_get_options *opt,
+                                riak_uint32_t             value) {
+    opt->has_pr = RIAK_TRUE;
+    opt->pr = value;
+}
+void
+riak_counter_get_options_set_basic_quorum(riak_counter_get_options *opt,
+                                          riak_boolean_t            value) {
+    opt->has_basic_quorum = RIAK_TRUE;
+    opt->basic_quorum = value;
+}
+void
+riak_counter_get_options_set_notfound_ok(riak_counter_get_options *opt,
+                                         riak_boolean_t            value) {
+    opt->has_notfound_ok = RIAK_TRUE;
+    opt->notfound_ok = value;
+}
@@ -0,0 +1,456 @@
+/*********************************************************************
+ *
+ * riak_csbucket.c: Riak C Client Bucket Range Fold Message
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+
+#include <unistd.h>
+#include "riak.h"
+#include "riak_messages.h"
+#include "riak_messages-internal.h"
+#include "riak_object-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_print-internal.h"
+
+riak_error
+riak_csbucket_request_encode(riak_operation         *rop,
+                             riak_binary            *bucket,
+                             riak_binary            *start_key,
+                             riak_csbucket_options  *options,
+                             riak_pb_message       **req) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCSBucketReq foldreq = RPB_CSBUCKET_REQ__INIT;
+
+    riak_operation_set_bucket(rop, bucket);
+    riak_binary_copy_to_pb(&(foldreq.bucket), bucket);
+    riak_binary_copy_to_pb(&(foldreq.start_key), start_key);
+    if (options) {
+        foldreq.has_end_key = options->has_end_key;
+        if (options->has_end_key) {
+            riak_binary_copy_to_pb(&(foldreq.end_key), options->end_key);
+        }
+        foldreq.has_start_incl   = options->has_start_incl;
+        foldreq.start_incl       = options->start_incl;
+        foldreq.has_end_incl     = options->has_end_incl;
+        foldreq.end_incl         = options->end_incl;
+        foldreq.has_continuation = options->has_continuation;
+        if (options->has_continuation) {
+            riak_binary_copy_to_pb(&(foldreq.continuation), options->continuation);
+        }
+        foldreq.has_max_results  = options->has_max_results;
+        foldreq.max_results      = options->max_results;
+        foldreq.has_timeout      = options->has_timeout;
+        foldreq.timeout          = options->timeout;
+        foldreq.has_type         = options->has_type;
+        if (options->has_type) {
+            riak_binary_copy_to_pb(&(foldreq.type), options->type);
+        }
+    }
+    riak_size_t msglen = rpb_csbucket_req__get_packed_size(&foldreq);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    if (msgbuf == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    rpb_csbucket_req__pack(&foldreq, msgbuf);
+
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBCSBUCKETREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_csbucket_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_csbucket_response_free);
+
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Shallow copy one folded object, as `riak_get` would have returned it
+ * @note RpbContent carries neither bucket nor key, so every sibling is given both
+ */
+static riak_error
+riak_csbucket_object_from_pb(riak_config        *cfg,
+                             riak_get_response **target,
+                             riak_binary        *bucket,
+                             RpbIndexObject     *obj) {
+    RpbGetResp *from = obj->object;
+    riak_get_response *response = (riak_get_response*)riak_config_clean_allocate(cfg, sizeof(riak_get_response));
+    if (response == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *target = response;
+    if (from->has_vclock) {
+        response->has_vclock = RIAK_TRUE;
+        response->vclock = riak_binary_copy_from_pb(cfg, &(from->vclock));
+        if (response->vclock == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    if (from->has_unchanged) {
+        response->has_unmodified = RIAK_TRUE;
+        response->unmodified = from->unchanged;
+    }
+    if (from->n_content > 0) {
+        riak_error err = riak_object_new_array(cfg, &(response->content), from->n_content);
+        if (err) {
+            return err;
+        }
+        for( ; response->n_content < from->n_content; response->n_content++) {
+            err = riak_object_new_from_pb(cfg, &(response->content[response->n_content]), from->content[response->n_content]);
+            riak_object *sibling = response->content[response->n_content];
+            if (err == ERIAK_OK && bucket) {
+                riak_object_set_bucket(sibling, riak_binary_copy(cfg, bucket));
+                if (sibling->bucket == NULL) err = ERIAK_OUT_OF_MEMORY;
+            }
+            if (err == ERIAK_OK) {
+                riak_object_set_key(sibling, riak_binary_copy_from_pb(cfg, &(obj->key)));
+                if (sibling->key == NULL) err = ERIAK_OUT_OF_MEMORY;
+            }
+            if (err) {
+                // A partly built sibling is still released with the rest
+                response->n_content++;
+                return err;
+            }
+        }
+    }
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Build the user-facing keys and objects from every message received
+ * @param cfg Riak Configuration
+ * @param bucket Bucket that was folded, copied into every object
+ * @param response Response holding the unpacked messages in `_internal`
+ * @returns Error code
+ * @note Keys and objects point into the messages, which the response keeps
+ */
+static riak_error
+riak_csbucket_response_assemble(riak_config            *cfg,
+                                riak_binary            *bucket,
+                                riak_csbucket_response *response) {
+    int i, j;
+    riak_uint32_t total = 0;
+    for(i = 0; i < response->_n_responses; i++) {
+        total += response->_internal[i]->n_objects;
+    }
+    if (total > 0) {
+        response->keys = (riak_binary**)riak_config_clean_allocate(cfg, sizeof(riak_binary*) * total);
+        response->objects = (riak_get_response**)riak_config_clean_allocate(cfg, sizeof(riak_get_response*) * total);
+        if (response->keys == NULL || response->objects == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    for(i = 0; i < response->_n_responses; i++) {
+        RpbCSBucketResp *rpb_response = response->_internal[i];
+        for(j = 0; j < rpb_response->n_objects; j++) {
+            RpbIndexObject *obj = rpb_response->objects[j];
+            riak_uint32_t n = response->n_objects++;
+            response->keys[n] = riak_binary_copy_from_pb(cfg, &(obj->key));
+            if (response->keys[n] == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+            riak_error err = riak_csbucket_object_from_pb(cfg, &(response->objects[n]), bucket, obj);
+            if (err) {
+                return err;
+            }
+        }
+        // The continuation normally rides on the final message
+        if (rpb_response->has_continuation) {
+            riak_binary_free(cfg, &(response->continuation));
+            response->has_continuation = RIAK_TRUE;
+            response->continuation = riak_binary_copy_from_pb(cfg, &(rpb_response->continuation));
+            if (response->continuation == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+        }
+    }
+    RpbCSBucketResp *rpb_response = response->_internal[response->_n_responses-1];
+    response->has_done = rpb_response->has_done;
+    response->done = rpb_response->done;
+
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Turn one streamed message into a response of its own for the stream callback
+ * @param rop Riak Operation with a stream callback
+ * @param rpbresp Unpacked message, handed over to the chunk
+ * @param response Running summary: counts, continuation and done flag
+ * @returns Error code
+ */
+static riak_error
+riak_csbucket_stream_chunk(riak_operation         *rop,
+                           RpbCSBucketResp        *rpbresp,
+                           riak_csbucket_response *response) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    riak_csbucket_response *chunk = (riak_csbucket_response*)riak_config_clean_allocate(cfg, sizeof(riak_csbucket_response));
+    if (chunk == NULL) {
+        rpb_csbucket_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    chunk->_internal = (RpbCSBucketResp**)riak_config_allocate(cfg, sizeof(RpbCSBucketResp*));
+    if (chunk->_internal == NULL) {
+        rpb_csbucket_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        riak_free(cfg, &chunk);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    chunk->_internal[0] = rpbresp;
+    chunk->_n_responses = 1;
+    riak_error err = riak_csbucket_response_assemble(cfg, riak_operation_get_bucket(rop), chunk);
+    if (err) {
+        riak_csbucket_response_free(cfg, &chunk);
+        return err;
+    }
+
+    // The summary outlives the chunk, so it needs its own continuation
+    response->n_objects += chunk->n_objects;
+    response->has_done   = chunk->has_done;
+    response->done       = chunk->done;
+    if (chunk->has_continuation) {
+        riak_binary_free(cfg, &(response->continuation));
+        response->has_continuation = RIAK_TRUE;
+        response->continuation = riak_binary_copy(cfg, chunk->continuation);
+        if (response->continuation == NULL) {
+            riak_csbucket_response_free(cfg, &chunk);
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    ((riak_csbucket_stream_callback)rop->stream_cb)(chunk, rop->stream_cb_data);
+
+    return ERIAK_OK;
+}
+
+void
+riak_csbucket_set_stream_cb(riak_operation               *rop,
+                            riak_csbucket_stream_callback cb,
+                            void                         *ptr) {
+    rop->stream_cb      = (riak_stream_callback)cb;
+    rop->stream_cb_data = ptr;
+}
+
+riak_error
+riak_csbucket_response_decode(riak_operation          *rop,
+                              riak_pb_message         *pbresp,
+                              riak_csbucket_response **resp,
+                              riak_boolean_t          *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    RpbCSBucketResp *rpbresp = rpb_csbucket_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
+    if (rpbresp == NULL) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+
+    // NULL until the first message of the fold arrives
+    riak_csbucket_response *response = *resp;
+    if (response == NULL) {
+        response = (riak_csbucket_response*)riak_config_clean_allocate(cfg, sizeof(riak_csbucket_response));
+        if (response == NULL) {
+            rpb_csbucket_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        *resp = response;
+    }
+    *done = RIAK_FALSE;
+    if (rpbresp->has_done) {
+        *done = rpbresp->done;
+    }
+    if (rop->stream_cb) {
+        return riak_csbucket_stream_chunk(rop, rpbresp, response);
+    }
+
+    // Hold on to every message until the last one arrives
+    riak_uint32_t existing_pbs = response->_n_responses;
+    if (riak_array_reserve(cfg,
+                           (void***)&(response->_internal),
+                           sizeof(RpbCSBucketResp*),
+                           existing_pbs,
+                           &(response->_capacity),
+                           existing_pbs+1) == NULL) {
+        rpb_csbucket_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    response->_internal[existing_pbs] = rpbresp;
+    response->_n_responses++;
+
+    if (*done) {
+        return riak_csbucket_response_assemble(cfg, riak_operation_get_bucket(rop), response);
+    }
+    return ERIAK_OK;
+}
+
+int
+riak_csbucket_response_print(riak_csbucket_response *response,
+                             char                   *target,
+                             riak_int32_t            len) {
+    riak_int32_t total = 0;
+    riak_print_int("Objects", response->n_objects, &target, &len, &total);
+    int i;
+    for(i = 0; response->keys && (len > 0) && (i < response->n_objects); i++) {
+        riak_print_binary("Key", response->keys[i], &target, &len, &total);
+    }
+    if (response->has_continuation) {
+        riak_print_binary_hex("Continuation", response->continuation, &target, &len, &total);
+    }
+    riak_print_bool("Done", response->done, &target, &len, &total);
+    return total;
+}
+
+void
+riak_csbucket_response_free(riak_config             *cfg,
+                            riak_csbucket_response **resp) {
+    riak_csbucket_response *response = *resp;
+    if (response == NULL) return;
+    int i;
+    // Streamed summaries carry counts but no keys or objects
+    if (response->keys) {
+        for(i = 0; i < response->n_objects; i++) {
+            riak_binary_free(cfg, &(response->keys[i]));
+        }
+        riak_free(cfg, &(response->keys));
+    }
+    if (response->objects) {
+        for(i = 0; i < response->n_objects; i++) {
+            riak_get_response_free(cfg, &(response->objects[i]));
+        }
+        riak_free(cfg, &(response->objects));
+    }
+    riak_binary_free(cfg, &(response->continuation));
+    for(i = 0; i < response->_n_responses; i++) {
+        rpb_csbucket_resp__free_unpacked(response->_internal[i], cfg->pb_allocator);
+    }
+    riak_free(cfg, &(response->_internal));
+    riak_free(cfg, resp);
+}
+
+riak_uint32_t
+riak_csbucket_get_n_objects(riak_csbucket_response *response) {
+    return response->n_objects;
+}
+
+riak_binary**
+riak_csbucket_get_keys(riak_csbucket_response *response) {
+    return response->keys;
+}
+
+riak_get_response**
+riak_csbucket_get_objects(riak_csbucket_response *response) {
+    return response->objects;
+}
+
+riak_boolean_t
+riak_csbucket_get_has_continuation(riak_csbucket_response *response) {
+    return response->has_continuation;
+}
+
+riak_binary*
+riak_csbucket_get_continuation(riak_csbucket_response *response) {
+    return response->continuation;
+}
+
+riak_boolean_t
+riak_csbucket_get_done(riak_csbucket_response *response) {
+    return response->done;
+}
+
+riak_csbucket_options*
+riak_csbucket_options_new(riak_config *cfg) {
+    riak_csbucket_options *o = (riak_csbucket_options*)riak_config_clean_allocate(cfg, sizeof(riak_csbucket_options));
+    return o;
+}
+
+void
+riak_csbucket_options_free(riak_config            *cfg,
+                           riak_csbucket_options **opt) {
+    riak_csbucket_options *options = *opt;
+    if (options == NULL) return;
+    riak_binary_free(cfg, &(options->end_key));
+    riak_binary_free(cfg, &(options->continuation));
+    riak_binary_free(cfg, &(options->type));
+    riak_free(cfg, opt);
+}
+
+riak_error
+riak_csbucket_options_set_end_key(riak_config           *cfg,
+                                  riak_csbucket_options *opt,
+                                  riak_binary           *value) {
+    opt->has_end_key = RIAK_TRUE;
+    riak_binary_free(cfg, &(opt->end_key));
+    opt->end_key = riak_binary_copy(cfg, value);
+    if (opt->end_key == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    return ERIAK_OK;
+}
+
+void
+riak_csbucket_options_set_start_incl(riak_csbucket_options *opt,
+                                     riak_boolean_t         value) {
+    opt->has_start_incl = RIAK_TRUE;
+    opt->start_incl = value;
+}
+
+void
+riak_csbucket_options_set_end_incl(riak_csbucket_options *opt,
+                                   riak_boolean_t         value) {
+    opt->has_end_incl = RIAK_TRUE;
+    opt->end_incl = value;
+}
+
+riak_error
+riak_csbucket_options_set_continuation(riak_config           *cfg,
+                                       riak_csbucket_options *opt,
+                                       riak_binary           *value) {
+    opt->has_continuation = RIAK_TRUE;
+    riak_binary_free(cfg, &(opt->continuation));
+    opt->continuation = riak_binary_copy(cfg, value);
+    if (opt->continuation == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    return ERIAK_OK;
+}
+
+void
+riak_csbucket_options_set_max_results(riak_csbucket_options *opt,
+                                      riak_uint32_t          value) {
+    opt->has_max_results = RIAK_TRUE;
+    opt->max_results = value;
+}
+
+void
+riak_csbucket_options_set_timeout(riak_csbucket_options *opt,
+                                  riak_uint32_t          value) {
+    opt->has_timeout = RIAK_TRUE;
+    opt->timeout = value;
+}
+
+riak_error
+riak_csbucket_options_set_type(riak_config           *cfg,
+                               riak_csbucket_options *opt,
+                               riak_binary           *value) {
+    opt->has_type = RIAK_TRUE;
+    riak_binary_free(cfg, &(opt->type));
+    opt->type = riak_binary_copy(cfg, value);
+    if (opt->type == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    return ERIAK_OK;
+}
@@ -78,7 +78,7 @@ riak_delete_request_encode(riak_operation      *rop,
     }
 
     riak_uint32_t msglen = rpb_del_req__get_packed_size (&delmsg);
-    riak_uint8_t* msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -90,6 +90,7 @@ riak_delete_request_encode(riak_operation      *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_delete_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_delete_response_free);
 
     return ERIAK_OK;
 }
@@ -101,7 +102,7 @@ riak_delete_response_decode(riak_operation        *rop,
                             riak_delete_response **resp,
                             riak_boolean_t        *done) {
     riak_config *cfg = riak_operation_get_config(rop);
-    riak_delete_response *response = (riak_delete_response*)(cfg->malloc_fn)(sizeof(riak_delete_response));
+    riak_delete_response *response = (riak_delete_response*)riak_config_allocate(cfg, sizeof(riak_delete_response));
     *done = RIAK_TRUE;
     if (response == NULL) {
         return ERIAK_OUT_OF_MEMORY;
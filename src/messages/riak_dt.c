@@ -0,0 +1,1267 @@
+/*********************************************************************
+ *
+ * riak_dt.c: Riak C Client Data Type (CRDT) Messages
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <unistd.h>
+#include "riak.h"
+#include "riak_messages.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_print-internal.h"
+
+// Smallest index allocated for set members or map fields
+#define RIAK_DT_INDEX_MIN_SIZE 16
+
+//
+// O P E R A T I O N S
+//
+
+static riak_dt_op*
+riak_dt_op_alloc(riak_config  *cfg,
+                 riak_dt_op   *parent,
+                 riak_uint32_t type) {
+    riak_dt_op *op = (riak_dt_op*)riak_config_clean_allocate(cfg, sizeof(riak_dt_op));
+    if (op == NULL) {
+        return NULL;
+    }
+    op->config = cfg;
+    op->parent = parent;
+    op->type   = type;
+    return op;
+}
+
+riak_dt_op*
+riak_dt_op_new(riak_config *cfg,
+               riak_dt_type type) {
+    switch (type) {
+    case RIAK_DT_COUNTER:
+        return riak_dt_op_alloc(cfg, NULL, RIAK_DT_FIELD_COUNTER);
+    case RIAK_DT_SET:
+        return riak_dt_op_alloc(cfg, NULL, RIAK_DT_FIELD_SET);
+    case RIAK_DT_MAP:
+        return riak_dt_op_alloc(cfg, NULL, RIAK_DT_FIELD_MAP);
+    }
+    return NULL;
+}
+
+static void
+riak_dt_op_release_entries(riak_dt_op *op) {
+    riak_config *cfg = op->config;
+    int i;
+    for(i = 0; i < op->n_entries; i++) {
+        riak_binary_free(cfg, &(op->entries[i].name));
+        riak_binary_free(cfg, &(op->entries[i].reg));
+        riak_dt_op_free(cfg, &(op->entries[i].op));
+    }
+    op->n_entries = 0;
+    if (op->index) {
+        memset((void*)op->index, '\0', op->index_size * sizeof(riak_uint32_t));
+    }
+}
+
+void
+riak_dt_op_free(riak_config *cfg,
+                riak_dt_op **op_target) {
+    if (op_target == NULL || *op_target == NULL) return;
+    riak_dt_op *op = *op_target;
+    riak_dt_op_release_entries(op);
+    riak_free(cfg, &(op->entries));
+    riak_free(cfg, &(op->index));
+    riak_free(cfg, op_target);
+}
+
+// Every enclosing map counts the operations applied to its fields
+static void
+riak_dt_op_add_pending(riak_dt_op  *op,
+                       riak_int32_t delta) {
+    for( ; op != NULL; op = op->parent) {
+        op->n_pending += delta;
+    }
+}
+
+void
+riak_dt_op_clear(riak_dt_op *op) {
+    riak_dt_op_add_pending(op, -(riak_int32_t)op->n_pending);
+    riak_dt_op_release_entries(op);
+    op->increment = 0;
+}
+
+riak_uint32_t
+riak_dt_op_get_n_pending(riak_dt_op *op) {
+    return op->n_pending;
+}
+
+static riak_uint32_t
+riak_dt_entry_hash(riak_binary  *name,
+                   riak_uint32_t type) {
+    riak_uint8_t t = (riak_uint8_t)type;
+    return (riak_uint32_t)riak_hash_bytes(name->data, name->len, riak_hash_bytes(&t, 1, RIAK_HASH_SEED));
+}
+
+static riak_error
+riak_dt_op_grow_index(riak_dt_op *op) {
+    riak_config  *cfg  = op->config;
+    riak_uint32_t size = (op->index_size > 0) ? op->index_size * 2 : RIAK_DT_INDEX_MIN_SIZE;
+    riak_uint32_t *index = (riak_uint32_t*)riak_config_clean_allocate(cfg, size * sizeof(riak_uint32_t));
+    if (index == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_uint32_t i;
+    for(i = 0; i < op->n_entries; i++) {
+        riak_uint32_t slot = riak_dt_entry_hash(op->entries[i].name, op->entries[i].type) & (size - 1);
+        while (index[slot] != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        index[slot] = i + 1;
+    }
+    riak_free(cfg, &(op->index));
+    op->index      = index;
+    op->index_size = size;
+
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Find the pending entry for a set member or map field, adding it if new
+ * @param op Set or Map operation
+ * @param name Set member or field name
+ * @param type Map field type; 0 for set members
+ * @param entry Pending entry (out)
+ * @returns Error code
+ */
+static riak_error
+riak_dt_op_entry(riak_dt_op     *op,
+                 riak_binary    *name,
+                 riak_uint32_t   type,
+                 riak_dt_entry **entry) {
+    riak_config *cfg = op->config;
+    // Kept at most half full so probes stay short
+    if ((op->n_entries + 1) * 2 > op->index_size) {
+        riak_error err = riak_dt_op_grow_index(op);
+        if (err) {
+            return err;
+        }
+    }
+    riak_uint32_t mask = op->index_size - 1;
+    riak_uint32_t slot = riak_dt_entry_hash(name, type) & mask;
+    while (op->index[slot] != 0) {
+        riak_dt_entry *found = &(op->entries[op->index[slot] - 1]);
+        if (found->type == type && found->name->len == name->len &&
+            (name->len == 0 || memcmp(found->name->data, name->data, name->len) == 0)) {
+            *entry = found;
+            return ERIAK_OK;
+        }
+        slot = (slot + 1) & mask;
+    }
+    if (riak_array_reserve(cfg,
+                           (void***)&(op->entries),
+                           sizeof(riak_dt_entry),
+                           op->n_entries,
+                           &(op->entries_capacity),
+                           op->n_entries + 1) == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_dt_entry *added = &(op->entries[op->n_entries]);
+    memset((void*)added, '\0', sizeof(riak_dt_entry));
+    added->name = riak_binary_copy(cfg, name);
+    if (added->name == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    added->type = type;
+    op->index[slot] = ++(op->n_entries);
+    *entry = added;
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_op_counter_increment(riak_dt_op  *op,
+                             riak_int64_t amount) {
+    if (op->type != RIAK_DT_FIELD_COUNTER) {
+        return ERIAK_DT_TYPE;
+    }
+    op->increment += amount;
+    riak_dt_op_add_pending(op, 1);
+
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_dt_op_set_member(riak_dt_op    *op,
+                      riak_binary   *member,
+                      riak_boolean_t removed) {
+    if (op->type != RIAK_DT_FIELD_SET) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_dt_entry *entry = NULL;
+    riak_error err = riak_dt_op_entry(op, member, 0, &entry);
+    if (err) {
+        return err;
+    }
+    // Only the last add or remove of a member is sent
+    entry->removed = removed;
+    riak_dt_op_add_pending(op, 1);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_op_set_add(riak_dt_op  *op,
+                   riak_binary *member) {
+    return riak_dt_op_set_member(op, member, RIAK_FALSE);
+}
+
+riak_error
+riak_dt_op_set_remove(riak_dt_op  *op,
+                      riak_binary *member) {
+    return riak_dt_op_set_member(op, member, RIAK_TRUE);
+}
+
+riak_error
+riak_dt_op_map_update(riak_dt_op         *op,
+                      riak_binary        *name,
+                      riak_dt_field_type  type,
+                      riak_dt_op        **field_op) {
+    if (op->type != RIAK_DT_FIELD_MAP ||
+        (type != RIAK_DT_FIELD_COUNTER && type != RIAK_DT_FIELD_SET && type != RIAK_DT_FIELD_MAP)) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_dt_entry *entry = NULL;
+    riak_error err = riak_dt_op_entry(op, name, type, &entry);
+    if (err) {
+        return err;
+    }
+    if (entry->op == NULL) {
+        entry->op = riak_dt_op_alloc(op->config, op, type);
+        if (entry->op == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        // Creating the field is an operation in itself
+        entry->removed = RIAK_FALSE;
+        riak_dt_op_add_pending(op, 1);
+    }
+    *field_op = entry->op;
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_op_map_set_register(riak_dt_op  *op,
+                            riak_binary *name,
+                            riak_binary *value) {
+    if (op->type != RIAK_DT_FIELD_MAP) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_binary *reg = riak_binary_copy(op->config, value);
+    if (reg == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_dt_entry *entry = NULL;
+    riak_error err = riak_dt_op_entry(op, name, RIAK_DT_FIELD_REGISTER, &entry);
+    if (err) {
+        riak_binary_free(op->config, &reg);
+        return err;
+    }
+    riak_binary_free(op->config, &(entry->reg));
+    entry->reg     = reg;
+    entry->removed = RIAK_FALSE;
+    riak_dt_op_add_pending(op, 1);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_op_map_set_flag(riak_dt_op    *op,
+                        riak_binary   *name,
+                        riak_boolean_t enable) {
+    if (op->type != RIAK_DT_FIELD_MAP) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_dt_entry *entry = NULL;
+    riak_error err = riak_dt_op_entry(op, name, RIAK_DT_FIELD_FLAG, &entry);
+    if (err) {
+        return err;
+    }
+    entry->enable  = enable;
+    entry->removed = RIAK_FALSE;
+    riak_dt_op_add_pending(op, 1);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_op_map_remove(riak_dt_op         *op,
+                      riak_binary        *name,
+                      riak_dt_field_type  type) {
+    if (op->type != RIAK_DT_FIELD_MAP ||
+        type < RIAK_DT_FIELD_COUNTER || type > RIAK_DT_FIELD_MAP) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_dt_entry *entry = NULL;
+    riak_error err = riak_dt_op_entry(op, name, type, &entry);
+    if (err) {
+        return err;
+    }
+    // Pending updates to the field are moot once it is removed
+    if (entry->op) {
+        riak_dt_op_add_pending(op, -(riak_int32_t)entry->op->n_pending);
+    }
+    riak_dt_op_free(op->config, &(entry->op));
+    riak_binary_free(op->config, &(entry->reg));
+    entry->removed = RIAK_TRUE;
+    riak_dt_op_add_pending(op, 1);
+
+    return ERIAK_OK;
+}
+
+//
+// E N C O D I N G
+//
+
+static void
+riak_dt_set_free_pb(riak_config *cfg,
+                    SetOp      **pb_target) {
+    SetOp *pb = *pb_target;
+    if (pb == NULL) return;
+    riak_free(cfg, &(pb->adds));
+    riak_free(cfg, &(pb->removes));
+    riak_free(cfg, pb_target);
+}
+
+static void
+riak_dt_map_free_pb(riak_config *cfg,
+                    MapOp      **pb_target) {
+    MapOp *pb = *pb_target;
+    if (pb == NULL) return;
+    int i;
+    for(i = 0; i < pb->n_adds; i++) {
+        riak_free(cfg, &(pb->adds[i]));
+    }
+    for(i = 0; i < pb->n_removes; i++) {
+        riak_free(cfg, &(pb->removes[i]));
+    }
+    for(i = 0; i < pb->n_updates; i++) {
+        MapUpdate *update = pb->updates[i];
+        riak_free(cfg, &(update->field));
+        riak_free(cfg, &(update->counter_op));
+        riak_dt_set_free_pb(cfg, &(update->set_op));
+        riak_dt_map_free_pb(cfg, &(update->map_op));
+        riak_free(cfg, &(pb->updates[i]));
+    }
+    riak_free(cfg, &(pb->adds));
+    riak_free(cfg, &(pb->removes));
+    riak_free(cfg, &(pb->updates));
+    riak_free(cfg, pb_target);
+}
+
+static riak_error
+riak_dt_counter_to_pb(riak_config *cfg,
+                      riak_dt_op  *op,
+                      CounterOp  **pb_target) {
+    CounterOp *pb = (CounterOp*)riak_config_allocate(cfg, sizeof(CounterOp));
+    if (pb == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    counter_op__init(pb);
+    pb->has_increment = RIAK_TRUE;
+    pb->increment     = op->increment;
+    *pb_target = pb;
+
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_dt_set_to_pb(riak_config *cfg,
+                  riak_dt_op  *op,
+                  SetOp      **pb_target) {
+    SetOp *pb = (SetOp*)riak_config_allocate(cfg, sizeof(SetOp));
+    if (pb == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    set_op__init(pb);
+    *pb_target = pb;
+    riak_uint32_t n_removes = 0;
+    int i;
+    for(i = 0; i < op->n_entries; i++) {
+        if (op->entries[i].removed) n_removes++;
+    }
+    riak_uint32_t n_adds = op->n_entries - n_removes;
+    if (n_adds > 0) {
+        pb->adds = (ProtobufCBinaryData*)riak_config_allocate(cfg, n_adds * sizeof(ProtobufCBinaryData));
+    }
+    if (n_removes > 0) {
+        pb->removes = (ProtobufCBinaryData*)riak_config_allocate(cfg, n_removes * sizeof(ProtobufCBinaryData));
+    }
+    if ((n_adds > 0 && pb->adds == NULL) || (n_removes > 0 && pb->removes == NULL)) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    // Members point at the entries; nothing is copied
+    for(i = 0; i < op->n_entries; i++) {
+        riak_dt_entry *entry = &(op->entries[i]);
+        if (entry->removed) {
+            riak_binary_copy_to_pb(&(pb->removes[pb->n_removes++]), entry->name);
+        } else {
+            riak_binary_copy_to_pb(&(pb->adds[pb->n_adds++]), entry->name);
+        }
+    }
+
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_dt_map_to_pb(riak_config *cfg,
+                  riak_dt_op  *op,
+                  MapOp      **pb_target);
+
+// Counters, sets and maps with nothing pending are created empty
+static riak_boolean_t
+riak_dt_entry_is_add(riak_dt_entry *entry) {
+    if (entry->removed || entry->type == RIAK_DT_FIELD_REGISTER || entry->type == RIAK_DT_FIELD_FLAG) {
+        return RIAK_FALSE;
+    }
+    return (entry->op == NULL || entry->op->n_pending == 0);
+}
+
+static MapField*
+riak_dt_field_to_pb(riak_config   *cfg,
+                    riak_dt_entry *entry) {
+    MapField *field = (MapField*)riak_config_allocate(cfg, sizeof(MapField));
+    if (field) {
+        map_field__init(field);
+        riak_binary_copy_to_pb(&(field->name), entry->name);
+        field->type = (MapField__MapFieldType)entry->type;
+    }
+    return field;
+}
+
+static riak_error
+riak_dt_update_to_pb(riak_config   *cfg,
+                     riak_dt_entry *entry,
+                     MapUpdate    **pb_target) {
+    MapUpdate *update = (MapUpdate*)riak_config_allocate(cfg, sizeof(MapUpdate));
+    if (update == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    map_update__init(update);
+    *pb_target = update;
+    update->field = riak_dt_field_to_pb(cfg, entry);
+    if (update->field == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    switch (entry->type) {
+    case RIAK_DT_FIELD_COUNTER:
+        return riak_dt_counter_to_pb(cfg, entry->op, &(update->counter_op));
+    case RIAK_DT_FIELD_SET:
+        return riak_dt_set_to_pb(cfg, entry->op, &(update->set_op));
+    case RIAK_DT_FIELD_MAP:
+        return riak_dt_map_to_pb(cfg, entry->op, &(update->map_op));
+    case RIAK_DT_FIELD_REGISTER:
+        update->has_register_op = RIAK_TRUE;
+        riak_binary_copy_to_pb(&(update->register_op), entry->reg);
+        break;
+    case RIAK_DT_FIELD_FLAG:
+        update->has_flag_op = RIAK_TRUE;
+        update->flag_op     = entry->enable ? MAP_UPDATE__FLAG_OP__ENABLE : MAP_UPDATE__FLAG_OP__DISABLE;
+        break;
+    }
+
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_dt_map_to_pb(riak_config *cfg,
+                  riak_dt_op  *op,
+                  MapOp      **pb_target) {
+    MapOp *pb = (MapOp*)riak_config_allocate(cfg, sizeof(MapOp));
+    if (pb == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    map_op__init(pb);
+    *pb_target = pb;
+    // Every field is either removed, added or updated
+    riak_uint32_t n_adds    = 0;
+    riak_uint32_t n_removes = 0;
+    int i;
+    for(i = 0; i < op->n_entries; i++) {
+        riak_dt_entry *entry = &(op->entries[i]);
+        if (entry->removed) {
+            n_removes++;
+        } else if (riak_dt_entry_is_add(entry)) {
+            n_adds++;
+        }
+    }
+    riak_uint32_t n_updates = op->n_entries - n_adds - n_removes;
+    if (n_adds > 0) {
+        pb->adds = (MapField**)riak_config_allocate(cfg, n_adds * sizeof(MapField*));
+    }
+    if (n_removes > 0) {
+        pb->removes = (MapField**)riak_config_allocate(cfg, n_removes * sizeof(MapField*));
+    }
+    if (n_updates > 0) {
+        pb->updates = (MapUpdate**)riak_config_allocate(cfg, n_updates * sizeof(MapUpdate*));
+    }
+    if ((n_adds > 0 && pb->adds == NULL) ||
+        (n_removes > 0 && pb->removes == NULL) ||
+        (n_updates > 0 && pb->updates == NULL)) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    for(i = 0; i < op->n_entries; i++) {
+        riak_dt_entry *entry = &(op->entries[i]);
+        if (entry->removed) {
+            pb->removes[pb->n_removes] = riak_dt_field_to_pb(cfg, entry);
+            if (pb->removes[pb->n_removes++] == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+        } else if (riak_dt_entry_is_add(entry)) {
+            pb->adds[pb->n_adds] = riak_dt_field_to_pb(cfg, entry);
+            if (pb->adds[pb->n_adds++] == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+        } else {
+            pb->updates[pb->n_updates] = NULL;
+            riak_error err = riak_dt_update_to_pb(cfg, entry, &(pb->updates[pb->n_updates]));
+            if (pb->updates[pb->n_updates] != NULL) {
+                pb->n_updates++;
+            }
+            if (err) {
+                return err;
+            }
+        }
+    }
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_fetch_request_encode(riak_operation         *rop,
+                             riak_binary            *bucket_type,
+                             riak_binary            *bucket,
+                             riak_binary            *key,
+                             riak_dt_fetch_options  *options,
+                             riak_pb_message       **req) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    DtFetchReq fetchreq = DT_FETCH_REQ__INIT;
+
+    riak_binary_copy_to_pb(&(fetchreq.type), bucket_type);
+    riak_binary_copy_to_pb(&(fetchreq.bucket), bucket);
+    riak_binary_copy_to_pb(&(fetchreq.key), key);
+    riak_operation_set_bucket(rop, bucket);
+    riak_operation_set_key(rop, key);
+    if (options) {
+        fetchreq.has_r               = options->has_r;
+        fetchreq.r                   = options->r;
+        fetchreq.has_pr              = options->has_pr;
+        fetchreq.pr                  = options->pr;
+        fetchreq.has_basic_quorum    = options->has_basic_quorum;
+        fetchreq.basic_quorum        = options->basic_quorum;
+        fetchreq.has_notfound_ok     = options->has_notfound_ok;
+        fetchreq.notfound_ok         = options->notfound_ok;
+        fetchreq.has_timeout         = options->has_timeout;
+        fetchreq.timeout             = options->timeout;
+        fetchreq.has_sloppy_quorum   = options->has_sloppy_quorum;
+        fetchreq.sloppy_quorum       = options->sloppy_quorum;
+        fetchreq.has_n_val           = options->has_n_val;
+        fetchreq.n_val               = options->n_val;
+        fetchreq.has_include_context = options->has_include_context;
+        fetchreq.include_context     = options->include_context;
+    }
+    riak_size_t msglen = dt_fetch_req__get_packed_size(&fetchreq);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    if (msgbuf == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    dt_fetch_req__pack(&fetchreq, msgbuf);
+
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_DTFETCHREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_dt_fetch_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_dt_fetch_response_free);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_dt_update_request_encode(riak_operation          *rop,
+                              riak_binary             *bucket_type,
+                              riak_binary             *bucket,
+                              riak_binary             *key,
+                              riak_dt_op              *op,
+                              riak_dt_update_options  *options,
+                              riak_pb_message        **req) {
+    // Field operations are sent as part of their map
+    if (op->parent != NULL) {
+        return ERIAK_DT_TYPE;
+    }
+    riak_config *cfg = riak_operation_get_config(rop);
+    DtUpdateReq updatereq = DT_UPDATE_REQ__INIT;
+    DtOp        dtop      = DT_OP__INIT;
+
+    riak_binary_copy_to_pb(&(updatereq.type), bucket_type);
+    riak_binary_copy_to_pb(&(updatereq.bucket), bucket);
+    riak_operation_set_bucket(rop, bucket);
+    if (key) {
+        updatereq.has_key = RIAK_TRUE;
+        riak_binary_copy_to_pb(&(updatereq.key), key);
+        riak_operation_set_key(rop, key);
+    }
+    if (options) {
+        if (options->has_context) {
+            updatereq.has_context = RIAK_TRUE;
+            riak_binary_copy_to_pb(&(updatereq.context), options->context);
+        }
+        updatereq.has_w               = options->has_w;
+        updatereq.w                   = options->w;
+        updatereq.has_dw              = options->has_dw;
+        updatereq.dw                  = options->dw;
+        updatereq.has_pw              = options->has_pw;
+        updatereq.pw                  = options->pw;
+        updatereq.has_return_body     = options->has_return_body;
+        updatereq.return_body         = options->return_body;
+        updatereq.has_timeout         = options->has_timeout;
+        updatereq.timeout             = options->timeout;
+        updatereq.has_sloppy_quorum   = options->has_sloppy_quorum;
+        updatereq.sloppy_quorum       = options->sloppy_quorum;
+        updatereq.has_n_val           = options->has_n_val;
+        updatereq.n_val               = options->n_val;
+        updatereq.has_include_context = options->has_include_context;
+        updatereq.include_context     = options->include_context;
+    }
+    updatereq.op = &dtop;
+
+    // All of the folded operations go out as one DtOp
+    riak_error err = ERIAK_OK;
+    switch (op->type) {
+    case RIAK_DT_FIELD_COUNTER:
+        err = riak_dt_counter_to_pb(cfg, op, &(dtop.counter_op));
+        break;
+    case RIAK_DT_FIELD_SET:
+        err = riak_dt_set_to_pb(cfg, op, &(dtop.set_op));
+        break;
+    case RIAK_DT_FIELD_MAP:
+        err = riak_dt_map_to_pb(cfg, op, &(dtop.map_op));
+        break;
+    }
+    riak_size_t   msglen = 0;
+    riak_uint8_t *msgbuf = NULL;
+    if (err == ERIAK_OK) {
+        msglen = dt_update_req__get_packed_size(&updatereq);
+        msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+        if (msgbuf == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
+        } else {
+            dt_update_req__pack(&updatereq, msgbuf);
+        }
+    }
+    riak_free(cfg, &(dtop.counter_op));
+    riak_dt_set_free_pb(cfg, &(dtop.set_op));
+    riak_dt_map_free_pb(cfg, &(dtop.map_op));
+    if (err) {
+        return err;
+    }
+
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_DTUPDATEREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_dt_update_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_dt_update_response_free);
+
+    return ERIAK_OK;
+}
+
+//
+// V A L U E S
+//
+
+static void
+riak_dt_value_free(riak_config    *cfg,
+                   riak_dt_value **value_target);
+
+static void
+riak_dt_map_entry_free(riak_config        *cfg,
+                       riak_dt_map_entry **entry_target) {
+    riak_dt_map_entry *entry = *entry_target;
+    if (entry == NULL) return;
+    riak_binary_free(cfg, &(entry->name));
+    riak_binary_free(cfg, &(entry->reg));
+    riak_dt_value_free(cfg, &(entry->value));
+    riak_free(cfg, entry_target);
+}
+
+static void
+riak_dt_value_free(riak_config    *cfg,
+                   riak_dt_value **value_target) {
+    riak_dt_value *value = *value_target;
+    if (value == NULL) return;
+    int i;
+    for(i = 0; i < value->n_set; i++) {
+        riak_binary_free(cfg, &(value->set[i]));
+    }
+    for(i = 0; i < value->n_map; i++) {
+        riak_dt_map_entry_free(cfg, &(value->map[i]));
+    }
+    riak_free(cfg, &(value->set));
+    riak_free(cfg, &(value->map));
+    riak_free(cfg, value_target);
+}
+
+static riak_error
+riak_dt_map_entry_from_pb(riak_config        *cfg,
+                          riak_dt_map_entry **entry_target,
+                          MapEntry           *pbentry);
+
+/**
+ * @brief Copy the parts of a DtValue, DtUpdateResp or MapEntry into a value
+ * @returns Error code; a partly built value is still returned for freeing
+ */
+static riak_error
+riak_dt_value_from_pb(riak_config         *cfg,
+                      riak_dt_value      **value_target,
+                      protobuf_c_boolean   has_counter,
+                      int64_t              counter,
+                      size_t               n_set,
+                      ProtobufCBinaryData *set,
+                      size_t               n_map,
+                      MapEntry           **map) {
+    riak_dt_value *value = (riak_dt_value*)riak_config_clean_allocate(cfg, sizeof(riak_dt_value));
+    if (value == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *value_target = value;
+    value->has_counter = has_counter;
+    value->counter     = counter;
+    if (n_set > 0) {
+        value->set = (riak_binary**)riak_config_allocate(cfg, n_set * sizeof(riak_binary*));
+        if (value->set == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        for( ; value->n_set < n_set; value->n_set++) {
+            value->set[value->n_set] = riak_binary_new(cfg, set[value->n_set].len, set[value->n_set].data);
+            if (value->set[value->n_set] == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+        }
+    }
+    if (n_map > 0) {
+        value->map = (riak_dt_map_entry**)riak_config_clean_allocate(cfg, n_map * sizeof(riak_dt_map_entry*));
+        if (value->map == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        for( ; value->n_map < n_map; value->n_map++) {
+            riak_error err = riak_dt_map_entry_from_pb(cfg, &(value->map[value->n_map]), map[value->n_map]);
+            if (err) {
+                value->n_map++;
+                return err;
+            }
+        }
+    }
+
+    return ERIAK_OK;
+}
+
+static riak_error
+riak_dt_map_entry_from_pb(riak_config        *cfg,
+                          riak_dt_map_entry **entry_target,
+                          MapEntry           *pbentry) {
+    riak_dt_map_entry *entry = (riak_dt_map_entry*)riak_config_clean_allocate(cfg, sizeof(riak_dt_map_entry));
+    if (entry == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *entry_target = entry;
+    entry->name = riak_binary_new(cfg, pbentry->field->name.len, pbentry->field->name.data);
+    if (entry->name == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    entry->type = (riak_dt_field_type)pbentry->field->type;
+    switch (entry->type) {
+    case RIAK_DT_FIELD_COUNTER:
+    case RIAK_DT_FIELD_SET:
+    case RIAK_DT_FIELD_MAP:
+        return riak_dt_value_from_pb(cfg, &(entry->value),
+                                     pbentry->has_counter_value, pbentry->counter_value,
+                                     pbentry->n_set_value, pbentry->set_value,
+                                     pbentry->n_map_value, pbentry->map_value);
+    case RIAK_DT_FIELD_REGISTER:
+        if (pbentry->has_register_value) {
+            entry->has_register = RIAK_TRUE;
+            entry->reg = riak_binary_new(cfg, pbentry->register_value.len, pbentry->register_value.data);
+            if (entry->reg == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+        }
+        break;
+    case RIAK_DT_FIELD_FLAG:
+        entry->has_flag = pbentry->has_flag_value;
+        entry->flag     = pbentry->flag_value;
+        break;
+    }
+
+    return ERIAK_OK;
+}
+
+static int
+riak_dt_value_print(riak_dt_value *value,
+                    char         **target,
+                    riak_int32_t  *len,
+                    riak_int32_t  *total) {
+    char buffer[32];
+    int i;
+    if (value->has_counter) {
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)value->counter);
+        riak_print_string("Counter", buffer, target, len, total);
+    }
+    for(i = 0; (i < value->n_set) && (*len > 0); i++) {
+        riak_print_binary("Member", value->set[i], target, len, total);
+    }
+    for(i = 0; (i < value->n_map) && (*len > 0); i++) {
+        riak_dt_map_entry *entry = value->map[i];
+        riak_print_binary("Field", entry->name, target, len, total);
+        riak_print_int("Type", entry->type, target, len, total);
+        if (entry->value) {
+            riak_dt_value_print(entry->value, target, len, total);
+        }
+        if (entry->has_register) {
+            riak_print_binary("Register", entry->reg, target, len, total);
+        }
+        if (entry->has_flag) {
+            riak_print_bool("Flag", entry->flag, target, len, total);
+        }
+    }
+    return *total;
+}
+
+riak_boolean_t
+riak_dt_value_get_has_counter(riak_dt_value *value) {
+    return value->has_counter;
+}
+
+riak_int64_t
+riak_dt_value_get_counter(riak_dt_value *value) {
+    return value->counter;
+}
+
+riak_int32_t
+riak_dt_value_get_n_set(riak_dt_value *value) {
+    return value->n_set;
+}
+
+riak_binary**
+riak_dt_value_get_set(riak_dt_value *value) {
+    return value->set;
+}
+
+riak_int32_t
+riak_dt_value_get_n_map(riak_dt_value *value) {
+    return value->n_map;
+}
+
+riak_dt_map_entry**
+riak_dt_value_get_map(riak_dt_value *value) {
+    return value->map;
+}
+
+riak_dt_map_entry*
+riak_dt_value_find(riak_dt_value      *value,
+                   riak_binary        *name,
+                   riak_dt_field_type  type) {
+    int i;
+    for(i = 0; i < value->n_map; i++) {
+        riak_dt_map_entry *entry = value->map[i];
+        if (entry->type == type && entry->name->len == name->len &&
+            (name->len == 0 || memcmp(entry->name->data, name->data, name->len) == 0)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+riak_binary*
+riak_dt_map_entry_get_name(riak_dt_map_entry *entry) {
+    return entry->name;
+}
+
+riak_dt_field_type
+riak_dt_map_entry_get_type(riak_dt_map_entry *entry) {
+    return entry->type;
+}
+
+riak_dt_value*
+riak_dt_map_entry_get_value(riak_dt_map_entry *entry) {
+    return entry->value;
+}
+
+riak_boolean_t
+riak_dt_map_entry_get_has_register(riak_dt_map_entry *entry) {
+    return entry->has_register;
+}
+
+riak_binary*
+riak_dt_map_entry_get_register(riak_dt_map_entry *entry) {
+    return entry->reg;
+}
+
+riak_boolean_t
+riak_dt_map_entry_get_has_flag(riak_dt_map_entry *entry) {
+    return entry->has_flag;
+}
+
+riak_boolean_t
+riak_dt_map_entry_get_flag(riak_dt_map_entry *entry) {
+    return entry->flag;
+}
+
+//
+// F E T C H
+//
+
+riak_error
+riak_dt_fetch_response_decode(riak_operation          *rop,
+                              riak_pb_message         *pbresp,
+                              riak_dt_fetch_response **resp,
+                              riak_boolean_t          *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    DtFetchResp *fetchresp = dt_fetch_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
+    if (fetchresp == NULL) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_dt_fetch_response *response = (riak_dt_fetch_response*)riak_config_clean_allocate(cfg, sizeof(riak_dt_fetch_response));
+    if (response == NULL) {
+        dt_fetch_resp__free_unpacked(fetchresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = ERIAK_OK;
+    response->type = (riak_dt_type)fetchresp->type;
+    if (fetchresp->has_context) {
+        response->has_context = RIAK_TRUE;
+        response->context = riak_binary_new(cfg, fetchresp->context.len, fetchresp->context.data);
+        if (response->context == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    DtValue *value = fetchresp->value;
+    if (err == ERIAK_OK && value) {
+        err = riak_dt_value_from_pb(cfg, &(response->value),
+                                    value->has_counter_value, value->counter_value,
+                                    value->n_set_value, value->set_value,
+                                    value->n_map_value, value->map_value);
+    }
+    // Everything was copied out, so the message can go
+    dt_fetch_resp__free_unpacked(fetchresp, cfg->pb_allocator);
+    if (err) {
+        riak_dt_fetch_response_free(cfg, &response);
+        return err;
+    }
+    *done = RIAK_TRUE;
+    *resp = response;
+
+    return ERIAK_OK;
+}
+
+int
+riak_dt_fetch_response_print(riak_dt_fetch_response *response,
+                             char                   *target,
+                             riak_int32_t            len) {
+    riak_int32_t total = 0;
+    riak_print_int("Type", response->type, &target, &len, &total);
+    if (response->has_context) {
+        riak_print_binary_hex("Context", response->context, &target, &len, &total);
+    }
+    if (response->value) {
+        riak_dt_value_print(response->value, &target, &len, &total);
+    } else {
+        riak_print_label("Not Found", &target, &len, &total);
+    }
+    return total;
+}
+
+void
+riak_dt_fetch_response_free(riak_config             *cfg,
+                            riak_dt_fetch_response **resp) {
+    riak_dt_fetch_response *response = *resp;
+    if (response == NULL) return;
+    riak_binary_free(cfg, &(response->context));
+    riak_dt_value_free(cfg, &(response->value));
+    riak_free(cfg, resp);
+}
+
+riak_boolean_t
+riak_dt_fetch_get_has_context(riak_dt_fetch_response *response) {
+    return response->has_context;
+}
+
+riak_binary*
+riak_dt_fetch_get_context(riak_dt_fetch_response *response) {
+    return response->context;
+}
+
+riak_dt_type
+riak_dt_fetch_get_type(riak_dt_fetch_response *response) {
+    return response->type;
+}
+
+riak_dt_value*
+riak_dt_fetch_get_value(riak_dt_fetch_response *response) {
+    return response->value;
+}
+
+riak_dt_fetch_options*
+riak_dt_fetch_options_new(riak_config *cfg) {
+    riak_dt_fetch_options *o = (riak_dt_fetch_options*)riak_config_clean_allocate(cfg, sizeof(riak_dt_fetch_options));
+    return o;
+}
+
+void
+riak_dt_fetch_options_free(riak_config            *cfg,
+                           riak_dt_fetch_options **opt) {
+    riak_free(cfg, opt);
+}
+
+void
+riak_dt_fetch_options_set_r(riak_dt_fetch_options *opt,
+                            riak_uint32_t          value) {
+    opt->has_r = RIAK_TRUE;
+    opt->r = value;
+}
+void
+riak_dt_fetch_options_set_pr(riak_dt_fetch_options *opt,
+                             riak_uint32_t          value) {
+    opt->has_pr = RIAK_TRUE;
+    opt->pr = value;
+}
+void
+riak_dt_fetch_options_set_basic_quorum(riak_dt_fetch_options *opt,
+                                       riak_boolean_t         value) {
+    opt->has_basic_quorum = RIAK_TRUE;
+    opt->basic_quorum = value;
+}
+void
+riak_dt_fetch_options_set_notfound_ok(riak_dt_fetch_options *opt,
+                                      riak_boolean_t         value) {
+    opt->has_notfound_ok = RIAK_TRUE;
+    opt->notfound_ok = value;
+}
+void
+riak_dt_fetch_options_set_timeout(riak_dt_fetch_options *opt,
+                                  riak_uint32_t          value) {
+    opt->has_timeout = RIAK_TRUE;
+    opt->timeout = value;
+}
+void
+riak_dt_fetch_options_set_sloppy_quorum(riak_dt_fetch_options *opt,
+                                        riak_boolean_t         value) {
+    opt->has_sloppy_quorum = RIAK_TRUE;
+    opt->sloppy_quorum = value;
+}
+void
+riak_dt_fetch_options_set_n_val(riak_dt_fetch_options *opt,
+                                riak_uint32_t          value) {
+    opt->has_n_val = RIAK_TRUE;
+    opt->n_val = value;
+}
+void
+riak_dt_fetch_options_set_include_context(riak_dt_fetch_options *opt,
+                                          riak_boolean_t         value) {
+    opt->has_include_context = RIAK_TRUE;
+    opt->include_context = value;
+}
+
+//
+// U P D A T E
+//
+
+riak_error
+riak_dt_update_response_decode(riak_operation           *rop,
+                               riak_pb_message          *pbresp,
+                               riak_dt_update_response **resp,
+                               riak_boolean_t           *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    DtUpdateResp *updateresp = dt_update_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
+    if (updateresp == NULL) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_dt_update_response *response = (riak_dt_update_response*)riak_config_clean_allocate(cfg, sizeof(riak_dt_update_response));
+    if (response == NULL) {
+        dt_update_resp__free_unpacked(updateresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = ERIAK_OK;
+    if (updateresp->has_key) {
+        response->has_key = RIAK_TRUE;
+        response->key = riak_binary_new(cfg, updateresp->key.len, updateresp->key.data);
+        if (response->key == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    if (err == ERIAK_OK && updateresp->has_context) {
+        response->has_context = RIAK_TRUE;
+        response->context = riak_binary_new(cfg, updateresp->context.len, updateresp->context.data);
+        if (response->context == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    if (err == ERIAK_OK &&
+        (updateresp->has_counter_value || updateresp->n_set_value > 0 || updateresp->n_map_value > 0)) {
+        err = riak_dt_value_from_pb(cfg, &(response->value),
+                                    updateresp->has_counter_value, updateresp->counter_value,
+                                    updateresp->n_set_value, updateresp->set_value,
+                                    updateresp->n_map_value, updateresp->map_value);
+    }
+    dt_update_resp__free_unpacked(updateresp, cfg->pb_allocator);
+    if (err) {
+        riak_dt_update_response_free(cfg, &response);
+        return err;
+    }
+    *done = RIAK_TRUE;
+    *resp = response;
+
+    return ERIAK_OK;
+}
+
+int
+riak_dt_update_response_print(riak_dt_update_response *response,
+                              char                    *target,
+                              riak_int32_t             len) {
+    riak_int32_t total = 0;
+    if (response->has_key) {
+        riak_print_binary("Key", response->key, &target, &len, &total);
+    }
+    if (response->has_context) {
+        riak_print_binary_hex("Context", response->context, &target, &len, &total);
+    }
+    if (response->value) {
+        riak_dt_value_print(response->value, &target, &len, &total);
+    }
+    return total;
+}
+
+void
+riak_dt_update_response_free(riak_config              *cfg,
+                             riak_dt_update_response **resp) {
+    riak_dt_update_response *response = *resp;
+    if (response == NULL) return;
+    riak_binary_free(cfg, &(response->key));
+    riak_binary_free(cfg, &(response->context));
+    riak_dt_value_free(cfg, &(response->value));
+    riak_free(cfg, resp);
+}
+
+riak_boolean_t
+riak_dt_update_get_has_key(riak_dt_update_response *response) {
+    return response->has_key;
+}
+
+riak_binary*
+riak_dt_update_get_key(riak_dt_update_response *response) {
+    return response->key;
+}
+
+riak_boolean_t
+riak_dt_update_get_has_context(riak_dt_update_response *response) {
+    return response->has_context;
+}
+
+riak_binary*
+riak_dt_update_get_context(riak_dt_update_response *response) {
+    return response->context;
+}
+
+riak_dt_value*
+riak_dt_update_get_value(riak_dt_update_response *response) {
+    return response->value;
+}
+
+riak_dt_update_options*
+riak_dt_update_options_new(riak_config *cfg) {
+    riak_dt_update_options *o = (riak_dt_update_options*)riak_config_clean_allocate(cfg, sizeof(riak_dt_update_options));
+    return o;
+}
+
+void
+riak_dt_update_options_free(riak_config             *cfg,
+                            riak_dt_update_options **opt) {
+    if (opt == NULL || *opt == NULL) return;
+    riak_binary_free(cfg, &((*opt)->context));
+    riak_free(cfg, opt);
+}
+
+void
+riak_dt_update_options_set_context(riak_config            *cfg,
+                                   riak_dt_update_options *opt,
+                                   riak_binary            *value) {
+    opt->has_context = RIAK_TRUE;
+    riak_binary_free(cfg, &(opt->context));
+    opt->context = riak_binary_copy(cfg, value);
+}
+void
+riak_dt_update_options_set_w(riak_dt_update_options *opt,
+                             riak_uint32_t           value) {
+    opt->has_w = RIAK_TRUE;
+    opt->w = value;
+}
+void
+riak_dt_update_options_set_dw(riak_dt_update_options *opt,
+                              riak_uint32_t           value) {
+    opt->has_dw = RIAK_TRUE;
+    opt->dw = value;
+}
+void
+riak_dt_update_options_set_pw(riak_dt_update_options *opt,
+                              riak_uint32_t           value) {
+    opt->has_pw = RIAK_TRUE;
+    opt->pw = value;
+}
+void
+riak_dt_update_options_set_return_body(riak_dt_update_options *opt,
+                                       riak_boolean_t          value) {
+    opt->has_return_body = RIAK_TRUE;
+    opt->return_body = value;
+}
+void
+riak_dt_update_options_set_timeout(riak_dt_update_options *opt,
+                                   riak_uint32_t           value) {
+    opt->has_timeout = RIAK_TRUE;
+    opt->timeout = value;
+}
+void
+riak_dt_update_options_set_sloppy_quorum(riak_dt_update_options *opt,
+                                         riak_boolean_t          value) {
+    opt->has_sloppy_quorum = RIAK_TRUE;
+    opt->sloppy_quorum = value;
+}
+void
+riak_dt_update_options_set_n_val(riak_dt_update_options *opt,
+                                 riak_uint32_t           value) {
+    opt->has_n_val = RIAK_TRUE;
+    opt->n_val = value;
+}
+void
+riak_dt_update_options_set_include_context(riak_dt_update_options *opt,
+                                           riak_boolean_t          value) {
+    opt->has_include_context = RIAK_TRUE;
+    opt->include_context = value;
+}
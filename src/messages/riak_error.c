@@ -41,9 +41,8 @@ riak_decode_error_response(riak_operation       *rop,
     if (errresp == NULL) {
         return ERIAK_MESSAGE_FORMAT;
     }
-    riak_error_response *response = (riak_error_response*)(cfg->malloc_fn)(sizeof(riak_error_response));
+    riak_error_response *response = (riak_error_response*)riak_config_allocate(cfg, sizeof(riak_error_response));
     *done = RIAK_TRUE;
-    riak_free(cfg, &pbresp);
     if (response == NULL) {
         rpb_error_resp__free_unpacked(errresp, cfg->pb_allocator);
         return ERIAK_OUT_OF_MEMORY;
@@ -57,13 +56,7 @@ riak_decode_error_response(riak_operation       *rop,
         return ERIAK_OUT_OF_MEMORY;
     }
 
-    // Call user's error callback, if present
-    if (rop->error_cb) {
-        riak_response_callback cb = rop->error_cb;
-        (cb)(response, rop->cb_data);
-    }
-    *resp = response;
-
+    // Keep a copy before the user's callback can free the response
     riak_error err = riak_server_error_new(cfg,
                                            &(rop->error),
                                            response->errcode,
@@ -74,6 +67,13 @@ riak_decode_error_response(riak_operation       *rop,
         rpb_error_resp__free_unpacked(errresp, cfg->pb_allocator);
         return err;
     }
+    *resp = response;
+
+    // Call user's error callback, if present
+    if (rop->error_cb) {
+        riak_response_callback cb = rop->error_cb;
+        (cb)(response, rop->cb_data);
+    }
 
     return ERIAK_OK;
 }
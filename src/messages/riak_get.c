@@ -30,6 +30,54 @@
 #include "riak_operation-internal.h"
 #include "riak_bucketprops-internal.h"
 #include "riak_print-internal.h"
+#include "riak_wire-internal.h"
+#include "riak_view-internal.h"
+
+// RpbGetReq field numbers
+#define RIAK_GETREQ_BUCKET         1
+#define RIAK_GETREQ_KEY            2
+#define RIAK_GETREQ_R              3
+#define RIAK_GETREQ_PR             4
+#define RIAK_GETREQ_BASIC_QUORUM   5
+#define RIAK_GETREQ_NOTFOUND_OK    6
+#define RIAK_GETREQ_IF_MODIFIED    7
+#define RIAK_GETREQ_HEAD           8
+#define RIAK_GETREQ_DELETEDVCLOCK  9
+#define RIAK_GETREQ_TIMEOUT        10
+#define RIAK_GETREQ_SLOPPY_QUORUM  11
+#define RIAK_GETREQ_N_VAL          12
+
+static riak_size_t
+riak_get_options_wire_size(riak_get_options *opt) {
+    riak_size_t msglen = 0;
+    if (opt->has_r)             msglen += riak_wire_uint_size(RIAK_GETREQ_R, opt->r);
+    if (opt->has_pr)            msglen += riak_wire_uint_size(RIAK_GETREQ_PR, opt->pr);
+    if (opt->has_basic_quorum)  msglen += riak_wire_uint_size(RIAK_GETREQ_BASIC_QUORUM, opt->basic_quorum ? 1 : 0);
+    if (opt->has_notfound_ok)   msglen += riak_wire_uint_size(RIAK_GETREQ_NOTFOUND_OK, opt->notfound_ok ? 1 : 0);
+    if (opt->has_if_modified)   msglen += riak_wire_bytes_size(RIAK_GETREQ_IF_MODIFIED, opt->if_modified->len);
+    if (opt->has_head)          msglen += riak_wire_uint_size(RIAK_GETREQ_HEAD, opt->head ? 1 : 0);
+    if (opt->has_deletedvclock) msglen += riak_wire_uint_size(RIAK_GETREQ_DELETEDVCLOCK, opt->deletedvclock ? 1 : 0);
+    if (opt->has_timeout)       msglen += riak_wire_uint_size(RIAK_GETREQ_TIMEOUT, opt->timeout);
+    if (opt->has_sloppy_quorum) msglen += riak_wire_uint_size(RIAK_GETREQ_SLOPPY_QUORUM, opt->sloppy_quorum ? 1 : 0);
+    if (opt->has_n_val)         msglen += riak_wire_uint_size(RIAK_GETREQ_N_VAL, opt->n_val);
+    return msglen;
+}
+
+static riak_uint8_t*
+riak_get_options_wire_write(riak_get_options *opt,
+                            riak_uint8_t     *pos) {
+    if (opt->has_r)             pos = riak_wire_put_uint(pos, RIAK_GETREQ_R, opt->r);
+    if (opt->has_pr)            pos = riak_wire_put_uint(pos, RIAK_GETREQ_PR, opt->pr);
+    if (opt->has_basic_quorum)  pos = riak_wire_put_uint(pos, RIAK_GETREQ_BASIC_QUORUM, opt->basic_quorum ? 1 : 0);
+    if (opt->has_notfound_ok)   pos = riak_wire_put_uint(pos, RIAK_GETREQ_NOTFOUND_OK, opt->notfound_ok ? 1 : 0);
+    if (opt->has_if_modified)   pos = riak_wire_put_bytes(pos, RIAK_GETREQ_IF_MODIFIED, opt->if_modified->data, opt->if_modified->len);
+    if (opt->has_head)          pos = riak_wire_put_uint(pos, RIAK_GETREQ_HEAD, opt->head ? 1 : 0);
+    if (opt->has_deletedvclock) pos = riak_wire_put_uint(pos, RIAK_GETREQ_DELETEDVCLOCK, opt->deletedvclock ? 1 : 0);
+    if (opt->has_timeout)       pos = riak_wire_put_uint(pos, RIAK_GETREQ_TIMEOUT, opt->timeout);
+    if (opt->has_sloppy_quorum) pos = riak_wire_put_uint(pos, RIAK_GETREQ_SLOPPY_QUORUM, opt->sloppy_quorum ? 1 : 0);
+    if (opt->has_n_val)         pos = riak_wire_put_uint(pos, RIAK_GETREQ_N_VAL, opt->n_val);
+    return pos;
+}
 
 riak_error
 riak_get_request_encode(riak_operation  *rop,
@@ -39,50 +87,108 @@ riak_get_request_encode(riak_operation  *rop,
                         riak_pb_message **req) {
 
     riak_config *cfg = riak_operation_get_config(rop);
-    RpbGetReq getmsg = RPB_GET_REQ__INIT;
-
+    riak_get_options  none;
+    riak_get_options *opt = get_options;
+    if (opt == NULL) {
+        memset((void*)&none, '\0', sizeof(none));
+        opt = &none;
+    }
     riak_operation_set_bucket(rop, bucket);
     riak_operation_set_key(rop, key);
-    riak_binary_copy_to_pb(&getmsg.bucket, bucket);
-    riak_binary_copy_to_pb(&getmsg.key, key);
-
-    // process get options
-    if(get_options != NULL) {
-        getmsg.has_r = get_options->has_r;
-        getmsg.r = get_options->r;
-        getmsg.has_pr = get_options->has_pr;
-        getmsg.pr = get_options->pr;
-        getmsg.has_basic_quorum = get_options->has_basic_quorum;
-        getmsg.basic_quorum = get_options->basic_quorum;
-        getmsg.has_notfound_ok = get_options->has_notfound_ok;
-        getmsg.notfound_ok = get_options->notfound_ok;
-        if (get_options->has_if_modified) {
-            getmsg.has_if_modified = get_options->has_if_modified;
-            riak_binary_copy_to_pb(&getmsg.if_modified, get_options->if_modified);
-        }
-        getmsg.has_head = get_options->has_head;
-        getmsg.head = get_options->head;
-        getmsg.has_deletedvclock = get_options->has_deletedvclock;
-        getmsg.deletedvclock = get_options->deletedvclock;
-        getmsg.has_timeout = get_options->has_timeout;
-        getmsg.timeout = get_options->timeout;
-        getmsg.has_sloppy_quorum = get_options->has_sloppy_quorum;
-        getmsg.sloppy_quorum = get_options->sloppy_quorum;
-        getmsg.has_n_val = get_options->has_n_val;
-        getmsg.n_val = get_options->n_val;
+
+    // Sized and written straight from the arguments, no RpbGetReq in between
+    riak_size_t msglen = riak_wire_bytes_size(RIAK_GETREQ_BUCKET, bucket->len) + riak_wire_bytes_size(RIAK_GETREQ_KEY, key->len);
+    msglen += riak_get_options_wire_size(opt);
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
+    if (msgbuf == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_uint8_t *pos = msgbuf;
+    pos = riak_wire_put_bytes(pos, RIAK_GETREQ_BUCKET, bucket->data, bucket->len);
+    pos = riak_wire_put_bytes(pos, RIAK_GETREQ_KEY, key->data, key->len);
+    riak_get_options_wire_write(opt, pos);
+    riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBGETREQ, msglen, msgbuf);
+    if (request == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *req = request;
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_response_free);
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_get_template_new(riak_config        *cfg,
+                      riak_get_template **tmpl,
+                      riak_binary        *bucket,
+                      riak_get_options   *get_options) {
+    riak_get_options  none;
+    riak_get_options *opt = get_options;
+    if (opt == NULL) {
+        memset((void*)&none, '\0', sizeof(none));
+        opt = &none;
     }
-    riak_uint32_t msglen = rpb_get_req__get_packed_size (&getmsg);
-    riak_uint8_t* msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_size_t bucket_len  = riak_wire_bytes_size(RIAK_GETREQ_BUCKET, bucket->len);
+    riak_size_t options_len = riak_get_options_wire_size(opt);
+    // Header and encoded bytes share one allocation
+    riak_get_template *t = (riak_get_template*)riak_config_allocate(cfg, sizeof(riak_get_template) + bucket_len + options_len);
+    if (t == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    t->encoded     = (riak_uint8_t*)(t + 1);
+    t->bucket_len  = bucket_len;
+    t->options_len = options_len;
+    riak_uint8_t *pos = riak_wire_put_header(t->encoded, RIAK_GETREQ_BUCKET, bucket->len);
+    t->bucket.len     = bucket->len;
+    t->bucket.data    = pos;
+    t->bucket.managed = RIAK_FALSE;
+    if (bucket->len > 0) {
+        memcpy(pos, bucket->data, bucket->len);
+    }
+    riak_get_options_wire_write(opt, t->encoded + bucket_len);
+    *tmpl = t;
+
+    return ERIAK_OK;
+}
+
+void
+riak_get_template_free(riak_config        *cfg,
+                       riak_get_template **tmpl) {
+    riak_free(cfg, tmpl);
+}
+
+riak_error
+riak_get_template_request_encode(riak_operation    *rop,
+                                 riak_get_template *tmpl,
+                                 riak_binary       *key,
+                                 riak_pb_message  **req) {
+
+    riak_config *cfg = riak_operation_get_config(rop);
+    // The bucket still lives in the template, so only the key is copied
+    rop->request.bucket = riak_binary_copy_shallow(cfg, &(tmpl->bucket));
+    if (rop->request.bucket == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_operation_set_key(rop, key);
+
+    riak_size_t msglen = tmpl->bucket_len + riak_wire_bytes_size(RIAK_GETREQ_KEY, key->len) + tmpl->options_len;
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
-    rpb_get_req__pack (&getmsg, msgbuf);
+    memcpy(msgbuf, tmpl->encoded, tmpl->bucket_len);
+    riak_uint8_t *pos = riak_wire_put_bytes(msgbuf + tmpl->bucket_len, RIAK_GETREQ_KEY, key->data, key->len);
+    if (tmpl->options_len > 0) {
+        memcpy(pos, tmpl->encoded + tmpl->bucket_len, tmpl->options_len);
+    }
     riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBGETREQ, msglen, msgbuf);
     if (request == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_response_free);
 
     return ERIAK_OK;
 }
@@ -92,57 +198,61 @@ riak_get_response_decode(riak_operation     *rop,
                          riak_pb_message    *pbresp,
                          riak_get_response **resp,
                          riak_boolean_t     *done) {
-    // decode the PB response etc
+    // Decoded from the wire in place; every binary points into the view
     riak_config *cfg = riak_operation_get_config(rop);
-    RpbGetResp *rpbresp = rpb_get_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
-    if (rpbresp == NULL) {
-        return ERIAK_MESSAGE_FORMAT;
+    riak_get_view *view = NULL;
+    riak_error err = riak_get_view_decode(rop, pbresp, &view, done);
+    if (err) {
+        return err;
     }
     riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_log_debug(cxn, "riak_decode_get_response len=%d/pb unpack = 0x%lx\n", pbresp->len, (long)(rpbresp));
-    *done = RIAK_TRUE;
-    if (rpbresp == NULL) {
-        return ERIAK_OUT_OF_MEMORY;
-    }
-    int i = 0;
-    riak_get_response *response = (riak_get_response*)(cfg->malloc_fn)(sizeof(riak_get_response));
+    riak_log_debug(cxn, "riak_decode_get_response len=%d/view = 0x%lx\n", pbresp->len, (long)(view));
+
+    return riak_get_response_new_from_view(cfg, &view, resp);
+}
+
+riak_error
+riak_get_response_new_from_view(riak_config        *cfg,
+                                riak_get_view     **view_target,
+                                riak_get_response **resp) {
+    riak_get_view *view = *view_target;
+    *view_target = NULL;
+    riak_get_response *response = (riak_get_response*)riak_config_clean_allocate(cfg, sizeof(riak_get_response));
     if (response == NULL) {
+        riak_get_view_free(cfg, &view);
         return ERIAK_OUT_OF_MEMORY;
     }
-    memset(response, '\0', sizeof(riak_get_response));
-    response->_internal = rpbresp;
+    response->_internal = view;
 
-    if (rpbresp->has_vclock) {
+    if (view->has_vclock) {
         response->has_vclock = RIAK_TRUE;
-        response->vclock = riak_binary_copy_from_pb(cfg, &(rpbresp->vclock));
+        response->vclock = riak_binary_new_shallow(cfg, view->vclock.len, view->vclock.data);
         if (response->vclock == NULL) {
-            riak_free(cfg, &response);
+            riak_get_response_free(cfg, &response);
             return ERIAK_OUT_OF_MEMORY;
         }
     }
-    if (rpbresp->has_unchanged) {
+    if (view->has_unmodified) {
         response->has_unmodified = RIAK_TRUE;
-        response->unmodified = rpbresp->unchanged;
+        response->unmodified = view->unmodified;
     }
-    if (rpbresp->n_content > 0) {
-        riak_error err = riak_object_new_array(cfg, &(response->content), rpbresp->n_content);
+    if (view->n_content > 0) {
+        riak_error err = riak_object_new_array(cfg, &(response->content), view->n_content);
         if (err != ERIAK_OK) {
-            riak_free(cfg, &response);
-            return 1;
+            riak_get_response_free(cfg, &response);
+            return err;
         }
-        response->n_content = rpbresp->n_content;
-        for(i = 0; i < rpbresp->n_content; i++) {
-            err = riak_object_new_from_pb(cfg, &(response->content[i]), rpbresp->content[i]);
-            // If any object allocation fails, clean up all previously allocated ones
+        int i;
+        for(i = 0; i < view->n_content; i++) {
+            err = riak_object_view_to_object(cfg, &(view->content[i]), &(response->content[i]));
+            // If any object fails, clean up all previously built ones
             if (err != ERIAK_OK) {
-                riak_object_free_array(cfg, &(response->content), i);
-                riak_free(cfg, &response);
+                response->n_content = i;
+                riak_get_response_free(cfg, &response);
                 return err;
             }
-            response->content[i]->bucket  = riak_binary_copy(cfg, riak_operation_get_bucket(rop));
-            response->content[i]->key     = riak_binary_copy(cfg, riak_operation_get_key(rop));
-            response->content[i]->has_key = RIAK_TRUE;
         }
+        response->n_content = view->n_content;
     }
     *resp = response;
 
@@ -178,11 +288,11 @@ riak_get_response_free(riak_config        *cfg,
                        riak_get_response **resp) {
     riak_get_response *response = *resp;
     if (response == NULL) return;
-    if (response->n_content > 0) {
+    if (response->content != NULL) {
         riak_object_free_array(cfg, &(response->content), response->n_content);
     }
     riak_free(cfg, &(response->vclock));
-    rpb_get_resp__free_unpacked(response->_internal, cfg->pb_allocator);
+    riak_get_view_free(cfg, &(response->_internal));
     riak_free(cfg, resp);
 }
 
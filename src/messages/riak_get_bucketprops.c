@@ -41,7 +41,7 @@ riak_get_bucketprops_request_encode(riak_operation   *rop,
 
     riak_binary_copy_to_pb(&(bucketreq.bucket), bucket);
     riak_size_t msglen = rpb_get_bucket_req__get_packed_size(&bucketreq);
-    riak_uint8_t *msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return 1;
     }
@@ -53,6 +53,7 @@ riak_get_bucketprops_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_bucketprops_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_bucketprops_response_free);
 
     return ERIAK_OK;
 
@@ -75,7 +76,7 @@ riak_get_bucketprops_response_decode(riak_operation                 *rop,
     if (rpbresp == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
-    riak_get_bucketprops_response *response = (riak_get_bucketprops_response*)(cfg->malloc_fn)(sizeof(riak_get_bucketprops_response));
+    riak_get_bucketprops_response *response = (riak_get_bucketprops_response*)riak_config_allocate(cfg, sizeof(riak_get_bucketprops_response));
     if (response == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
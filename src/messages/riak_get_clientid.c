@@ -40,6 +40,7 @@ riak_get_clientid_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_clientid_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_clientid_response_free);
 
     return ERIAK_OK;
 }
@@ -62,7 +63,7 @@ riak_get_clientid_response_decode(riak_operation              *rop,
     if (rpbresp == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
-    riak_get_clientid_response *response = (riak_get_clientid_response*)(cfg->malloc_fn)(sizeof(riak_get_clientid_response));
+    riak_get_clientid_response *response = (riak_get_clientid_response*)riak_config_allocate(cfg, sizeof(riak_get_clientid_response));
     if (response == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
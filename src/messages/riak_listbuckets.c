@@ -38,7 +38,7 @@ riak_listbuckets_request_encode(riak_operation   *rop,
     listbucketsreq.stream = RIAK_TRUE;
     listbucketsreq.has_stream = RIAK_TRUE;
     riak_size_t msglen = rpb_list_buckets_req__get_packed_size(&listbucketsreq);
-    riak_uint8_t *msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -50,6 +50,7 @@ riak_listbuckets_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_listbuckets_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_listbuckets_response_free);
 
     return ERIAK_OK;
 }
@@ -73,7 +74,7 @@ riak_listbuckets_response_decode(riak_operation             *rop,
     // If this is NULL, there was no propious message
     if (response == NULL) {
         riak_log_debug(cxn, "%s", "Initializing listbucket response");
-        response = (cfg->malloc_fn)(sizeof(riak_listbuckets_response));
+        response = riak_config_allocate(cfg, sizeof(riak_listbuckets_response));
         if (response == NULL) {
             return ERIAK_OUT_OF_MEMORY;
         }
@@ -93,7 +94,7 @@ riak_listbuckets_response_decode(riak_operation             *rop,
             return ERIAK_OUT_OF_MEMORY;
         }
     } else {
-        response->buckets = (riak_binary**)(cfg->malloc_fn)(sizeof(riak_binary*)*additional_buckets);
+        response->buckets = (riak_binary**)riak_config_allocate(cfg, sizeof(riak_binary*)*additional_buckets);
         if (response->buckets == NULL) {
             return ERIAK_OUT_OF_MEMORY;
         }
@@ -134,7 +135,7 @@ riak_listbuckets_response_decode(riak_operation             *rop,
             return ERIAK_OUT_OF_MEMORY;
         }
     } else {
-        response->_internal = (RpbListBucketsResp **)(cfg->malloc_fn)(sizeof(RpbListBucketsResp*));
+        response->_internal = (RpbListBucketsResp **)riak_config_allocate(cfg, sizeof(RpbListBucketsResp*));
         if (response->_internal == NULL) {
             return ERIAK_OUT_OF_MEMORY;
         }
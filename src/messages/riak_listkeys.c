@@ -44,7 +44,7 @@ riak_listkeys_request_encode(riak_operation   *rop,
         listkeysreq.timeout = timeout;
     }
     riak_size_t msglen = rpb_list_keys_req__get_packed_size(&listkeysreq);
-    riak_uint8_t *msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t *msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return 1;
     }
@@ -56,11 +56,53 @@ riak_listkeys_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_listkeys_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_listkeys_response_free);
 
     return ERIAK_OK;
 
 }
 
+void
+riak_listkeys_set_stream_cb(riak_operation               *rop,
+                            riak_listkeys_stream_callback cb,
+                            void                         *ptr) {
+    rop->stream_cb      = (riak_stream_callback)cb;
+    rop->stream_cb_data = ptr;
+}
+
+/**
+ * @brief Pass one chunk's keys to the stream callback without copying them
+ * @param rop Riak Operation with a stream callback
+ * @param listkeyresp Unpacked chunk
+ * @returns Error code
+ */
+static riak_error
+riak_listkeys_stream_chunk(riak_operation  *rop,
+                           RpbListKeysResp *listkeyresp) {
+    riak_config  *cfg    = riak_operation_get_config(rop);
+    riak_uint32_t n_keys = listkeyresp->n_keys;
+    if (n_keys == 0) {
+        return ERIAK_OK;
+    }
+    // Views and the pointers to them share one allocation
+    riak_binary  *views = (riak_binary*)riak_config_allocate(cfg, n_keys * (sizeof(riak_binary) + sizeof(riak_binary*)));
+    if (views == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_binary **keys = (riak_binary**)(views + n_keys);
+    int i;
+    for(i = 0; i < n_keys; i++) {
+        views[i].len     = listkeyresp->keys[i].len;
+        views[i].data    = listkeyresp->keys[i].data;
+        views[i].managed = RIAK_FALSE;
+        keys[i] = &(views[i]);
+    }
+    ((riak_listkeys_stream_callback)rop->stream_cb)(keys, n_keys, rop->stream_cb_data);
+    riak_free(cfg, &views);
+
+    return ERIAK_OK;
+}
+
 // STREAMING MESSAGE
 riak_error
 riak_listkeys_response_decode(riak_operation          *rop,
@@ -77,76 +119,51 @@ riak_listkeys_response_decode(riak_operation          *rop,
     riak_listkeys_response *response = *resp;
     // If this is NULL, there was no previous message
     if (response == NULL) {
-        response = (cfg->malloc_fn)(sizeof(riak_listkeys_response));
+        response = riak_config_clean_allocate(cfg, sizeof(riak_listkeys_response));
         if (response == NULL) {
+            rpb_list_keys_resp__free_unpacked(listkeyresp, cfg->pb_allocator);
             return ERIAK_OUT_OF_MEMORY;
         }
-        memset((void*)response, '\0', sizeof(riak_listkeys_response));
+        *resp = response;
     }
-    // Existing keys need some expansion, so copy the pointers
-    // of the old keys to a new, larger array
-    // TODO: Geometric reallocation to minimize extra mallocs, maybe?
     riak_uint32_t existing_keys   = response->n_keys;
     riak_uint32_t additional_keys = listkeyresp->n_keys;
-    if (response->keys != NULL) {
-        if (riak_array_realloc(cfg,
+    riak_error    err             = ERIAK_OK;
+    if (rop->stream_cb) {
+        err = riak_listkeys_stream_chunk(rop, listkeyresp);
+        if (err == ERIAK_OK) {
+            response->n_keys += additional_keys;
+        }
+    } else if (additional_keys > 0) {
+        // Grow geometrically so streamed chunks are not copied over and over
+        if (riak_array_reserve(cfg,
                                (void***)&(response->keys),
                                sizeof(riak_binary*),
                                existing_keys,
-                               (additional_keys+existing_keys)) == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-    } else {
-        response->keys = (riak_binary**)(cfg->malloc_fn)(sizeof(riak_binary*)*additional_keys);
-        if (response->keys == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
+                               &(response->keys_capacity),
+                               existing_keys+additional_keys) == NULL) {
+            err = ERIAK_OUT_OF_MEMORY;
         }
-    }
-    response->n_keys += additional_keys;
-    for(i = 0; i < additional_keys; i++) {
-        ProtobufCBinaryData *binary = &(listkeyresp->keys[i]);
-        response->keys[i+existing_keys] = riak_binary_new(cfg, binary->len, binary->data);
-        if (response->keys[i+existing_keys]->data == NULL) {
-            int j;
-            rpb_list_keys_resp__free_unpacked(listkeyresp, cfg->pb_allocator);
-            for(j = 0; j < i; j++) {
-                riak_free(cfg, &(response->keys[j+existing_keys]));
+        for(i = 0; err == ERIAK_OK && i < additional_keys; i++) {
+            ProtobufCBinaryData *binary = &(listkeyresp->keys[i]);
+            riak_binary *key = riak_binary_new(cfg, binary->len, binary->data);
+            if (key == NULL) {
+                err = ERIAK_OUT_OF_MEMORY;
+                break;
             }
-            riak_free(cfg, &(response->keys));
-            riak_free(cfg, resp);
-
-            return ERIAK_OUT_OF_MEMORY;
+            response->keys[response->n_keys++] = key;
         }
     }
-    response->done = RIAK_FALSE;
-    if (listkeyresp->has_done) {
+    if (err == ERIAK_OK && listkeyresp->has_done) {
         riak_connection *cxn = riak_operation_get_connection(rop);
         riak_log_debug(cxn, "%s", "HAS DONE");
         response->done = listkeyresp->done;
     }
     *done = response->done;
+    // Keys were either copied or handed to the callback, so the chunk can go
+    rpb_list_keys_resp__free_unpacked(listkeyresp, cfg->pb_allocator);
 
-    // Expand the vector of internal RpbListKeysResp links as necessary
-    riak_uint32_t existing_pbs = response->n_responses;
-    if (existing_pbs > 0) {
-        if (riak_array_realloc(cfg,
-                               (void***)&(response->_internal),
-                               sizeof(RpbListKeysResp*),
-                               existing_pbs,
-                               (existing_pbs+1)) == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-    } else {
-        response->_internal = (RpbListKeysResp **)(cfg->malloc_fn)(sizeof(RpbListKeysResp*));
-        if (response->_internal == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-    }
-    response->_internal[existing_pbs] = listkeyresp;
-    response->n_responses++;
-    *resp = response;
-
-    return ERIAK_OK;
+    return err;
 }
 
 void
@@ -162,7 +179,7 @@ riak_listkeys_response_print(riak_listkeys_response *response,
         left_to_write -= wrote;
         target += wrote;
     }
-    for(i = 0; (left_to_write > 0) && (i < response->n_keys); i++) {
+    for(i = 0; response->keys && (left_to_write > 0) && (i < response->n_keys); i++) {
         riak_binary_print(response->keys[i], name, sizeof(name));
         wrote = snprintf(target, left_to_write, "%d - %s\n", i, name);
         left_to_write -= wrote;
@@ -179,15 +196,11 @@ riak_listkeys_response_free(riak_config             *cfg,
     riak_listkeys_response *response = *resp;
     if (response == NULL) return;
     int i;
-    for(i = 0; i < response->n_keys; i++) {
-        riak_free(cfg, &(response->keys[i]));
-    }
-    riak_free(cfg, &(response->keys));
-    if (response->n_responses > 0) {
-        for(i = 0; i < response->n_responses; i++) {
-            rpb_list_keys_resp__free_unpacked(response->_internal[i], cfg->pb_allocator);
+    if (response->keys) {
+        for(i = 0; i < response->n_keys; i++) {
+            riak_binary_free(cfg, &(response->keys[i]));
         }
-        riak_free(cfg, &(response->_internal));
+        riak_free(cfg, &(response->keys));
     }
     riak_free(cfg, resp);
 }
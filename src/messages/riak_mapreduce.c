@@ -44,7 +44,7 @@ riak_mapreduce_request_encode(riak_operation   *rop,
     riak_binary_copy_to_pb(&mapmsg.content_type, content_type);
 
     riak_uint32_t msglen = rpb_map_red_req__get_packed_size (&mapmsg);
-    riak_uint8_t* msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -55,10 +55,19 @@ riak_mapreduce_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_mapreduce_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_mapreduce_response_free);
 
     return ERIAK_OK;
 }
 
+void
+riak_mapreduce_set_stream_cb(riak_operation                *rop,
+                             riak_mapreduce_stream_callback cb,
+                             void                          *ptr) {
+    rop->stream_cb      = (riak_stream_callback)cb;
+    rop->stream_cb_data = ptr;
+}
+
 riak_error
 riak_mapreduce_response_decode(riak_operation           *rop,
                                riak_pb_message          *pbresp,
@@ -77,8 +86,10 @@ riak_mapreduce_response_decode(riak_operation           *rop,
     if (response == NULL) {
         response = (riak_mapreduce_response*)riak_config_clean_allocate(cfg, sizeof(riak_mapreduce_response));
         if (response == NULL) {
+            rpb_map_red_resp__free_unpacked(rpbresp, cfg->pb_allocator);
             return ERIAK_OUT_OF_MEMORY;
         }
+        *resp = response;
     }
     *done = RIAK_FALSE;
     if (rpbresp->has_done) {
@@ -87,28 +98,33 @@ riak_mapreduce_response_decode(riak_operation           *rop,
         *done = rpbresp->done;
     }
 
-    // Expand the vector of internal RpbListKeysResp links as necessary
-    riak_uint32_t existing_pbs = response->n_responses;
-    if (existing_pbs > 0) {
-        if (riak_array_realloc(cfg,
-                               (void***)&(response->_internal),
-                               sizeof(RpbMapRedResp*),
-                               existing_pbs,
-                               (existing_pbs+1)) == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
-        }
-    } else {
-        response->_internal = (RpbMapRedResp **)riak_config_allocate(cfg, sizeof(RpbMapRedResp*));
-        if (response->_internal == NULL) {
-            return ERIAK_OUT_OF_MEMORY;
+    // Hand the result over and let go of the message right away
+    if (rop->stream_cb) {
+        if (rpbresp->has_response) {
+            riak_binary result = { rpbresp->response.len, rpbresp->response.data, RIAK_FALSE };
+            ((riak_mapreduce_stream_callback)rop->stream_cb)(rpbresp->phase, &result, rop->stream_cb_data);
+            response->n_responses++;
         }
+        rpb_map_red_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OK;
+    }
+
+    // Expand the vector of internal RpbMapRedResp links as necessary
+    riak_uint32_t existing_pbs = response->n_responses;
+    if (riak_array_reserve(cfg,
+                           (void***)&(response->_internal),
+                           sizeof(RpbMapRedResp*),
+                           existing_pbs,
+                           &(response->_capacity),
+                           existing_pbs+1) == NULL) {
+        rpb_map_red_resp__free_unpacked(rpbresp, cfg->pb_allocator);
+        return ERIAK_OUT_OF_MEMORY;
     }
     response->_internal[existing_pbs] = rpbresp;
     response->n_responses++;
 
-    // If we are streaming, i.e., returning partial results or if we
-    // have the complete message, then assemble a user-consumable response
-    if (rop->streaming || *done) {
+    // Once the last message is in, assemble a user-consumable response
+    if (*done) {
         int i;
         response->msg = (riak_mapreduce_message**)riak_config_clean_allocate(cfg, sizeof(riak_mapreduce_message*) * response->n_responses);
         if (response->msg == NULL) {
@@ -131,8 +147,6 @@ riak_mapreduce_response_decode(riak_operation           *rop,
         }
     }
 
-    *resp = response;
-
     return ERIAK_OK;
 }
 
@@ -166,16 +180,32 @@ void
 riak_mapreduce_response_free(riak_config              *cfg,
                              riak_mapreduce_response **resp) {
     riak_mapreduce_response *response = *resp;
+    if (response == NULL) {
+        return;
+    }
     int i;
-    for(i = 0; i < response->n_responses; i++) {
-        riak_binary_free(cfg, &(response->msg[i]->response));
-        riak_free(cfg, &(response->msg[i]));
-        rpb_map_red_resp__free_unpacked(response->_internal[i], cfg->pb_allocator);
+    // Streamed responses keep a count but neither messages nor protobufs
+    if (response->msg) {
+        for(i = 0; i < response->n_responses; i++) {
+            riak_binary_free(cfg, &(response->msg[i]->response));
+            riak_free(cfg, &(response->msg[i]));
+        }
+        riak_free(cfg, &(response->msg));
+    }
+    if (response->_internal) {
+        for(i = 0; i < response->n_responses; i++) {
+            rpb_map_red_resp__free_unpacked(response->_internal[i], cfg->pb_allocator);
+        }
+        riak_free(cfg, &(response->_internal));
     }
-    riak_free(cfg, &(response->_internal));
     riak_free(cfg, resp);
 }
 
+riak_uint32_t
+riak_mapreduce_get_n_responses(riak_mapreduce_response *response) {
+    return response->n_responses;
+}
+
 riak_mapreduce_message**
 riak_mapreduce_get_messages(riak_mapreduce_response *response) {
     return response->msg;
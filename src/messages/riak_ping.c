@@ -40,6 +40,7 @@ riak_encode_ping_request(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_decode_ping_response);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_free_ping_response);
 
     return ERIAK_OK;
 }
@@ -51,7 +52,7 @@ riak_decode_ping_response(riak_operation      *rop,
                           riak_ping_response **resp,
                           riak_boolean_t      *done) {
     riak_config *cfg = riak_operation_get_config(rop);
-    riak_ping_response *response = (riak_ping_response*)(cfg->malloc_fn)(sizeof(riak_ping_response));
+    riak_ping_response *response = (riak_ping_response*)riak_config_allocate(cfg, sizeof(riak_ping_response));
     *done = RIAK_TRUE;
     if (response == NULL) {
         return ERIAK_OUT_OF_MEMORY;
@@ -29,6 +29,25 @@
 #include "riak_config-internal.h"
 #include "riak_operation-internal.h"
 #include "riak_print-internal.h"
+#include "riak_wire-internal.h"
+#include "riak_view-internal.h"
+
+// RpbPutReq field numbers
+#define RIAK_PUTREQ_BUCKET           1
+#define RIAK_PUTREQ_KEY              2
+#define RIAK_PUTREQ_VCLOCK           3
+#define RIAK_PUTREQ_CONTENT          4
+#define RIAK_PUTREQ_W                5
+#define RIAK_PUTREQ_DW               6
+#define RIAK_PUTREQ_RETURN_BODY      7
+#define RIAK_PUTREQ_PW               8
+#define RIAK_PUTREQ_IF_NOT_MODIFIED  9
+#define RIAK_PUTREQ_IF_NONE_MATCH    10
+#define RIAK_PUTREQ_RETURN_HEAD      11
+#define RIAK_PUTREQ_TIMEOUT          12
+#define RIAK_PUTREQ_ASIS             13
+#define RIAK_PUTREQ_SLOPPY_QUORUM    14
+#define RIAK_PUTREQ_N_VAL            15
 
 riak_error
 riak_put_request_encode(riak_operation   *rop,
@@ -37,79 +56,52 @@ riak_put_request_encode(riak_operation   *rop,
                         riak_pb_message **req) {
 
     riak_config *cfg = riak_operation_get_config(rop);
-    RpbPutReq putmsg = RPB_PUT_REQ__INIT;
-
-    riak_binary_copy_to_pb(&(putmsg.bucket), riak_obj->bucket);
-
-    // Is the Key provided?
-    if (riak_obj->has_key) {
-        putmsg.has_key = RIAK_TRUE;
-        riak_binary_copy_to_pb(&(putmsg.key), riak_obj->key);
-    }
-
-    // Data content payload
-    RpbContent content;
-    riak_object_to_pb_copy(cfg, &content, riak_obj);
-    putmsg.content = &content;
-
-    // process put options
-    if (options != NULL) {
-        if (options->has_asis) {
-            putmsg.has_asis = RIAK_TRUE;
-            putmsg.asis = options->asis;
-        }
-        if (options->has_dw) {
-            putmsg.has_dw = RIAK_TRUE;
-            putmsg.dw = options->dw;
-        }
-        if (options->has_if_none_match) {
-            putmsg.has_if_none_match = RIAK_TRUE;
-            putmsg.has_if_none_match = options->has_if_none_match;
-        }
-        if (options->has_if_not_modified) {
-            putmsg.has_if_not_modified = RIAK_TRUE;
-            putmsg.has_if_not_modified = options->has_if_not_modified;
-        }
-        if (options->has_n_val) {
-            putmsg.has_n_val = RIAK_TRUE;
-            putmsg.n_val = options->n_val;
-        }
-        if (options->has_pw) {
-            putmsg.has_pw = RIAK_TRUE;
-            putmsg.pw = options->pw;
-        }
-        if (options->has_return_body) {
-            putmsg.has_return_body = RIAK_TRUE;
-            putmsg.return_body = options->return_body;
-        }
-        if (options->has_return_head) {
-            putmsg.has_return_head = RIAK_TRUE;
-            putmsg.return_head = options->return_head;
-        }
-        if (options->has_sloppy_quorum) {
-            putmsg.has_sloppy_quorum = RIAK_TRUE;
-            putmsg.sloppy_quorum = options->sloppy_quorum;
-        }
-        if (options->has_timeout) {
-            putmsg.has_timeout = RIAK_TRUE;
-            putmsg.timeout = options->timeout;
-        }
-        if (options->has_vclock) {
-            putmsg.has_vclock = RIAK_TRUE;
-            riak_binary_copy_to_pb(&(putmsg.vclock), options->vclock);
-        }
-        if (options->has_w) {
-            putmsg.has_w = RIAK_TRUE;
-            putmsg.w = options->w;
-        }
+    riak_put_options  none;
+    riak_put_options *opt = options;
+    if (opt == NULL) {
+        memset((void*)&none, '\0', sizeof(none));
+        opt = &none;
     }
 
-    riak_uint32_t msglen = rpb_put_req__get_packed_size (&putmsg);
-    riak_uint8_t* msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    // Sized and written straight from the object, no RpbPutReq/RpbContent in between
+    riak_binary *bucket     = riak_obj->bucket;
+    riak_size_t content_len = riak_object_wire_size(riak_obj);
+    riak_size_t msglen      = riak_wire_bytes_size(RIAK_PUTREQ_BUCKET, bucket->len);
+    if (riak_obj->has_key)          msglen += riak_wire_bytes_size(RIAK_PUTREQ_KEY, riak_obj->key->len);
+    if (opt->has_vclock)            msglen += riak_wire_bytes_size(RIAK_PUTREQ_VCLOCK, opt->vclock->len);
+    msglen += riak_wire_bytes_size(RIAK_PUTREQ_CONTENT, content_len);
+    if (opt->has_w)                 msglen += riak_wire_uint_size(RIAK_PUTREQ_W, opt->w);
+    if (opt->has_dw)                msglen += riak_wire_uint_size(RIAK_PUTREQ_DW, opt->dw);
+    if (opt->has_return_body)       msglen += riak_wire_uint_size(RIAK_PUTREQ_RETURN_BODY, opt->return_body ? 1 : 0);
+    if (opt->has_pw)                msglen += riak_wire_uint_size(RIAK_PUTREQ_PW, opt->pw);
+    if (opt->has_if_not_modified)   msglen += riak_wire_uint_size(RIAK_PUTREQ_IF_NOT_MODIFIED, opt->if_not_modified ? 1 : 0);
+    if (opt->has_if_none_match)     msglen += riak_wire_uint_size(RIAK_PUTREQ_IF_NONE_MATCH, opt->if_none_match ? 1 : 0);
+    if (opt->has_return_head)       msglen += riak_wire_uint_size(RIAK_PUTREQ_RETURN_HEAD, opt->return_head ? 1 : 0);
+    if (opt->has_timeout)           msglen += riak_wire_uint_size(RIAK_PUTREQ_TIMEOUT, opt->timeout);
+    if (opt->has_asis)              msglen += riak_wire_uint_size(RIAK_PUTREQ_ASIS, opt->asis ? 1 : 0);
+    if (opt->has_sloppy_quorum)     msglen += riak_wire_uint_size(RIAK_PUTREQ_SLOPPY_QUORUM, opt->sloppy_quorum ? 1 : 0);
+    if (opt->has_n_val)             msglen += riak_wire_uint_size(RIAK_PUTREQ_N_VAL, opt->n_val);
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
-    rpb_put_req__pack (&putmsg, msgbuf);
+    riak_uint8_t *pos = msgbuf;
+    pos = riak_wire_put_bytes(pos, RIAK_PUTREQ_BUCKET, bucket->data, bucket->len);
+    if (riak_obj->has_key)          pos = riak_wire_put_bytes(pos, RIAK_PUTREQ_KEY, riak_obj->key->data, riak_obj->key->len);
+    if (opt->has_vclock)            pos = riak_wire_put_bytes(pos, RIAK_PUTREQ_VCLOCK, opt->vclock->data, opt->vclock->len);
+    pos = riak_wire_put_header(pos, RIAK_PUTREQ_CONTENT, content_len);
+    pos = riak_object_wire_write(riak_obj, pos);
+    if (opt->has_w)                 pos = riak_wire_put_uint(pos, RIAK_PUTREQ_W, opt->w);
+    if (opt->has_dw)                pos = riak_wire_put_uint(pos, RIAK_PUTREQ_DW, opt->dw);
+    if (opt->has_return_body)       pos = riak_wire_put_uint(pos, RIAK_PUTREQ_RETURN_BODY, opt->return_body ? 1 : 0);
+    if (opt->has_pw)                pos = riak_wire_put_uint(pos, RIAK_PUTREQ_PW, opt->pw);
+    if (opt->has_if_not_modified)   pos = riak_wire_put_uint(pos, RIAK_PUTREQ_IF_NOT_MODIFIED, opt->if_not_modified ? 1 : 0);
+    if (opt->has_if_none_match)     pos = riak_wire_put_uint(pos, RIAK_PUTREQ_IF_NONE_MATCH, opt->if_none_match ? 1 : 0);
+    if (opt->has_return_head)       pos = riak_wire_put_uint(pos, RIAK_PUTREQ_RETURN_HEAD, opt->return_head ? 1 : 0);
+    if (opt->has_timeout)           pos = riak_wire_put_uint(pos, RIAK_PUTREQ_TIMEOUT, opt->timeout);
+    if (opt->has_asis)              pos = riak_wire_put_uint(pos, RIAK_PUTREQ_ASIS, opt->asis ? 1 : 0);
+    if (opt->has_sloppy_quorum)     pos = riak_wire_put_uint(pos, RIAK_PUTREQ_SLOPPY_QUORUM, opt->sloppy_quorum ? 1 : 0);
+    if (opt->has_n_val)             pos = riak_wire_put_uint(pos, RIAK_PUTREQ_N_VAL, opt->n_val);
 
     riak_pb_message* request = riak_pb_message_new(cfg, MSG_RPBPUTREQ, msglen, msgbuf);
     if (request == NULL) {
@@ -117,6 +109,7 @@ riak_put_request_encode(riak_operation   *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_put_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_put_response_free);
 
     return ERIAK_OK;
 }
@@ -126,7 +119,7 @@ riak_free_put_request(riak_config        *cfg,
                       riak_put_response **resp) {
     riak_put_response *response = *resp;
     if (response == NULL) return;
-    rpb_put_resp__free_unpacked(response->_internal, cfg->pb_allocator);
+    riak_get_view_free(cfg, &(response->_internal));
     riak_free(cfg, resp);
 }
 
@@ -135,55 +128,57 @@ riak_put_response_decode(riak_operation     *rop,
                          riak_pb_message    *pbresp,
                          riak_put_response **resp,
                          riak_boolean_t     *done) {
-    // decode the PB response etc
+    // Decoded from the wire in place; every binary points into the view
     riak_config *cfg = riak_operation_get_config(rop);
-    RpbPutResp *rpbresp = rpb_put_resp__unpack(cfg->pb_allocator, (pbresp->len)-1, (uint8_t*)((pbresp->data)+1));
-    if (rpbresp == NULL) {
-        return ERIAK_MESSAGE_FORMAT;
+    riak_get_view *view = NULL;
+    riak_error err = riak_view_new(cfg, &view, NULL, NULL, pbresp->data + 1, pbresp->len - 1, RIAK_TRUE);
+    if (err) {
+        return err;
     }
     *done = RIAK_TRUE;
     riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_log_debug(cxn, "riak_decode_put_response len=%d/pb unpack = 0x%lx\n", pbresp->len, (long)(rpbresp));
-    if (rpbresp == NULL) {
-        return ERIAK_OUT_OF_MEMORY;
-    }
-    int i = 0;
-    riak_put_response *response = (riak_put_response*)(cfg->malloc_fn)(sizeof(riak_put_response));
+    riak_log_debug(cxn, "riak_decode_put_response len=%d/view = 0x%lx\n", pbresp->len, (long)(view));
+    riak_put_response *response = (riak_put_response*)riak_config_clean_allocate(cfg, sizeof(riak_put_response));
     if (response == NULL) {
+        riak_get_view_free(cfg, &view);
         return ERIAK_OUT_OF_MEMORY;
     }
-    memset(response, '\0', sizeof(riak_put_response));
-    response->_internal = rpbresp;
-    if (rpbresp->has_vclock) {
+    response->_internal = view;
+    if (view->has_vclock) {
         response->has_vclock = RIAK_TRUE;
-        response->vclock = riak_binary_copy_from_pb(cfg, &(rpbresp->vclock));
+        response->vclock = riak_binary_new_shallow(cfg, view->vclock.len, view->vclock.data);
         if (response->vclock == NULL) {
+            riak_put_response_free(cfg, &response);
             return ERIAK_OUT_OF_MEMORY;
         }
     }
-    if (rpbresp->has_key) {
+    if (view->has_key) {
         response->has_key = RIAK_TRUE;
-        response->key = riak_binary_copy_from_pb(cfg, &(rpbresp->key));
+        response->key = riak_binary_new_shallow(cfg, view->key.len, view->key.data);
         if (response->key == NULL) {
+            riak_put_response_free(cfg, &response);
             return ERIAK_OUT_OF_MEMORY;
         }
+        // Stored objects do not report the generated key themselves
+        view->has_key = RIAK_FALSE;
     }
-    if (rpbresp->n_content > 0) {
-        riak_error err = riak_object_new_array(cfg, &(response->content), rpbresp->n_content);
+    if (view->n_content > 0) {
+        err = riak_object_new_array(cfg, &(response->content), view->n_content);
         if (err != ERIAK_OK) {
-            riak_free(cfg, &response);
+            riak_put_response_free(cfg, &response);
             return err;
         }
-        response->n_content = rpbresp->n_content;
-        for(i = 0; i < rpbresp->n_content; i++) {
-            err = riak_object_new_from_pb(cfg, &(response->content[i]), rpbresp->content[i]);
-            // If any object allocation fails, clean up all previously allocated ones
+        int i;
+        for(i = 0; i < view->n_content; i++) {
+            err = riak_object_view_to_object(cfg, &(view->content[i]), &(response->content[i]));
+            // If any object fails, clean up all previously built ones
             if (err != ERIAK_OK) {
-                riak_object_free_array(cfg, &(response->content), i);
-                riak_free(cfg, &response);
+                response->n_content = i;
+                riak_put_response_free(cfg, &response);
                 return err;
             }
         }
+        response->n_content = view->n_content;
     }
     *resp = response;
 
@@ -226,12 +221,12 @@ riak_put_response_free(riak_config        *cfg,
                        riak_put_response **resp) {
     riak_put_response *response = *resp;
     if (response == NULL) return;
-    if (response->n_content > 0) {
+    if (response->content != NULL) {
         riak_object_free_array(cfg, &(response->content), response->n_content);
     }
     riak_free(cfg, &(response->key));
     riak_free(cfg, &(response->vclock));
-    rpb_put_resp__free_unpacked(response->_internal, cfg->pb_allocator);
+    riak_get_view_free(cfg, &(response->_internal));
     riak_free(cfg, resp);
 }
 
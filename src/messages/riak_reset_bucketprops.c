@@ -43,7 +43,7 @@ riak_reset_bucketprops_request_encode(riak_operation      *rop,
     riak_binary_copy_to_pb(&resetmsg.bucket, bucket);
 
     riak_uint32_t msglen = rpb_reset_bucket_req__get_packed_size(&resetmsg);
-    riak_uint8_t* msgbuf = (riak_uint8_t*)(cfg->malloc_fn)(msglen);
+    riak_uint8_t* msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, msglen);
     if (msgbuf == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -55,6 +55,7 @@ riak_reset_bucketprops_request_encode(riak_operation      *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_reset_bucketprops_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_reset_bucketprops_response_free);
 
     return ERIAK_OK;
 }
@@ -65,7 +66,7 @@ riak_reset_bucketprops_response_decode(riak_operation                   *rop,
                                        riak_reset_bucketprops_response **resp,
                                        riak_boolean_t                   *done) {
     riak_config *cfg = riak_operation_get_config(rop);
-    riak_reset_bucketprops_response *response = (riak_reset_bucketprops_response*)(cfg->malloc_fn)(sizeof(riak_reset_bucketprops_response));
+    riak_reset_bucketprops_response *response = (riak_reset_bucketprops_response*)riak_config_allocate(cfg, sizeof(riak_reset_bucketprops_response));
     *done = RIAK_TRUE;
     if (response == NULL) {
         return ERIAK_OUT_OF_MEMORY;
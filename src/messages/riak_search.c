@@ -95,6 +95,7 @@ riak_search_request_encode(riak_operation      *rop,
     }
     *req = request;
     riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_search_response_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_search_response_free);
 
     return ERIAK_OK;
 }
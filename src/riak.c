@@ -21,41 +21,176 @@
  *********************************************************************/
 
 #include <errno.h>
+#include <poll.h>
 #include "riak.h"
 #include "riak_connection.h"
 #include "riak_messages-internal.h"
 #include "riak_utils-internal.h"
 #include "riak_operation-internal.h"
+#include "riak_view-internal.h"
+#include "riak_connection-internal.h"
 
 //
 // SYNCHRONOUS CALLBACKS
 //
 
-riak_ssize_t
-riak_sync_read_cb(void       *ptr,
-                  void       *data,
-                  riak_size_t size) {
-    riak_operation  *rop = (riak_operation*)ptr;
+/**
+ * @brief Wait for a socket to become readable or writable
+ * @param cxn Riak Connection
+ * @param events POLLIN or POLLOUT
+ * @param timeout Milliseconds (0 waits indefinitely)
+ * @returns Positive when ready, 0 on timeout, negative on error
+ */
+static int
+riak_sync_wait(riak_connection *cxn,
+               short            events,
+               riak_uint32_t    timeout) {
+    struct pollfd pfd;
+    pfd.fd      = riak_connection_get_fd(cxn);
+    pfd.events  = events;
+    pfd.revents = 0;
+    int ready;
+    do {
+        ready = poll(&pfd, 1, (timeout > 0) ? (int)timeout : -1);
+    } while (ready < 0 && errno == EINTR);
+    return ready;
+}
+
+/**
+ * @brief Give up on an operation that ran out of time
+ * @param rop Riak Operation
+ * @note The reply may still turn up, so the socket is shut down
+ *       rather than risk matching it to a later request
+ */
+static void
+riak_sync_timed_out(riak_operation *rop) {
     riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_socket_t     fd = riak_connection_get_fd(cxn);
-    riak_ssize_t  result = read(fd, data, size);
-    if (result < 0) {
+    riak_log_error(cxn, "%s", "Operation timed out, connection shut down");
+    rop->timed_out = RIAK_TRUE;
+    shutdown(riak_connection_get_fd(cxn), SHUT_RDWR);
+}
+
+/**
+ * @brief Read whatever is available, within the operation's read timeout
+ * @param rop Riak Operation
+ * @param data Where to put the bytes
+ * @param size Room in `data`
+ * @returns Bytes read, 0 at end of stream, negative on error or timeout
+ */
+static riak_ssize_t
+riak_sync_recv(riak_operation *rop,
+               void           *data,
+               riak_size_t     size) {
+    riak_connection *cxn     = riak_operation_get_connection(rop);
+    riak_uint32_t    timeout = (rop->timeout > 0) ? rop->timeout : cxn->options.read_timeout;
+    while (RIAK_TRUE) {
+        if (timeout > 0 && riak_sync_wait(cxn, POLLIN, timeout) == 0) {
+            riak_sync_timed_out(rop);
+            return -1;
+        }
+        riak_ssize_t result = recv(riak_connection_get_fd(cxn), data, size, 0);
+        if (result >= 0) {
+            return result;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        // Only on non-blocking sockets
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (timeout == 0) {
+                riak_sync_wait(cxn, POLLIN, 0);
+            }
+            continue;
+        }
         char message[256];
         strerror_r(errno, message, sizeof(message));
-        printf("%s\n", message);
-        abort();
+        riak_log_error(cxn, "Read failed: %s", message);
+        return -1;
     }
-    return result;
 }
 
-riak_ssize_t
-riak_sync_write_cb(void       *ptr,
-                   void       *data,
-                   riak_size_t size) {
-    riak_operation  *rop = (riak_operation*)ptr;
-    riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_socket_t    fd  = riak_connection_get_fd(cxn);
-    return write(fd, data, size);
+/**
+ * @brief Send a message, within the operation's write timeout
+ * @param rop Riak Operation
+ * @param msg Data to send
+ * @returns Bytes sent, negative on error or timeout
+ */
+static riak_ssize_t
+riak_sync_sendmsg(riak_operation *rop,
+                  struct msghdr  *msg) {
+    riak_connection *cxn     = riak_operation_get_connection(rop);
+    riak_uint32_t    timeout = (rop->timeout > 0) ? rop->timeout : cxn->options.write_timeout;
+    // Don't let a peer-closed (e.g. pooled) socket raise SIGPIPE
+    int              flags   = MSG_NOSIGNAL | ((timeout > 0) ? MSG_DONTWAIT : 0);
+    while (RIAK_TRUE) {
+        riak_ssize_t wrote = sendmsg(riak_connection_get_fd(cxn), msg, flags);
+        if (wrote >= 0) {
+            return wrote;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (riak_sync_wait(cxn, POLLOUT, timeout) == 0) {
+                riak_sync_timed_out(rop);
+                return -1;
+            }
+            continue;
+        }
+        char message[256];
+        strerror_r(errno, message, sizeof(message));
+        riak_log_error(cxn, "Write failed: %s", message);
+        return -1;
+    }
+}
+
+static riak_ssize_t
+riak_sync_writev_cb(void         *ptr,
+                    struct iovec *iov,
+                    int           iovcnt) {
+    riak_operation  *rop   = (riak_operation*)ptr;
+    riak_ssize_t     total = 0;
+
+    // Usually one call, but keep going after a short write
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        memset(&msg, '\0', sizeof(msg));
+        msg.msg_iov    = iov;
+        msg.msg_iovlen = iovcnt;
+        riak_ssize_t wrote = riak_sync_sendmsg(rop, &msg);
+        if (wrote < 0) {
+            return -1;
+        }
+        total += wrote;
+        while (iovcnt > 0 && (riak_size_t)wrote >= iov->iov_len) {
+            wrote -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base  = (riak_uint8_t*)iov->iov_base + wrote;
+            iov->iov_len  -= wrote;
+        }
+    }
+    return total;
+}
+
+// Blocking reader which notices when the peer hangs up
+typedef struct _riak_sync_reader {
+    riak_operation *rop;
+    riak_boolean_t  closed;
+} riak_sync_reader;
+
+static riak_ssize_t
+riak_sync_reader_cb(void       *ptr,
+                    void       *data,
+                    riak_size_t size) {
+    riak_sync_reader *reader = (riak_sync_reader*)ptr;
+    riak_ssize_t result = riak_sync_recv(reader->rop, data, size);
+    if (result <= 0) {
+        reader->closed = RIAK_TRUE;
+    }
+    return result;
 }
 
 static riak_error
@@ -65,21 +200,154 @@ riak_sync_request(riak_operation **rop_target,
     riak_connection *cxn = riak_operation_get_connection(rop);
     riak_operation_set_cb_data(rop, rop);
 
-    riak_error err = riak_write(rop, riak_sync_write_cb, rop);
+    riak_error err = riak_writev(rop, riak_sync_writev_cb, rop);
     if (err) {
         riak_log_critical(cxn, "%s", "Could not send request");
+        if (rop->timed_out) {
+            err = ERIAK_TIMEOUT;
+        }
         riak_operation_free(rop_target);
         return err;
     }
 
-    riak_boolean_t done_streaming;
-    err = riak_read(rop, &done_streaming, riak_sync_read_cb, rop);
+    riak_sync_reader reader = { rop, RIAK_FALSE };
+    riak_boolean_t done_streaming = RIAK_FALSE;
+    while (!done_streaming) {
+        err = riak_read(rop, &done_streaming, riak_sync_reader_cb, &reader);
+        if (err) break;
+        if (!done_streaming && reader.closed) {
+            riak_log_error(cxn, "%s", "Connection closed before the response arrived");
+            err = ERIAK_READ;
+            break;
+        }
+    }
+    if (rop->timed_out) {
+        err = ERIAK_TIMEOUT;
+    }
 
+    // Whatever arrived before a failure is incomplete, so never hand it out
+    if (err) {
+        riak_operation_discard_response(rop);
+    }
     *response = rop->response;
     riak_operation_free(rop_target);
     return err;
 }
 
+//
+// PIPELINING
+//
+
+// Operations framed per sendmsg when flushing a pipeline
+#define RIAK_PIPELINE_BATCH 32
+
+/**
+ * @brief Fail every pending operation once responses can no longer be matched
+ * @param cxn Riak Connection
+ * @param err Error code reported to each operation's error callback
+ */
+static void
+riak_pipeline_abort(riak_connection *cxn,
+                    riak_error       err) {
+    riak_log_error(cxn, "Dropping %d pipelined requests", cxn->n_pending);
+    riak_connection_abort_pending(cxn, err);
+}
+
+riak_error
+riak_pipeline_send(riak_operation *rop) {
+    riak_connection *cxn = riak_operation_get_connection(rop);
+    rop->next = NULL;
+    if (cxn->pending_tail) {
+        cxn->pending_tail->next = rop;
+    } else {
+        cxn->pending_head = rop;
+    }
+    cxn->pending_tail = rop;
+    if (cxn->pending_unsent == NULL) {
+        cxn->pending_unsent = rop;
+    }
+    cxn->n_pending++;
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_pipeline_flush(riak_connection *cxn) {
+    struct iovec iov[RIAK_PIPELINE_BATCH * RIAK_FRAME_IOV_MAX];
+    while (cxn->pending_unsent) {
+        riak_operation *first  = cxn->pending_unsent;
+        riak_operation *rop    = first;
+        riak_ssize_t    length = 0;
+        int             iovcnt = 0;
+        int             i;
+        for(i = 0; rop && i < RIAK_PIPELINE_BATCH; i++, rop = rop->next) {
+            iovcnt += riak_frame_iov(rop, &iov[iovcnt], &length);
+        }
+        riak_ssize_t wrote = riak_sync_writev_cb(first, iov, iovcnt);
+        if (wrote != length) {
+            riak_error err = (first->timed_out) ? ERIAK_TIMEOUT : ERIAK_WRITE;
+            riak_log_critical(cxn, "%s", "Could not send pipelined requests");
+            riak_pipeline_abort(cxn, err);
+            return err;
+        }
+        cxn->pending_unsent = rop;
+    }
+    return ERIAK_OK;
+}
+
+riak_error
+riak_pipeline_receive(riak_connection *cxn) {
+    riak_operation *rop = cxn->pending_head;
+    if (rop == NULL) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_error err = riak_pipeline_flush(cxn);
+    if (err) {
+        return err;
+    }
+    riak_sync_reader reader = { rop, RIAK_FALSE };
+    riak_boolean_t done_streaming = RIAK_FALSE;
+    // Keep reading until the whole (possibly streamed) response is in
+    while (!done_streaming) {
+        err = riak_read(rop, &done_streaming, riak_sync_reader_cb, &reader);
+        if (err) break;
+        if (!done_streaming && reader.closed) {
+            err = ERIAK_READ;
+            break;
+        }
+    }
+    if (rop->timed_out) {
+        err = ERIAK_TIMEOUT;
+    }
+    // A server error still consumed its frame, so later responses line up
+    if (err == ERIAK_OK || err == ERIAK_SERVER_ERROR) {
+        cxn->pending_head = rop->next;
+        if (cxn->pending_head == NULL) {
+            cxn->pending_tail = NULL;
+        }
+        cxn->n_pending--;
+        riak_operation_free(&rop);
+        return err;
+    }
+
+    // Framing is lost, so nothing else on this socket can be matched up
+    riak_pipeline_abort(cxn, err);
+
+    return err;
+}
+
+riak_error
+riak_pipeline_drain(riak_connection *cxn) {
+    riak_error result = riak_pipeline_flush(cxn);
+    while (cxn->pending_head) {
+        riak_error err = riak_pipeline_receive(cxn);
+        if (err && result == ERIAK_OK) {
+            result = err;
+        }
+    }
+    return result;
+}
+
 riak_error
 riak_ping(riak_connection *cxn) {
     riak_operation *rop = NULL;
@@ -87,6 +355,7 @@ riak_ping(riak_connection *cxn) {
     if (err) {
         return err;
     }
+    riak_config        *cfg      = riak_operation_get_config(rop);
     riak_ping_response *response = NULL;
     err = riak_encode_ping_request(rop, &(rop->pb_request));
     if (err) {
@@ -96,7 +365,13 @@ riak_ping(riak_connection *cxn) {
     if (err) {
         return err;
     }
-    if (response->success != RIAK_TRUE) {
+    // A closed socket reads no response at all
+    if (response == NULL) {
+        return ERIAK_NO_PING;
+    }
+    riak_boolean_t success = response->success;
+    riak_free_ping_response(cfg, &response);
+    if (success != RIAK_TRUE) {
         return ERIAK_NO_PING;
     }
     return ERIAK_OK;
@@ -146,6 +421,45 @@ riak_get(riak_connection    *cxn,
     return ERIAK_OK;
 }
 
+riak_error
+riak_get_prepared(riak_connection    *cxn,
+                  riak_get_template  *tmpl,
+                  riak_binary        *key,
+                  riak_get_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_get_template_request_encode(rop, tmpl, key, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
+riak_error
+riak_get_lazy(riak_connection  *cxn,
+              riak_binary      *bucket,
+              riak_binary      *key,
+              riak_get_options *opts,
+              riak_get_view   **view) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_get_request_encode(rop, bucket, key, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_view_decode);
+    riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_view_free);
+    return riak_sync_request(&rop, (void**)view);
+}
+
 riak_error
 riak_put(riak_connection    *cxn,
          riak_object        *obj,
@@ -178,19 +492,102 @@ riak_delete(riak_connection    *cxn,
     if (err) {
         return err;
     }
+    riak_config *cfg = riak_operation_get_config(rop);
     err = riak_delete_request_encode(rop, bucket, key, opts, &(rop->pb_request));
     if (err) {
+        riak_operation_free(&rop);
         return err;
     }
-    riak_get_response *response = NULL;
+    riak_delete_response *response = NULL;
     err = riak_sync_request(&rop, (void**)&response);
     if (err) {
         return err;
     }
+    riak_delete_response_free(cfg, &response);
 
     return ERIAK_OK;
 }
 
+riak_error
+riak_dt_fetch(riak_connection         *cxn,
+              riak_binary             *bucket_type,
+              riak_binary             *bucket,
+              riak_binary             *key,
+              riak_dt_fetch_options   *opts,
+              riak_dt_fetch_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_dt_fetch_request_encode(rop, bucket_type, bucket, key, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
+riak_error
+riak_dt_update(riak_connection          *cxn,
+               riak_binary              *bucket_type,
+               riak_binary              *bucket,
+               riak_binary              *key,
+               riak_dt_op               *op,
+               riak_dt_update_options   *opts,
+               riak_dt_update_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_dt_update_request_encode(rop, bucket_type, bucket, key, op, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
+riak_error
+riak_counter_update(riak_connection               *cxn,
+                    riak_binary                   *bucket,
+                    riak_binary                   *key,
+                    riak_int64_t                   amount,
+                    riak_counter_update_options   *opts,
+                    riak_counter_update_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_counter_update_request_encode(rop, bucket, key, amount, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
+riak_error
+riak_counter_get(riak_connection            *cxn,
+                 riak_binary                *bucket,
+                 riak_binary                *key,
+                 riak_counter_get_options   *opts,
+                 riak_counter_get_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_counter_get_request_encode(rop, bucket, key, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
 riak_error
 riak_listbuckets(riak_connection            *cxn,
                  riak_listbuckets_response **response) {
@@ -231,6 +628,36 @@ riak_listkeys(riak_connection         *cxn,
     return ERIAK_OK;
 }
 
+riak_error
+riak_listkeys_stream(riak_connection              *cxn,
+                     riak_binary                  *bucket,
+                     riak_uint32_t                 timeout,
+                     riak_listkeys_stream_callback cb,
+                     void                         *ptr,
+                     riak_uint32_t                *n_keys) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    riak_config *cfg = riak_operation_get_config(rop);
+    err = riak_listkeys_request_encode(rop, bucket, timeout, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    riak_listkeys_set_stream_cb(rop, cb, ptr);
+    riak_listkeys_response *response = NULL;
+    err = riak_sync_request(&rop, (void**)&response);
+    if (response) {
+        if (n_keys) {
+            *n_keys = riak_listkeys_get_n_keys(response);
+        }
+        riak_listkeys_response_free(cfg, &response);
+    }
+    return err;
+}
+
 riak_error
 riak_get_clientid(riak_connection             *cxn,
                   riak_get_clientid_response **response) {
@@ -358,6 +785,36 @@ riak_mapreduce(riak_connection          *cxn,
     return ERIAK_OK;
 }
 
+riak_error
+riak_mapreduce_stream(riak_connection               *cxn,
+                      riak_binary                   *content_type,
+                      riak_binary                   *map_request,
+                      riak_mapreduce_stream_callback cb,
+                      void                          *ptr,
+                      riak_uint32_t                 *n_results) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    riak_config *cfg = riak_operation_get_config(rop);
+    err = riak_mapreduce_request_encode(rop, content_type, map_request, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    riak_mapreduce_set_stream_cb(rop, cb, ptr);
+    riak_mapreduce_response *response = NULL;
+    err = riak_sync_request(&rop, (void**)&response);
+    if (response) {
+        if (n_results) {
+            *n_results = riak_mapreduce_get_n_responses(response);
+        }
+        riak_mapreduce_response_free(cfg, &response);
+    }
+    return err;
+}
+
 riak_error
 riak_2index(riak_connection       *cxn,
             riak_binary           *bucket,
@@ -381,6 +838,80 @@ riak_2index(riak_connection       *cxn,
     return ERIAK_OK;
 }
 
+riak_error
+riak_csbucket(riak_connection         *cxn,
+              riak_binary             *bucket,
+              riak_binary             *start_key,
+              riak_csbucket_options   *opts,
+              riak_csbucket_response **response) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    if (err) {
+        return err;
+    }
+    err = riak_csbucket_request_encode(rop, bucket, start_key, opts, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_sync_request(&rop, (void**)response);
+}
+
+riak_error
+riak_csbucket_fold(riak_connection               *cxn,
+                   riak_binary                   *bucket,
+                   riak_binary                   *start_key,
+                   riak_csbucket_options         *opts,
+                   riak_uint32_t                  page_size,
+                   riak_csbucket_stream_callback  cb,
+                   void                          *ptr) {
+    riak_config *cfg = riak_connection_get_config(cxn);
+    // Page through a private copy so the caller's options can be reused
+    riak_csbucket_options options;
+    if (opts) {
+        options = *opts;
+    } else {
+        memset((void*)&options, '\0', sizeof(options));
+    }
+    riak_binary *continuation = NULL;
+    if (page_size > 0) {
+        riak_csbucket_options_set_max_results(&options, page_size);
+    }
+    riak_error err;
+    riak_boolean_t more = RIAK_TRUE;
+    while (more) {
+        riak_operation *rop = NULL;
+        err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+        if (err) {
+            break;
+        }
+        riak_config *rop_cfg = riak_operation_get_config(rop);
+        err = riak_csbucket_request_encode(rop, bucket, start_key, &options, &(rop->pb_request));
+        if (err) {
+            riak_operation_free(&rop);
+            break;
+        }
+        riak_csbucket_set_stream_cb(rop, cb, ptr);
+        // Objects go straight to `cb`; the summary only says where the next page starts
+        riak_csbucket_response *summary = NULL;
+        err = riak_sync_request(&rop, (void**)&summary);
+        more = (err == ERIAK_OK && summary && summary->has_continuation);
+        if (more) {
+            riak_binary_free(cfg, &continuation);
+            continuation = riak_binary_copy(cfg, summary->continuation);
+            if (continuation == NULL) {
+                err = ERIAK_OUT_OF_MEMORY;
+                more = RIAK_FALSE;
+            }
+            options.has_continuation = RIAK_TRUE;
+            options.continuation     = continuation;
+        }
+        riak_csbucket_response_free(rop_cfg, &summary);
+    }
+    riak_binary_free(cfg, &continuation);
+    return err;
+}
+
 riak_error
 riak_search(riak_connection       *cxn,
             riak_binary           *bucket,
@@ -404,101 +935,127 @@ riak_search(riak_connection       *cxn,
     return ERIAK_OK;
 }
 
+/**
+ * @brief Make room in the connection's read buffer for at least `needed` bytes
+ * @param cxn Riak Connection
+ * @param needed Size of the frame being assembled
+ * @returns Error code
+ */
+static riak_error
+riak_read_buffer_reserve(riak_connection *cxn,
+                         riak_size_t      needed) {
+    riak_config *cfg = riak_connection_get_config(cxn);
+    riak_size_t  used = cxn->inbuf_end - cxn->inbuf_start;
+
+    // Slide the unparsed tail to the front before growing
+    if (cxn->inbuf_start > 0) {
+        if (used > 0) {
+            memmove(cxn->inbuf, cxn->inbuf + cxn->inbuf_start, used);
+        }
+        cxn->inbuf_start = 0;
+        cxn->inbuf_end   = used;
+    }
+    if (needed <= cxn->inbuf_size && cxn->inbuf_end < cxn->inbuf_size) {
+        return ERIAK_OK;
+    }
+    riak_size_t size = (cxn->inbuf_size > 0) ? cxn->inbuf_size : RIAK_READ_BUFFER_INITIAL;
+    while (size < needed || size <= used) {
+        size *= 2;
+    }
+    riak_uint8_t *inbuf = (riak_uint8_t*)riak_config_allocate(cfg, size);
+    if (inbuf == NULL) {
+        riak_log_critical(cxn, "Could not grow read buffer to %d bytes", (int)size);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    if (used > 0) {
+        memcpy(inbuf, cxn->inbuf, used);
+    }
+    riak_free(cfg, &(cxn->inbuf));
+    cxn->inbuf      = inbuf;
+    cxn->inbuf_size = size;
+
+    return ERIAK_OK;
+}
+
 riak_error
 riak_read(riak_operation *rop,
           riak_boolean_t *done_streaming,
           riak_io_cb      read_cb,
           void           *read_cb_data) {
     riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_config     *cfg = riak_connection_get_config(cxn);
-    riak_size_t      buflen;
     *done_streaming = RIAK_FALSE;
 
     while(RIAK_TRUE) {
-        // Are we in the middle of a message already?
-        if (rop->msglen_complete == RIAK_FALSE) {
-            // Read the first 32-bits which are the message size
-            // However, if a few size bytes were included during the last read, add them in
-            riak_uint32_t inmsglen          = rop->msglen;
-            riak_size_t   remaining_msg_len = sizeof(inmsglen) - rop->position;
-            riak_uint8_t *target            = (riak_uint8_t*)(&inmsglen);
-            target += rop->position;
-            buflen = (read_cb)(read_cb_data, target, remaining_msg_len);
-            target = (riak_uint8_t*)(&inmsglen);
-            // If we can't ready any more bytes, stop trying
-            if (buflen != remaining_msg_len) {
-                riak_log_debug(cxn, "Expected %d bytes but received bytes = %d", remaining_msg_len, buflen);
-                if (buflen == 0) break;
-                // A few message size bytes of next message were in this buffer
-                // Stuff the partial size into rop->msglen and note the position
-                if (buflen < sizeof(inmsglen)) {
-                    rop->position = buflen;
-                    rop->msglen   = inmsglen;
-                    return ERIAK_OK;
-                }
-                return ERIAK_READ;  // Something is hosed here
+        // Decode every complete frame already buffered; a single read
+        // often carries several (streamed or pipelined) responses
+        riak_size_t   available = cxn->inbuf_end - cxn->inbuf_start;
+        riak_uint32_t msglen    = 0;
+        if (available >= sizeof(msglen)) {
+            memcpy(&msglen, cxn->inbuf + cxn->inbuf_start, sizeof(msglen));
+            msglen = ntohl(msglen);
+        }
+        if (available < sizeof(msglen) || available - sizeof(msglen) < msglen) {
+            riak_error err = riak_read_buffer_reserve(cxn, sizeof(msglen) + msglen);
+            if (err) {
+                return err;
             }
-
-            rop->msglen_complete = RIAK_TRUE;
-            rop->msglen = ntohl(inmsglen);
-            riak_log_debug(cxn, "Read msglen = %d", rop->msglen);
-
-            // TODO: Need to malloc new buffer each time?
-            rop->msgbuf = (riak_uint8_t*)riak_config_allocate(cfg, rop->msglen);
-            if (rop->msgbuf == NULL) {
-                riak_log_debug(cxn, "%s", "Could not allocate read buffer");
+            riak_ssize_t buflen = (read_cb)(read_cb_data,
+                                            (void*)(cxn->inbuf + cxn->inbuf_end),
+                                            cxn->inbuf_size - cxn->inbuf_end);
+            riak_log_debug(cxn, "read %d bytes, %d buffered", (int)buflen, (int)available);
+            if (buflen < 0) {
                 return ERIAK_READ;
             }
-        } else {
-            riak_log_debug(cxn, "%s", "Continuation of partial message");
+            // Nothing more for now; pick up here on the next callback
+            if (buflen == 0) {
+                break;
+            }
+            cxn->inbuf_end += buflen;
+            continue;
         }
-
-        riak_uint8_t *current_position = rop->msgbuf;
-        current_position += rop->position;
-        buflen = (read_cb)(read_cb_data, (void*)current_position, rop->msglen - rop->position);
-        riak_log_debug(cxn, "read %d bytes at position %d, msglen = %d", buflen, rop->position, rop->msglen);
-        rop->position += buflen;
-        // Are we done yet? If not, break out and wait for the next callback
-        if (rop->position < rop->msglen) {
-            riak_log_error(cxn, "%s","Partial message received");
-            if (!rop->response_cb) /* If the operation is not async, read again */
-              continue;
-            return ERIAK_OK;
+        if (msglen == 0) {
+            riak_log_error(cxn, "%s", "Received an empty frame");
+            return ERIAK_MESSAGE_FORMAT;
         }
-        assert(rop->position == rop->msglen);
 
-        riak_uint8_t msgid = (rop->msgbuf)[0];
-        riak_pb_message *pbresp = riak_pb_message_new(cfg, msgid, rop->msglen, rop->msgbuf);
+        // Decode straight out of the read buffer
+        riak_pb_message pbresp;
+        pbresp.len   = msglen;
+        pbresp.data  = cxn->inbuf + cxn->inbuf_start + sizeof(msglen);
+        pbresp.msgid = pbresp.data[0];
+        cxn->inbuf_start += sizeof(msglen) + msglen;
+        if (cxn->inbuf_start == cxn->inbuf_end) {
+            cxn->inbuf_start = cxn->inbuf_end = 0;
+        }
         riak_error result;
-        rop->position = 0;  // Reset on success
-        rop->msglen = 0;
-        rop->msglen_complete = RIAK_FALSE;
 
         // Response varies by data type
         riak_error_response *err_response = NULL;
         // Assume we are doing a single loop, unless told otherwise
         *done_streaming = RIAK_TRUE;
         if (rop->decoder == NULL) {
-            riak_log_debug(cxn, "%d NOT IMPLEMENTED", msgid);
+            riak_log_debug(cxn, "%d NOT IMPLEMENTED", pbresp.msgid);
             return ERIAK_READ;
         }
-        if (msgid == MSG_RPBERRORRESP) {
-            result = riak_decode_error_response(rop, pbresp, &err_response, done_streaming);
+        if (pbresp.msgid == MSG_RPBERRORRESP) {
+            // The user's error callback, if any, takes ownership of the response
+            result = riak_decode_error_response(rop, &pbresp, &err_response, done_streaming);
+            if (result) {
+                return result;
+            }
             // Convert error response to a null-terminated string
             char errmsg[2048];
-            riak_binary_print(err_response->errmsg, errmsg, sizeof(errmsg));
-            riak_log_error(cxn, "ERR #%d - %s\n", err_response->errcode, errmsg);
-            if (rop->error_cb) {
-                (rop->error_cb)(err_response, rop->cb_data);
+            riak_binary_print(riak_server_error_get_errmsg(rop->error), errmsg, sizeof(errmsg));
+            riak_log_error(cxn, "ERR #%d - %s\n", riak_server_error_get_errcode(rop->error), errmsg);
+            if (rop->error_cb == NULL) {
+                riak_free_error_response(riak_operation_get_config(rop), &err_response);
             }
-            rop->response = NULL;
+            // Drop any chunks that streamed in before the error
+            riak_operation_discard_response(rop);
             return ERIAK_SERVER_ERROR;
         }
         // Decode the message from Protocol Buffers
-        result = (rop->decoder)(rop, pbresp, &(rop->response), done_streaming);
-
-        riak_free(cfg, &pbresp);
-        riak_free(cfg, &rop->msgbuf);
+        result = (rop->decoder)(rop, &pbresp, &(rop->response), done_streaming);
 
         // Something is amiss
         if (result)
@@ -517,25 +1074,59 @@ riak_read(riak_operation *rop,
 }
 
 
+int
+riak_frame_iov(riak_operation *rop,
+               struct iovec   *iov,
+               riak_ssize_t   *length) {
+    riak_pb_message *msg = rop->pb_request;
+
+    // Length (network byte order) covers the msgid plus the payload
+    riak_uint32_t msglen = htonl(msg->len+1);
+    memcpy(rop->frame_header, &msglen, sizeof(msglen));
+    rop->frame_header[sizeof(msglen)] = msg->msgid;
+
+    iov[0].iov_base = rop->frame_header;
+    iov[0].iov_len  = sizeof(rop->frame_header);
+    *length += sizeof(rop->frame_header);
+    if (msg->len == 0) {
+        return 1;
+    }
+    iov[1].iov_base = msg->data;
+    iov[1].iov_len  = msg->len;
+    *length += msg->len;
+    return 2;
+}
+
+riak_error
+riak_writev(riak_operation *rop,
+            riak_iov_cb     writev_cb,
+            void           *writev_cb_data) {
+    struct iovec iov[RIAK_FRAME_IOV_MAX];
+    riak_ssize_t length = 0;
+    int          iovcnt = riak_frame_iov(rop, iov, &length);
+    riak_ssize_t wrote  = (writev_cb)(writev_cb_data, iov, iovcnt);
+    if (wrote != length) return ERIAK_WRITE;
+    return ERIAK_OK;
+}
+
 // TODO: NOT CHARSET SAFE, need iconv
 riak_error
 riak_write(riak_operation *rop,
            riak_io_cb      write_cb,
            void           *write_cb_data) {
     riak_pb_message *msg = rop->pb_request;
-    riak_uint8_t  reqid  = msg->msgid;
     riak_uint8_t *msgbuf = msg->data;
     riak_size_t   len    = msg->len;
+    struct iovec  iov[RIAK_FRAME_IOV_MAX];
+    riak_ssize_t  length = 0;
 
-    // Convert len to network byte order
-    riak_uint32_t msglen = htonl(len+1);
-    riak_int32_t wrote = (write_cb)(write_cb_data, (void*)&msglen, sizeof(msglen));
-    if (wrote == 0) return ERIAK_WRITE;
-    wrote = (write_cb)(write_cb_data, (void*)&reqid, sizeof(reqid));
-    if (wrote == 0) return ERIAK_WRITE;
+    // Header goes out in one piece, even for callbacks that can't do vectors
+    riak_frame_iov(rop, iov, &length);
+    riak_int32_t wrote = (write_cb)(write_cb_data, iov[0].iov_base, iov[0].iov_len);
+    if (wrote <= 0) return ERIAK_WRITE;
     if (len > 0) {
         wrote = (write_cb)(write_cb_data, (void*)msgbuf, len);
-        if (wrote == 0) return ERIAK_WRITE;
+        if (wrote <= 0) return ERIAK_WRITE;
     }
 #ifdef _RIAK_DEBUG
     riak_connection *cxn = riak_operation_get_connection(rop);
@@ -0,0 +1,239 @@
+/*********************************************************************
+ *
+ * riak_2index_cursor.c: Paged Secondary Index queries
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_2index_cursor-internal.h"
+
+riak_error
+riak_2index_cursor_new(riak_connection             *cxn,
+                       riak_2index_cursor         **cursor_target,
+                       riak_binary                 *bucket,
+                       riak_binary                 *index,
+                       riak_2index_options         *opts,
+                       riak_uint32_t                page_size,
+                       riak_2index_stream_callback  cb,
+                       void                        *ptr) {
+    riak_config *cfg = riak_connection_get_config(cxn);
+    riak_2index_cursor *cursor = (riak_2index_cursor*)riak_config_clean_allocate(cfg, sizeof(riak_2index_cursor));
+    if (cursor == NULL) {
+        riak_log_critical(cxn, "%s", "Could not allocate a riak_2index_cursor");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    cursor->connection = cxn;
+    cursor->config     = cfg;
+    cursor->cb         = cb;
+    cursor->cb_data    = ptr;
+    cursor->options    = opts;
+    if (cursor->options == NULL) {
+        cursor->options = riak_2index_options_new(cfg);
+        cursor->owns_options = RIAK_TRUE;
+    }
+    cursor->bucket = riak_binary_copy(cfg, bucket);
+    cursor->index  = riak_binary_copy(cfg, index);
+    if (cursor->options == NULL || cursor->bucket == NULL || cursor->index == NULL) {
+        riak_2index_cursor_free(&cursor);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    // Only streamed responses end with a done flag
+    riak_2index_options_set_stream(cursor->options, RIAK_TRUE);
+    if (page_size > 0) {
+        riak_2index_options_set_max_results(cursor->options, page_size);
+    }
+
+    *cursor_target = cursor;
+    return ERIAK_OK;
+}
+
+static void
+riak_2index_cursor_discard_page(riak_2index_cursor *cursor) {
+    int i;
+    for(i = 0; i < cursor->n_page; i++) {
+        riak_2index_response_free(cursor->page_config, &(cursor->page[i]));
+    }
+    cursor->n_page      = 0;
+    cursor->page_failed = RIAK_FALSE;
+}
+
+/**
+ * @brief Stream callback; holds chunks until their page is complete
+ */
+static void
+riak_2index_cursor_collect(riak_2index_response *chunk,
+                           void                 *ptr) {
+    riak_2index_cursor *cursor = (riak_2index_cursor*)ptr;
+    if (riak_array_reserve(cursor->config,
+                           (void***)&(cursor->page),
+                           sizeof(riak_2index_response*),
+                           cursor->n_page,
+                           &(cursor->page_capacity),
+                           cursor->n_page+1) == NULL) {
+        cursor->page_failed = RIAK_TRUE;
+        riak_2index_response_free(cursor->rop_config, &chunk);
+        return;
+    }
+    cursor->page_config = cursor->rop_config;
+    cursor->page[cursor->n_page++] = chunk;
+}
+
+/**
+ * @brief Response callback; remembers where the next page starts
+ */
+static void
+riak_2index_cursor_page_done(void *response,
+                             void *ptr) {
+    riak_2index_cursor   *cursor  = (riak_2index_cursor*)ptr;
+    riak_2index_response *summary = (riak_2index_response*)response;
+    riak_binary_free(cursor->config, &(cursor->continuation));
+    if (riak_2index_get_has_continuation(summary)) {
+        cursor->continuation = riak_binary_copy(cursor->config, riak_2index_get_continuation(summary));
+        if (cursor->continuation == NULL) {
+            cursor->page_failed = RIAK_TRUE;
+        }
+    }
+    riak_2index_response_free(cursor->rop_config, &summary);
+}
+
+/**
+ * @brief Queue and write the request for the page at the current continuation
+ */
+static riak_error
+riak_2index_cursor_request(riak_2index_cursor *cursor) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cursor->connection, &rop, riak_2index_cursor_page_done, NULL, cursor);
+    if (err) {
+        return err;
+    }
+    err = riak_2index_request_encode(rop, cursor->bucket, cursor->index, cursor->options, &(rop->pb_request));
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    riak_2index_set_stream_cb(rop, riak_2index_cursor_collect, cursor);
+    // Chunks and summary come from the operation's allocator, maybe an arena
+    cursor->rop_config = riak_operation_get_config(rop);
+    riak_pipeline_send(rop);
+    cursor->in_flight = RIAK_TRUE;
+
+    return riak_pipeline_flush(cursor->connection);
+}
+
+riak_error
+riak_2index_cursor_next(riak_2index_cursor *cursor) {
+    if (cursor->done) {
+        return ERIAK_OK;
+    }
+    riak_error err;
+    if (!cursor->in_flight) {
+        err = riak_2index_cursor_request(cursor);
+        if (err) {
+            cursor->in_flight = RIAK_FALSE;
+            cursor->done = RIAK_TRUE;
+            return err;
+        }
+    }
+    err = riak_pipeline_receive(cursor->connection);
+    cursor->in_flight = RIAK_FALSE;
+    if (err == ERIAK_OK && cursor->page_failed) {
+        err = ERIAK_OUT_OF_MEMORY;
+    }
+    if (err) {
+        riak_2index_cursor_discard_page(cursor);
+        cursor->done = RIAK_TRUE;
+        return err;
+    }
+
+    // Prefetch: the next page is on its way while this one is consumed
+    if (cursor->continuation) {
+        err = riak_2index_options_set_continuation(cursor->config, cursor->options, cursor->continuation);
+        if (err == ERIAK_OK) {
+            err = riak_2index_cursor_request(cursor);
+        }
+        if (err) {
+            riak_2index_cursor_discard_page(cursor);
+            cursor->done = RIAK_TRUE;
+            return err;
+        }
+    } else {
+        cursor->done = RIAK_TRUE;
+    }
+
+    // Ownership of each chunk passes to the application
+    int i;
+    for(i = 0; i < cursor->n_page; i++) {
+        if (cursor->cb) {
+            (cursor->cb)(cursor->page[i], cursor->cb_data);
+        } else {
+            riak_2index_response_free(cursor->page_config, &(cursor->page[i]));
+        }
+    }
+    cursor->n_page = 0;
+    cursor->n_pages++;
+
+    return ERIAK_OK;
+}
+
+riak_error
+riak_2index_cursor_run(riak_2index_cursor *cursor) {
+    while (!cursor->done) {
+        riak_error err = riak_2index_cursor_next(cursor);
+        if (err) {
+            return err;
+        }
+    }
+    return ERIAK_OK;
+}
+
+riak_boolean_t
+riak_2index_cursor_get_done(riak_2index_cursor *cursor) {
+    return cursor->done;
+}
+
+riak_uint32_t
+riak_2index_cursor_get_n_pages(riak_2index_cursor *cursor) {
+    return cursor->n_pages;
+}
+
+void
+riak_2index_cursor_free(riak_2index_cursor **cursor_target) {
+    if (cursor_target == NULL || *cursor_target == NULL) return;
+    riak_2index_cursor *cursor = *cursor_target;
+    riak_config *cfg = cursor->config;
+
+    // A prefetched page still has to come off the wire to keep framing intact
+    if (cursor->in_flight) {
+        riak_pipeline_drain(cursor->connection);
+    }
+    riak_2index_cursor_discard_page(cursor);
+    riak_free(cfg, &(cursor->page));
+    riak_binary_free(cfg, &(cursor->continuation));
+    riak_binary_free(cfg, &(cursor->bucket));
+    riak_binary_free(cfg, &(cursor->index));
+    if (cursor->owns_options) {
+        riak_2index_options_free(cfg, &(cursor->options));
+    }
+    riak_free(cfg, cursor_target);
+}
@@ -0,0 +1,508 @@
+/*********************************************************************
+ *
+ * riak_aggregator.c: Local aggregation of legacy counter increments
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+// For pthread_rwlockattr_setkind_np
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_connection-internal.h"
+#include "riak_aggregator-internal.h"
+
+static riak_uint64_t
+riak_aggregator_hash(riak_binary *bucket,
+                     riak_binary *key) {
+    riak_uint64_t hash = riak_hash_bytes(riak_binary_data(bucket), riak_binary_len(bucket), RIAK_HASH_SEED);
+    return riak_hash_bytes(riak_binary_data(key), riak_binary_len(key), hash);
+}
+
+static riak_boolean_t
+riak_aggregator_entry_matches(riak_aggregator_entry *entry,
+                              riak_uint64_t          hash,
+                              riak_binary           *bucket,
+                              riak_binary           *key) {
+    return (entry->hash == hash &&
+            riak_binary_len(entry->bucket) == riak_binary_len(bucket) &&
+            riak_binary_len(entry->key) == riak_binary_len(key) &&
+            memcmp(riak_binary_data(entry->bucket), riak_binary_data(bucket), riak_binary_len(bucket)) == 0 &&
+            memcmp(riak_binary_data(entry->key), riak_binary_data(key), riak_binary_len(key)) == 0);
+}
+
+static void
+riak_aggregator_entry_free(riak_config            *cfg,
+                           riak_aggregator_entry **entry_target) {
+    riak_aggregator_entry *entry = *entry_target;
+    if (entry == NULL) return;
+    riak_binary_free(cfg, &(entry->bucket));
+    riak_binary_free(cfg, &(entry->key));
+    riak_free(cfg, entry_target);
+}
+
+static riak_error
+riak_aggregator_entry_new(riak_config            *cfg,
+                          riak_aggregator_entry **entry_target,
+                          riak_uint64_t           hash,
+                          riak_binary            *bucket,
+                          riak_binary            *key) {
+    riak_aggregator_entry *entry = (riak_aggregator_entry*)riak_config_clean_allocate(cfg, sizeof(riak_aggregator_entry));
+    if (entry == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    entry->hash   = hash;
+    entry->bucket = riak_binary_copy(cfg, bucket);
+    entry->key    = riak_binary_copy(cfg, key);
+    if (entry->bucket == NULL || entry->key == NULL) {
+        riak_aggregator_entry_free(cfg, &entry);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *entry_target = entry;
+    return ERIAK_OK;
+}
+
+riak_error
+riak_aggregator_new(riak_config                 *cfg,
+                    riak_aggregator            **agg_target,
+                    riak_connection_pool        *pool,
+                    riak_uint32_t                max_keys,
+                    riak_counter_update_options *opts) {
+    if (max_keys == 0 || max_keys > (1U << 30)) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_aggregator *agg = (riak_aggregator*)riak_config_clean_allocate(cfg, sizeof(riak_aggregator));
+    if (agg == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_aggregator");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    // Keeping the table at most half full keeps probes short and guarantees an empty slot
+    agg->n_slots = 2;
+    while (agg->n_slots < max_keys * 2) {
+        agg->n_slots <<= 1;
+    }
+    agg->slots = (riak_aggregator_entry**)riak_config_clean_allocate(cfg, sizeof(riak_aggregator_entry*) * agg->n_slots);
+    if (agg->slots == NULL) {
+        riak_free(cfg, &agg);
+        riak_log_critical_config(cfg, "%s", "Could not allocate aggregator slots");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    agg->sends = (riak_aggregator_send*)riak_config_clean_allocate(cfg, sizeof(riak_aggregator_send) * max_keys);
+    if (agg->sends == NULL) {
+        riak_free(cfg, &(agg->slots));
+        riak_free(cfg, &agg);
+        riak_log_critical_config(cfg, "%s", "Could not allocate aggregator sends");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    agg->config   = cfg;
+    agg->pool     = pool;
+    agg->max_keys = max_keys;
+    if (opts) {
+        agg->options = *opts;
+    }
+    pthread_mutex_init(&(agg->flush_lock), NULL);
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    // Otherwise a steady stream of increments would keep idle pairs forever
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&(agg->table_lock), &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pthread_mutex_init(&(agg->lock), NULL);
+    pthread_cond_init(&(agg->cond), NULL);
+
+    *agg_target = agg;
+    return ERIAK_OK;
+}
+
+void
+riak_aggregator_free(riak_aggregator **agg_target) {
+    riak_aggregator *agg = *agg_target;
+    if (agg == NULL) return;
+    riak_aggregator_stop(agg);
+    // Whatever has not reached Riak yet goes out now
+    riak_error err = riak_aggregator_flush(agg);
+    if (err) {
+        riak_log_error_config(agg->config, "Final flush failed, increments lost: %s", riak_strerror(err));
+    }
+    riak_config *cfg = agg->config;
+    riak_uint32_t i;
+    for(i = 0; i < agg->n_slots; i++) {
+        riak_aggregator_entry_free(cfg, &(agg->slots[i]));
+    }
+    riak_free(cfg, &(agg->slots));
+    riak_free(cfg, &(agg->sends));
+    pthread_cond_destroy(&(agg->cond));
+    pthread_mutex_destroy(&(agg->lock));
+    pthread_rwlock_destroy(&(agg->table_lock));
+    pthread_mutex_destroy(&(agg->flush_lock));
+    riak_free(cfg, agg_target);
+}
+
+/**
+ * @brief Hand a flush to the background thread, or run it here when there is none
+ */
+static void
+riak_aggregator_request_flush(riak_aggregator *agg) {
+    pthread_mutex_lock(&(agg->lock));
+    riak_boolean_t running = agg->running;
+    if (running) {
+        agg->flush_requested = RIAK_TRUE;
+        pthread_cond_signal(&(agg->cond));
+    }
+    pthread_mutex_unlock(&(agg->lock));
+    if (!running) {
+        riak_error err = riak_aggregator_flush(agg);
+        if (err) {
+            riak_log_warn_config(agg->config, "Threshold flush failed: %s", riak_strerror(err));
+        }
+    }
+}
+
+riak_error
+riak_aggregator_increment(riak_aggregator *agg,
+                          riak_binary     *bucket,
+                          riak_binary     *key,
+                          riak_int64_t     amount) {
+    riak_uint64_t hash = riak_aggregator_hash(bucket, key);
+    riak_uint32_t mask = agg->n_slots - 1;
+    riak_uint32_t i    = (riak_uint32_t)hash & mask;
+    riak_aggregator_entry *fresh = NULL;
+    riak_error err = ERIAK_OK;
+    pthread_rwlock_rdlock(&(agg->table_lock));
+    for(;;) {
+        riak_aggregator_entry *entry = __atomic_load_n(&(agg->slots[i]), __ATOMIC_ACQUIRE);
+        if (entry == NULL) {
+            // Reserve room for the pair before publishing it
+            if (fresh == NULL) {
+                if (__atomic_add_fetch(&(agg->n_keys), 1, __ATOMIC_RELAXED) > agg->max_keys) {
+                    __atomic_sub_fetch(&(agg->n_keys), 1, __ATOMIC_RELAXED);
+                    pthread_rwlock_unlock(&(agg->table_lock));
+                    return ERIAK_AGGREGATOR_FULL;
+                }
+                err = riak_aggregator_entry_new(agg->config, &fresh, hash, bucket, key);
+                if (err) {
+                    __atomic_sub_fetch(&(agg->n_keys), 1, __ATOMIC_RELAXED);
+                    pthread_rwlock_unlock(&(agg->table_lock));
+                    return err;
+                }
+            }
+            // On failure `entry` is whatever another thread published here
+            if (__atomic_compare_exchange_n(&(agg->slots[i]), &entry, fresh, RIAK_FALSE,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                entry = fresh;
+                fresh = NULL;
+            }
+        }
+        if (riak_aggregator_entry_matches(entry, hash, bucket, key)) {
+            __atomic_fetch_add(&(entry->delta), amount, __ATOMIC_RELAXED);
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    // Another thread published the same pair first
+    if (fresh) {
+        riak_aggregator_entry_free(agg->config, &fresh);
+        __atomic_sub_fetch(&(agg->n_keys), 1, __ATOMIC_RELAXED);
+    }
+    // Released before a threshold flush, which may need the table exclusively
+    pthread_rwlock_unlock(&(agg->table_lock));
+
+    riak_uint64_t threshold = __atomic_load_n(&(agg->threshold), __ATOMIC_RELAXED);
+    if (threshold > 0) {
+        // The threshold may have been lowered below the count, so compare with >=;
+        // whoever resets the count is the one thread that asks for the flush
+        riak_uint64_t n_pending = __atomic_add_fetch(&(agg->n_pending), 1, __ATOMIC_RELAXED);
+        if (n_pending >= threshold &&
+            __atomic_compare_exchange_n(&(agg->n_pending), &n_pending, 0, RIAK_FALSE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            riak_aggregator_request_flush(agg);
+        }
+    }
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Drop pairs that stayed idle for a whole flush and rehash the rest
+ * @param agg Riak Aggregator (flush_lock held)
+ */
+static void
+riak_aggregator_reclaim(riak_aggregator *agg) {
+    riak_config *cfg = agg->config;
+    // Built up front so a failed allocation leaves the table untouched
+    riak_aggregator_entry **slots = (riak_aggregator_entry**)riak_config_clean_allocate(cfg, sizeof(riak_aggregator_entry*) * agg->n_slots);
+    if (slots == NULL) {
+        riak_log_warn_config(cfg, "%s", "Could not allocate slots to reclaim idle counters");
+        return;
+    }
+    riak_uint32_t mask   = agg->n_slots - 1;
+    riak_uint32_t n_keys = 0;
+    riak_uint32_t i;
+    pthread_rwlock_wrlock(&(agg->table_lock));
+    for(i = 0; i < agg->n_slots; i++) {
+        riak_aggregator_entry *entry = agg->slots[i];
+        if (entry == NULL) continue;
+        // An increment since the flush pass keeps the pair
+        if (entry->idle && entry->delta == 0) {
+            riak_aggregator_entry_free(cfg, &entry);
+            continue;
+        }
+        riak_uint32_t j = (riak_uint32_t)entry->hash & mask;
+        while (slots[j]) {
+            j = (j + 1) & mask;
+        }
+        slots[j] = entry;
+        n_keys++;
+    }
+    riak_aggregator_entry **old = agg->slots;
+    agg->slots  = slots;
+    agg->n_keys = n_keys;
+    pthread_rwlock_unlock(&(agg->table_lock));
+    riak_free(cfg, &old);
+}
+
+static void
+riak_aggregator_sent_cb(void *response,
+                        void *ptr) {
+    riak_aggregator_send *send = (riak_aggregator_send*)ptr;
+    riak_counter_update_response *reply = (riak_counter_update_response*)response;
+    send->answered = RIAK_TRUE;
+    riak_counter_update_response_free(send->config, &reply);
+}
+
+static void
+riak_aggregator_error_cb(void *response,
+                         void *ptr) {
+    riak_aggregator_send *send = (riak_aggregator_send*)ptr;
+    // Only a server error comes with a response; a lost connection has none
+    if (response) {
+        riak_error_response *err_response = (riak_error_response*)response;
+        send->answered = RIAK_TRUE;
+        send->rejected = RIAK_TRUE;
+        riak_free_error_response(send->config, &err_response);
+    }
+}
+
+/**
+ * @brief Queue one counter update on the flush's pipeline
+ * @returns Error code; nothing is queued on failure
+ */
+static riak_error
+riak_aggregator_queue(riak_aggregator      *agg,
+                      riak_connection      *cxn,
+                      riak_aggregator_send *send) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_operation_new(cxn, &rop, NULL, riak_aggregator_error_cb, send);
+    if (err) {
+        return err;
+    }
+    // The reply comes from the connection's arena when it has one
+    send->config   = riak_operation_get_config(rop);
+    send->answered = RIAK_FALSE;
+    send->rejected = RIAK_FALSE;
+    err = riak_async_register_counter_update(rop, send->entry->bucket, send->entry->key, send->amount,
+                                             &(agg->options), riak_aggregator_sent_cb);
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_pipeline_send(rop);
+}
+
+riak_error
+riak_aggregator_flush(riak_aggregator *agg) {
+    riak_connection *cxn = NULL;
+    riak_error result = ERIAK_OK;
+    riak_uint32_t n_idle = 0;
+    riak_uint32_t n_sent = 0;
+    riak_uint32_t i;
+
+    pthread_mutex_lock(&(agg->flush_lock));
+    __atomic_store_n(&(agg->n_pending), 0, __ATOMIC_RELAXED);
+    for(i = 0; i < agg->n_slots && n_sent < agg->max_keys; i++) {
+        riak_aggregator_entry *entry = __atomic_load_n(&(agg->slots[i]), __ATOMIC_ACQUIRE);
+        if (entry == NULL) continue;
+        // Increments landing after the swap wait for the next flush
+        riak_int64_t amount = __atomic_exchange_n(&(entry->delta), 0, __ATOMIC_ACQ_REL);
+        entry->idle = (amount == 0);
+        if (amount == 0) {
+            n_idle++;
+            continue;
+        }
+
+        riak_error err = ERIAK_OK;
+        if (cxn == NULL) {
+            err = riak_connection_pool_checkout(agg->pool, &cxn);
+        }
+        if (err == ERIAK_OK) {
+            riak_aggregator_send *send = &(agg->sends[n_sent]);
+            send->entry  = entry;
+            send->amount = amount;
+            err = riak_aggregator_queue(agg, cxn, send);
+        }
+        if (err) {
+            __atomic_fetch_add(&(entry->delta), amount, __ATOMIC_RELAXED);
+            result = err;
+            break;
+        }
+        n_sent++;
+    }
+
+    // Every update goes out together and the replies come back in the same order
+    riak_boolean_t lost = RIAK_FALSE;
+    if (n_sent > 0) {
+        riak_error err = riak_pipeline_drain(cxn);
+        for(i = 0; i < n_sent; i++) {
+            riak_aggregator_send *send = &(agg->sends[i]);
+            if (!send->answered) {
+                // Never answered, so it may not have been applied; try again next time
+                __atomic_fetch_add(&(send->entry->delta), send->amount, __ATOMIC_RELAXED);
+                lost = RIAK_TRUE;
+                if (result == ERIAK_OK) {
+                    result = (err == ERIAK_OK || err == ERIAK_SERVER_ERROR) ? ERIAK_READ : err;
+                }
+            } else if (send->rejected) {
+                // Sending the same update again would only be rejected again
+                char name[256];
+                riak_binary_print(send->entry->key, name, sizeof(name));
+                riak_log_error_config(agg->config, "Dropping %lld for counter %s rejected by the server",
+                                      (long long)send->amount, name);
+                if (result == ERIAK_OK) {
+                    result = ERIAK_SERVER_ERROR;
+                }
+            }
+        }
+    }
+    if (lost) {
+        riak_connection_pool_evict(agg->pool, &cxn);
+    } else if (cxn) {
+        riak_connection_pool_checkin(agg->pool, &cxn);
+    }
+    if (n_idle > 0) {
+        riak_aggregator_reclaim(agg);
+    }
+    pthread_mutex_unlock(&(agg->flush_lock));
+
+    return result;
+}
+
+void
+riak_aggregator_set_threshold(riak_aggregator *agg,
+                              riak_uint64_t    threshold) {
+    __atomic_store_n(&(agg->threshold), threshold, __ATOMIC_RELAXED);
+}
+
+static void*
+riak_aggregator_flush_loop(void *ptr) {
+    riak_aggregator *agg = (riak_aggregator*)ptr;
+
+    pthread_mutex_lock(&(agg->lock));
+    while (agg->running) {
+        if (!agg->flush_requested) {
+            struct timeval  now;
+            struct timespec wakeup;
+            gettimeofday(&now, NULL);
+            riak_uint64_t usecs = (riak_uint64_t)now.tv_usec + (riak_uint64_t)agg->interval * 1000;
+            wakeup.tv_sec  = now.tv_sec + (usecs / 1000000);
+            wakeup.tv_nsec = (usecs % 1000000) * 1000;
+            pthread_cond_timedwait(&(agg->cond), &(agg->lock), &wakeup);
+        }
+        if (!agg->running) break;
+        agg->flush_requested = RIAK_FALSE;
+        pthread_mutex_unlock(&(agg->lock));
+        riak_error err = riak_aggregator_flush(agg);
+        if (err) {
+            riak_log_warn_config(agg->config, "Background flush failed: %s", riak_strerror(err));
+        }
+        pthread_mutex_lock(&(agg->lock));
+    }
+    pthread_mutex_unlock(&(agg->lock));
+
+    return NULL;
+}
+
+riak_error
+riak_aggregator_start(riak_aggregator *agg,
+                      riak_uint32_t    interval_ms) {
+    pthread_mutex_lock(&(agg->lock));
+    if (agg->running) {
+        agg->interval = interval_ms;
+        pthread_mutex_unlock(&(agg->lock));
+        return ERIAK_OK;
+    }
+    agg->interval = interval_ms;
+    agg->running  = RIAK_TRUE;
+    pthread_mutex_unlock(&(agg->lock));
+
+    if (pthread_create(&(agg->thread), NULL, riak_aggregator_flush_loop, agg) != 0) {
+        pthread_mutex_lock(&(agg->lock));
+        agg->running = RIAK_FALSE;
+        pthread_mutex_unlock(&(agg->lock));
+        riak_log_critical_config(agg->config, "%s", "Could not start aggregator flush thread");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    return ERIAK_OK;
+}
+
+void
+riak_aggregator_stop(riak_aggregator *agg) {
+    pthread_mutex_lock(&(agg->lock));
+    if (!agg->running) {
+        pthread_mutex_unlock(&(agg->lock));
+        return;
+    }
+    agg->running = RIAK_FALSE;
+    pthread_cond_signal(&(agg->cond));
+    pthread_mutex_unlock(&(agg->lock));
+    pthread_join(agg->thread, NULL);
+}
+
+riak_int64_t
+riak_aggregator_get_pending(riak_aggregator *agg,
+                            riak_binary     *bucket,
+                            riak_binary     *key) {
+    riak_uint64_t hash = riak_aggregator_hash(bucket, key);
+    riak_uint32_t mask = agg->n_slots - 1;
+    riak_uint32_t i    = (riak_uint32_t)hash & mask;
+    riak_int64_t  result = 0;
+    pthread_rwlock_rdlock(&(agg->table_lock));
+    for(;;) {
+        riak_aggregator_entry *entry = __atomic_load_n(&(agg->slots[i]), __ATOMIC_ACQUIRE);
+        if (entry == NULL) {
+            break;
+        }
+        if (riak_aggregator_entry_matches(entry, hash, bucket, key)) {
+            result = __atomic_load_n(&(entry->delta), __ATOMIC_RELAXED);
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    pthread_rwlock_unlock(&(agg->table_lock));
+    return result;
+}
+
+riak_uint32_t
+riak_aggregator_get_n_keys(riak_aggregator *agg) {
+    return __atomic_load_n(&(agg->n_keys), __ATOMIC_RELAXED);
+}
@@ -25,6 +25,7 @@
 #include "riak_messages-internal.h"
 #include "riak_utils-internal.h"
 #include "riak_operation-internal.h"
+#include "riak_view-internal.h"
 
 riak_error
 riak_async_register_ping(riak_operation        *rop,
@@ -51,6 +52,30 @@ riak_async_register_get(riak_operation        *rop,
     return riak_get_request_encode(rop, bucket, key, get_options, &(rop->pb_request));
 }
 
+riak_error
+riak_async_register_get_prepared(riak_operation        *rop,
+                                 riak_get_template     *tmpl,
+                                 riak_binary           *key,
+                                 riak_response_callback cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_get_template_request_encode(rop, tmpl, key, &(rop->pb_request));
+}
+
+riak_error
+riak_async_register_get_lazy(riak_operation        *rop,
+                             riak_binary           *bucket,
+                             riak_binary           *key,
+                             riak_get_options      *get_options,
+                             riak_response_callback cb) {
+    riak_operation_set_response_cb(rop, cb);
+    riak_error err = riak_get_request_encode(rop, bucket, key, get_options, &(rop->pb_request));
+    if (err == ERIAK_OK) {
+        riak_operation_set_response_decoder(rop, (riak_response_decoder)riak_get_view_decode);
+        riak_operation_set_response_free(rop, (riak_response_free_fn)riak_get_view_free);
+    }
+    return err;
+}
+
 riak_error
 riak_async_register_put(riak_operation        *rop,
                         riak_object           *riak_obj,
@@ -70,6 +95,50 @@ riak_async_register_delete(riak_operation        *rop,
     return riak_delete_request_encode(rop, bucket, key, NULL, &(rop->pb_request));
 }
 
+riak_error
+riak_async_register_dt_fetch(riak_operation        *rop,
+                             riak_binary           *bucket_type,
+                             riak_binary           *bucket,
+                             riak_binary           *key,
+                             riak_dt_fetch_options *options,
+                             riak_response_callback cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_dt_fetch_request_encode(rop, bucket_type, bucket, key, options, &(rop->pb_request));
+}
+
+riak_error
+riak_async_register_dt_update(riak_operation         *rop,
+                              riak_binary            *bucket_type,
+                              riak_binary            *bucket,
+                              riak_binary            *key,
+                              riak_dt_op             *op,
+                              riak_dt_update_options *options,
+                              riak_response_callback  cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_dt_update_request_encode(rop, bucket_type, bucket, key, op, options, &(rop->pb_request));
+}
+
+riak_error
+riak_async_register_counter_update(riak_operation              *rop,
+                                   riak_binary                 *bucket,
+                                   riak_binary                 *key,
+                                   riak_int64_t                 amount,
+                                   riak_counter_update_options *options,
+                                   riak_response_callback       cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_counter_update_request_encode(rop, bucket, key, amount, options, &(rop->pb_request));
+}
+
+riak_error
+riak_async_register_counter_get(riak_operation           *rop,
+                                riak_binary              *bucket,
+                                riak_binary              *key,
+                                riak_counter_get_options *options,
+                                riak_response_callback    cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_counter_get_request_encode(rop, bucket, key, options, &(rop->pb_request));
+}
+
 riak_error
 riak_async_register_listbuckets(riak_operation        *rop,
                                 riak_response_callback cb) {
@@ -132,7 +201,14 @@ riak_async_register_mapreduce(riak_operation        *rop,
                               riak_binary           *map_request,
                               riak_boolean_t         streaming,
                               riak_response_callback cb) {
+    // Streamed results can only go to a stream callback
+    if (streaming && rop->stream_cb == NULL) {
+        return ERIAK_UNINITIALIZED;
+    }
     riak_operation_set_response_cb(rop, cb);
+    if (!streaming) {
+        riak_mapreduce_set_stream_cb(rop, NULL, NULL);
+    }
     return riak_mapreduce_request_encode(rop, content_type, map_request, &(rop->pb_request));
 }
 
@@ -146,6 +222,16 @@ riak_async_register_2index(riak_operation        *rop,
     return riak_2index_request_encode(rop, bucket, index, index_options, &(rop->pb_request));
 }
 
+riak_error
+riak_async_register_csbucket(riak_operation        *rop,
+                             riak_binary           *bucket,
+                             riak_binary           *start_key,
+                             riak_csbucket_options *options,
+                             riak_response_callback cb) {
+    riak_operation_set_response_cb(rop, cb);
+    return riak_csbucket_request_encode(rop, bucket, start_key, options, &(rop->pb_request));
+}
+
 riak_error
 riak_async_register_search(riak_operation      *rop,
                            riak_binary         *bucket,
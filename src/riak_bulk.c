@@ -0,0 +1,315 @@
+/*********************************************************************
+ *
+ * riak_bulk.c: Load many objects over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_connection_pool-internal.h"
+#include "riak_bulk-internal.h"
+
+void
+riak_bulk_options_init(riak_bulk_options *opts) {
+    memset((void*)opts, '\0', sizeof(riak_bulk_options));
+    opts->concurrency  = RIAK_BULK_DEFAULT_CONCURRENCY;
+    opts->window       = RIAK_BULK_DEFAULT_WINDOW;
+    opts->retries      = RIAK_BULK_DEFAULT_RETRIES;
+    opts->backoff_base = RIAK_CONNECTION_DEFAULT_BACKOFF_BASE;
+    opts->backoff_max  = RIAK_CONNECTION_DEFAULT_BACKOFF_MAX;
+}
+
+/**
+ * @brief Top up the window from the source; the window bounds memory use
+ * @returns Number of occupied slots
+ */
+static riak_uint32_t
+riak_bulk_fill(riak_bulk_worker *worker) {
+    riak_bulk_load_state *state = worker->state;
+    riak_config          *cfg   = state->pool->config;
+    pthread_mutex_lock(&(state->lock));
+    while (worker->n_slots < state->options.window && !state->exhausted) {
+        riak_object  *object = NULL;
+        riak_uint64_t start  = riak_get_time_us();
+        riak_error    err    = (state->source)(cfg, &object, state->source_data);
+        state->stats.read_us += riak_get_time_us() - start;
+        if (err || object == NULL) {
+            if (err && state->result == ERIAK_OK) {
+                state->result = err;
+            }
+            state->exhausted = RIAK_TRUE;
+            break;
+        }
+        riak_bulk_slot *slot = &(worker->slots[worker->n_slots++]);
+        slot->object   = object;
+        slot->attempts = 0;
+    }
+    pthread_mutex_unlock(&(state->lock));
+    return worker->n_slots;
+}
+
+static void
+riak_bulk_response_cb(void *response,
+                      void *ptr) {
+    riak_bulk_slot    *slot = (riak_bulk_slot*)ptr;
+    riak_put_response *put  = (riak_put_response*)response;
+    riak_put_response_free(slot->config, &put);
+}
+
+/**
+ * @brief Put every slot in the window over one connection
+ * @returns Error that made the connection unusable, if any
+ */
+static riak_error
+riak_bulk_store(riak_bulk_worker *worker,
+                riak_uint64_t    *encode_us,
+                riak_uint64_t    *network_us) {
+    riak_bulk_load_state *state = worker->state;
+    riak_error err = ERIAK_OK;
+    riak_uint32_t i;
+    for(i = 0; i < worker->n_slots; i++) {
+        worker->slots[i].sent   = RIAK_FALSE;
+        worker->slots[i].result = ERIAK_OK;
+    }
+    if (worker->cxn == NULL) {
+        // Someone outside the load may hold a connection for a while
+        err = riak_connection_pool_checkout_wait(state->pool, &(worker->cxn), RIAK_CONNECTION_POOL_DEFAULT_WAIT_MS);
+        if (err) {
+            for(i = 0; i < worker->n_slots; i++) {
+                worker->slots[i].result = err;
+            }
+            return err;
+        }
+    }
+
+    riak_uint64_t start = riak_get_time_us();
+    for(i = 0; i < worker->n_slots; i++) {
+        riak_bulk_slot *slot = &(worker->slots[i]);
+        riak_operation *rop  = NULL;
+        slot->result = riak_operation_new(worker->cxn, &rop, riak_bulk_response_cb, NULL, slot);
+        if (slot->result == ERIAK_OK) {
+            // The reply comes from the operation's config, which may be an arena
+            slot->config = riak_operation_get_config(rop);
+            slot->result = riak_put_request_encode(rop, slot->object, state->put_opts, &(rop->pb_request));
+            if (slot->result) {
+                riak_operation_free(&rop);
+            }
+        }
+        if (slot->result == ERIAK_OK) {
+            riak_pipeline_send(rop);
+            slot->sent = RIAK_TRUE;
+        }
+    }
+    *encode_us += riak_get_time_us() - start;
+
+    start = riak_get_time_us();
+    err = riak_pipeline_flush(worker->cxn);
+    for(i = 0; i < worker->n_slots; i++) {
+        riak_bulk_slot *slot = &(worker->slots[i]);
+        if (!slot->sent) continue;
+        // Replies that never arrived share the connection's fate
+        if (err) {
+            slot->result = err;
+            continue;
+        }
+        slot->result = riak_pipeline_receive(worker->cxn);
+        // Server errors still leave the connection in step
+        if (slot->result != ERIAK_OK && slot->result != ERIAK_SERVER_ERROR) {
+            err = slot->result;
+        }
+    }
+    *network_us += riak_get_time_us() - start;
+    return err;
+}
+
+static void*
+riak_bulk_work(void *ptr) {
+    riak_bulk_worker     *worker = (riak_bulk_worker*)ptr;
+    riak_bulk_load_state *state  = worker->state;
+    riak_config          *cfg    = state->pool->config;
+    while (riak_bulk_fill(worker) > 0) {
+        riak_uint64_t encode_us  = 0;
+        riak_uint64_t network_us = 0;
+        riak_error err = riak_bulk_store(worker, &encode_us, &network_us);
+        if (err) {
+            riak_connection_pool_evict(state->pool, &(worker->cxn));
+        }
+
+        // Keep what failed at the front of the window for another attempt
+        riak_uint64_t n_stored   = 0;
+        riak_uint64_t n_failed   = 0;
+        riak_uint64_t n_retries  = 0;
+        riak_uint32_t n_kept     = 0;
+        riak_uint32_t max_tries  = 0;
+        riak_error    first_fail = ERIAK_OK;
+        riak_uint32_t i;
+        for(i = 0; i < worker->n_slots; i++) {
+            riak_bulk_slot slot = worker->slots[i];
+            riak_error result = slot.result;
+            if (result == ERIAK_OK) {
+                riak_object_free(cfg, &(slot.object));
+                n_stored++;
+                continue;
+            }
+            slot.attempts++;
+            // A precondition that failed once will fail every time
+            riak_boolean_t final = (result == ERIAK_SERVER_ERROR && state->conditional);
+            if (final || slot.attempts > state->options.retries) {
+                riak_object_free(cfg, &(slot.object));
+                if (first_fail == ERIAK_OK) first_fail = result;
+                n_failed++;
+                continue;
+            }
+            if (slot.attempts > max_tries) max_tries = slot.attempts;
+            worker->slots[n_kept++] = slot;
+            n_retries++;
+        }
+        worker->n_slots = n_kept;
+
+        pthread_mutex_lock(&(state->lock));
+        state->stats.n_stored   += n_stored;
+        state->stats.n_failed   += n_failed;
+        state->stats.n_retries  += n_retries;
+        state->stats.encode_us  += encode_us;
+        state->stats.network_us += network_us;
+        if (first_fail && state->result == ERIAK_OK) {
+            state->result = first_fail;
+        }
+        pthread_mutex_unlock(&(state->lock));
+
+        if (max_tries > 0) {
+            riak_sleep_ms(riak_backoff_ms(max_tries - 1, state->options.backoff_base, state->options.backoff_max));
+        }
+    }
+    riak_connection_pool_checkin(state->pool, &(worker->cxn));
+    return NULL;
+}
+
+riak_error
+riak_bulk_load(riak_connection_pool *pool,
+               riak_put_options     *put_opts,
+               riak_bulk_options    *opts,
+               riak_bulk_source      source,
+               void                 *ptr,
+               riak_bulk_stats      *stats) {
+    riak_config *cfg = pool->config;
+    if (stats) {
+        memset((void*)stats, '\0', sizeof(riak_bulk_stats));
+    }
+    riak_bulk_load_state state;
+    memset((void*)&state, '\0', sizeof(state));
+    if (opts) {
+        state.options = *opts;
+    } else {
+        riak_bulk_options_init(&(state.options));
+    }
+    if (state.options.window == 0) {
+        state.options.window = 1;
+    }
+    if (state.options.concurrency == 0) {
+        state.options.concurrency = 1;
+    }
+    // Workers beyond the pool's size would only fight over its connections
+    if (state.options.concurrency > pool->max_connections) {
+        state.options.concurrency = pool->max_connections;
+    }
+    state.conditional = (put_opts &&
+                         ((riak_put_options_get_has_if_none_match(put_opts) && riak_put_options_get_if_none_match(put_opts)) ||
+                          (riak_put_options_get_has_if_not_modified(put_opts) && riak_put_options_get_if_not_modified(put_opts))));
+    state.pool        = pool;
+    state.put_opts    = put_opts;
+    state.source      = source;
+    state.source_data = ptr;
+
+    riak_uint32_t n_workers = state.options.concurrency;
+    riak_bulk_worker *workers = (riak_bulk_worker*)riak_config_clean_allocate(cfg, sizeof(riak_bulk_worker) * n_workers);
+    if (workers == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate bulk load workers");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_uint32_t i;
+    for(i = 0; i < n_workers; i++) {
+        workers[i].state = &state;
+        workers[i].slots = (riak_bulk_slot*)riak_config_clean_allocate(cfg, sizeof(riak_bulk_slot) * state.options.window);
+        if (workers[i].slots == NULL) {
+            for(; i > 0; i--) {
+                riak_free(cfg, &(workers[i-1].slots));
+            }
+            riak_free(cfg, &workers);
+            riak_log_critical_config(cfg, "%s", "Could not allocate bulk load windows");
+            return ERIAK_OUT_OF_MEMORY;
+        }
+    }
+    pthread_mutex_init(&(state.lock), NULL);
+
+    // The calling thread is worker 0; the rest get their own threads
+    riak_uint64_t start = riak_get_time_ms();
+    riak_uint32_t n_started = 1;
+    for(i = 1; i < n_workers; i++) {
+        if (pthread_create(&(workers[i].thread), NULL, riak_bulk_work, &workers[i]) != 0) {
+            riak_log_warn_config(cfg, "Running bulk load with %d workers", n_started);
+            break;
+        }
+        n_started++;
+    }
+    riak_bulk_work(&workers[0]);
+    for(i = 1; i < n_started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    state.stats.elapsed_ms = riak_get_time_ms() - start;
+    if (state.stats.elapsed_ms > 0) {
+        state.stats.objects_per_sec = (riak_float64_t)state.stats.n_stored * 1000.0 / state.stats.elapsed_ms;
+    }
+
+    pthread_mutex_destroy(&(state.lock));
+    for(i = 0; i < n_workers; i++) {
+        riak_free(cfg, &(workers[i].slots));
+    }
+    riak_free(cfg, &workers);
+    if (stats) {
+        *stats = state.stats;
+    }
+    return state.result;
+}
+
+void
+riak_bulk_stats_print(riak_bulk_stats *stats,
+                      char            *target,
+                      riak_size_t      len) {
+    riak_uint64_t n_attempts = stats->n_stored + stats->n_failed + stats->n_retries;
+    if (n_attempts == 0) {
+        n_attempts = 1;
+    }
+    snprintf(target, len,
+             "Stored: %llu\nFailed: %llu\nRetries: %llu\n"
+             "Elapsed: %llu ms\nThroughput: %.1f objects/s\n"
+             "Read: %.1f us/object\nEncode: %.1f us/object\nNetwork: %.1f us/object\n",
+             (unsigned long long)stats->n_stored,
+             (unsigned long long)stats->n_failed,
+             (unsigned long long)stats->n_retries,
+             (unsigned long long)stats->elapsed_ms,
+             stats->objects_per_sec,
+             (riak_float64_t)stats->read_us / n_attempts,
+             (riak_float64_t)stats->encode_us / n_attempts,
+             (riak_float64_t)stats->network_us / n_attempts);
+}
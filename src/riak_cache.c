@@ -0,0 +1,475 @@
+/*********************************************************************
+ *
+ * riak_cache.c: Client-side read-through object cache
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_view-internal.h"
+#include "riak_cache-internal.h"
+
+static riak_uint64_t
+riak_cache_hash(riak_binary *bucket,
+                riak_binary *key) {
+    riak_uint64_t hash = riak_hash_bytes(riak_binary_data(bucket), riak_binary_len(bucket), RIAK_HASH_SEED);
+    return riak_hash_bytes(riak_binary_data(key), riak_binary_len(key), hash);
+}
+
+static riak_cache_shard*
+riak_cache_shard_for(riak_cache   *cache,
+                     riak_uint64_t hash) {
+    // The low bits pick the hash bucket, so shard on the high ones
+    return &(cache->shards[(hash >> 32) % cache->n_shards]);
+}
+
+static riak_boolean_t
+riak_cache_binary_equal(riak_binary *a,
+                        riak_binary *b) {
+    return (riak_binary_len(a) == riak_binary_len(b) &&
+            memcmp(riak_binary_data(a), riak_binary_data(b), riak_binary_len(a)) == 0);
+}
+
+static riak_cache_entry*
+riak_cache_find(riak_cache_shard *shard,
+                riak_uint64_t     hash,
+                riak_binary      *bucket,
+                riak_binary      *key) {
+    riak_cache_entry *entry = shard->buckets[hash & (shard->n_buckets - 1)];
+    for(; entry != NULL; entry = entry->chain) {
+        if (entry->hash == hash &&
+            riak_cache_binary_equal(&(entry->bucket), bucket) &&
+            riak_cache_binary_equal(&(entry->key), key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void
+riak_cache_unlink_recency(riak_cache_shard *shard,
+                          riak_cache_entry *entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        shard->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        shard->oldest = entry->newer;
+    }
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void
+riak_cache_link_newest(riak_cache_shard *shard,
+                       riak_cache_entry *entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest) {
+        shard->newest->newer = entry;
+    } else {
+        shard->oldest = entry;
+    }
+    shard->newest = entry;
+}
+
+static void
+riak_cache_touch(riak_cache_shard *shard,
+                 riak_cache_entry *entry) {
+    if (shard->newest == entry) return;
+    riak_cache_unlink_recency(shard, entry);
+    riak_cache_link_newest(shard, entry);
+}
+
+static void
+riak_cache_remove(riak_config      *cfg,
+                  riak_cache_shard *shard,
+                  riak_cache_entry *entry) {
+    riak_cache_entry **link = &(shard->buckets[entry->hash & (shard->n_buckets - 1)]);
+    while (*link != entry) {
+        link = &((*link)->chain);
+    }
+    *link = entry->chain;
+    riak_cache_unlink_recency(shard, entry);
+    shard->n_entries--;
+    shard->n_bytes -= entry->size;
+    riak_free(cfg, &entry);
+}
+
+static void
+riak_cache_insert(riak_cache_shard *shard,
+                  riak_cache_entry *entry) {
+    riak_cache_entry **head = &(shard->buckets[entry->hash & (shard->n_buckets - 1)]);
+    entry->chain = *head;
+    *head = entry;
+    riak_cache_link_newest(shard, entry);
+    shard->n_entries++;
+    shard->n_bytes += entry->size;
+}
+
+static riak_error
+riak_cache_entry_new(riak_config       *cfg,
+                     riak_cache_entry **entry_target,
+                     riak_uint64_t      hash,
+                     riak_binary       *bucket,
+                     riak_binary       *key,
+                     riak_get_view     *view) {
+    riak_size_t bucket_len = riak_binary_len(bucket);
+    riak_size_t key_len    = riak_binary_len(key);
+    riak_size_t size       = sizeof(riak_cache_entry) + bucket_len + key_len + view->len;
+    riak_cache_entry *entry = (riak_cache_entry*)riak_config_allocate(cfg, size);
+    if (entry == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    memset((void*)entry, '\0', sizeof(riak_cache_entry));
+    riak_uint8_t *bytes = (riak_uint8_t*)(entry + 1);
+    entry->hash = hash;
+    entry->size = size;
+    entry->bucket.data = bytes;
+    entry->bucket.len  = bucket_len;
+    memcpy((void*)bytes, (void*)riak_binary_data(bucket), bucket_len);
+    bytes += bucket_len;
+    entry->key.data = bytes;
+    entry->key.len  = key_len;
+    memcpy((void*)bytes, (void*)riak_binary_data(key), key_len);
+    bytes += key_len;
+    entry->data = bytes;
+    entry->len  = view->len;
+    memcpy((void*)bytes, (void*)view->data, view->len);
+    if (view->has_vclock) {
+        entry->has_vclock  = RIAK_TRUE;
+        entry->vclock.data = entry->data + (view->vclock.data - view->data);
+        entry->vclock.len  = view->vclock.len;
+    }
+    entry->fetched = riak_get_time_ms();
+    *entry_target = entry;
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Keep a freshly fetched object, or forget the key if it was not found
+ */
+static void
+riak_cache_fill(riak_cache    *cache,
+                riak_uint64_t  generation,
+                riak_uint64_t  hash,
+                riak_binary   *bucket,
+                riak_binary   *key,
+                riak_get_view *view) {
+    riak_config *cfg = cache->config;
+    riak_cache_shard *shard = riak_cache_shard_for(cache, hash);
+    riak_cache_entry *fresh = NULL;
+    // Tombstones and misses are not kept; neither is anything too big for the shard
+    if (view->n_content > 0 &&
+        sizeof(riak_cache_entry) + riak_binary_len(bucket) + riak_binary_len(key) + view->len <= cache->shard_bytes) {
+        riak_cache_entry_new(cfg, &fresh, hash, bucket, key, view);
+    }
+
+    pthread_mutex_lock(&(shard->lock));
+    riak_cache_entry *entry = riak_cache_find(shard, hash, bucket, key);
+    if (entry) {
+        riak_cache_remove(cfg, shard, entry);
+    }
+    // An invalidation raced with this fetch, so the object may already be out of date
+    if (fresh && shard->generation == generation) {
+        while (shard->oldest &&
+               (shard->n_entries + 1 > cache->shard_entries ||
+                shard->n_bytes + fresh->size > cache->shard_bytes)) {
+            riak_cache_remove(cfg, shard, shard->oldest);
+        }
+        riak_cache_insert(shard, fresh);
+        fresh = NULL;
+    }
+    pthread_mutex_unlock(&(shard->lock));
+    riak_free(cfg, &fresh);
+}
+
+riak_error
+riak_cache_new(riak_config   *cfg,
+               riak_cache   **cache_target,
+               riak_uint32_t  n_shards,
+               riak_uint32_t  max_entries,
+               riak_size_t    max_bytes,
+               riak_uint32_t  ttl_ms) {
+    if (n_shards == 0 || max_entries < n_shards || max_entries > (1U << 30)) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_cache *cache = (riak_cache*)riak_config_clean_allocate(cfg, sizeof(riak_cache));
+    if (cache == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_cache");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    cache->config        = cfg;
+    cache->n_shards      = n_shards;
+    cache->shard_entries = max_entries / n_shards;
+    cache->shard_bytes   = max_bytes / n_shards;
+    cache->ttl           = ttl_ms;
+    cache->shards = (riak_cache_shard*)riak_config_clean_allocate(cfg, sizeof(riak_cache_shard) * n_shards);
+    if (cache->shards == NULL) {
+        riak_free(cfg, &cache);
+        riak_log_critical_config(cfg, "%s", "Could not allocate cache shards");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    // Chains average at most one entry when a shard is full
+    riak_uint32_t n_buckets = 1;
+    while (n_buckets < cache->shard_entries) {
+        n_buckets <<= 1;
+    }
+    riak_uint32_t i;
+    for(i = 0; i < n_shards; i++) {
+        riak_cache_shard *shard = &(cache->shards[i]);
+        shard->n_buckets = n_buckets;
+        shard->buckets = (riak_cache_entry**)riak_config_clean_allocate(cfg, sizeof(riak_cache_entry*) * n_buckets);
+        if (shard->buckets == NULL) {
+            cache->n_shards = i;
+            riak_cache_free(&cache);
+            riak_log_critical_config(cfg, "%s", "Could not allocate cache buckets");
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        pthread_mutex_init(&(shard->lock), NULL);
+    }
+
+    *cache_target = cache;
+    return ERIAK_OK;
+}
+
+void
+riak_cache_free(riak_cache **cache_target) {
+    riak_cache *cache = *cache_target;
+    if (cache == NULL) return;
+    riak_config *cfg = cache->config;
+    riak_uint32_t i;
+    for(i = 0; i < cache->n_shards; i++) {
+        riak_cache_shard *shard = &(cache->shards[i]);
+        while (shard->oldest) {
+            riak_cache_remove(cfg, shard, shard->oldest);
+        }
+        riak_free(cfg, &(shard->buckets));
+        pthread_mutex_destroy(&(shard->lock));
+    }
+    riak_free(cfg, &(cache->shards));
+    riak_free(cfg, cache_target);
+}
+
+/**
+ * @brief Hand back the cached copy as a response of its own
+ */
+static riak_error
+riak_cache_entry_to_response(riak_config        *cfg,
+                             riak_cache_entry   *entry,
+                             riak_get_response **response) {
+    riak_get_view *view = NULL;
+    riak_error err = riak_get_view_new(cfg, &view, &(entry->bucket), &(entry->key), entry->data, entry->len);
+    if (err) {
+        return err;
+    }
+    return riak_get_response_new_from_view(cfg, &view, response);
+}
+
+/**
+ * @brief Move a fetched view into the cache's allocator
+ * @note Fetches come from the connection's arena when one is set, which
+ * the caller cannot free responses with, so such views are copied out
+ */
+static riak_error
+riak_cache_adopt_view(riak_config    *cfg,
+                      riak_binary    *bucket,
+                      riak_binary    *key,
+                      riak_get_view **view_target) {
+    riak_get_view *view = *view_target;
+    if (view->config == cfg) {
+        return ERIAK_OK;
+    }
+    riak_get_view *copy = NULL;
+    riak_error err = riak_get_view_new(cfg, &copy, bucket, key, view->data, view->len);
+    riak_get_view_free(view->config, view_target);
+    *view_target = copy;
+    return err;
+}
+
+riak_error
+riak_cache_get(riak_connection    *cxn,
+               riak_cache         *cache,
+               riak_binary        *bucket,
+               riak_binary        *key,
+               riak_get_options   *opts,
+               riak_get_response **response) {
+    // Partial or conditional fetches are not what the cache holds
+    if (opts && ((opts->has_head && opts->head) || opts->has_if_modified)) {
+        return riak_get(cxn, bucket, key, opts, response);
+    }
+    riak_config *cfg = cache->config;
+    riak_uint64_t hash = riak_cache_hash(bucket, key);
+    riak_cache_shard *shard = riak_cache_shard_for(cache, hash);
+    riak_binary *vclock = NULL;
+    riak_error err = ERIAK_OK;
+
+    pthread_mutex_lock(&(shard->lock));
+    riak_uint64_t generation = shard->generation;
+    riak_cache_entry *entry = riak_cache_find(shard, hash, bucket, key);
+    if (entry) {
+        if (riak_get_time_ms() - entry->fetched < cache->ttl) {
+            riak_cache_touch(shard, entry);
+            err = riak_cache_entry_to_response(cfg, entry, response);
+            pthread_mutex_unlock(&(shard->lock));
+            if (err == ERIAK_OK) {
+                __atomic_add_fetch(&(cache->hits), 1, __ATOMIC_RELAXED);
+            }
+            return err;
+        }
+        if (entry->has_vclock) {
+            vclock = riak_binary_copy(cfg, &(entry->vclock));
+        }
+    }
+    pthread_mutex_unlock(&(shard->lock));
+
+    riak_get_view *view = NULL;
+    if (vclock) {
+        riak_get_options revalidate;
+        if (opts) {
+            revalidate = *opts;
+        } else {
+            memset((void*)&revalidate, '\0', sizeof(revalidate));
+        }
+        revalidate.has_if_modified = RIAK_TRUE;
+        revalidate.if_modified     = vclock;
+        err = riak_get_lazy(cxn, bucket, key, &revalidate, &view);
+        if (err == ERIAK_OK && view->has_unmodified && view->unmodified) {
+            riak_get_view_free(view->config, &view);
+            pthread_mutex_lock(&(shard->lock));
+            // The copy may have been evicted or replaced while the request was out
+            entry = riak_cache_find(shard, hash, bucket, key);
+            if (entry && entry->has_vclock && riak_cache_binary_equal(&(entry->vclock), vclock)) {
+                entry->fetched = riak_get_time_ms();
+                riak_cache_touch(shard, entry);
+                err = riak_cache_entry_to_response(cfg, entry, response);
+                pthread_mutex_unlock(&(shard->lock));
+                riak_binary_free(cfg, &vclock);
+                if (err == ERIAK_OK) {
+                    __atomic_add_fetch(&(cache->revalidated), 1, __ATOMIC_RELAXED);
+                }
+                return err;
+            }
+            pthread_mutex_unlock(&(shard->lock));
+        }
+        riak_binary_free(cfg, &vclock);
+        if (err) {
+            return err;
+        }
+    }
+    if (view == NULL) {
+        err = riak_get_lazy(cxn, bucket, key, opts, &view);
+        if (err) {
+            return err;
+        }
+    }
+    err = riak_cache_adopt_view(cfg, bucket, key, &view);
+    if (err) {
+        return err;
+    }
+    __atomic_add_fetch(&(cache->misses), 1, __ATOMIC_RELAXED);
+    riak_cache_fill(cache, generation, hash, bucket, key, view);
+
+    return riak_get_response_new_from_view(cfg, &view, response);
+}
+
+riak_error
+riak_cache_put(riak_connection    *cxn,
+               riak_cache         *cache,
+               riak_object        *obj,
+               riak_put_options   *opts,
+               riak_put_response **response) {
+    riak_error err = riak_put(cxn, obj, opts, response);
+    // Even a failed store may have reached some replicas
+    if (riak_object_get_has_key(obj)) {
+        riak_cache_invalidate(cache, riak_object_get_bucket(obj), riak_object_get_key(obj));
+    }
+    return err;
+}
+
+riak_error
+riak_cache_delete(riak_connection     *cxn,
+                  riak_cache          *cache,
+                  riak_binary         *bucket,
+                  riak_binary         *key,
+                  riak_delete_options *opts) {
+    riak_error err = riak_delete(cxn, bucket, key, opts);
+    riak_cache_invalidate(cache, bucket, key);
+    return err;
+}
+
+void
+riak_cache_invalidate(riak_cache  *cache,
+                      riak_binary *bucket,
+                      riak_binary *key) {
+    riak_uint64_t hash = riak_cache_hash(bucket, key);
+    riak_cache_shard *shard = riak_cache_shard_for(cache, hash);
+    pthread_mutex_lock(&(shard->lock));
+    shard->generation++;
+    riak_cache_entry *entry = riak_cache_find(shard, hash, bucket, key);
+    if (entry) {
+        riak_cache_remove(cache->config, shard, entry);
+    }
+    pthread_mutex_unlock(&(shard->lock));
+}
+
+riak_uint32_t
+riak_cache_get_n_entries(riak_cache *cache) {
+    riak_uint32_t total = 0;
+    riak_uint32_t i;
+    for(i = 0; i < cache->n_shards; i++) {
+        pthread_mutex_lock(&(cache->shards[i].lock));
+        total += cache->shards[i].n_entries;
+        pthread_mutex_unlock(&(cache->shards[i].lock));
+    }
+    return total;
+}
+
+riak_size_t
+riak_cache_get_n_bytes(riak_cache *cache) {
+    riak_size_t total = 0;
+    riak_uint32_t i;
+    for(i = 0; i < cache->n_shards; i++) {
+        pthread_mutex_lock(&(cache->shards[i].lock));
+        total += cache->shards[i].n_bytes;
+        pthread_mutex_unlock(&(cache->shards[i].lock));
+    }
+    return total;
+}
+
+riak_uint64_t
+riak_cache_get_hits(riak_cache *cache) {
+    return __atomic_load_n(&(cache->hits), __ATOMIC_RELAXED);
+}
+
+riak_uint64_t
+riak_cache_get_revalidated(riak_cache *cache) {
+    return __atomic_load_n(&(cache->revalidated), __ATOMIC_RELAXED);
+}
+
+riak_uint64_t
+riak_cache_get_misses(riak_cache *cache) {
+    return __atomic_load_n(&(cache->misses), __ATOMIC_RELAXED);
+}
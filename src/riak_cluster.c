@@ -0,0 +1,407 @@
+/*********************************************************************
+ *
+ * riak_cluster.c: Load balancing across several Riak nodes
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_connection-internal.h"
+#include "riak_connection_pool-internal.h"
+#include "riak_cluster-internal.h"
+
+riak_error
+riak_cluster_new(riak_config         *cfg,
+                 riak_cluster       **cluster_target,
+                 riak_cluster_policy  policy) {
+    riak_cluster *cluster = (riak_cluster*)riak_config_clean_allocate(cfg, sizeof(riak_cluster));
+    if (cluster == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_cluster");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    cluster->config         = cfg;
+    cluster->policy         = policy;
+    cluster->retry_interval = RIAK_CLUSTER_DEFAULT_RETRY_MS;
+    pthread_mutex_init(&(cluster->lock), NULL);
+
+    *cluster_target = cluster;
+    return ERIAK_OK;
+}
+
+void
+riak_cluster_free(riak_cluster **cluster_target) {
+    if (cluster_target == NULL || *cluster_target == NULL) return;
+    riak_cluster *cluster = *cluster_target;
+    riak_config  *cfg     = cluster->config;
+
+    riak_uint32_t i;
+    for(i = 0; i < cluster->n_nodes; i++) {
+        riak_connection_pool_free(&(cluster->nodes[i]->pool));
+        riak_free(cfg, &(cluster->nodes[i]));
+    }
+    pthread_mutex_destroy(&(cluster->lock));
+    riak_free(cfg, &(cluster->nodes));
+    riak_free(cfg, cluster_target);
+}
+
+riak_error
+riak_cluster_add_node(riak_cluster      *cluster,
+                      const char        *hostname,
+                      const char        *portnum,
+                      riak_addr_resolver resolver,
+                      riak_uint32_t      max_connections) {
+    riak_config *cfg = cluster->config;
+    riak_cluster_node *node = (riak_cluster_node*)riak_config_clean_allocate(cfg, sizeof(riak_cluster_node));
+    if (node == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = riak_connection_pool_new(cfg, &(node->pool), hostname, portnum, resolver, max_connections);
+    if (err) {
+        riak_free(cfg, &node);
+        return err;
+    }
+
+    pthread_mutex_lock(&(cluster->lock));
+    riak_cluster_node **nodes = riak_config_clean_allocate(cfg, sizeof(riak_cluster_node*) * (cluster->n_nodes+1));
+    if (nodes == NULL) {
+        pthread_mutex_unlock(&(cluster->lock));
+        riak_connection_pool_free(&(node->pool));
+        riak_free(cfg, &node);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    if (cluster->n_nodes > 0) {
+        memcpy(nodes, cluster->nodes, sizeof(riak_cluster_node*) * cluster->n_nodes);
+    }
+    riak_free(cfg, &(cluster->nodes));
+    nodes[cluster->n_nodes++] = node;
+    cluster->nodes = nodes;
+    pthread_mutex_unlock(&(cluster->lock));
+
+    return ERIAK_OK;
+}
+
+void
+riak_cluster_set_retry_interval(riak_cluster *cluster,
+                                riak_uint32_t retry_ms) {
+    pthread_mutex_lock(&(cluster->lock));
+    cluster->retry_interval = retry_ms;
+    pthread_mutex_unlock(&(cluster->lock));
+}
+
+/**
+ * @brief Errors which say more about the node than about the request
+ */
+static riak_boolean_t
+riak_cluster_is_network_error(riak_error err) {
+    switch (err) {
+    case ERIAK_DNS_RESOLUTION:
+    case ERIAK_CONNECT:
+    case ERIAK_READ:
+    case ERIAK_WRITE:
+    case ERIAK_EVENT:
+    case ERIAK_NO_PING:
+    case ERIAK_TIMEOUT:
+        return RIAK_TRUE;
+    default:
+        return RIAK_FALSE;
+    }
+}
+
+/**
+ * @brief Pick the best node not yet tried, according to the cluster's policy
+ * @param cluster Riak Cluster (lock held)
+ * @param tried Flags for nodes to skip, one per node
+ * @returns Index of the chosen node, or -1 if none is eligible
+ */
+static riak_int32_t
+riak_cluster_choose(riak_cluster   *cluster,
+                    riak_boolean_t *tried) {
+    riak_uint64_t  now    = riak_get_time_ms();
+    riak_int32_t   chosen = -1;
+    riak_float64_t best   = 0;
+    riak_uint32_t  i;
+
+    // Start at the round-robin cursor so ties are spread evenly
+    for(i = 0; i < cluster->n_nodes; i++) {
+        riak_uint32_t      idx  = (cluster->next + i) % cluster->n_nodes;
+        riak_cluster_node *node = cluster->nodes[idx];
+        if (tried[idx] || node->down_until > now) {
+            continue;
+        }
+        riak_float64_t score;
+        switch (cluster->policy) {
+        case RIAK_CLUSTER_LEAST_OUTSTANDING:
+            score = node->outstanding;
+            break;
+        case RIAK_CLUSTER_LATENCY_WEIGHTED:
+            // Unmeasured nodes score lowest so each one gets sampled
+            score = (node->latency + 1.0) * (node->outstanding + 1);
+            break;
+        case RIAK_CLUSTER_ROUND_ROBIN:
+        default:
+            score = i;
+            break;
+        }
+        if (chosen < 0 || score < best) {
+            chosen = idx;
+            best   = score;
+        }
+    }
+    if (chosen >= 0) {
+        cluster->next = (chosen + 1) % cluster->n_nodes;
+    }
+    return chosen;
+}
+
+/**
+ * @brief Take a node out of rotation for the retry interval
+ * @param cluster Riak Cluster (lock held)
+ * @param node Failing node
+ */
+static void
+riak_cluster_mark_down(riak_cluster      *cluster,
+                       riak_cluster_node *node) {
+    node->failures++;
+    node->down_until = riak_get_time_ms() + cluster->retry_interval;
+    riak_log_warn_config(cluster->config, "Marking node %s:%s down after %d failures",
+                         node->pool->hostname, node->pool->portnum, node->failures);
+}
+
+/**
+ * @brief Checkout skipping (and then flagging) nodes already tried
+ * @param cluster Riak Cluster
+ * @param tried Flags for nodes to skip, one per node
+ * @param node_target Node the connection belongs to (out)
+ * @param cxn_target Checked-out Riak Connection (out)
+ * @returns Error code
+ */
+static riak_error
+riak_cluster_checkout_untried(riak_cluster       *cluster,
+                              riak_boolean_t     *tried,
+                              riak_cluster_node **node_target,
+                              riak_connection   **cxn_target) {
+    riak_error last_err = ERIAK_NO_NODES;
+    while (RIAK_TRUE) {
+        pthread_mutex_lock(&(cluster->lock));
+        riak_int32_t idx = riak_cluster_choose(cluster, tried);
+        if (idx < 0) {
+            pthread_mutex_unlock(&(cluster->lock));
+            return last_err;
+        }
+        riak_cluster_node *node = cluster->nodes[idx];
+        tried[idx] = RIAK_TRUE;
+        node->outstanding++;
+        pthread_mutex_unlock(&(cluster->lock));
+
+        riak_connection *cxn = NULL;
+        riak_error err = riak_connection_pool_checkout(node->pool, &cxn);
+        if (err == ERIAK_OK) {
+            cxn->checkout_time = riak_get_time_ms();
+            *node_target = node;
+            *cxn_target  = cxn;
+            return ERIAK_OK;
+        }
+        pthread_mutex_lock(&(cluster->lock));
+        node->outstanding--;
+        if (riak_cluster_is_network_error(err)) {
+            riak_cluster_mark_down(cluster, node);
+        }
+        pthread_mutex_unlock(&(cluster->lock));
+        last_err = err;
+    }
+}
+
+riak_error
+riak_cluster_checkout(riak_cluster       *cluster,
+                      riak_cluster_node **node,
+                      riak_connection   **cxn) {
+    pthread_mutex_lock(&(cluster->lock));
+    riak_uint32_t n_nodes = cluster->n_nodes;
+    pthread_mutex_unlock(&(cluster->lock));
+    if (n_nodes == 0) {
+        return ERIAK_NO_NODES;
+    }
+    riak_boolean_t *tried = (riak_boolean_t*)riak_config_clean_allocate(cluster->config, sizeof(riak_boolean_t) * n_nodes);
+    if (tried == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = riak_cluster_checkout_untried(cluster, tried, node, cxn);
+    riak_free(cluster->config, &tried);
+    return err;
+}
+
+void
+riak_cluster_checkin(riak_cluster      *cluster,
+                     riak_cluster_node *node,
+                     riak_connection  **cxn,
+                     riak_error         result) {
+    if (cxn == NULL || *cxn == NULL) return;
+    riak_uint64_t elapsed = riak_get_time_ms() - (*cxn)->checkout_time;
+    riak_boolean_t failed = riak_cluster_is_network_error(result);
+    if (failed) {
+        riak_connection_pool_evict(node->pool, cxn);
+    } else {
+        riak_connection_pool_checkin(node->pool, cxn);
+    }
+
+    pthread_mutex_lock(&(cluster->lock));
+    node->outstanding--;
+    if (failed) {
+        riak_cluster_mark_down(cluster, node);
+    } else {
+        node->failures   = 0;
+        node->down_until = 0;
+        if (node->latency == 0) {
+            node->latency = elapsed;
+        } else {
+            node->latency += RIAK_CLUSTER_EWMA_ALPHA * ((riak_float64_t)elapsed - node->latency);
+        }
+    }
+    pthread_mutex_unlock(&(cluster->lock));
+}
+
+riak_uint32_t
+riak_cluster_get_n_up(riak_cluster *cluster) {
+    riak_uint64_t now = riak_get_time_ms();
+    riak_uint32_t n_up = 0;
+    riak_uint32_t i;
+    pthread_mutex_lock(&(cluster->lock));
+    for(i = 0; i < cluster->n_nodes; i++) {
+        if (cluster->nodes[i]->down_until <= now) n_up++;
+    }
+    pthread_mutex_unlock(&(cluster->lock));
+    return n_up;
+}
+
+//
+// IDEMPOTENT OPERATIONS WITH FAILOVER
+//
+
+typedef riak_error (*riak_cluster_op)(riak_connection *cxn, void *args);
+
+/**
+ * @brief Run `op` on one node after another until one answers
+ * @param cluster Riak Cluster
+ * @param op Operation to run; must be safe to repeat
+ * @param args Arguments passed through to `op`
+ * @returns Error code of the last attempt
+ */
+static riak_error
+riak_cluster_with_failover(riak_cluster   *cluster,
+                           riak_cluster_op op,
+                           void           *args) {
+    pthread_mutex_lock(&(cluster->lock));
+    riak_uint32_t n_nodes = cluster->n_nodes;
+    pthread_mutex_unlock(&(cluster->lock));
+    if (n_nodes == 0) {
+        return ERIAK_NO_NODES;
+    }
+    riak_boolean_t *tried = (riak_boolean_t*)riak_config_clean_allocate(cluster->config, sizeof(riak_boolean_t) * n_nodes);
+    if (tried == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = ERIAK_OK;
+    while (RIAK_TRUE) {
+        riak_cluster_node *node = NULL;
+        riak_connection   *cxn  = NULL;
+        riak_error checkout_err = riak_cluster_checkout_untried(cluster, tried, &node, &cxn);
+        if (checkout_err) {
+            // Report why the last node failed rather than running out of nodes
+            if (err == ERIAK_OK) err = checkout_err;
+            break;
+        }
+        err = (op)(cxn, args);
+        riak_cluster_checkin(cluster, node, &cxn, err);
+        if (!riak_cluster_is_network_error(err)) break;
+    }
+    riak_free(cluster->config, &tried);
+    return err;
+}
+
+typedef struct _riak_cluster_get_args {
+    riak_binary        *bucket;
+    riak_binary        *key;
+    riak_get_options   *opts;
+    riak_get_response **response;
+} riak_cluster_get_args;
+
+static riak_error
+riak_cluster_get_op(riak_connection *cxn,
+                    void            *ptr) {
+    riak_cluster_get_args *args = (riak_cluster_get_args*)ptr;
+    return riak_get(cxn, args->bucket, args->key, args->opts, args->response);
+}
+
+riak_error
+riak_cluster_get(riak_cluster       *cluster,
+                 riak_binary        *bucket,
+                 riak_binary        *key,
+                 riak_get_options   *opts,
+                 riak_get_response **response) {
+    riak_cluster_get_args args = { bucket, key, opts, response };
+    return riak_cluster_with_failover(cluster, riak_cluster_get_op, &args);
+}
+
+typedef struct _riak_cluster_listkeys_args {
+    riak_binary             *bucket;
+    riak_uint32_t            timeout;
+    riak_listkeys_response **response;
+} riak_cluster_listkeys_args;
+
+static riak_error
+riak_cluster_listkeys_op(riak_connection *cxn,
+                         void            *ptr) {
+    riak_cluster_listkeys_args *args = (riak_cluster_listkeys_args*)ptr;
+    return riak_listkeys(cxn, args->bucket, args->timeout, args->response);
+}
+
+riak_error
+riak_cluster_listkeys(riak_cluster            *cluster,
+                      riak_binary             *bucket,
+                      riak_uint32_t            timeout,
+                      riak_listkeys_response **response) {
+    riak_cluster_listkeys_args args = { bucket, timeout, response };
+    return riak_cluster_with_failover(cluster, riak_cluster_listkeys_op, &args);
+}
+
+typedef struct _riak_cluster_2index_args {
+    riak_binary           *bucket;
+    riak_binary           *index;
+    riak_2index_options   *opts;
+    riak_2index_response **response;
+} riak_cluster_2index_args;
+
+static riak_error
+riak_cluster_2index_op(riak_connection *cxn,
+                       void            *ptr) {
+    riak_cluster_2index_args *args = (riak_cluster_2index_args*)ptr;
+    return riak_2index(cxn, args->bucket, args->index, args->opts, args->response);
+}
+
+riak_error
+riak_cluster_2index(riak_cluster          *cluster,
+                    riak_binary           *bucket,
+                    riak_binary           *index,
+                    riak_2index_options   *opts,
+                    riak_2index_response **response) {
+    riak_cluster_2index_args args = { bucket, index, opts, response };
+    return riak_cluster_with_failover(cluster, riak_cluster_2index_op, &args);
+}
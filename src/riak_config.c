@@ -25,9 +25,46 @@
 #include "riak_utils-internal.h"
 #include "riak_network.h"
 #include "riak_config-internal.h"
+#include "riak_operation-internal.h"
 
 extern ProtobufCAllocator protobuf_c_default_allocator;
 
+/**
+ * @brief Release a thread's context
+ * @param ctx Riak Thread Context, already off its config's list
+ */
+static void
+riak_thread_context_free(riak_thread_context *ctx) {
+    riak_config *cfg = ctx->config;
+    while (ctx->free_ops) {
+        riak_operation *rop = ctx->free_ops;
+        ctx->free_ops = rop->next;
+        riak_free(cfg, &rop);
+    }
+    riak_free(cfg, &ctx);
+}
+
+/**
+ * @brief Release a thread's context, run by pthreads as the thread exits
+ * @param ptr Riak Thread Context
+ */
+static void
+riak_thread_context_exit(void *ptr) {
+    riak_thread_context *ctx = (riak_thread_context*)ptr;
+    riak_config         *cfg = ctx->config;
+    pthread_mutex_lock(&(cfg->thread_lock));
+    if (ctx->prev) {
+        ctx->prev->next = ctx->next;
+    } else {
+        cfg->threads = ctx->next;
+    }
+    if (ctx->next) {
+        ctx->next->prev = ctx->prev;
+    }
+    pthread_mutex_unlock(&(cfg->thread_lock));
+    riak_thread_context_free(ctx);
+}
+
 riak_error
 riak_config_new(riak_config      **config,
                  riak_alloc_fn     alloc,
@@ -59,15 +96,27 @@ riak_config_new(riak_config      **config,
     cfg->free_fn      = free_fn;
     cfg->pb_allocator = NULL;
     if (pb_alloc != NULL && pb_free != NULL) {
-        cfg->pb_allocator = &protobuf_c_default_allocator;
-        cfg->pb_allocator->alloc = pb_alloc;
-        cfg->pb_allocator->tmp_alloc = pb_alloc;
-        cfg->pb_allocator->free = pb_free;
+        // Keep our own copy; other configs (and other libraries) may rely on the default
+        cfg->custom_pb_allocator            = protobuf_c_default_allocator;
+        cfg->custom_pb_allocator.alloc      = pb_alloc;
+        cfg->custom_pb_allocator.tmp_alloc  = pb_alloc;
+        cfg->custom_pb_allocator.free       = pb_free;
+        cfg->pb_allocator = &(cfg->custom_pb_allocator);
     }
     cfg->log_data        = NULL;
     cfg->log_fn          = NULL;
     cfg->log_init_fn     = NULL;
     cfg->log_cleanup_fn  = NULL;
+    if (pthread_mutex_init(&(cfg->thread_lock), NULL) != 0) {
+        (free_fn)(cfg);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    if (pthread_key_create(&(cfg->thread_key), riak_thread_context_exit) != 0) {
+        pthread_mutex_destroy(&(cfg->thread_lock));
+        (free_fn)(cfg);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    cfg->has_thread_key = RIAK_TRUE;
 
     *config = cfg;
     return ERIAK_OK;
@@ -97,11 +146,174 @@ riak_config_set_logging(riak_config        *cfg,
     return ERIAK_OK;
 }
 
+// Block headers are padded so the first allocation stays aligned
+#define RIAK_ARENA_ROUND(N)   (((N) + RIAK_ARENA_ALIGN - 1) & ~((riak_size_t)RIAK_ARENA_ALIGN - 1))
+#define RIAK_ARENA_HEADER_LEN RIAK_ARENA_ROUND(sizeof(riak_arena_block))
+#define RIAK_ARENA_DATA(B)    ((riak_uint8_t*)(B) + RIAK_ARENA_HEADER_LEN)
+
+static void*
+riak_config_arena_allocate(riak_config *cfg,
+                           riak_size_t  bytes) {
+    riak_size_t       needed = RIAK_ARENA_ROUND(bytes);
+    riak_arena_block *block  = cfg->arena;
+    if (block && block->size - block->used >= needed) {
+        void *memory = RIAK_ARENA_DATA(block) + block->used;
+        block->used += needed;
+        return memory;
+    }
+
+    // Oversized requests get a block of their own, tucked behind the
+    // current one so it can keep filling up
+    riak_size_t size = (needed > cfg->arena_block_size) ? needed : cfg->arena_block_size;
+    riak_arena_block *fresh = (riak_arena_block*)(cfg->malloc_fn)(RIAK_ARENA_HEADER_LEN + size);
+    if (fresh == NULL) {
+        return NULL;
+    }
+    fresh->size = size;
+    fresh->used = needed;
+    if (block && size > cfg->arena_block_size) {
+        fresh->next = block->next;
+        block->next = fresh;
+    } else {
+        fresh->next = block;
+        cfg->arena  = fresh;
+    }
+    return RIAK_ARENA_DATA(fresh);
+}
+
+static void*
+riak_config_arena_pb_alloc(void  *allocator_data,
+                           size_t size) {
+    return riak_config_arena_allocate((riak_config*)allocator_data, size);
+}
+
+static void
+riak_config_arena_pb_free(void *allocator_data,
+                          void *pointer) {
+    // Released along with the rest of the arena
+}
+
+riak_boolean_t
+riak_config_arena_owns(riak_config *cfg,
+                       void        *ptr) {
+    riak_arena_block *block;
+    for (block = cfg->arena; block != NULL; block = block->next) {
+        riak_uint8_t *data = RIAK_ARENA_DATA(block);
+        if ((riak_uint8_t*)ptr >= data && (riak_uint8_t*)ptr < data + block->size) {
+            return RIAK_TRUE;
+        }
+    }
+    return RIAK_FALSE;
+}
+
+riak_error
+riak_config_new_arena(riak_config  *parent,
+                      riak_config **arena,
+                      riak_size_t   block_size) {
+    *arena = NULL;
+    // Arenas always draw from a heap-backed config
+    while (parent->parent) {
+        parent = parent->parent;
+    }
+    riak_config *cfg = (riak_config*)riak_config_clean_allocate(parent, sizeof(riak_config));
+    if (cfg == NULL) {
+        riak_log_critical_config(parent, "%s", "Could not allocate an arena");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    cfg->malloc_fn        = parent->malloc_fn;
+    cfg->realloc_fn       = parent->realloc_fn;
+    cfg->free_fn          = parent->free_fn;
+    cfg->log_data         = parent->log_data;
+    cfg->log_fn           = parent->log_fn;
+    cfg->parent           = parent;
+    cfg->arena_block_size = (block_size > 0) ? RIAK_ARENA_ROUND(block_size) : RIAK_CONFIG_ARENA_BLOCK_SIZE;
+
+    cfg->arena_pb_allocator.alloc          = riak_config_arena_pb_alloc;
+    cfg->arena_pb_allocator.tmp_alloc      = riak_config_arena_pb_alloc;
+    cfg->arena_pb_allocator.free           = riak_config_arena_pb_free;
+    cfg->arena_pb_allocator.max_alloca     = protobuf_c_default_allocator.max_alloca;
+    cfg->arena_pb_allocator.allocator_data = cfg;
+    cfg->pb_allocator = &(cfg->arena_pb_allocator);
+
+    *arena = cfg;
+    return ERIAK_OK;
+}
+
+void
+riak_config_arena_reset(riak_config *arena) {
+    riak_arena_block *keep  = NULL;
+    riak_arena_block *block = arena->arena;
+    while (block != NULL) {
+        riak_arena_block *next = block->next;
+        if (keep == NULL && block->size == arena->arena_block_size) {
+            keep = block;
+            keep->used = 0;
+            keep->next = NULL;
+        } else {
+            (arena->free_fn)(block);
+        }
+        block = next;
+    }
+    arena->arena = keep;
+}
+
+riak_size_t
+riak_config_get_arena_used(riak_config *arena) {
+    riak_size_t       used  = 0;
+    riak_arena_block *block = arena->arena;
+    for (; block != NULL; block = block->next) {
+        used += block->used;
+    }
+    return used;
+}
+
+riak_thread_context*
+riak_config_get_thread_context(riak_config *cfg) {
+    while (cfg->parent) {
+        cfg = cfg->parent;
+    }
+    riak_thread_context *ctx = (riak_thread_context*)pthread_getspecific(cfg->thread_key);
+    if (ctx) {
+        return ctx;
+    }
+    ctx = (riak_thread_context*)riak_config_clean_allocate(cfg, sizeof(riak_thread_context));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    ctx->config = cfg;
+    if (pthread_setspecific(cfg->thread_key, ctx) != 0) {
+        riak_free(cfg, &ctx);
+        return NULL;
+    }
+    // Remembered so riak_config_free can reach threads that are still running
+    pthread_mutex_lock(&(cfg->thread_lock));
+    ctx->next = cfg->threads;
+    if (cfg->threads) {
+        cfg->threads->prev = ctx;
+    }
+    cfg->threads = ctx;
+    pthread_mutex_unlock(&(cfg->thread_lock));
+    return ctx;
+}
+
+riak_error
+riak_config_get_thread_stats(riak_config       *cfg,
+                             riak_thread_stats *stats) {
+    riak_thread_context *ctx = riak_config_get_thread_context(cfg);
+    if (ctx == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *stats = ctx->stats;
+    return ERIAK_OK;
+}
+
 void*
 riak_config_allocate(riak_config *cfg,
                      riak_size_t  bytes) {
     void *memory = NULL;
-    if (cfg && cfg->malloc_fn) {
+    if (cfg && cfg->arena_block_size) {
+        memory = riak_config_arena_allocate(cfg, bytes);
+    } else if (cfg && cfg->malloc_fn) {
         memory = (cfg->malloc_fn)(bytes);
     }
     return memory;
@@ -110,12 +322,9 @@ riak_config_allocate(riak_config *cfg,
 void*
 riak_config_clean_allocate(riak_config *cfg,
                            riak_size_t  bytes) {
-    void *memory = NULL;
-    if (cfg && cfg->malloc_fn) {
-        memory = (cfg->malloc_fn)(bytes);
-        if (memory) {
-            memset(memory, '\0', bytes);
-        }
+    void *memory = riak_config_allocate(cfg, bytes);
+    if (memory) {
+        memset(memory, '\0', bytes);
     }
     return memory;
 }
@@ -126,6 +335,25 @@ riak_config_free(riak_config **config) {
     riak_config *cfg = *config;
     riak_free_fn freer = cfg->free_fn;
 
+    // An arena only borrows its parent's logging
+    if (cfg->parent) {
+        riak_config_arena_reset(cfg);
+        if (cfg->arena) {
+            (freer)(cfg->arena);
+        }
+    }
+    // Destructors stop running once the key is gone, so tidy up every thread now
+    if (cfg->has_thread_key) {
+        pthread_key_delete(cfg->thread_key);
+        pthread_mutex_lock(&(cfg->thread_lock));
+        while (cfg->threads) {
+            riak_thread_context *ctx = cfg->threads;
+            cfg->threads = ctx->next;
+            riak_thread_context_free(ctx);
+        }
+        pthread_mutex_unlock(&(cfg->thread_lock));
+        pthread_mutex_destroy(&(cfg->thread_lock));
+    }
     // Since we will only clean up one config, let's shut down non-threadsafe logging here, too
     if (cfg->log_cleanup_fn) {
         (cfg->log_cleanup_fn)(cfg->log_data);
@@ -26,16 +26,52 @@
 #include "riak_connection.h"
 #include "riak_config-internal.h"
 #include "riak_connection-internal.h"
+#include "riak_operation-internal.h"
 #include "riak_network.h"
 
+void
+riak_connection_options_init(riak_connection_options *opts) {
+    memset((void*)opts, '\0', sizeof(riak_connection_options));
+    opts->connect_timeout = RIAK_CONNECTION_DEFAULT_CONNECT_TIMEOUT;
+    opts->backoff_base    = RIAK_CONNECTION_DEFAULT_BACKOFF_BASE;
+    opts->backoff_max     = RIAK_CONNECTION_DEFAULT_BACKOFF_MAX;
+}
+
+/**
+ * @brief Connect to any of the host's addresses, retrying with backoff
+ * @param cxn Riak Connection with resolved addresses
+ * @returns Error code of the last attempt
+ */
+static riak_error
+riak_connection_connect(riak_connection *cxn) {
+    riak_config             *cfg  = riak_connection_get_config(cxn);
+    riak_connection_options *opts = &(cxn->options);
+    riak_error               err  = ERIAK_CONNECT;
+    riak_uint32_t            attempt;
+    for (attempt = 0; attempt <= opts->connect_retries; attempt++) {
+        if (attempt > 0) {
+            riak_uint32_t delay = riak_backoff_ms(attempt-1, opts->backoff_base, opts->backoff_max);
+            riak_log_notice_config(cfg, "Reconnecting to %s:%s in %d ms", cxn->hostname, cxn->portnum, (int)delay);
+            riak_sleep_ms(delay);
+        }
+        err = riak_connect_any(cfg, cxn->addrinfo, opts->connect_timeout, &(cxn->fd));
+        if (err == ERIAK_OK) {
+            return ERIAK_OK;
+        }
+    }
+    riak_log_critical_config(cfg, "Could not connect to %s:%s", cxn->hostname, cxn->portnum);
+    return err;
+}
+
 riak_error
-riak_connection_new(riak_config       *cfg,
-                    riak_connection  **cxn_target,
-                    const char        *hostname,
-                    const char        *portnum,
-                    riak_addr_resolver resolver) {
+riak_connection_new_with_options(riak_config             *cfg,
+                                 riak_connection        **cxn_target,
+                                 const char              *hostname,
+                                 const char              *portnum,
+                                 riak_addr_resolver       resolver,
+                                 riak_connection_options *opts) {
 
-    riak_connection *cxn = (riak_connection*)(cfg->malloc_fn)(sizeof(riak_connection));
+    riak_connection *cxn = (riak_connection*)riak_config_allocate(cfg, sizeof(riak_connection));
     if (cxn == NULL) {
         riak_log_critical_config(cfg, "%s", "Could not allocate a riak_connection");
         return ERIAK_OUT_OF_MEMORY;
@@ -43,6 +79,12 @@ riak_connection_new(riak_config       *cfg,
     memset((void*)cxn, '\0', sizeof(riak_connection));
     *cxn_target = cxn;
     cxn->config = cfg;
+    cxn->fd     = -1;
+    if (opts) {
+        cxn->options = *opts;
+    } else {
+        riak_connection_options_init(&(cxn->options));
+    }
 
     if (resolver == NULL) {
         resolver = getaddrinfo;
@@ -56,14 +98,53 @@ riak_connection_new(riak_config       *cfg,
         return ERIAK_DNS_RESOLUTION;
     }
 
-    // TODO: Implement retry logic
-    cxn->fd = riak_just_open_a_socket(cfg, cxn->addrinfo);
-    if (cxn->fd < 0) {
-        riak_log_critical_config(cfg, "%s", "Could not just open a socket");
-        return ERIAK_CONNECT;
+    return riak_connection_connect(cxn);
+}
+
+riak_error
+riak_connection_new(riak_config       *cfg,
+                    riak_connection  **cxn_target,
+                    const char        *hostname,
+                    const char        *portnum,
+                    riak_addr_resolver resolver) {
+    return riak_connection_new_with_options(cfg, cxn_target, hostname, portnum, resolver, NULL);
+}
+
+void
+riak_connection_abort_pending(riak_connection *cxn,
+                              riak_error       err) {
+    // Detach the queue first; error callbacks may pipeline again
+    riak_operation *rop = cxn->pending_head;
+    cxn->pending_head   = NULL;
+    cxn->pending_tail   = NULL;
+    cxn->pending_unsent = NULL;
+    cxn->n_pending      = 0;
+    while (rop) {
+        riak_operation *next = rop->next;
+        riak_operation_report_error(rop, err);
+        riak_operation_free(&rop);
+        rop = next;
     }
+}
+
+riak_error
+riak_connection_reconnect(riak_connection *cxn) {
+    // Whatever was in flight belongs to the old socket
+    riak_connection_abort_pending(cxn, ERIAK_READ);
+    cxn->inbuf_start = cxn->inbuf_end = 0;
+    if (cxn->fd >= 0) {
+        close(cxn->fd);
+        cxn->fd = -1;
+    }
+    return riak_connection_connect(cxn);
+}
 
-    return ERIAK_OK;
+void
+riak_connection_set_timeouts(riak_connection *cxn,
+                             riak_uint32_t    read_timeout,
+                             riak_uint32_t    write_timeout) {
+    cxn->options.read_timeout  = read_timeout;
+    cxn->options.write_timeout = write_timeout;
 }
 
 riak_socket_t
@@ -75,16 +156,34 @@ riak_connection_get_config(riak_connection *cxn) {
     return cxn->config;
 }
 
+riak_config*
+riak_connection_get_operation_config(riak_connection *cxn) {
+    return (cxn->arena) ? cxn->arena : cxn->config;
+}
+
+void
+riak_connection_set_arena(riak_connection *cxn,
+                          riak_config     *arena) {
+    cxn->arena = arena;
+}
+
+riak_uint32_t
+riak_connection_get_n_pending(riak_connection *cxn) {
+    return cxn->n_pending;
+}
+
 void riak_connection_free(riak_connection** cxn_target) {
     if (cxn_target == NULL || *cxn_target == NULL) return;
     riak_connection *cxn = *cxn_target;
     riak_config *cfg = riak_connection_get_config(cxn);
 
-    if (cxn->fd) {
+    // Responses to these will never be read
+    riak_connection_abort_pending(cxn, ERIAK_READ);
+    if (cxn->fd >= 0) {
         close(cxn->fd);
-
     }
     if (cxn->addrinfo != NULL) freeaddrinfo(cxn->addrinfo);
+    riak_free(cfg, &(cxn->inbuf));
     riak_free(cfg, cxn_target);
 }
 
@@ -0,0 +1,349 @@
+/*********************************************************************
+ *
+ * riak_connection_pool.c: Pool of warm Riak Connections to one node
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <errno.h>
+#include <sys/time.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_connection_pool-internal.h"
+
+riak_error
+riak_connection_pool_new(riak_config           *cfg,
+                         riak_connection_pool **pool_target,
+                         const char            *hostname,
+                         const char            *portnum,
+                         riak_addr_resolver     resolver,
+                         riak_uint32_t          max_connections) {
+    if (max_connections == 0) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_connection_pool *pool = (riak_connection_pool*)riak_config_clean_allocate(cfg, sizeof(riak_connection_pool));
+    if (pool == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_connection_pool");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    pool->idle = (riak_pooled_connection*)riak_config_clean_allocate(cfg, sizeof(riak_pooled_connection)*max_connections);
+    if (pool->idle == NULL) {
+        riak_free(cfg, &pool);
+        riak_log_critical_config(cfg, "%s", "Could not allocate idle connection slots");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    pool->config          = cfg;
+    pool->resolver        = resolver;
+    pool->max_connections = max_connections;
+    riak_strlcpy(pool->hostname, hostname, sizeof(pool->hostname));
+    riak_strlcpy(pool->portnum, portnum, sizeof(pool->portnum));
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->health_cond), NULL);
+    pthread_cond_init(&(pool->available), NULL);
+
+    *pool_target = pool;
+    return ERIAK_OK;
+}
+
+void
+riak_connection_pool_free(riak_connection_pool **pool_target) {
+    if (pool_target == NULL || *pool_target == NULL) return;
+    riak_connection_pool *pool = *pool_target;
+    riak_config *cfg = pool->config;
+
+    riak_connection_pool_stop_health_check(pool);
+    riak_uint32_t i;
+    for(i = 0; i < pool->n_idle; i++) {
+        riak_connection_free(&(pool->idle[i].cxn));
+    }
+    if (pool->n_open > pool->n_idle) {
+        riak_log_warn_config(cfg, "%d connections still checked out of pool %s:%s",
+                             pool->n_open - pool->n_idle, pool->hostname, pool->portnum);
+    }
+    pthread_cond_destroy(&(pool->health_cond));
+    pthread_cond_destroy(&(pool->available));
+    pthread_mutex_destroy(&(pool->lock));
+    riak_free(cfg, &(pool->idle));
+    riak_free(cfg, pool_target);
+}
+
+/**
+ * @brief Open a brand new socket to the pool's node
+ * @param pool Riak Connection Pool
+ * @param cxn_target Connected Riak Connection (out)
+ * @returns Error code
+ * @note Called without the pool lock held
+ */
+static riak_error
+riak_connection_pool_connect(riak_connection_pool *pool,
+                             riak_connection     **cxn_target) {
+    riak_connection *cxn = NULL;
+    riak_error err = riak_connection_new(pool->config, &cxn, pool->hostname, pool->portnum, pool->resolver);
+    if (err) {
+        riak_connection_free(&cxn);
+        return err;
+    }
+    *cxn_target = cxn;
+    return ERIAK_OK;
+}
+
+riak_error
+riak_connection_pool_warm(riak_connection_pool *pool,
+                          riak_uint32_t         count) {
+    if (count > pool->max_connections) {
+        count = pool->max_connections;
+    }
+    while (RIAK_TRUE) {
+        pthread_mutex_lock(&(pool->lock));
+        if (pool->n_idle >= count || pool->n_open >= pool->max_connections) {
+            pthread_mutex_unlock(&(pool->lock));
+            break;
+        }
+        // Reserve the slot before dropping the lock to connect
+        pool->n_open++;
+        pthread_mutex_unlock(&(pool->lock));
+
+        riak_connection *cxn = NULL;
+        riak_error err = riak_connection_pool_connect(pool, &cxn);
+        pthread_mutex_lock(&(pool->lock));
+        if (err) {
+            pool->n_open--;
+            pthread_mutex_unlock(&(pool->lock));
+            return err;
+        }
+        pool->idle[pool->n_idle].cxn       = cxn;
+        pool->idle[pool->n_idle].last_used = riak_get_time_ms();
+        pool->n_idle++;
+        pthread_mutex_unlock(&(pool->lock));
+    }
+    return ERIAK_OK;
+}
+
+riak_error
+riak_connection_pool_checkout(riak_connection_pool *pool,
+                              riak_connection     **cxn_target) {
+    pthread_mutex_lock(&(pool->lock));
+    if (pool->n_idle > 0) {
+        pool->n_idle--;
+        *cxn_target = pool->idle[pool->n_idle].cxn;
+        pool->idle[pool->n_idle].cxn = NULL;
+        pthread_mutex_unlock(&(pool->lock));
+        return ERIAK_OK;
+    }
+    if (pool->n_open >= pool->max_connections) {
+        pthread_mutex_unlock(&(pool->lock));
+        return ERIAK_POOL_EXHAUSTED;
+    }
+    // Nothing idle, so lazily (re)connect in a reserved slot
+    pool->n_open++;
+    pthread_mutex_unlock(&(pool->lock));
+
+    riak_error err = riak_connection_pool_connect(pool, cxn_target);
+    if (err) {
+        pthread_mutex_lock(&(pool->lock));
+        pool->n_open--;
+        pthread_cond_signal(&(pool->available));
+        pthread_mutex_unlock(&(pool->lock));
+    }
+    return err;
+}
+
+riak_error
+riak_connection_pool_checkout_wait(riak_connection_pool *pool,
+                                   riak_connection     **cxn_target,
+                                   riak_uint32_t         timeout_ms) {
+    riak_uint64_t deadline = riak_get_time_ms() + timeout_ms;
+    while (RIAK_TRUE) {
+        riak_error err = riak_connection_pool_checkout(pool, cxn_target);
+        if (err != ERIAK_POOL_EXHAUSTED) {
+            return err;
+        }
+        pthread_mutex_lock(&(pool->lock));
+        while (pool->n_idle == 0 && pool->n_open >= pool->max_connections) {
+            riak_uint64_t now = riak_get_time_ms();
+            if (now >= deadline) {
+                pthread_mutex_unlock(&(pool->lock));
+                return ERIAK_POOL_EXHAUSTED;
+            }
+            struct timeval  tv;
+            struct timespec wakeup;
+            gettimeofday(&tv, NULL);
+            riak_uint64_t usecs = (riak_uint64_t)tv.tv_usec + (deadline - now) * 1000;
+            wakeup.tv_sec  = tv.tv_sec + (usecs / 1000000);
+            wakeup.tv_nsec = (usecs % 1000000) * 1000;
+            pthread_cond_timedwait(&(pool->available), &(pool->lock), &wakeup);
+        }
+        pthread_mutex_unlock(&(pool->lock));
+        // Another waiter may still beat us to it, so go around again
+    }
+}
+
+void
+riak_connection_pool_checkin(riak_connection_pool *pool,
+                             riak_connection     **cxn_target) {
+    if (cxn_target == NULL || *cxn_target == NULL) return;
+    pthread_mutex_lock(&(pool->lock));
+    // Every open connection is already idle, so this one was never checked
+    // out of the pool (or was returned twice); there is no slot to park it in
+    if (pool->n_idle >= pool->n_open) {
+        pthread_mutex_unlock(&(pool->lock));
+        riak_log_warn_config(pool->config, "Closing connection checked in beyond pool capacity to %s:%s",
+                             pool->hostname, pool->portnum);
+        riak_connection_free(cxn_target);
+        return;
+    }
+    pool->idle[pool->n_idle].cxn       = *cxn_target;
+    pool->idle[pool->n_idle].last_used = riak_get_time_ms();
+    pool->n_idle++;
+    pthread_cond_signal(&(pool->available));
+    pthread_mutex_unlock(&(pool->lock));
+    *cxn_target = NULL;
+}
+
+void
+riak_connection_pool_evict(riak_connection_pool *pool,
+                           riak_connection     **cxn_target) {
+    if (cxn_target == NULL || *cxn_target == NULL) return;
+    riak_connection_free(cxn_target);
+    pthread_mutex_lock(&(pool->lock));
+    pool->n_open--;
+    pthread_cond_signal(&(pool->available));
+    pthread_mutex_unlock(&(pool->lock));
+}
+
+riak_uint32_t
+riak_connection_pool_check_health(riak_connection_pool *pool,
+                                  riak_uint32_t         idle_ms) {
+    riak_config *cfg = pool->config;
+    riak_uint32_t n_stale = 0;
+    riak_uint32_t n_evicted = 0;
+    riak_uint32_t i;
+
+    // Pull stale connections out of the idle stack so nobody checks
+    // them out while we ping them without holding the lock
+    pthread_mutex_lock(&(pool->lock));
+    riak_uint64_t now = riak_get_time_ms();
+    riak_pooled_connection *stale = (riak_pooled_connection*)riak_config_allocate(cfg, sizeof(riak_pooled_connection)*(pool->n_idle+1));
+    if (stale == NULL) {
+        pthread_mutex_unlock(&(pool->lock));
+        return 0;
+    }
+    riak_uint32_t kept = 0;
+    for(i = 0; i < pool->n_idle; i++) {
+        if (now - pool->idle[i].last_used >= idle_ms) {
+            stale[n_stale++] = pool->idle[i];
+        } else {
+            pool->idle[kept++] = pool->idle[i];
+        }
+    }
+    pool->n_idle = kept;
+    pthread_mutex_unlock(&(pool->lock));
+
+    for(i = 0; i < n_stale; i++) {
+        if (riak_ping(stale[i].cxn) == ERIAK_OK) {
+            riak_connection_pool_checkin(pool, &(stale[i].cxn));
+        } else {
+            riak_log_warn_config(cfg, "Evicting dead connection to %s:%s", pool->hostname, pool->portnum);
+            riak_connection_pool_evict(pool, &(stale[i].cxn));
+            n_evicted++;
+        }
+    }
+    riak_free(cfg, &stale);
+
+    return n_evicted;
+}
+
+static void*
+riak_connection_pool_health_loop(void *ptr) {
+    riak_connection_pool *pool = (riak_connection_pool*)ptr;
+
+    pthread_mutex_lock(&(pool->lock));
+    while (pool->health_running) {
+        struct timeval  now;
+        struct timespec wakeup;
+        gettimeofday(&now, NULL);
+        riak_uint64_t usecs = (riak_uint64_t)now.tv_usec + (riak_uint64_t)pool->health_interval * 1000;
+        wakeup.tv_sec  = now.tv_sec + (usecs / 1000000);
+        wakeup.tv_nsec = (usecs % 1000000) * 1000;
+        int result = pthread_cond_timedwait(&(pool->health_cond), &(pool->lock), &wakeup);
+        if (result == ETIMEDOUT && pool->health_running) {
+            // The interval may be changed by a restart once the lock is dropped
+            riak_uint32_t interval = pool->health_interval;
+            pthread_mutex_unlock(&(pool->lock));
+            riak_connection_pool_check_health(pool, interval);
+            pthread_mutex_lock(&(pool->lock));
+        }
+    }
+    pthread_mutex_unlock(&(pool->lock));
+
+    return NULL;
+}
+
+riak_error
+riak_connection_pool_start_health_check(riak_connection_pool *pool,
+                                        riak_uint32_t         interval_ms) {
+    pthread_mutex_lock(&(pool->lock));
+    if (pool->health_running) {
+        pool->health_interval = interval_ms;
+        pthread_mutex_unlock(&(pool->lock));
+        return ERIAK_OK;
+    }
+    pool->health_interval = interval_ms;
+    pool->health_running  = RIAK_TRUE;
+    pthread_mutex_unlock(&(pool->lock));
+
+    if (pthread_create(&(pool->health_thread), NULL, riak_connection_pool_health_loop, pool) != 0) {
+        pthread_mutex_lock(&(pool->lock));
+        pool->health_running = RIAK_FALSE;
+        pthread_mutex_unlock(&(pool->lock));
+        riak_log_critical_config(pool->config, "%s", "Could not start pool health check thread");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    return ERIAK_OK;
+}
+
+void
+riak_connection_pool_stop_health_check(riak_connection_pool *pool) {
+    pthread_mutex_lock(&(pool->lock));
+    if (!pool->health_running) {
+        pthread_mutex_unlock(&(pool->lock));
+        return;
+    }
+    pool->health_running = RIAK_FALSE;
+    pthread_cond_signal(&(pool->health_cond));
+    pthread_mutex_unlock(&(pool->lock));
+    pthread_join(pool->health_thread, NULL);
+}
+
+riak_uint32_t
+riak_connection_pool_get_n_open(riak_connection_pool *pool) {
+    pthread_mutex_lock(&(pool->lock));
+    riak_uint32_t result = pool->n_open;
+    pthread_mutex_unlock(&(pool->lock));
+    return result;
+}
+
+riak_uint32_t
+riak_connection_pool_get_n_idle(riak_connection_pool *pool) {
+    pthread_mutex_lock(&(pool->lock));
+    riak_uint32_t result = pool->n_idle;
+    pthread_mutex_unlock(&(pool->lock));
+    return result;
+}
@@ -36,7 +36,7 @@ riak_server_error_new(struct _riak_config  *cfg,
                       riak_server_error   **err,
                       riak_uint32_t         errcode,
                       struct _riak_binary  *errmsg) {
-    riak_server_error *error = (riak_server_error*)(cfg->malloc_fn)(sizeof(riak_server_error));
+    riak_server_error *error = (riak_server_error*)riak_config_allocate(cfg, sizeof(riak_server_error));
     if (error == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -0,0 +1,243 @@
+/*********************************************************************
+ *
+ * riak_multiget.c: Fetch many keys over pooled, pipelined connections
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_connection_pool-internal.h"
+#include "riak_multiget-internal.h"
+
+void
+riak_multiget_options_init(riak_multiget_options *opts) {
+    memset((void*)opts, '\0', sizeof(riak_multiget_options));
+    opts->concurrency = RIAK_MULTIGET_DEFAULT_CONCURRENCY;
+    opts->depth       = RIAK_MULTIGET_DEFAULT_DEPTH;
+}
+
+static void
+riak_multiget_deliver(riak_multiget_batch *batch,
+                      riak_uint32_t        index,
+                      riak_error           err,
+                      riak_get_response   *response) {
+    pthread_mutex_lock(&(batch->lock));
+    if (err && batch->result == ERIAK_OK) {
+        batch->result = err;
+    }
+    (batch->cb)(index, err, response, batch->cb_data);
+    pthread_mutex_unlock(&(batch->lock));
+}
+
+/**
+ * @brief Claim the next window of up to `depth` keys
+ * @returns False once every key has been claimed
+ */
+static riak_boolean_t
+riak_multiget_claim(riak_multiget_batch *batch,
+                    riak_uint32_t       *start,
+                    riak_uint32_t       *end) {
+    pthread_mutex_lock(&(batch->lock));
+    *start = batch->next;
+    *end   = *start + batch->depth;
+    if (*end > batch->n_keys) {
+        *end = batch->n_keys;
+    }
+    batch->next = *end;
+    pthread_mutex_unlock(&(batch->lock));
+    return (*start < *end);
+}
+
+static void
+riak_multiget_response_cb(void *response,
+                          void *ptr) {
+    riak_multiget_worker *worker = (riak_multiget_worker*)ptr;
+    worker->response = (riak_get_response*)response;
+}
+
+/**
+ * @brief Queue a get for every key in the window
+ * @param end Shortened to the first key that could not be queued
+ * @returns Error code for the keys that were not queued
+ */
+static riak_error
+riak_multiget_send(riak_multiget_worker *worker,
+                   riak_uint32_t         start,
+                   riak_uint32_t        *end) {
+    riak_multiget_batch *batch = worker->batch;
+    riak_uint32_t i;
+    for(i = start; i < *end; i++) {
+        riak_operation *rop = NULL;
+        riak_error err = riak_operation_new(worker->cxn, &rop, riak_multiget_response_cb, NULL, worker);
+        if (err == ERIAK_OK) {
+            err = riak_get_request_encode(rop, batch->bucket, batch->keys[i], batch->get_opts, &(rop->pb_request));
+            if (err) {
+                riak_operation_free(&rop);
+            }
+        }
+        if (err) {
+            *end = i;
+            return err;
+        }
+        riak_pipeline_send(rop);
+    }
+    return ERIAK_OK;
+}
+
+static void*
+riak_multiget_work(void *ptr) {
+    riak_multiget_worker *worker = (riak_multiget_worker*)ptr;
+    riak_multiget_batch  *batch  = worker->batch;
+    riak_uint32_t start;
+    riak_uint32_t end;
+    while (riak_multiget_claim(batch, &start, &end)) {
+        riak_uint32_t window_end = end;
+        riak_error    queue_err  = ERIAK_OK;
+        riak_error    err        = ERIAK_OK;
+        if (worker->cxn == NULL) {
+            // Someone outside the batch may hold a connection for a while
+            err = riak_connection_pool_checkout_wait(batch->pool, &(worker->cxn), RIAK_CONNECTION_POOL_DEFAULT_WAIT_MS);
+        }
+        if (err == ERIAK_OK) {
+            queue_err = riak_multiget_send(worker, start, &end);
+            err = riak_pipeline_flush(worker->cxn);
+        }
+        riak_uint32_t i = start;
+        for(; err == ERIAK_OK && i < end; i++) {
+            // Server errors still leave the connection in step
+            riak_error key_err = riak_pipeline_receive(worker->cxn);
+            if (key_err != ERIAK_OK && key_err != ERIAK_SERVER_ERROR) {
+                err = key_err;
+                break;
+            }
+            riak_multiget_deliver(batch, i, key_err, worker->response);
+            worker->response = NULL;
+        }
+        if (err) {
+            // Nothing else pipelined on a broken connection can be matched up
+            for(; i < end; i++) {
+                riak_multiget_deliver(batch, i, err, NULL);
+            }
+            riak_connection_pool_evict(batch->pool, &(worker->cxn));
+        }
+        for(i = end; i < window_end; i++) {
+            riak_multiget_deliver(batch, i, queue_err, NULL);
+        }
+    }
+    riak_connection_pool_checkin(batch->pool, &(worker->cxn));
+    return NULL;
+}
+
+riak_error
+riak_multiget_cb(riak_connection_pool   *pool,
+                 riak_binary            *bucket,
+                 riak_binary           **keys,
+                 riak_uint32_t           n_keys,
+                 riak_get_options       *get_opts,
+                 riak_multiget_options  *opts,
+                 riak_multiget_callback  cb,
+                 void                   *ptr) {
+    if (n_keys == 0) {
+        return ERIAK_OK;
+    }
+    riak_multiget_options defaults;
+    if (opts == NULL) {
+        riak_multiget_options_init(&defaults);
+        opts = &defaults;
+    }
+    riak_uint32_t depth = (opts->depth > 0) ? opts->depth : 1;
+    // No point in workers that would never get a window
+    riak_uint32_t n_workers = (n_keys + depth - 1) / depth;
+    if (opts->concurrency > 0 && opts->concurrency < n_workers) {
+        n_workers = opts->concurrency;
+    }
+    // Nor in more workers than the pool has connections to hand out
+    if (pool->max_connections < n_workers) {
+        n_workers = pool->max_connections;
+    }
+
+    riak_config *cfg = pool->config;
+    riak_multiget_worker *workers = (riak_multiget_worker*)riak_config_clean_allocate(cfg, sizeof(riak_multiget_worker) * n_workers);
+    if (workers == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate multi-get workers");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_multiget_batch batch;
+    memset((void*)&batch, '\0', sizeof(batch));
+    batch.pool     = pool;
+    batch.bucket   = bucket;
+    batch.keys     = keys;
+    batch.n_keys   = n_keys;
+    batch.get_opts = get_opts;
+    batch.depth    = depth;
+    batch.cb       = cb;
+    batch.cb_data  = ptr;
+    pthread_mutex_init(&(batch.lock), NULL);
+
+    // The calling thread is worker 0; the rest get their own threads
+    riak_uint32_t i;
+    for(i = 0; i < n_workers; i++) {
+        workers[i].batch = &batch;
+    }
+    riak_uint32_t n_started = 1;
+    for(i = 1; i < n_workers; i++) {
+        if (pthread_create(&(workers[i].thread), NULL, riak_multiget_work, &workers[i]) != 0) {
+            riak_log_warn_config(cfg, "Running multi-get with %d workers", n_started);
+            break;
+        }
+        n_started++;
+    }
+    riak_multiget_work(&workers[0]);
+    for(i = 1; i < n_started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&(batch.lock));
+    riak_free(cfg, &workers);
+    return batch.result;
+}
+
+static void
+riak_multiget_collect(riak_uint32_t      index,
+                      riak_error         err,
+                      riak_get_response *response,
+                      void              *ptr) {
+    riak_multiget_collector *collector = (riak_multiget_collector*)ptr;
+    collector->responses[index] = response;
+    if (collector->errors) {
+        collector->errors[index] = err;
+    }
+}
+
+riak_error
+riak_multiget(riak_connection_pool   *pool,
+              riak_binary            *bucket,
+              riak_binary           **keys,
+              riak_uint32_t           n_keys,
+              riak_get_options       *get_opts,
+              riak_multiget_options  *opts,
+              riak_get_response     **responses,
+              riak_error             *errors) {
+    riak_multiget_collector collector = { responses, errors };
+    return riak_multiget_cb(pool, bucket, keys, n_keys, get_opts, opts, riak_multiget_collect, &collector);
+}
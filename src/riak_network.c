@@ -22,9 +22,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include "riak.h"
 #include "riak_messages-internal.h"
 #include "riak_utils-internal.h"
+#include "riak_network.h"
 
 riak_error
 riak_resolve_address(riak_config       *cfg,
@@ -36,8 +39,8 @@ riak_resolve_address(riak_config       *cfg,
 
     // Build the hints to tell getaddrinfo how to act.
     memset(&addrhints, '\0', sizeof(riak_addrinfo));
-//   addrhints.ai_family   = AF_UNSPEC; // IPv6 seems a bit broken for now
-    addrhints.ai_family   = AF_INET; // IPv4 works like a champ
+    // Every address is tried when connecting, so a broken family costs little
+    addrhints.ai_family   = AF_UNSPEC;
     addrhints.ai_socktype = SOCK_STREAM;
     addrhints.ai_protocol = IPPROTO_TCP; // We want a TCP socket
     /* Only return addresses we can use. */
@@ -78,42 +81,208 @@ riak_print_host(riak_addrinfo *addrinfo,
     }
 }
 
-riak_socket_t
-riak_just_open_a_socket(riak_config   *cfg,
-                        riak_addrinfo *addrinfo) {
+riak_error
+riak_set_blocking(riak_socket_t  sock,
+                  riak_boolean_t blocking) {
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0) {
+        return ERIAK_CONNECT;
+    }
+    flags = blocking ? (flags&~O_NONBLOCK) : (flags|O_NONBLOCK);
+    if (fcntl(sock, F_SETFL, flags) != 0) {
+        return ERIAK_CONNECT;
+    }
+    return ERIAK_OK;
+}
 
+/**
+ * @brief Log why connecting to one address failed
+ * @param cfg Riak Configuration
+ * @param addrinfo Address that failed
+ * @param errnum Error number
+ */
+static void
+riak_log_connect_failure(riak_config   *cfg,
+                         riak_addrinfo *addrinfo,
+                         int            errnum) {
+    char ip[INET6_ADDRSTRLEN];
+    riak_uint16_t port;
+    riak_print_host(addrinfo, ip, sizeof(ip), &port);
+    riak_log_warn_config(cfg, "Could not connect a socket to host %s:%d [%s]", ip, port, strerror(errnum));
+}
+
+/**
+ * @brief Open a non-blocking socket and start connecting it
+ * @param cfg Riak Configuration
+ * @param addrinfo Single address to connect to
+ * @param connected Set when the connection completed immediately
+ * @returns Socket with a connection in progress, or -1
+ */
+static riak_socket_t
+riak_start_connect(riak_config    *cfg,
+                   riak_addrinfo  *addrinfo,
+                   riak_boolean_t *connected) {
+    *connected = RIAK_FALSE;
     riak_socket_t sock = socket(addrinfo->ai_family,
                                 addrinfo->ai_socktype,
                                 addrinfo->ai_protocol);
     if (sock < 0) {
-        riak_log_critical_config(cfg, "%s", "Could not just open a socket");
+        riak_log_warn_config(cfg, "Could not just open a socket [%s]", strerror(errno));
         return -1;
     }
 
-#ifdef _RIAK_NON_BLOCKING
-    riak_boolean_t blocking = RIAK_FALSE;
-    int flags = fcntl(sock, F_GETFL, 0);
-    if (flags < 0) return -1;
-    flags = blocking ? (flags&~O_NONBLOCK) : (flags|O_NONBLOCK);
-    if (fcntl(sock, F_SETFL, flags) != 0) {
-       return -1;
+    // Requests are written whole, so Nagle would only delay them
+    int nodelay = 1;
+    if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) != 0) {
+        riak_log_warn_config(cfg, "Could not set TCP_NODELAY [%s]", strerror(errno));
     }
-#endif
 
+    if (riak_set_blocking(sock, RIAK_FALSE) != ERIAK_OK) {
+        close(sock);
+        return -1;
+    }
     int err = connect(sock, addrinfo->ai_addr, addrinfo->ai_addrlen);
-    if (err) {
-        // Since this is nonblocking, we'll need to treat some errors
-        // (like EINTR and EAGAIN) specially.
-        if (errno != EINPROGRESS && errno != EAGAIN) {
-            char ip[INET6_ADDRSTRLEN];
-            riak_uint16_t port;
-            riak_print_host(addrinfo, ip, sizeof(ip), &port);
-            close(sock);
-            riak_log_critical_config(cfg, "Could not connect a socket to host %s:%d [%s]\n", ip, port, strerror(errno));
-            return -1;
-        }
+    if (err == 0) {
+        *connected = RIAK_TRUE;
+    } else if (errno != EINPROGRESS && errno != EINTR) {
+        riak_log_connect_failure(cfg, addrinfo, errno);
+        close(sock);
+        return -1;
     }
     return sock;
 }
 
+riak_error
+riak_connect_any(riak_config   *cfg,
+                 riak_addrinfo *addrinfo,
+                 riak_uint32_t  timeout,
+                 riak_socket_t *sock_out) {
+    *sock_out = -1;
+
+    // Alternate address families, starting with the resolver's favourite,
+    // so one broken family cannot starve the other
+    riak_addrinfo *preferred[RIAK_CONNECT_MAX_ADDRS];
+    riak_addrinfo *others[RIAK_CONNECT_MAX_ADDRS];
+    riak_addrinfo *ordered[RIAK_CONNECT_MAX_ADDRS];
+    riak_addrinfo *ai;
+    int n_preferred = 0;
+    int n_others    = 0;
+    int n_addrs     = 0;
+    int i;
+    for (ai = addrinfo; ai != NULL && n_preferred + n_others < RIAK_CONNECT_MAX_ADDRS; ai = ai->ai_next) {
+        if (ai->ai_family == addrinfo->ai_family) {
+            preferred[n_preferred++] = ai;
+        } else {
+            others[n_others++] = ai;
+        }
+    }
+    for (i = 0; i < n_preferred || i < n_others; i++) {
+        if (i < n_preferred) ordered[n_addrs++] = preferred[i];
+        if (i < n_others)    ordered[n_addrs++] = others[i];
+    }
+
+    struct pollfd  pfds[RIAK_CONNECT_MAX_ADDRS];
+    riak_addrinfo *owners[RIAK_CONNECT_MAX_ADDRS];
+    int            n_inflight  = 0;
+    int            next        = 0;
+    riak_uint64_t  now         = riak_get_time_ms();
+    riak_uint64_t  deadline    = (timeout > 0) ? now + timeout : 0;
+    riak_uint64_t  next_start  = now;
+    riak_socket_t  winner      = -1;
+    riak_error     result      = ERIAK_CONNECT;
+
+    while (winner < 0) {
+        now = riak_get_time_ms();
+        // Start the next attempt once the previous one has had its head start
+        if (next < n_addrs && (n_inflight == 0 || now >= next_start)) {
+            riak_boolean_t connected;
+            riak_socket_t  sock = riak_start_connect(cfg, ordered[next], &connected);
+            next++;
+            next_start = now + RIAK_CONNECT_ATTEMPT_DELAY;
+            if (sock < 0) {
+                continue;
+            }
+            if (connected) {
+                winner = sock;
+                break;
+            }
+            pfds[n_inflight].fd      = sock;
+            pfds[n_inflight].events  = POLLOUT;
+            pfds[n_inflight].revents = 0;
+            owners[n_inflight]       = ordered[next-1];
+            n_inflight++;
+        }
+        if (n_inflight == 0) {
+            if (next < n_addrs) continue;
+            break;
+        }
+        if (deadline && now >= deadline) {
+            result = ERIAK_TIMEOUT;
+            break;
+        }
+
+        // Sleep until a socket is ready, the next attempt is due or we give up
+        riak_uint64_t wake = (next < n_addrs) ? next_start : deadline;
+        if (deadline && wake > deadline) {
+            wake = deadline;
+        }
+        int wait = (wake == 0) ? -1 : (int)((wake > now) ? wake - now : 0);
+        int ready = poll(pfds, n_inflight, wait);
+        if (ready < 0 && errno != EINTR) {
+            riak_log_error_config(cfg, "Could not wait for connections [%s]", strerror(errno));
+            break;
+        }
+        for (i = 0; ready > 0 && i < n_inflight; i++) {
+            if (pfds[i].revents == 0) {
+                continue;
+            }
+            int       sockerr = 0;
+            socklen_t len     = sizeof(sockerr);
+            if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &sockerr, &len) != 0) {
+                sockerr = errno;
+            }
+            if (sockerr == 0) {
+                winner = pfds[i].fd;
+                pfds[i] = pfds[--n_inflight];
+                break;
+            }
+            riak_log_connect_failure(cfg, owners[i], sockerr);
+            close(pfds[i].fd);
+            pfds[i]   = pfds[n_inflight-1];
+            owners[i] = owners[n_inflight-1];
+            n_inflight--;
+            i--;
+        }
+    }
+
+    // Losers of the race are simply dropped
+    for (i = 0; i < n_inflight; i++) {
+        close(pfds[i].fd);
+    }
+    if (winner < 0) {
+        if (result == ERIAK_TIMEOUT) {
+            riak_log_error_config(cfg, "Timed out after %d ms connecting", (int)timeout);
+        }
+        return result;
+    }
+#ifndef _RIAK_NON_BLOCKING
+    if (riak_set_blocking(winner, RIAK_TRUE) != ERIAK_OK) {
+        close(winner);
+        return ERIAK_CONNECT;
+    }
+#endif
+    *sock_out = winner;
+    return ERIAK_OK;
+}
+
+riak_socket_t
+riak_just_open_a_socket(riak_config   *cfg,
+                        riak_addrinfo *addrinfo) {
+    riak_socket_t sock;
+    if (riak_connect_any(cfg, addrinfo, 0, &sock) != ERIAK_OK) {
+        riak_log_critical_config(cfg, "%s", "Could not just open a socket");
+        return -1;
+    }
+    return sock;
+}
 
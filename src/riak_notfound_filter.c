@@ -0,0 +1,247 @@
+/*********************************************************************
+ *
+ * riak_notfound_filter.c: Negative-lookup cache for missing keys
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_config-internal.h"
+#include "riak_notfound_filter-internal.h"
+
+/**
+ * @brief Counter positions for a key, by double hashing one 64-bit hash
+ */
+static void
+riak_notfound_filter_probes(riak_notfound_filter *filter,
+                            riak_binary          *bucket,
+                            riak_binary          *key,
+                            riak_uint32_t        *probes) {
+    riak_uint64_t hash = riak_hash_bytes(riak_binary_data(bucket), riak_binary_len(bucket), RIAK_HASH_SEED);
+    hash = riak_hash_bytes(riak_binary_data(key), riak_binary_len(key), hash);
+    riak_uint32_t a    = (riak_uint32_t)hash;
+    riak_uint32_t b    = (riak_uint32_t)(hash >> 32) | 1;
+    riak_uint32_t mask = filter->n_counters - 1;
+    int i;
+    for(i = 0; i < RIAK_NOTFOUND_HASHES; i++) {
+        probes[i] = (a + i * b) & mask;
+    }
+}
+
+/**
+ * @brief Clear the oldest generations once their time is up
+ */
+static void
+riak_notfound_filter_rotate(riak_notfound_filter *filter) {
+    riak_uint64_t now = riak_get_time_ms();
+    if (now < __atomic_load_n(&(filter->rotate_at), __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    pthread_mutex_lock(&(filter->lock));
+    int n_cleared = 0;
+    while (now >= filter->rotate_at && n_cleared < RIAK_NOTFOUND_GENERATIONS) {
+        riak_uint32_t next = (filter->current + 1) % RIAK_NOTFOUND_GENERATIONS;
+        memset((void*)(filter->counters + (riak_size_t)next * filter->n_counters), '\0', filter->n_counters);
+        __atomic_store_n(&(filter->current), next, __ATOMIC_RELEASE);
+        filter->rotate_at += filter->period;
+        n_cleared++;
+    }
+    // Idle for longer than the TTL, so everything is already gone
+    if (now >= filter->rotate_at) {
+        filter->rotate_at = now + filter->period;
+    }
+    pthread_mutex_unlock(&(filter->lock));
+}
+
+static riak_boolean_t
+riak_notfound_filter_contains_in(riak_uint8_t  *counters,
+                                 riak_uint32_t *probes) {
+    int i;
+    for(i = 0; i < RIAK_NOTFOUND_HASHES; i++) {
+        if (__atomic_load_n(&(counters[probes[i]]), __ATOMIC_RELAXED) == 0) {
+            return RIAK_FALSE;
+        }
+    }
+    return RIAK_TRUE;
+}
+
+riak_error
+riak_notfound_filter_new(riak_config           *cfg,
+                         riak_notfound_filter **filter_target,
+                         riak_uint32_t          capacity,
+                         riak_uint32_t          ttl_ms) {
+    if (capacity == 0 || capacity > (1U << 26) || ttl_ms == 0) {
+        return ERIAK_UNINITIALIZED;
+    }
+    riak_notfound_filter *filter = (riak_notfound_filter*)riak_config_clean_allocate(cfg, sizeof(riak_notfound_filter));
+    if (filter == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_notfound_filter");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    filter->n_counters = 1;
+    while (filter->n_counters < capacity * RIAK_NOTFOUND_PER_KEY) {
+        filter->n_counters <<= 1;
+    }
+    filter->counters = (riak_uint8_t*)riak_config_clean_allocate(cfg, (riak_size_t)filter->n_counters * RIAK_NOTFOUND_GENERATIONS);
+    if (filter->counters == NULL) {
+        riak_free(cfg, &filter);
+        riak_log_critical_config(cfg, "%s", "Could not allocate not found counters");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    filter->config    = cfg;
+    filter->period    = (ttl_ms < RIAK_NOTFOUND_GENERATIONS) ? 1 : ttl_ms / RIAK_NOTFOUND_GENERATIONS;
+    filter->rotate_at = riak_get_time_ms() + filter->period;
+    pthread_mutex_init(&(filter->lock), NULL);
+
+    *filter_target = filter;
+    return ERIAK_OK;
+}
+
+void
+riak_notfound_filter_free(riak_notfound_filter **filter_target) {
+    riak_notfound_filter *filter = *filter_target;
+    if (filter == NULL) return;
+    riak_config *cfg = filter->config;
+    riak_free(cfg, &(filter->counters));
+    pthread_mutex_destroy(&(filter->lock));
+    riak_free(cfg, filter_target);
+}
+
+void
+riak_notfound_filter_add(riak_notfound_filter *filter,
+                         riak_binary          *bucket,
+                         riak_binary          *key) {
+    riak_uint32_t probes[RIAK_NOTFOUND_HASHES];
+    riak_notfound_filter_probes(filter, bucket, key, probes);
+    riak_notfound_filter_rotate(filter);
+    riak_uint32_t current = __atomic_load_n(&(filter->current), __ATOMIC_ACQUIRE);
+    riak_uint8_t *counters = filter->counters + (riak_size_t)current * filter->n_counters;
+    int i;
+    for(i = 0; i < RIAK_NOTFOUND_HASHES; i++) {
+        riak_uint8_t count = __atomic_load_n(&(counters[probes[i]]), __ATOMIC_RELAXED);
+        while (count < RIAK_NOTFOUND_SATURATED &&
+               !__atomic_compare_exchange_n(&(counters[probes[i]]), &count, count + 1, RIAK_TRUE,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+void
+riak_notfound_filter_remove(riak_notfound_filter *filter,
+                            riak_binary          *bucket,
+                            riak_binary          *key) {
+    riak_uint32_t probes[RIAK_NOTFOUND_HASHES];
+    riak_notfound_filter_probes(filter, bucket, key, probes);
+    __atomic_add_fetch(&(filter->epoch), 1, __ATOMIC_ACQ_REL);
+    int g;
+    for(g = 0; g < RIAK_NOTFOUND_GENERATIONS; g++) {
+        riak_uint8_t *counters = filter->counters + (riak_size_t)g * filter->n_counters;
+        // Concurrent misses may have counted the key more than once
+        while (riak_notfound_filter_contains_in(counters, probes)) {
+            riak_boolean_t changed = RIAK_FALSE;
+            int i;
+            for(i = 0; i < RIAK_NOTFOUND_HASHES; i++) {
+                riak_uint8_t count = __atomic_load_n(&(counters[probes[i]]), __ATOMIC_RELAXED);
+                while (count > 0 && count < RIAK_NOTFOUND_SATURATED) {
+                    if (__atomic_compare_exchange_n(&(counters[probes[i]]), &count, count - 1, RIAK_TRUE,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                        changed = RIAK_TRUE;
+                        break;
+                    }
+                }
+            }
+            // Only saturated counters left; the generation ages out instead
+            if (!changed) break;
+        }
+    }
+}
+
+riak_boolean_t
+riak_notfound_filter_contains(riak_notfound_filter *filter,
+                              riak_binary          *bucket,
+                              riak_binary          *key) {
+    riak_uint32_t probes[RIAK_NOTFOUND_HASHES];
+    riak_notfound_filter_probes(filter, bucket, key, probes);
+    riak_notfound_filter_rotate(filter);
+    int g;
+    for(g = 0; g < RIAK_NOTFOUND_GENERATIONS; g++) {
+        if (riak_notfound_filter_contains_in(filter->counters + (riak_size_t)g * filter->n_counters, probes)) {
+            return RIAK_TRUE;
+        }
+    }
+    return RIAK_FALSE;
+}
+
+riak_error
+riak_notfound_filter_get(riak_connection      *cxn,
+                         riak_notfound_filter *filter,
+                         riak_binary          *bucket,
+                         riak_binary          *key,
+                         riak_get_options     *opts,
+                         riak_get_response   **response) {
+    // Both ask for something only the server can answer
+    if (opts && (opts->has_if_modified || (opts->has_deletedvclock && opts->deletedvclock))) {
+        return riak_get(cxn, bucket, key, opts, response);
+    }
+    riak_config *cfg = filter->config;
+    if (riak_notfound_filter_contains(filter, bucket, key)) {
+        riak_get_response *empty = (riak_get_response*)riak_config_clean_allocate(cfg, sizeof(riak_get_response));
+        if (empty == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        __atomic_add_fetch(&(filter->hits), 1, __ATOMIC_RELAXED);
+        *response = empty;
+        return ERIAK_OK;
+    }
+    riak_uint64_t epoch = __atomic_load_n(&(filter->epoch), __ATOMIC_ACQUIRE);
+    riak_error err = riak_get(cxn, bucket, key, opts, response);
+    if (err) {
+        return err;
+    }
+    riak_get_response *found = *response;
+    if (found->n_content == 0 && !(found->has_unmodified && found->unmodified)) {
+        riak_notfound_filter_add(filter, bucket, key);
+        // A store finished while this fetch was out, so the key may exist now
+        if (__atomic_load_n(&(filter->epoch), __ATOMIC_ACQUIRE) != epoch) {
+            riak_notfound_filter_remove(filter, bucket, key);
+        }
+    }
+    return ERIAK_OK;
+}
+
+riak_error
+riak_notfound_filter_put(riak_connection      *cxn,
+                         riak_notfound_filter *filter,
+                         riak_object          *obj,
+                         riak_put_options     *opts,
+                         riak_put_response   **response) {
+    riak_error err = riak_put(cxn, obj, opts, response);
+    // Even a failed store may have reached some replicas
+    if (riak_object_get_has_key(obj)) {
+        riak_notfound_filter_remove(filter, riak_object_get_bucket(obj), riak_object_get_key(obj));
+    }
+    return err;
+}
+
+riak_uint64_t
+riak_notfound_filter_get_hits(riak_notfound_filter *filter) {
+    return __atomic_load_n(&(filter->hits), __ATOMIC_RELAXED);
+}
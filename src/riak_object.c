@@ -27,6 +27,7 @@
 #include "riak_object-internal.h"
 #include "riak_config-internal.h"
 #include "riak_print-internal.h"
+#include "riak_wire-internal.h"
 
 //
 // P A I R S
@@ -34,7 +35,7 @@
 
 riak_pair*
 riak_pair_new(riak_config *cfg) {
-    riak_pair *lnk = (riak_pair*)(cfg->malloc_fn)(sizeof(riak_pair));
+    riak_pair *lnk = (riak_pair*)riak_config_allocate(cfg, sizeof(riak_pair));
     if (lnk) memset(lnk, '\0', sizeof(riak_pair));
     return lnk;
 }
@@ -182,7 +183,7 @@ riak_pairs_free(riak_config  *cfg,
 
 riak_link*
 riak_link_new(riak_config *cfg) {
-    riak_link *lnk = (riak_link*)(cfg->malloc_fn)(sizeof(riak_link));
+    riak_link *lnk = (riak_link*)riak_config_allocate(cfg, sizeof(riak_link));
     if (lnk) memset(lnk, '\0', sizeof(riak_link));
     return lnk;
 }
@@ -192,13 +193,13 @@ riak_links_copy_to_pb(riak_config  *cfg,
                       RpbLink    ***pblink_target,
                       riak_link   **link,
                       int           num_links) {
-    RpbLink **pblink = (RpbLink**)(cfg->malloc_fn)(sizeof(RpbLink*) * num_links);
+    RpbLink **pblink = (RpbLink**)riak_config_allocate(cfg, sizeof(RpbLink*) * num_links);
     if (pblink == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
     int i;
     for(i = 0; i < num_links; i++) {
-        pblink[i] = (RpbLink*)(cfg->malloc_fn)(sizeof(RpbLink));
+        pblink[i] = (RpbLink*)riak_config_allocate(cfg, sizeof(RpbLink));
         if (pblink[i] == NULL) {
             return ERIAK_OUT_OF_MEMORY;
         }
@@ -239,13 +240,13 @@ riak_links_copy_from_pb(riak_config  *cfg,
                         riak_link  ***link_target,
                         RpbLink     **pblink,
                         int           num_links) {
-    riak_link **link = (riak_link**)(cfg->malloc_fn)(sizeof(riak_link*) * num_links);
+    riak_link **link = (riak_link**)riak_config_allocate(cfg, sizeof(riak_link*) * num_links);
     if (pblink == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
     int i;
     for(i = 0; i < num_links; i++) {
-        link[i] = (riak_link*)(cfg->malloc_fn)(sizeof(riak_link));
+        link[i] = (riak_link*)riak_config_allocate(cfg, sizeof(riak_link));
         if (link[i] == NULL) {
             return ERIAK_OUT_OF_MEMORY;
         }
@@ -282,7 +283,7 @@ riak_error
 riak_link_new_array(riak_config  *cfg,
                     riak_link  ***array,
                     riak_size_t   len) {
-    riak_link **result = (riak_link**)(cfg->malloc_fn)(sizeof(riak_link)*len);
+    riak_link **result = (riak_link**)riak_config_allocate(cfg, sizeof(riak_link)*len);
     if (result == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -304,7 +305,7 @@ riak_links_free(riak_config  *cfg,
         riak_free(cfg, &(link[i]->tag));
         riak_free(cfg, &(link[i]));
     }
-    riak_free(cfg, *link_target);
+    riak_free(cfg, link_target);
 }
 
 int
@@ -333,7 +334,7 @@ riak_links_print(riak_link    *link,
 //
 riak_object*
 riak_object_new(riak_config *cfg) {
-    riak_object *o = (riak_object*)(cfg->malloc_fn)(sizeof(riak_object));
+    riak_object *o = (riak_object*)riak_config_allocate(cfg, sizeof(riak_object));
     if (o) memset(o, '\0', sizeof(riak_object));
     return o;
 }
@@ -342,7 +343,7 @@ riak_error
 riak_object_new_array(riak_config   *cfg,
                       riak_object ***array,
                       riak_size_t    len) {
-    riak_object **result = (riak_object**)(cfg->malloc_fn)(sizeof(riak_object)*len);
+    riak_object **result = (riak_object**)riak_config_allocate(cfg, sizeof(riak_object)*len);
     if (result == NULL) {
         return ERIAK_OUT_OF_MEMORY;
     }
@@ -432,6 +433,127 @@ riak_object_to_pb_copy(riak_config *cfg,
 }
 
 
+//
+// W I R E   F O R M A T
+//
+
+// RpbContent, RpbLink and RpbPair field numbers
+#define RIAK_CONTENT_VALUE            1
+#define RIAK_CONTENT_CONTENT_TYPE     2
+#define RIAK_CONTENT_CHARSET          3
+#define RIAK_CONTENT_CONTENT_ENCODING 4
+#define RIAK_CONTENT_VTAG             5
+#define RIAK_CONTENT_LINKS            6
+#define RIAK_CONTENT_LAST_MOD         7
+#define RIAK_CONTENT_LAST_MOD_USECS   8
+#define RIAK_CONTENT_USERMETA         9
+#define RIAK_CONTENT_INDEXES         10
+#define RIAK_CONTENT_DELETED         11
+#define RIAK_LINK_BUCKET              1
+#define RIAK_LINK_KEY                 2
+#define RIAK_LINK_TAG                 3
+#define RIAK_PAIR_KEY                 1
+#define RIAK_PAIR_VALUE               2
+
+static riak_size_t
+riak_binary_wire_size(riak_uint32_t number,
+                      riak_binary  *bin) {
+    return riak_wire_bytes_size(number, bin ? bin->len : 0);
+}
+
+static riak_uint8_t*
+riak_binary_wire_write(riak_uint8_t *pos,
+                       riak_uint32_t number,
+                       riak_binary  *bin) {
+    return riak_wire_put_bytes(pos, number, bin ? bin->data : NULL, bin ? bin->len : 0);
+}
+
+static riak_size_t
+riak_link_wire_len(riak_link *link) {
+    riak_size_t len = 0;
+    if (link->has_bucket) len += riak_binary_wire_size(RIAK_LINK_BUCKET, link->bucket);
+    if (link->has_key)    len += riak_binary_wire_size(RIAK_LINK_KEY, link->key);
+    if (link->has_tag)    len += riak_binary_wire_size(RIAK_LINK_TAG, link->tag);
+    return len;
+}
+
+static riak_size_t
+riak_pair_wire_len(riak_pair *pair) {
+    riak_size_t len = riak_binary_wire_size(RIAK_PAIR_KEY, pair->key);
+    if (pair->has_value) len += riak_binary_wire_size(RIAK_PAIR_VALUE, pair->value);
+    return len;
+}
+
+static riak_size_t
+riak_pairs_wire_size(riak_uint32_t number,
+                     riak_pair   **pairs,
+                     riak_int32_t  n_pairs) {
+    riak_size_t size = 0;
+    riak_int32_t i;
+    for(i = 0; i < n_pairs; i++) {
+        size += riak_wire_bytes_size(number, riak_pair_wire_len(pairs[i]));
+    }
+    return size;
+}
+
+static riak_uint8_t*
+riak_pairs_wire_write(riak_uint8_t *pos,
+                      riak_uint32_t number,
+                      riak_pair   **pairs,
+                      riak_int32_t  n_pairs) {
+    riak_int32_t i;
+    for(i = 0; i < n_pairs; i++) {
+        pos = riak_wire_put_header(pos, number, riak_pair_wire_len(pairs[i]));
+        pos = riak_binary_wire_write(pos, RIAK_PAIR_KEY, pairs[i]->key);
+        if (pairs[i]->has_value) pos = riak_binary_wire_write(pos, RIAK_PAIR_VALUE, pairs[i]->value);
+    }
+    return pos;
+}
+
+riak_size_t
+riak_object_wire_size(riak_object *obj) {
+    riak_size_t size = riak_binary_wire_size(RIAK_CONTENT_VALUE, obj->value);
+    if (obj->has_content_type)     size += riak_binary_wire_size(RIAK_CONTENT_CONTENT_TYPE, obj->content_type);
+    if (obj->has_charset)          size += riak_binary_wire_size(RIAK_CONTENT_CHARSET, obj->charset);
+    if (obj->has_content_encoding) size += riak_binary_wire_size(RIAK_CONTENT_CONTENT_ENCODING, obj->encoding);
+    if (obj->has_vtag)             size += riak_binary_wire_size(RIAK_CONTENT_VTAG, obj->vtag);
+    riak_int32_t i;
+    for(i = 0; i < obj->n_links; i++) {
+        size += riak_wire_bytes_size(RIAK_CONTENT_LINKS, riak_link_wire_len(obj->links[i]));
+    }
+    if (obj->has_last_mod)         size += riak_wire_uint_size(RIAK_CONTENT_LAST_MOD, obj->last_mod);
+    if (obj->has_last_mod_usecs)   size += riak_wire_uint_size(RIAK_CONTENT_LAST_MOD_USECS, obj->last_mod_usecs);
+    size += riak_pairs_wire_size(RIAK_CONTENT_USERMETA, obj->usermeta, obj->n_usermeta);
+    size += riak_pairs_wire_size(RIAK_CONTENT_INDEXES, obj->indexes, obj->n_indexes);
+    if (obj->has_deleted)          size += riak_wire_uint_size(RIAK_CONTENT_DELETED, obj->deleted ? 1 : 0);
+    return size;
+}
+
+riak_uint8_t*
+riak_object_wire_write(riak_object  *obj,
+                       riak_uint8_t *pos) {
+    // Ascending field order, as protobuf-c packs it
+    pos = riak_binary_wire_write(pos, RIAK_CONTENT_VALUE, obj->value);
+    if (obj->has_content_type)     pos = riak_binary_wire_write(pos, RIAK_CONTENT_CONTENT_TYPE, obj->content_type);
+    if (obj->has_charset)          pos = riak_binary_wire_write(pos, RIAK_CONTENT_CHARSET, obj->charset);
+    if (obj->has_content_encoding) pos = riak_binary_wire_write(pos, RIAK_CONTENT_CONTENT_ENCODING, obj->encoding);
+    if (obj->has_vtag)             pos = riak_binary_wire_write(pos, RIAK_CONTENT_VTAG, obj->vtag);
+    riak_int32_t i;
+    for(i = 0; i < obj->n_links; i++) {
+        riak_link *link = obj->links[i];
+        pos = riak_wire_put_header(pos, RIAK_CONTENT_LINKS, riak_link_wire_len(link));
+        if (link->has_bucket) pos = riak_binary_wire_write(pos, RIAK_LINK_BUCKET, link->bucket);
+        if (link->has_key)    pos = riak_binary_wire_write(pos, RIAK_LINK_KEY, link->key);
+        if (link->has_tag)    pos = riak_binary_wire_write(pos, RIAK_LINK_TAG, link->tag);
+    }
+    if (obj->has_last_mod)         pos = riak_wire_put_uint(pos, RIAK_CONTENT_LAST_MOD, obj->last_mod);
+    if (obj->has_last_mod_usecs)   pos = riak_wire_put_uint(pos, RIAK_CONTENT_LAST_MOD_USECS, obj->last_mod_usecs);
+    pos = riak_pairs_wire_write(pos, RIAK_CONTENT_USERMETA, obj->usermeta, obj->n_usermeta);
+    pos = riak_pairs_wire_write(pos, RIAK_CONTENT_INDEXES, obj->indexes, obj->n_indexes);
+    if (obj->has_deleted)          pos = riak_wire_put_uint(pos, RIAK_CONTENT_DELETED, obj->deleted ? 1 : 0);
+    return pos;
+}
+
 riak_error
 riak_object_new_from_pb(riak_config  *cfg,
                         riak_object **target,
@@ -592,13 +714,13 @@ riak_object_free(riak_config *cfg,
     riak_object* object = *obj;
     if (object == NULL) return;
 
-    riak_free(cfg, &(object->bucket));
-    riak_free(cfg, &(object->charset));
-    riak_free(cfg, &(object->content_type));
-    riak_free(cfg, &(object->encoding));
-    riak_free(cfg, &(object->key));
-    riak_free(cfg, &(object->value));
-    riak_free(cfg, &(object->vtag));
+    riak_binary_free(cfg, &(object->bucket));
+    riak_binary_free(cfg, &(object->charset));
+    riak_binary_free(cfg, &(object->content_type));
+    riak_binary_free(cfg, &(object->encoding));
+    riak_binary_free(cfg, &(object->key));
+    riak_binary_free(cfg, &(object->value));
+    riak_binary_free(cfg, &(object->vtag));
     riak_pairs_free(cfg, &(object->indexes), object->n_indexes);
     riak_pairs_free(cfg, &(object->usermeta), object->n_usermeta);
     riak_links_free(cfg, &(object->links), object->n_links);
@@ -23,6 +23,8 @@
 #include "riak.h"
 #include "riak_messages-internal.h"
 #include "riak_operation-internal.h"
+#include "riak_connection-internal.h"
+#include "riak_config-internal.h"
 
 riak_error
 riak_operation_new(riak_connection        *cxn,
@@ -30,15 +32,31 @@ riak_operation_new(riak_connection        *cxn,
                    riak_response_callback response_cb,
                    riak_response_callback error_cb,
                    void                  *cb_data) {
-    riak_config    *cfg = riak_connection_get_config(cxn);
-    riak_operation *rop = (riak_operation*)riak_config_clean_allocate(cfg, sizeof(riak_operation));
-    if (cxn == NULL) {
+    riak_config         *cfg = riak_connection_get_operation_config(cxn);
+    riak_thread_context *ctx = riak_config_get_thread_context(cfg);
+    riak_operation      *rop = NULL;
+    if (ctx) {
+        ctx->stats.operations++;
+        // Arena operations are never retired, so only reuse heap ones
+        if (ctx->free_ops && cfg->parent == NULL) {
+            rop = ctx->free_ops;
+            ctx->free_ops = rop->next;
+            ctx->n_free_ops--;
+            ctx->stats.operations_reused++;
+            memset(rop, '\0', sizeof(riak_operation));
+        }
+    }
+    if (rop == NULL) {
+        rop = (riak_operation*)riak_config_clean_allocate(cfg, sizeof(riak_operation));
+    }
+    if (rop == NULL) {
         riak_log_critical_config(cfg, "%s", "Could not allocate a riak_operation");
         return ERIAK_OUT_OF_MEMORY;
     }
     *rop_target = rop;
 
     rop->connection  = cxn;
+    rop->config      = cfg;
     rop->response_cb = response_cb;
     rop->error_cb    = error_cb;
     rop->cb_data     = cb_data;
@@ -53,14 +71,25 @@ riak_operation_free(riak_operation **rop_target) {
     if (rop->pb_request) {
         riak_pb_message_free(cfg, &(rop->pb_request));
     }
-    riak_free(cfg, &(rop->request.bucket));
-    riak_free(cfg, &(rop->request.key));
+    riak_binary_free(cfg, &(rop->request.bucket));
+    riak_binary_free(cfg, &(rop->request.key));
+    riak_binary_free(cfg, &(rop->request.index));
+    riak_server_error_free(cfg, &(rop->error));
+    // Keep a few around for this thread's next operations
+    riak_thread_context *ctx = (cfg->parent == NULL) ? riak_config_get_thread_context(cfg) : NULL;
+    if (ctx && ctx->n_free_ops < RIAK_THREAD_FREE_OPS_MAX) {
+        rop->next = ctx->free_ops;
+        ctx->free_ops = rop;
+        ctx->n_free_ops++;
+        *rop_target = NULL;
+        return;
+    }
     riak_free(cfg, rop_target);
 }
 
 riak_config*
 riak_operation_get_config(riak_operation *rop) {
-    return riak_connection_get_config(rop->connection);
+    return rop->config;
 }
 
 riak_connection*
@@ -73,6 +102,25 @@ riak_operation_get_server_error(riak_operation *rop) {
     return rop->error;
 }
 
+void
+riak_operation_report_error(riak_operation *rop,
+                            riak_error      err) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    if (rop->error == NULL) {
+        riak_binary errmsg;
+        const char *msg = riak_strerror(err);
+        errmsg.len     = strlen(msg);
+        errmsg.data    = (riak_uint8_t*)msg;
+        errmsg.managed = RIAK_FALSE;
+        if (riak_server_error_new(cfg, &(rop->error), err, &errmsg) != ERIAK_OK) {
+            riak_log_error_config(cfg, "Could not record error %s", msg);
+        }
+    }
+    if (rop->error_cb) {
+        (rop->error_cb)(NULL, rop->cb_data);
+    }
+}
+
 void
 riak_operation_set_response_cb(riak_operation          *rop,
                                riak_response_callback  cb) {
@@ -85,6 +133,17 @@ riak_operation_set_error_cb(riak_operation         *rop,
     rop->error_cb = cb;
 }
 
+void
+riak_operation_set_timeout(riak_operation *rop,
+                           riak_uint32_t   timeout) {
+    rop->timeout = timeout;
+}
+
+riak_uint32_t
+riak_operation_get_timeout(riak_operation *rop) {
+    return rop->timeout;
+}
+
 void
 riak_operation_set_cb_data(riak_operation     *rop,
                            void               *cb_data) {
@@ -96,27 +155,38 @@ riak_operation_set_response_decoder(riak_operation       *rop,
     rop->decoder = decoder;
 }
 
+void
+riak_operation_set_response_free(riak_operation       *rop,
+                                 riak_response_free_fn response_free) {
+    rop->response_free = response_free;
+}
+
+void
+riak_operation_discard_response(riak_operation *rop) {
+    if (rop->response && rop->response_free) {
+        (rop->response_free)(riak_operation_get_config(rop), &(rop->response));
+    }
+    rop->response = NULL;
+}
+
 void
 riak_operation_set_bucket(riak_operation *rop,
                           riak_binary    *bucket) {
-    riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_config     *cfg = riak_connection_get_config(cxn);
+    riak_config *cfg = riak_operation_get_config(rop);
     rop->request.bucket = riak_binary_copy(cfg, bucket);
 }
 
 void
 riak_operation_set_key(riak_operation *rop,
                        riak_binary    *key) {
-    riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_config     *cfg = riak_connection_get_config(cxn);
+    riak_config *cfg = riak_operation_get_config(rop);
     rop->request.key = riak_binary_copy(cfg, key);
 }
 
 void
 riak_operation_set_index(riak_operation *rop,
                          riak_binary    *key) {
-    riak_connection *cxn = riak_operation_get_connection(rop);
-    riak_config     *cfg = riak_connection_get_config(cxn);
+    riak_config *cfg = riak_operation_get_config(rop);
     rop->request.index = riak_binary_copy(cfg, key);
 }
 
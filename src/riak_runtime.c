@@ -0,0 +1,519 @@
+/*********************************************************************
+ *
+ * riak_runtime.c: Per-core event loops shared by every thread (Linux)
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#ifdef __linux__
+
+// For pthread_setaffinity_np
+#define _GNU_SOURCE
+#include <sched.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "riak.h"
+#include "riak_runtime.h"
+#include "riak_utils-internal.h"
+#include "riak_runtime-internal.h"
+
+static void
+riak_mpsc_init(riak_mpsc_queue *q) {
+    q->stub.next = NULL;
+    q->head      = &(q->stub);
+    q->tail      = &(q->stub);
+}
+
+static void
+riak_mpsc_push(riak_mpsc_queue *q,
+               riak_mpsc_node  *node) {
+    __atomic_store_n(&(node->next), NULL, __ATOMIC_RELAXED);
+    riak_mpsc_node *prev = __atomic_exchange_n(&(q->head), node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&(prev->next), node, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take the oldest node, or NULL if empty (or a push is half done)
+ */
+static riak_mpsc_node*
+riak_mpsc_pop(riak_mpsc_queue *q) {
+    riak_mpsc_node *tail = q->tail;
+    riak_mpsc_node *next = __atomic_load_n(&(tail->next), __ATOMIC_ACQUIRE);
+    if (tail == &(q->stub)) {
+        if (next == NULL) {
+            return NULL;
+        }
+        q->tail = next;
+        tail    = next;
+        next    = __atomic_load_n(&(next->next), __ATOMIC_ACQUIRE);
+    }
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&(q->head), __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    riak_mpsc_push(q, &(q->stub));
+    next = __atomic_load_n(&(tail->next), __ATOMIC_ACQUIRE);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Wake the consumer, unless a wakeup is already on its way
+ * @note The consumer clears `pending` before draining, so nothing is missed
+ */
+static void
+riak_runtime_wake(int  fd,
+                  int *pending) {
+    if (__atomic_exchange_n(pending, 1, __ATOMIC_SEQ_CST) == 0) {
+        riak_uint64_t one = 1;
+        if (write(fd, &one, sizeof(one)) < 0) {
+            // Counter saturated; the consumer is awake anyway
+        }
+    }
+}
+
+static void
+riak_runtime_unwake(int  fd,
+                    int *pending) {
+    riak_uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0) {
+        // Nothing to consume
+    }
+    __atomic_store_n(pending, 0, __ATOMIC_SEQ_CST);
+}
+
+static void
+riak_runtime_deliver(riak_runtime_task *task) {
+    if (task->kind == RIAK_RUNTIME_TASK_GET) {
+        (task->get_cb)(task->err, (riak_get_response*)task->response, task->ptr);
+    } else if (task->kind == RIAK_RUNTIME_TASK_PUT) {
+        (task->put_cb)(task->err, (riak_put_response*)task->response, task->ptr);
+    }
+    riak_config *cfg = task->config;
+    riak_free(cfg, &task);
+}
+
+static void
+riak_runtime_complete(riak_runtime_task *task,
+                      riak_error         err,
+                      void              *response) {
+    task->rop      = NULL;  // Freed by the reactor once this returns
+    task->err      = err;
+    task->response = response;
+    riak_runtime_completions *completions = task->completions;
+    if (completions == NULL) {
+        riak_runtime_deliver(task);
+        return;
+    }
+    riak_mpsc_push(&(completions->queue), &(task->node));
+    riak_runtime_wake(completions->fd, &(completions->wakeup_pending));
+}
+
+static void
+riak_runtime_response_cb(void *response,
+                         void *ptr) {
+    riak_runtime_complete((riak_runtime_task*)ptr, ERIAK_OK, response);
+}
+
+static void
+riak_runtime_error_cb(void *response,
+                      void *ptr) {
+    riak_runtime_task *task = (riak_runtime_task*)ptr;
+    riak_error err = ERIAK_SERVER_ERROR;
+    if (response) {
+        riak_free_error_response(task->config, (riak_error_response**)&response);
+    } else {
+        // Local errors carry their code in place of the server's
+        riak_server_error *error = riak_operation_get_server_error(task->rop);
+        err = error ? (riak_error)riak_server_error_get_errcode(error) : ERIAK_READ;
+    }
+    riak_runtime_complete(task, err, NULL);
+}
+
+/**
+ * @brief Hand queued submissions to the reactor, or fail them when stopping
+ */
+static void
+riak_runtime_loop_drain(riak_runtime_loop *loop,
+                        riak_boolean_t     stopping) {
+    riak_mpsc_node *node;
+    while ((node = riak_mpsc_pop(&(loop->submissions))) != NULL) {
+        riak_runtime_task *task = (riak_runtime_task*)node;
+        if (task->kind == RIAK_RUNTIME_TASK_FN) {
+            if (!stopping) {
+                (task->fn)(loop->ep, task->ptr);
+            }
+            riak_config *cfg = task->config;
+            riak_free(cfg, &task);
+            continue;
+        }
+        if (stopping) {
+            riak_operation_free(&(task->rop));
+            riak_runtime_complete(task, ERIAK_EVENT, NULL);
+            continue;
+        }
+        // On error the reactor has already freed the operation
+        riak_error err = riak_epoll_send(loop->ep, task->rop);
+        if (err) {
+            riak_runtime_complete(task, err, NULL);
+        }
+    }
+}
+
+static void*
+riak_runtime_loop_run(void *ptr) {
+    riak_runtime_loop *loop = (riak_runtime_loop*)ptr;
+    riak_runtime      *rt   = loop->rt;
+    struct pollfd fds[2];
+    fds[0].fd     = loop->wakefd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = riak_epoll_get_fd(loop->ep);
+    fds[1].events = POLLIN;
+    while (!__atomic_load_n(&(rt->stopping), __ATOMIC_ACQUIRE)) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            riak_log_error_config(rt->config, "Loop %d poll: %s", loop->index, strerror(errno));
+            break;
+        }
+        if (fds[0].revents) {
+            riak_runtime_unwake(loop->wakefd, &(loop->wakeup_pending));
+        }
+        riak_runtime_loop_drain(loop, RIAK_FALSE);
+        if (fds[1].revents) {
+            riak_epoll_run_once(loop->ep, 0);
+        }
+    }
+    riak_runtime_loop_drain(loop, RIAK_TRUE);
+    return NULL;
+}
+
+void
+riak_runtime_options_init(riak_runtime_options *opts) {
+    memset((void*)opts, '\0', sizeof(riak_runtime_options));
+    opts->n_channels = RIAK_RUNTIME_DEFAULT_CHANNELS;
+    opts->sharding   = RIAK_RUNTIME_ROUND_ROBIN;
+    opts->timeout    = RIAK_EPOLL_DEFAULT_TIMEOUT_MS;
+}
+
+riak_error
+riak_runtime_new(riak_config          *cfg,
+                 riak_runtime        **rt_target,
+                 const char           *hostname,
+                 const char           *portnum,
+                 riak_addr_resolver    resolver,
+                 riak_runtime_options *opts) {
+    riak_runtime_options defaults;
+    if (opts == NULL) {
+        riak_runtime_options_init(&defaults);
+        opts = &defaults;
+    }
+    riak_uint32_t n_loops = opts->n_loops;
+    if (n_loops == 0) {
+        long n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+        n_loops = (n_cores > 0) ? (riak_uint32_t)n_cores : 1;
+    }
+    riak_uint32_t n_channels = (opts->n_channels > 0) ? opts->n_channels : RIAK_RUNTIME_DEFAULT_CHANNELS;
+    riak_runtime *rt = (riak_runtime*)riak_config_clean_allocate(cfg, sizeof(riak_runtime));
+    if (rt == NULL) {
+        riak_log_critical_config(cfg, "%s", "Could not allocate a riak_runtime");
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    rt->config     = cfg;
+    rt->sharding   = opts->sharding;
+    rt->n_channels = n_channels;
+    rt->loops = (riak_runtime_loop*)riak_config_clean_allocate(cfg, n_loops * sizeof(riak_runtime_loop));
+    if (rt->loops == NULL) {
+        riak_free(cfg, &rt);
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *rt_target = rt;
+    riak_error err = ERIAK_OK;
+    riak_uint32_t i;
+    for (i = 0; i < n_loops && err == ERIAK_OK; i++) {
+        riak_runtime_loop *loop = &(rt->loops[i]);
+        loop->rt     = rt;
+        loop->index  = i;
+        loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        riak_mpsc_init(&(loop->submissions));
+        rt->n_loops++;
+        if (loop->wakefd < 0) {
+            err = ERIAK_EVENT;
+            break;
+        }
+        err = riak_connection_pool_new(cfg, &(loop->pool), hostname, portnum, resolver, n_channels);
+        if (err == ERIAK_OK) {
+            err = riak_epoll_new(cfg, &(loop->ep), loop->pool, n_channels);
+        }
+    }
+    for (i = 0; i < rt->n_loops && err == ERIAK_OK; i++) {
+        riak_runtime_loop *loop = &(rt->loops[i]);
+        riak_epoll_set_timeout(loop->ep, opts->timeout);
+        if (pthread_create(&(loop->thread), NULL, riak_runtime_loop_run, loop) != 0) {
+            err = ERIAK_EVENT;
+            break;
+        }
+        loop->started = RIAK_TRUE;
+        if (opts->pin_loops) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % CPU_SETSIZE, &cpus);
+            if (pthread_setaffinity_np(loop->thread, sizeof(cpus), &cpus) != 0) {
+                riak_log_warn_config(cfg, "Could not pin loop %d", i);
+            }
+        }
+    }
+    if (err) {
+        riak_log_error_config(cfg, "Could not start runtime: %s", riak_strerror(err));
+        riak_runtime_free(rt_target);
+    }
+    return err;
+}
+
+void
+riak_runtime_free(riak_runtime **rt_target) {
+    if (rt_target == NULL || *rt_target == NULL) {
+        return;
+    }
+    riak_runtime *rt  = *rt_target;
+    riak_config  *cfg = rt->config;
+    __atomic_store_n(&(rt->stopping), 1, __ATOMIC_RELEASE);
+    riak_uint32_t i;
+    for (i = 0; i < rt->n_loops; i++) {
+        riak_runtime_loop *loop = &(rt->loops[i]);
+        if (loop->started) {
+            riak_runtime_wake(loop->wakefd, &(loop->wakeup_pending));
+            pthread_join(loop->thread, NULL);
+        }
+        // Fails whatever was still in flight, through the usual callbacks
+        riak_epoll_free(&(loop->ep));
+        riak_connection_pool_free(&(loop->pool));
+        if (loop->wakefd >= 0) {
+            close(loop->wakefd);
+        }
+    }
+    riak_free(cfg, &(rt->loops));
+    riak_free(cfg, rt_target);
+}
+
+riak_uint32_t
+riak_runtime_get_n_loops(riak_runtime *rt) {
+    return rt->n_loops;
+}
+
+/**
+ * @brief Pick the loop and connection for a key (NULL key for round-robin)
+ */
+static riak_runtime_loop*
+riak_runtime_shard(riak_runtime     *rt,
+                   riak_binary      *bucket,
+                   riak_binary      *key,
+                   riak_connection **cxn) {
+    riak_runtime_loop *loop;
+    riak_uint32_t      channel;
+    if (rt->sharding == RIAK_RUNTIME_KEY_HASH && key != NULL) {
+        riak_uint64_t hash = RIAK_HASH_SEED;
+        if (bucket) {
+            hash = riak_hash_bytes(riak_binary_data(bucket), riak_binary_len(bucket), hash);
+        }
+        hash = riak_hash_bytes(riak_binary_data(key), riak_binary_len(key), hash);
+        loop    = &(rt->loops[hash % rt->n_loops]);
+        channel = (riak_uint32_t)((hash / rt->n_loops) % rt->n_channels);
+    } else {
+        loop    = &(rt->loops[__atomic_fetch_add(&(rt->next_loop), 1, __ATOMIC_RELAXED) % rt->n_loops]);
+        channel = __atomic_fetch_add(&(loop->next_channel), 1, __ATOMIC_RELAXED) % rt->n_channels;
+    }
+    if (cxn) {
+        *cxn = riak_epoll_get_connection(loop->ep, channel);
+    }
+    return loop;
+}
+
+static riak_runtime_task*
+riak_runtime_task_new(riak_runtime             *rt,
+                      riak_runtime_task_kind    kind,
+                      riak_runtime_completions *completions,
+                      void                     *ptr) {
+    riak_runtime_task *task = (riak_runtime_task*)riak_config_clean_allocate(rt->config, sizeof(riak_runtime_task));
+    if (task) {
+        task->kind        = kind;
+        task->config      = rt->config;
+        task->completions = completions;
+        task->ptr         = ptr;
+    }
+    return task;
+}
+
+static void
+riak_runtime_enqueue(riak_runtime_loop *loop,
+                     riak_runtime_task *task) {
+    riak_mpsc_push(&(loop->submissions), &(task->node));
+    riak_runtime_wake(loop->wakefd, &(loop->wakeup_pending));
+}
+
+riak_error
+riak_runtime_get(riak_runtime              *rt,
+                 riak_binary               *bucket,
+                 riak_binary               *key,
+                 riak_get_options          *opts,
+                 riak_runtime_completions  *completions,
+                 riak_runtime_get_callback  cb,
+                 void                      *ptr) {
+    riak_runtime_task *task = riak_runtime_task_new(rt, RIAK_RUNTIME_TASK_GET, completions, ptr);
+    if (task == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    task->get_cb = cb;
+    riak_connection   *cxn  = NULL;
+    riak_runtime_loop *loop = riak_runtime_shard(rt, bucket, key, &cxn);
+    riak_error err = riak_operation_new(cxn, &(task->rop), NULL, riak_runtime_error_cb, task);
+    if (err == ERIAK_OK) {
+        err = riak_async_register_get(task->rop, bucket, key, opts, riak_runtime_response_cb);
+        if (err) {
+            riak_operation_free(&(task->rop));
+        }
+    }
+    if (err) {
+        riak_free(rt->config, &task);
+        return err;
+    }
+    riak_runtime_enqueue(loop, task);
+    return ERIAK_OK;
+}
+
+riak_error
+riak_runtime_put(riak_runtime              *rt,
+                 riak_object               *object,
+                 riak_put_options          *opts,
+                 riak_runtime_completions  *completions,
+                 riak_runtime_put_callback  cb,
+                 void                      *ptr) {
+    riak_runtime_task *task = riak_runtime_task_new(rt, RIAK_RUNTIME_TASK_PUT, completions, ptr);
+    if (task == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    task->put_cb = cb;
+    riak_connection   *cxn  = NULL;
+    riak_runtime_loop *loop = riak_runtime_shard(rt,
+                                                 riak_object_get_bucket(object),
+                                                 riak_object_get_key(object),
+                                                 &cxn);
+    riak_error err = riak_operation_new(cxn, &(task->rop), NULL, riak_runtime_error_cb, task);
+    if (err == ERIAK_OK) {
+        err = riak_async_register_put(task->rop, object, opts, riak_runtime_response_cb);
+        if (err) {
+            riak_operation_free(&(task->rop));
+        }
+    }
+    if (err) {
+        riak_free(rt->config, &task);
+        return err;
+    }
+    riak_runtime_enqueue(loop, task);
+    return ERIAK_OK;
+}
+
+riak_error
+riak_runtime_submit(riak_runtime         *rt,
+                    riak_binary          *shard,
+                    riak_runtime_task_fn  fn,
+                    void                 *ptr) {
+    riak_runtime_task *task = riak_runtime_task_new(rt, RIAK_RUNTIME_TASK_FN, NULL, ptr);
+    if (task == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    task->fn = fn;
+    riak_runtime_enqueue(riak_runtime_shard(rt, NULL, shard, NULL), task);
+    return ERIAK_OK;
+}
+
+riak_error
+riak_runtime_completions_new(riak_config               *cfg,
+                             riak_runtime_completions **completions_target) {
+    riak_runtime_completions *completions = (riak_runtime_completions*)riak_config_clean_allocate(cfg, sizeof(riak_runtime_completions));
+    if (completions == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    completions->config = cfg;
+    completions->fd     = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (completions->fd < 0) {
+        riak_free(cfg, &completions);
+        return ERIAK_EVENT;
+    }
+    riak_mpsc_init(&(completions->queue));
+    *completions_target = completions;
+    return ERIAK_OK;
+}
+
+void
+riak_runtime_completions_free(riak_runtime_completions **completions_target) {
+    if (completions_target == NULL || *completions_target == NULL) {
+        return;
+    }
+    riak_runtime_completions *completions = *completions_target;
+    riak_config *cfg = completions->config;
+    riak_mpsc_node *node;
+    while ((node = riak_mpsc_pop(&(completions->queue))) != NULL) {
+        riak_runtime_task *task = (riak_runtime_task*)node;
+        if (task->kind == RIAK_RUNTIME_TASK_GET) {
+            riak_get_response_free(cfg, (riak_get_response**)&(task->response));
+        } else if (task->kind == RIAK_RUNTIME_TASK_PUT) {
+            riak_put_response_free(cfg, (riak_put_response**)&(task->response));
+        }
+        riak_free(cfg, &task);
+    }
+    close(completions->fd);
+    riak_free(cfg, completions_target);
+}
+
+int
+riak_runtime_completions_get_fd(riak_runtime_completions *completions) {
+    return completions->fd;
+}
+
+riak_uint32_t
+riak_runtime_completions_drain(riak_runtime_completions *completions,
+                               int                       timeout) {
+    riak_uint32_t n = 0;
+    while (RIAK_TRUE) {
+        riak_runtime_unwake(completions->fd, &(completions->wakeup_pending));
+        riak_mpsc_node *node;
+        while ((node = riak_mpsc_pop(&(completions->queue))) != NULL) {
+            riak_runtime_deliver((riak_runtime_task*)node);
+            n++;
+        }
+        if (n > 0 || timeout == 0) {
+            break;
+        }
+        struct pollfd pfd;
+        pfd.fd     = completions->fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout) <= 0) {
+            break;
+        }
+    }
+    return n;
+}
+
+#endif // __linux__
@@ -21,6 +21,8 @@
  *********************************************************************/
 
 #include <stdarg.h>
+#include <time.h>
+#include <errno.h>
 
 #include "riak.h"
 #include "riak_binary-internal.h"
@@ -67,7 +69,7 @@ riak_array_realloc(riak_config *cfg,
                    riak_size_t   size,
                    riak_uint32_t oldnum,
                    riak_uint32_t newnum) {
-    void** new_array = (void**)(cfg->malloc_fn)(newnum*size);
+    void** new_array = (void**)riak_config_allocate(cfg, newnum*size);
     if (new_array == NULL) {
         return NULL;
     }
@@ -79,12 +81,83 @@ riak_array_realloc(riak_config *cfg,
     return (*from);
 }
 
+// Smallest array riak_array_reserve will allocate
+#define RIAK_ARRAY_MIN_CAPACITY 16
+
+void**
+riak_array_reserve(riak_config   *cfg,
+                   void        ***from,
+                   riak_size_t    size,
+                   riak_uint32_t  used,
+                   riak_uint32_t *capacity,
+                   riak_uint32_t  needed) {
+    if (*from != NULL && needed <= *capacity) {
+        return *from;
+    }
+    riak_uint32_t newnum = (*capacity > RIAK_ARRAY_MIN_CAPACITY) ? *capacity : RIAK_ARRAY_MIN_CAPACITY;
+    while (newnum < needed) {
+        newnum *= 2;
+    }
+    void** new_array = (void**)riak_config_allocate(cfg, newnum*size);
+    if (new_array == NULL) {
+        return NULL;
+    }
+    if (*from != NULL) {
+        memcpy((void*)new_array, (void*)(*from), used*size);
+        riak_free(cfg, from);
+    }
+    *from     = new_array;
+    *capacity = newnum;
+    return new_array;
+}
+
+riak_uint64_t
+riak_get_time_ms() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((riak_uint64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+riak_uint64_t
+riak_get_time_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((riak_uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+riak_uint32_t
+riak_backoff_ms(riak_uint32_t attempt,
+                riak_uint32_t base,
+                riak_uint32_t max) {
+    riak_uint64_t delay = base;
+    while (attempt-- > 0 && delay < max) {
+        delay *= 2;
+    }
+    if (delay > max) {
+        delay = max;
+    }
+    // Spread out clients that all lost the same node at once
+    riak_uint32_t half = (riak_uint32_t)(delay / 2);
+    return (riak_uint32_t)(delay - half) + (riak_uint32_t)(random() % (half + 1));
+}
+
+void
+riak_sleep_ms(riak_uint32_t ms) {
+    struct timespec delay;
+    delay.tv_sec  = ms / 1000;
+    delay.tv_nsec = (ms % 1000) * 1000000L;
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
 
 void
 riak_free_internal(riak_config *cfg,
                    void       **pp) {
     if(pp != NULL && *pp != NULL) {
-        (cfg->free_fn)(*pp);
+        // Arena memory goes away with the rest of the arena
+        if (!riak_config_arena_owns(cfg, *pp)) {
+            (cfg->free_fn)(*pp);
+        }
         *pp = NULL;
     }
 }
@@ -126,3 +199,16 @@ riak_snprintf_cat(char **target,
 
   return nb_bytes;
 }
+
+riak_uint64_t
+riak_hash_bytes(const riak_uint8_t *data,
+                riak_size_t         len,
+                riak_uint64_t       seed) {
+    riak_uint64_t hash = seed;
+    riak_size_t i;
+    for(i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,599 @@
+/*********************************************************************
+ *
+ * riak_view.c: Lazily decoded fetch responses
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stddef.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_binary-internal.h"
+#include "riak_object-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_utils-internal.h"
+#include "riak_wire-internal.h"
+#include "riak_view-internal.h"
+
+// RpbGetResp
+#define RIAK_VIEW_GET_CONTENT    1
+#define RIAK_VIEW_GET_VCLOCK     2
+#define RIAK_VIEW_GET_UNCHANGED  3
+// RpbContent
+#define RIAK_VIEW_VALUE            1
+#define RIAK_VIEW_CONTENT_TYPE     2
+#define RIAK_VIEW_CHARSET          3
+#define RIAK_VIEW_CONTENT_ENCODING 4
+#define RIAK_VIEW_VTAG             5
+#define RIAK_VIEW_LINKS            6
+#define RIAK_VIEW_LAST_MOD         7
+#define RIAK_VIEW_LAST_MOD_USECS   8
+#define RIAK_VIEW_USERMETA         9
+#define RIAK_VIEW_INDEXES         10
+#define RIAK_VIEW_DELETED         11
+
+static void
+riak_view_set_binary(riak_binary     *bin,
+                     riak_wire_field *field) {
+    bin->len     = field->len;
+    bin->data    = field->data;
+    bin->managed = RIAK_FALSE;
+}
+
+riak_error
+riak_get_view_new(riak_config    *cfg,
+                  riak_get_view **view_target,
+                  riak_binary    *bucket,
+                  riak_binary    *key,
+                  riak_uint8_t   *data,
+                  riak_size_t     len) {
+    return riak_view_new(cfg, view_target, bucket, key, data, len, RIAK_FALSE);
+}
+
+riak_error
+riak_view_new(riak_config    *cfg,
+              riak_get_view **view_target,
+              riak_binary    *bucket,
+              riak_binary    *key,
+              riak_uint8_t   *data,
+              riak_size_t     len,
+              riak_boolean_t  put_resp) {
+    riak_int32_t n_content = riak_wire_count(data, len, RIAK_VIEW_GET_CONTENT);
+    if (n_content < 0) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_size_t bucket_len = bucket ? bucket->len : 0;
+    riak_size_t key_len    = key ? key->len : 0;
+    riak_size_t header_len = sizeof(riak_get_view) + n_content * sizeof(riak_object_view);
+    riak_uint8_t *block = (riak_uint8_t*)riak_config_allocate(cfg, header_len + bucket_len + key_len + len);
+    if (block == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    memset((void*)block, '\0', header_len);
+    riak_get_view *view = (riak_get_view*)block;
+    view->config    = cfg;
+    view->content   = (riak_object_view*)(block + sizeof(riak_get_view));
+    view->n_content = n_content;
+    riak_uint8_t *bytes = block + header_len;
+    if (bucket) {
+        memcpy((void*)bytes, (void*)bucket->data, bucket_len);
+        view->bucket.data = bytes;
+        view->bucket.len  = bucket_len;
+        bytes += bucket_len;
+    }
+    if (key) {
+        memcpy((void*)bytes, (void*)key->data, key_len);
+        view->has_key  = RIAK_TRUE;
+        view->key.data = bytes;
+        view->key.len  = key_len;
+        bytes += key_len;
+    }
+    if (len > 0) {
+        memcpy((void*)bytes, (void*)data, len);
+    }
+    view->data = bytes;
+    view->len  = len;
+
+    // Only the outer message is decoded now
+    riak_wire_reader reader;
+    riak_wire_field  field;
+    riak_int32_t     i = 0;
+    riak_wire_reader_init(&reader, bytes, len);
+    while (riak_wire_next(&reader, &field)) {
+        switch (field.number) {
+        case RIAK_VIEW_GET_CONTENT:
+            if (field.type == RIAK_WIRE_BYTES) {
+                view->content[i].parent = view;
+                view->content[i].data   = field.data;
+                view->content[i].len    = field.len;
+                i++;
+            }
+            break;
+        case RIAK_VIEW_GET_VCLOCK:
+            view->has_vclock = RIAK_TRUE;
+            riak_view_set_binary(&(view->vclock), &field);
+            break;
+        case RIAK_VIEW_GET_UNCHANGED:
+            if (put_resp) {
+                // RpbPutResp carries the generated key here instead
+                view->has_key = RIAK_TRUE;
+                riak_view_set_binary(&(view->key), &field);
+            } else {
+                view->has_unmodified = RIAK_TRUE;
+                view->unmodified     = (field.value != 0);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    *view_target = view;
+    return ERIAK_OK;
+}
+
+static void
+riak_object_view_free_links(riak_config      *cfg,
+                            riak_object_view *obj) {
+    riak_int32_t i;
+    for(i = 0; obj->links && i < obj->n_links; i++) {
+        if (obj->links[i] == NULL) continue;
+        riak_free(cfg, &(obj->links[i]->bucket));
+        riak_free(cfg, &(obj->links[i]->key));
+        riak_free(cfg, &(obj->links[i]->tag));
+        riak_free(cfg, &(obj->links[i]));
+    }
+    riak_free(cfg, &(obj->links));
+}
+
+static void
+riak_object_view_free_pairs(riak_config  *cfg,
+                            riak_pair  ***pairs,
+                            riak_int32_t  n_pairs) {
+    riak_int32_t i;
+    for(i = 0; *pairs && i < n_pairs; i++) {
+        if ((*pairs)[i] == NULL) continue;
+        riak_free(cfg, &((*pairs)[i]->key));
+        riak_free(cfg, &((*pairs)[i]->value));
+        riak_free(cfg, &((*pairs)[i]));
+    }
+    riak_free(cfg, pairs);
+}
+
+void
+riak_get_view_free(riak_config    *cfg,
+                   riak_get_view **view_target) {
+    if (view_target == NULL || *view_target == NULL) {
+        return;
+    }
+    riak_get_view *view = *view_target;
+    riak_int32_t i;
+    for(i = 0; i < view->n_content; i++) {
+        riak_object_view *obj = &(view->content[i]);
+        riak_object_view_free_links(cfg, obj);
+        riak_object_view_free_pairs(cfg, &(obj->usermeta), obj->n_usermeta);
+        riak_object_view_free_pairs(cfg, &(obj->indexes), obj->n_indexes);
+    }
+    riak_free(cfg, view_target);
+}
+
+riak_boolean_t
+riak_get_view_get_has_vclock(riak_get_view *view) {
+    return view->has_vclock;
+}
+
+riak_binary*
+riak_get_view_get_vclock(riak_get_view *view) {
+    return view->has_vclock ? &(view->vclock) : NULL;
+}
+
+riak_boolean_t
+riak_get_view_get_has_unmodified(riak_get_view *view) {
+    return view->has_unmodified;
+}
+
+riak_boolean_t
+riak_get_view_get_unmodified(riak_get_view *view) {
+    return view->unmodified;
+}
+
+riak_int32_t
+riak_get_view_get_n_content(riak_get_view *view) {
+    return view->n_content;
+}
+
+riak_object_view*
+riak_get_view_get_content(riak_get_view *view,
+                          riak_int32_t   index) {
+    if (index < 0 || index >= view->n_content) {
+        return NULL;
+    }
+    return &(view->content[index]);
+}
+
+/**
+ * @brief Decode the scalar fields and count the repeated ones, once
+ */
+static riak_object_view*
+riak_object_view_scan(riak_object_view *obj) {
+    if (obj->scanned) {
+        return obj;
+    }
+    obj->scanned = RIAK_TRUE;
+    riak_wire_reader reader;
+    riak_wire_field  field;
+    riak_wire_reader_init(&reader, obj->data, obj->len);
+    while (riak_wire_next(&reader, &field)) {
+        switch (field.number) {
+        case RIAK_VIEW_VALUE:
+            riak_view_set_binary(&(obj->value), &field);
+            break;
+        case RIAK_VIEW_CONTENT_TYPE:
+            obj->has_content_type = RIAK_TRUE;
+            riak_view_set_binary(&(obj->content_type), &field);
+            break;
+        case RIAK_VIEW_CHARSET:
+            obj->has_charset = RIAK_TRUE;
+            riak_view_set_binary(&(obj->charset), &field);
+            break;
+        case RIAK_VIEW_CONTENT_ENCODING:
+            obj->has_content_encoding = RIAK_TRUE;
+            riak_view_set_binary(&(obj->encoding), &field);
+            break;
+        case RIAK_VIEW_VTAG:
+            obj->has_vtag = RIAK_TRUE;
+            riak_view_set_binary(&(obj->vtag), &field);
+            break;
+        case RIAK_VIEW_LINKS:
+            obj->n_links++;
+            break;
+        case RIAK_VIEW_LAST_MOD:
+            obj->has_last_mod = RIAK_TRUE;
+            obj->last_mod     = (riak_uint32_t)field.value;
+            break;
+        case RIAK_VIEW_LAST_MOD_USECS:
+            obj->has_last_mod_usecs = RIAK_TRUE;
+            obj->last_mod_usecs     = (riak_uint32_t)field.value;
+            break;
+        case RIAK_VIEW_USERMETA:
+            obj->n_usermeta++;
+            break;
+        case RIAK_VIEW_INDEXES:
+            obj->n_indexes++;
+            break;
+        case RIAK_VIEW_DELETED:
+            obj->has_deleted = RIAK_TRUE;
+            obj->deleted     = (field.value != 0);
+            break;
+        default:
+            break;
+        }
+    }
+    if (reader.failed) {
+        obj->malformed = RIAK_TRUE;
+        riak_log_error_config(obj->parent->config, "%s", "Malformed RpbContent in fetch response");
+        memset((void*)&(obj->value), '\0', sizeof(riak_object_view) - offsetof(riak_object_view, value));
+    }
+    return obj;
+}
+
+/**
+ * @brief Build shallow links or pairs for one repeated field
+ * @returns Error code; on failure the partial array is released by the view
+ */
+static riak_error
+riak_object_view_build(riak_object_view *obj,
+                       riak_uint32_t     number,
+                       void           ***array,
+                       riak_int32_t      n_items) {
+    riak_config *cfg = obj->parent->config;
+    riak_size_t  item_size = (number == RIAK_VIEW_LINKS) ? sizeof(riak_link) : sizeof(riak_pair);
+    void **items = (void**)riak_config_clean_allocate(cfg, n_items * sizeof(void*));
+    if (items == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    *array = items;
+    riak_wire_reader reader;
+    riak_wire_field  field;
+    riak_int32_t     i = 0;
+    riak_wire_reader_init(&reader, obj->data, obj->len);
+    while (i < n_items && riak_wire_next(&reader, &field)) {
+        if (field.number != number) continue;
+        items[i] = riak_config_clean_allocate(cfg, item_size);
+        if (items[i] == NULL) {
+            return ERIAK_OUT_OF_MEMORY;
+        }
+        riak_link *link = (riak_link*)items[i];
+        riak_pair *pair = (riak_pair*)items[i];
+        riak_wire_reader inner;
+        riak_wire_field  part;
+        riak_wire_reader_init(&inner, field.data, field.len);
+        while (riak_wire_next(&inner, &part)) {
+            if (part.type != RIAK_WIRE_BYTES) continue;
+            riak_binary *bin = riak_binary_new_shallow(cfg, part.len, part.data);
+            if (bin == NULL) {
+                return ERIAK_OUT_OF_MEMORY;
+            }
+            riak_binary **slot = NULL;
+            if (number == RIAK_VIEW_LINKS) {
+                // RpbLink: bucket = 1, key = 2, tag = 3
+                if (part.number == 1) {
+                    link->has_bucket = RIAK_TRUE;
+                    slot = &(link->bucket);
+                } else if (part.number == 2) {
+                    link->has_key = RIAK_TRUE;
+                    slot = &(link->key);
+                } else if (part.number == 3) {
+                    link->has_tag = RIAK_TRUE;
+                    slot = &(link->tag);
+                }
+            } else {
+                // RpbPair: key = 1, value = 2
+                if (part.number == 1) {
+                    slot = &(pair->key);
+                } else if (part.number == 2) {
+                    pair->has_value = RIAK_TRUE;
+                    slot = &(pair->value);
+                }
+            }
+            if (slot == NULL || *slot != NULL) {
+                riak_free(cfg, &bin);
+                continue;
+            }
+            *slot = bin;
+        }
+        i++;
+    }
+    return ERIAK_OK;
+}
+
+riak_binary*
+riak_object_view_get_bucket(riak_object_view *obj) {
+    return obj->parent->bucket.data ? &(obj->parent->bucket) : NULL;
+}
+
+riak_boolean_t
+riak_object_view_get_has_key(riak_object_view *obj) {
+    return obj->parent->has_key;
+}
+
+riak_binary*
+riak_object_view_get_key(riak_object_view *obj) {
+    return obj->parent->has_key ? &(obj->parent->key) : NULL;
+}
+
+riak_binary*
+riak_object_view_get_value(riak_object_view *obj) {
+    return &(riak_object_view_scan(obj)->value);
+}
+
+riak_boolean_t
+riak_object_view_get_has_charset(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_charset;
+}
+
+riak_binary*
+riak_object_view_get_charset(riak_object_view *obj) {
+    return riak_object_view_get_has_charset(obj) ? &(obj->charset) : NULL;
+}
+
+riak_boolean_t
+riak_object_view_get_has_last_mod(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_last_mod;
+}
+
+riak_uint32_t
+riak_object_view_get_last_mod(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->last_mod;
+}
+
+riak_boolean_t
+riak_object_view_get_has_last_mod_usecs(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_last_mod_usecs;
+}
+
+riak_uint32_t
+riak_object_view_get_last_mod_usecs(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->last_mod_usecs;
+}
+
+riak_boolean_t
+riak_object_view_get_has_content_type(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_content_type;
+}
+
+riak_binary*
+riak_object_view_get_content_type(riak_object_view *obj) {
+    return riak_object_view_get_has_content_type(obj) ? &(obj->content_type) : NULL;
+}
+
+riak_boolean_t
+riak_object_view_get_has_content_encoding(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_content_encoding;
+}
+
+riak_binary*
+riak_object_view_get_encoding(riak_object_view *obj) {
+    return riak_object_view_get_has_content_encoding(obj) ? &(obj->encoding) : NULL;
+}
+
+riak_boolean_t
+riak_object_view_get_has_deleted(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_deleted;
+}
+
+riak_boolean_t
+riak_object_view_get_deleted(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->deleted;
+}
+
+riak_boolean_t
+riak_object_view_get_has_vtag(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->has_vtag;
+}
+
+riak_binary*
+riak_object_view_get_vtag(riak_object_view *obj) {
+    return riak_object_view_get_has_vtag(obj) ? &(obj->vtag) : NULL;
+}
+
+riak_int32_t
+riak_object_view_get_n_links(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->n_links;
+}
+
+riak_link**
+riak_object_view_get_links(riak_object_view *obj) {
+    if (riak_object_view_get_n_links(obj) == 0 || obj->links) {
+        return obj->links;
+    }
+    if (riak_object_view_build(obj, RIAK_VIEW_LINKS, (void***)&(obj->links), obj->n_links)) {
+        riak_object_view_free_links(obj->parent->config, obj);
+    }
+    return obj->links;
+}
+
+riak_int32_t
+riak_object_view_get_n_usermeta(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->n_usermeta;
+}
+
+riak_pair**
+riak_object_view_get_usermeta(riak_object_view *obj) {
+    if (riak_object_view_get_n_usermeta(obj) == 0 || obj->usermeta) {
+        return obj->usermeta;
+    }
+    if (riak_object_view_build(obj, RIAK_VIEW_USERMETA, (void***)&(obj->usermeta), obj->n_usermeta)) {
+        riak_object_view_free_pairs(obj->parent->config, &(obj->usermeta), obj->n_usermeta);
+    }
+    return obj->usermeta;
+}
+
+riak_int32_t
+riak_object_view_get_n_indexes(riak_object_view *obj) {
+    return riak_object_view_scan(obj)->n_indexes;
+}
+
+riak_pair**
+riak_object_view_get_indexes(riak_object_view *obj) {
+    if (riak_object_view_get_n_indexes(obj) == 0 || obj->indexes) {
+        return obj->indexes;
+    }
+    if (riak_object_view_build(obj, RIAK_VIEW_INDEXES, (void***)&(obj->indexes), obj->n_indexes)) {
+        riak_object_view_free_pairs(obj->parent->config, &(obj->indexes), obj->n_indexes);
+    }
+    return obj->indexes;
+}
+
+static riak_binary*
+riak_view_shallow(riak_config *cfg,
+                  riak_binary *bin,
+                  riak_error  *err) {
+    riak_binary *copy = riak_binary_new_shallow(cfg, bin->len, bin->data);
+    if (copy == NULL) {
+        *err = ERIAK_OUT_OF_MEMORY;
+    }
+    return copy;
+}
+
+riak_error
+riak_object_view_to_object(riak_config       *cfg,
+                           riak_object_view  *ov,
+                           riak_object      **obj_target) {
+    riak_object_view_scan(ov);
+    if (ov->malformed) {
+        return ERIAK_MESSAGE_FORMAT;
+    }
+    riak_object *obj = riak_object_new(cfg);
+    if (obj == NULL) {
+        return ERIAK_OUT_OF_MEMORY;
+    }
+    riak_error err = ERIAK_OK;
+    riak_get_view *view = ov->parent;
+    if (view->bucket.data) {
+        obj->bucket = riak_view_shallow(cfg, &(view->bucket), &err);
+    }
+    if (view->has_key) {
+        obj->has_key = RIAK_TRUE;
+        obj->key     = riak_view_shallow(cfg, &(view->key), &err);
+    }
+    obj->value = riak_view_shallow(cfg, &(ov->value), &err);
+    if (ov->has_charset) {
+        obj->has_charset = RIAK_TRUE;
+        obj->charset     = riak_view_shallow(cfg, &(ov->charset), &err);
+    }
+    if (ov->has_content_type) {
+        obj->has_content_type = RIAK_TRUE;
+        obj->content_type     = riak_view_shallow(cfg, &(ov->content_type), &err);
+    }
+    if (ov->has_content_encoding) {
+        obj->has_content_encoding = RIAK_TRUE;
+        obj->encoding             = riak_view_shallow(cfg, &(ov->encoding), &err);
+    }
+    if (ov->has_vtag) {
+        obj->has_vtag = RIAK_TRUE;
+        obj->vtag     = riak_view_shallow(cfg, &(ov->vtag), &err);
+    }
+    obj->has_last_mod       = ov->has_last_mod;
+    obj->last_mod           = ov->last_mod;
+    obj->has_last_mod_usecs = ov->has_last_mod_usecs;
+    obj->last_mod_usecs     = ov->last_mod_usecs;
+    obj->has_deleted        = ov->has_deleted;
+    obj->deleted            = ov->deleted;
+
+    // The object takes over the arrays; they still point into the view
+    if (ov->n_links > 0) {
+        if (riak_object_view_get_links(ov) == NULL) err = ERIAK_OUT_OF_MEMORY;
+        obj->n_links = ov->n_links;
+        obj->links   = ov->links;
+        ov->links    = NULL;
+    }
+    if (ov->n_usermeta > 0) {
+        if (riak_object_view_get_usermeta(ov) == NULL) err = ERIAK_OUT_OF_MEMORY;
+        obj->n_usermeta = ov->n_usermeta;
+        obj->usermeta   = ov->usermeta;
+        ov->usermeta    = NULL;
+    }
+    if (ov->n_indexes > 0) {
+        if (riak_object_view_get_indexes(ov) == NULL) err = ERIAK_OUT_OF_MEMORY;
+        obj->n_indexes = ov->n_indexes;
+        obj->indexes   = ov->indexes;
+        ov->indexes    = NULL;
+    }
+    if (err) {
+        riak_object_free(cfg, &obj);
+        return err;
+    }
+    *obj_target = obj;
+    return ERIAK_OK;
+}
+
+riak_error
+riak_get_view_decode(riak_operation   *rop,
+                     riak_pb_message  *pbresp,
+                     riak_get_view   **resp,
+                     riak_boolean_t   *done) {
+    riak_config *cfg = riak_operation_get_config(rop);
+    *done = RIAK_TRUE;
+    // Skip the message code; the inbound buffer is reused once this returns
+    return riak_get_view_new(cfg, resp,
+                             riak_operation_get_bucket(rop),
+                             riak_operation_get_key(rop),
+                             pbresp->data + 1,
+                             pbresp->len - 1);
+}
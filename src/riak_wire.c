@@ -0,0 +1,184 @@
+/*********************************************************************
+ *
+ * riak_wire.c: Protocol buffer wire format scanning
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include "riak.h"
+#include "riak_wire-internal.h"
+
+void
+riak_wire_reader_init(riak_wire_reader *reader,
+                      riak_uint8_t     *data,
+                      riak_size_t       len) {
+    reader->pos    = data;
+    reader->end    = data + len;
+    reader->failed = RIAK_FALSE;
+}
+
+riak_boolean_t
+riak_wire_read_varint(riak_wire_reader *reader,
+                      riak_uint64_t    *value) {
+    riak_uint64_t result = 0;
+    int shift;
+    for(shift = 0; shift < 64; shift += 7) {
+        if (reader->pos >= reader->end) {
+            break;
+        }
+        riak_uint8_t byte = *(reader->pos)++;
+        result |= (riak_uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return RIAK_TRUE;
+        }
+    }
+    reader->failed = RIAK_TRUE;
+    return RIAK_FALSE;
+}
+
+riak_boolean_t
+riak_wire_next(riak_wire_reader *reader,
+               riak_wire_field  *field) {
+    if (reader->failed || reader->pos >= reader->end) {
+        return RIAK_FALSE;
+    }
+    riak_uint64_t tag;
+    if (!riak_wire_read_varint(reader, &tag)) {
+        return RIAK_FALSE;
+    }
+    field->number = (riak_uint32_t)(tag >> 3);
+    field->type   = (riak_uint32_t)(tag & 0x07);
+    field->value  = 0;
+    field->data   = NULL;
+    field->len    = 0;
+    riak_size_t left = reader->end - reader->pos;
+    switch (field->type) {
+    case RIAK_WIRE_VARINT:
+        return riak_wire_read_varint(reader, &(field->value));
+    case RIAK_WIRE_BYTES: {
+        riak_uint64_t len;
+        if (!riak_wire_read_varint(reader, &len)) {
+            return RIAK_FALSE;
+        }
+        if (len > (riak_uint64_t)(reader->end - reader->pos)) {
+            break;
+        }
+        field->data  = reader->pos;
+        field->len   = (riak_size_t)len;
+        reader->pos += len;
+        return RIAK_TRUE;
+    }
+    case RIAK_WIRE_FIXED64:
+    case RIAK_WIRE_FIXED32: {
+        riak_size_t width = (field->type == RIAK_WIRE_FIXED64) ? 8 : 4;
+        if (left < width) {
+            break;
+        }
+        riak_size_t i;
+        for(i = 0; i < width; i++) {
+            field->value |= (riak_uint64_t)reader->pos[i] << (8 * i);
+        }
+        reader->pos += width;
+        return RIAK_TRUE;
+    }
+    default:
+        // Groups are deprecated and never sent by Riak
+        break;
+    }
+    reader->failed = RIAK_TRUE;
+    return RIAK_FALSE;
+}
+
+riak_int32_t
+riak_wire_count(riak_uint8_t *data,
+                riak_size_t   len,
+                riak_uint32_t number) {
+    riak_wire_reader reader;
+    riak_wire_field  field;
+    riak_int32_t     count = 0;
+    riak_wire_reader_init(&reader, data, len);
+    while (riak_wire_next(&reader, &field)) {
+        if (field.number == number && field.type == RIAK_WIRE_BYTES) {
+            count++;
+        }
+    }
+    return reader.failed ? -1 : count;
+}
+
+riak_size_t
+riak_wire_varint_size(riak_uint64_t value) {
+    riak_size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+riak_size_t
+riak_wire_uint_size(riak_uint32_t number,
+                    riak_uint64_t value) {
+    return riak_wire_varint_size((riak_uint64_t)number << 3) + riak_wire_varint_size(value);
+}
+
+riak_size_t
+riak_wire_bytes_size(riak_uint32_t number,
+                     riak_size_t   len) {
+    return riak_wire_varint_size((riak_uint64_t)number << 3) + riak_wire_varint_size(len) + len;
+}
+
+riak_uint8_t*
+riak_wire_put_varint(riak_uint8_t *pos,
+                     riak_uint64_t value) {
+    while (value >= 0x80) {
+        *pos++ = (riak_uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *pos++ = (riak_uint8_t)value;
+    return pos;
+}
+
+riak_uint8_t*
+riak_wire_put_uint(riak_uint8_t *pos,
+                   riak_uint32_t number,
+                   riak_uint64_t value) {
+    pos = riak_wire_put_varint(pos, ((riak_uint64_t)number << 3) | RIAK_WIRE_VARINT);
+    return riak_wire_put_varint(pos, value);
+}
+
+riak_uint8_t*
+riak_wire_put_header(riak_uint8_t *pos,
+                     riak_uint32_t number,
+                     riak_size_t   len) {
+    pos = riak_wire_put_varint(pos, ((riak_uint64_t)number << 3) | RIAK_WIRE_BYTES);
+    return riak_wire_put_varint(pos, len);
+}
+
+riak_uint8_t*
+riak_wire_put_bytes(riak_uint8_t *pos,
+                    riak_uint32_t number,
+                    riak_uint8_t *data,
+                    riak_size_t   len) {
+    pos = riak_wire_put_header(pos, number, len);
+    if (len > 0) {
+        memcpy((void*)pos, (void*)data, len);
+    }
+    return pos + len;
+}
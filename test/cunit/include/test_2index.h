@@ -58,3 +58,9 @@ test_2index_options_pagination_sort();
 
 void
 test_2index_response_decode();
+
+void
+test_2index_response_stream();
+
+void
+test_2index_cursor_pages();
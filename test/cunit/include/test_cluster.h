@@ -0,0 +1,36 @@
+/*********************************************************************
+ *
+ * test_cluster.h: Riak C Unit testing for Riak Clusters
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+void
+test_cluster_round_robin();
+
+void
+test_cluster_least_outstanding();
+
+void
+test_cluster_marks_node_down();
+
+void
+test_cluster_no_nodes();
+
+void
+test_cluster_failover_mid_stream();
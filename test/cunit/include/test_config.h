@@ -34,3 +34,18 @@ test_config_allocate_clean();
 
 void
 test_config_free();
+
+void
+test_config_arena();
+
+void
+test_config_arena_protobuf();
+
+void
+test_config_pb_allocator_private();
+
+void
+test_config_thread_context();
+
+void
+test_config_free_thread_contexts();
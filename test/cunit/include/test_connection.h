@@ -26,3 +26,12 @@ test_connection_with_good_resolver();
 void
 test_connection_with_bad_resolver();
 
+void
+test_connection_tries_every_address();
+
+void
+test_connection_read_timeout();
+
+void
+test_connection_retry_backoff();
+
@@ -0,0 +1,63 @@
+/*********************************************************************
+ *
+ * test_connection_pool.h: Riak C Unit testing for Connection Pools
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+/**
+ * @brief Listen on an ephemeral loopback port so connects succeed without a Riak node
+ * @param portnum Port number as a string (out)
+ * @param len Length of `portnum`
+ * @returns Listening socket, or -1
+ */
+int
+test_listen_on_loopback(char       *portnum,
+                        riak_size_t len);
+
+#define TEST_SERVER_MAX_CONNECTIONS 8
+
+typedef struct _test_reply_server {
+    int            listener;
+    int            n_connections;  // Accepted before serving
+    riak_boolean_t silent;         // Read requests but never answer
+    riak_uint32_t  error_every;    // Every Nth request gets an error (0 for none)
+    riak_uint32_t  n_requests;
+} test_reply_server;
+
+/**
+ * @brief Thread body answering each framed request with "not found" or an error
+ * @param ptr Test reply server; returns once every connection has closed
+ */
+void*
+test_serve_replies(void *ptr);
+
+void
+test_connection_pool_checkout_checkin();
+
+void
+test_connection_pool_exhausted();
+
+void
+test_connection_pool_checkin_beyond_capacity();
+
+void
+test_connection_pool_connect_failure();
+
+void
+test_connection_pool_evicts_dead();
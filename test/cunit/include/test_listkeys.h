@@ -22,3 +22,9 @@
 
 void
 test_listkeys_response_decode();
+
+void
+test_listkeys_response_stream();
+
+void
+test_listkeys_response_growth();
@@ -22,3 +22,9 @@
 
 void
 test_mapreduce_response_decode();
+
+void
+test_mapreduce_response_stream();
+
+void
+test_mapreduce_register_streaming();
@@ -0,0 +1,34 @@
+/*********************************************************************
+ *
+ * test_wire.h: Riak C Unit testing for the hand-written Get/Put codec
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+void
+test_wire_varint();
+
+void
+test_wire_get_request_matches_protobuf();
+
+void
+test_wire_put_request_matches_protobuf();
+
+void
+test_wire_put_response_decode();
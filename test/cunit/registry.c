@@ -32,17 +32,33 @@
 #include "test_binary.h"
 #include "test_config.h"
 #include "test_connection.h"
+#include "test_connection_pool.h"
 #include "test_operation.h"
+#include "test_pipeline.h"
 #include "test_serverinfo.h"
+#include "test_uring.h"
 #include "test_clientid.h"
+#include "test_cluster.h"
 #include "test_delete.h"
+#include "test_cache.h"
+#include "test_counter.h"
+#include "test_csbucket.h"
+#include "test_notfound_filter.h"
+#include "test_dt.h"
+#include "test_epoll.h"
 #include "test_get.h"
+#include "test_libevent.h"
 #include "test_put.h"
+#include "test_runtime.h"
 #include "test_listbuckets.h"
 #include "test_listkeys.h"
 #include "test_bucketprops.h"
+#include "test_bulk.h"
 #include "test_mapreduce.h"
+#include "test_multiget.h"
 #include "test_search.h"
+#include "test_view.h"
+#include "test_wire.h"
 
 int
 main(int   argc,
@@ -71,18 +87,69 @@ main(int   argc,
     CU_ADD_TEST(config_suite, test_build_config);
     CU_ADD_TEST(connection_suite, test_connection_with_bad_resolver);
     CU_ADD_TEST(connection_suite, test_connection_with_good_resolver);
+    CU_ADD_TEST(connection_suite, test_connection_tries_every_address);
+    CU_ADD_TEST(connection_suite, test_connection_read_timeout);
+    CU_ADD_TEST(connection_suite, test_connection_retry_backoff);
+    CU_ADD_TEST(connection_suite, test_connection_pool_checkout_checkin);
+    CU_ADD_TEST(connection_suite, test_connection_pool_exhausted);
+    CU_ADD_TEST(connection_suite, test_connection_pool_checkin_beyond_capacity);
+    CU_ADD_TEST(connection_suite, test_connection_pool_connect_failure);
+    CU_ADD_TEST(connection_suite, test_connection_pool_evicts_dead);
+    CU_ADD_TEST(connection_suite, test_cluster_round_robin);
+    CU_ADD_TEST(connection_suite, test_cluster_least_outstanding);
+    CU_ADD_TEST(connection_suite, test_cluster_marks_node_down);
+    CU_ADD_TEST(connection_suite, test_cluster_no_nodes);
+    CU_ADD_TEST(connection_suite, test_cluster_failover_mid_stream);
+    CU_ADD_TEST(connection_suite, test_multiget_per_key_errors);
+    CU_ADD_TEST(connection_suite, test_multiget_parallel);
+    CU_ADD_TEST(connection_suite, test_multiget_small_pool);
+    CU_ADD_TEST(connection_suite, test_bulk_load_retries);
+    CU_ADD_TEST(connection_suite, test_bulk_load_gives_up);
+    CU_ADD_TEST(connection_suite, test_bulk_load_precondition);
+    CU_ADD_TEST(connection_suite, test_aggregator_folds_increments);
+    CU_ADD_TEST(connection_suite, test_aggregator_keeps_failed_sums);
+    CU_ADD_TEST(connection_suite, test_aggregator_reclaims_idle_keys);
+    CU_ADD_TEST(connection_suite, test_libevent_engine_many_ops);
+    CU_ADD_TEST(connection_suite, test_libevent_engine_timeout);
+#ifdef __linux__
+    CU_ADD_TEST(connection_suite, test_epoll_many_ops);
+    CU_ADD_TEST(connection_suite, test_epoll_timeout);
+    CU_ADD_TEST(connection_suite, test_runtime_many_threads);
+    CU_ADD_TEST(connection_suite, test_runtime_key_hash);
+#endif
+#ifdef RIAK_USE_IO_URING
+    CU_ADD_TEST(connection_suite, test_uring_many_ops);
+    CU_ADD_TEST(connection_suite, test_uring_timeout);
+#endif
     CU_ADD_TEST(config_suite, test_config_with_logging);
     CU_ADD_TEST(config_suite, test_config_allocate);
     CU_ADD_TEST(config_suite, test_config_allocate_clean);
     CU_ADD_TEST(config_suite, test_config_free);
+    CU_ADD_TEST(config_suite, test_config_arena);
+    CU_ADD_TEST(config_suite, test_config_arena_protobuf);
+    CU_ADD_TEST(config_suite, test_config_pb_allocator_private);
+    CU_ADD_TEST(config_suite, test_config_thread_context);
+    CU_ADD_TEST(config_suite, test_config_free_thread_contexts);
     CU_ADD_TEST(operation_suite, test_operation_new);
     CU_ADD_TEST(operation_suite, test_operation_callbacks);
+    CU_ADD_TEST(operation_suite, test_pipeline_in_order);
+    CU_ADD_TEST(operation_suite, test_pipeline_peer_closed);
+    CU_ADD_TEST(operation_suite, test_writev_single_call);
+    CU_ADD_TEST(operation_suite, test_read_buffered_frames);
     CU_ADD_TEST(messages_suite, test_server_info_encode_request);
     CU_ADD_TEST(messages_suite, test_server_info_decode_good_response);
     CU_ADD_TEST(messages_suite, test_server_info_decode_bad_response);
     CU_ADD_TEST(messages_suite, test_set_clientid);
     CU_ADD_TEST(messages_suite, test_get_clientid);
     CU_ADD_TEST(messages_suite, test_delete_encode_request);
+    CU_ADD_TEST(messages_suite, test_counter_update_encode);
+    CU_ADD_TEST(messages_suite, test_counter_get_decode);
+    CU_ADD_TEST(messages_suite, test_csbucket_encode_request);
+    CU_ADD_TEST(messages_suite, test_csbucket_decode_response);
+    CU_ADD_TEST(messages_suite, test_dt_counter_set_folding);
+    CU_ADD_TEST(messages_suite, test_dt_map_encode);
+    CU_ADD_TEST(messages_suite, test_dt_fetch_decode);
+    CU_ADD_TEST(messages_suite, test_dt_update_decode);
     CU_ADD_TEST(messages_suite, test_get_options_r);
     CU_ADD_TEST(messages_suite, test_get_options_pr);
     CU_ADD_TEST(messages_suite, test_get_options_basic_quorum);
@@ -94,6 +161,14 @@ main(int   argc,
     CU_ADD_TEST(messages_suite, test_get_options_sloppy_quorum);
     CU_ADD_TEST(messages_suite, test_get_options_n_val);
     CU_ADD_TEST(messages_suite, test_get_decode_response);
+    CU_ADD_TEST(messages_suite, test_get_template_matches_encode);
+    CU_ADD_TEST(messages_suite, test_view_matches_eager_decode);
+    CU_ADD_TEST(messages_suite, test_view_malformed);
+    CU_ADD_TEST(messages_suite, test_view_fetch);
+    CU_ADD_TEST(messages_suite, test_wire_varint);
+    CU_ADD_TEST(messages_suite, test_wire_get_request_matches_protobuf);
+    CU_ADD_TEST(messages_suite, test_wire_put_request_matches_protobuf);
+    CU_ADD_TEST(messages_suite, test_wire_put_response_decode);
     CU_ADD_TEST(messages_suite, test_put_options_vclock);
     CU_ADD_TEST(messages_suite, test_put_options_w);
     CU_ADD_TEST(messages_suite, test_put_options_dw);
@@ -109,8 +184,12 @@ main(int   argc,
     CU_ADD_TEST(messages_suite, test_put_decode_response);
     CU_ADD_TEST(messages_suite, test_listbuckets_response_decode);
     CU_ADD_TEST(messages_suite, test_listkeys_response_decode);
+    CU_ADD_TEST(messages_suite, test_listkeys_response_stream);
+    CU_ADD_TEST(messages_suite, test_listkeys_response_growth);
     CU_ADD_TEST(messages_suite, test_bucketprops);
     CU_ADD_TEST(messages_suite, test_mapreduce_response_decode);
+    CU_ADD_TEST(messages_suite, test_mapreduce_response_stream);
+    CU_ADD_TEST(messages_suite, test_mapreduce_register_streaming);
     CU_ADD_TEST(messages_suite, test_2index_options_qtype);
     CU_ADD_TEST(messages_suite, test_2index_options_key);
     CU_ADD_TEST(messages_suite, test_2index_options_range_min);
@@ -123,6 +202,13 @@ main(int   argc,
     CU_ADD_TEST(messages_suite, test_2index_options_term_regex);
     CU_ADD_TEST(messages_suite, test_2index_options_pagination_sort);
     CU_ADD_TEST(messages_suite, test_2index_response_decode);
+    CU_ADD_TEST(messages_suite, test_2index_response_stream);
+    CU_ADD_TEST(operation_suite, test_2index_cursor_pages);
+    CU_ADD_TEST(operation_suite, test_csbucket_fold_pages);
+    CU_ADD_TEST(operation_suite, test_cache_revalidates);
+    CU_ADD_TEST(operation_suite, test_cache_evicts_oldest);
+    CU_ADD_TEST(operation_suite, test_notfound_filter_membership);
+    CU_ADD_TEST(operation_suite, test_notfound_filter_answers_locally);
     CU_ADD_TEST(messages_suite, test_search_options_rows);
     CU_ADD_TEST(messages_suite, test_search_options_start);
     CU_ADD_TEST(messages_suite, test_search_options_sort);
@@ -30,6 +30,7 @@
 #include "riak.h"
 #include "riak_messages-internal.h"
 #include "riak_operation-internal.h"
+#include "test_connection_pool.h"
 
 void
 test_2index_options_qtype() {
@@ -319,3 +320,177 @@ test_2index_response_decode() {
     riak_config_free(&cfg);
     CU_PASS("test_2index_response_decode passed")
 }
+
+typedef struct _test_2index_stream_state {
+    riak_config  *cfg;
+    riak_uint32_t n_calls;
+    riak_uint32_t n_keys;
+    char          keys[8][8];
+} test_2index_stream_state;
+
+static void
+test_2index_stream_cb(riak_2index_response *chunk,
+                      void                 *ptr) {
+    test_2index_stream_state *state = (test_2index_stream_state*)ptr;
+    riak_binary **keys = riak_2index_get_keys(chunk);
+    int i;
+    for(i = 0; i < riak_2index_get_n_keys(chunk) && state->n_keys < 8; i++) {
+        snprintf(state->keys[state->n_keys++], sizeof(state->keys[0]), "%.*s",
+                 (int)riak_binary_len(keys[i]), (char*)riak_binary_data(keys[i]));
+    }
+    state->n_calls++;
+    riak_2index_response_free(state->cfg, &chunk);
+}
+
+void
+test_2index_response_stream() {
+    riak_config     *cfg;
+    riak_operation  *rop = NULL;
+    riak_connection *cxn = NULL;
+
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    test_2index_stream_state state;
+    memset(&state, '\0', sizeof(state));
+    state.cfg = cfg;
+    riak_2index_set_stream_cb(rop, test_2index_stream_cb, &state);
+
+    // keys "k1","k2"; key "k3"; continuation "c1" and done
+    riak_uint8_t bytes0[] = { 0x1a,0x0a,0x02,0x6b,0x31,0x0a,0x02,0x6b,0x32 };
+    riak_uint8_t bytes1[] = { 0x1a,0x0a,0x02,0x6b,0x33 };
+    riak_uint8_t bytes2[] = { 0x1a,0x1a,0x02,0x63,0x31,0x20,0x01 };
+    riak_uint8_t *bytes[] = { bytes0, bytes1, bytes2 };
+    riak_int32_t len[]    = { sizeof(bytes0), sizeof(bytes1), sizeof(bytes2) };
+
+    riak_pb_message       pb_response;
+    riak_2index_response *response = NULL;
+    riak_boolean_t        done = RIAK_FALSE;
+    for(int i = 0; i < 3; i++) {
+        pb_response.data = bytes[i];
+        pb_response.len  = len[i];
+        err = riak_2index_response_decode(rop, &pb_response, &response, &done);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        // Each chunk is handed over as soon as it is decoded
+        CU_ASSERT_EQUAL(state.n_calls, i+1)
+    }
+    CU_ASSERT_TRUE(done)
+    CU_ASSERT_EQUAL(state.n_keys, 3)
+    CU_ASSERT_STRING_EQUAL(state.keys[2], "k3")
+    // The summary keeps counts and the continuation, not the keys
+    CU_ASSERT_EQUAL(riak_2index_get_n_keys(response), 3)
+    CU_ASSERT_PTR_NULL(riak_2index_get_keys(response))
+    CU_ASSERT_TRUE(riak_2index_get_has_continuation(response))
+    riak_binary *continuation = riak_2index_get_continuation(response);
+    CU_ASSERT_EQUAL(memcmp(riak_binary_data(continuation), "c1", riak_binary_len(continuation)), 0)
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_2index_response_free(cfg, &response);
+    riak_config_free(&cfg);
+    CU_PASS("test_2index_response_stream passed")
+}
+
+/**
+ * @brief Read one framed request off the server side of a connection
+ * @returns Frame length, excluding the 4-byte length prefix
+ */
+static riak_uint32_t
+test_2index_read_frame(int           server,
+                       riak_uint8_t *buf,
+                       riak_size_t   len) {
+    riak_uint8_t  header[4];
+    riak_size_t   total = 0;
+    while (total < sizeof(header)) {
+        riak_ssize_t got = read(server, header + total, sizeof(header) - total);
+        CU_ASSERT_FATAL(got > 0)
+        total += got;
+    }
+    riak_uint32_t frame_len = ((riak_uint32_t)header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+    CU_ASSERT_FATAL(frame_len <= len)
+    total = 0;
+    while (total < frame_len) {
+        riak_ssize_t got = read(server, buf + total, frame_len - total);
+        CU_ASSERT_FATAL(got > 0)
+        total += got;
+    }
+    return frame_len;
+}
+
+static riak_boolean_t
+test_2index_contains(riak_uint8_t *buf,
+                     riak_uint32_t len,
+                     const char   *needle) {
+    riak_size_t n = strlen(needle);
+    riak_uint32_t i;
+    for(i = 0; i + n <= len; i++) {
+        if (memcmp(buf + i, needle, n) == 0) return RIAK_TRUE;
+    }
+    return RIAK_FALSE;
+}
+
+void
+test_2index_cursor_pages() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+
+    // Page 1: "k1","k2" then continuation "c1"; page 2: "k3" and done
+    riak_uint8_t pages[] = { 0,0,0,9,  26,0x0a,0x02,0x6b,0x31,0x0a,0x02,0x6b,0x32,
+                             0,0,0,7,  26,0x1a,0x02,0x63,0x31,0x20,0x01,
+                             0,0,0,7,  26,0x0a,0x02,0x6b,0x33,0x20,0x01 };
+    CU_ASSERT_FATAL(write(server, pages, sizeof(pages)) == sizeof(pages))
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *index  = riak_binary_copy_from_string(cfg, "i_bin");
+    test_2index_stream_state state;
+    memset(&state, '\0', sizeof(state));
+    state.cfg = cfg;
+    riak_2index_cursor *cursor = NULL;
+    err = riak_2index_cursor_new(cxn, &cursor, bucket, index, NULL, 2, test_2index_stream_cb, &state);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    err = riak_2index_cursor_next(cursor);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(state.n_keys, 2)
+    CU_ASSERT_FALSE(riak_2index_cursor_get_done(cursor))
+    // The second page was requested before the first reached the callback
+    CU_ASSERT_EQUAL(riak_connection_get_n_pending(cxn), 1)
+
+    err = riak_2index_cursor_run(cursor);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_TRUE(riak_2index_cursor_get_done(cursor))
+    CU_ASSERT_EQUAL(riak_2index_cursor_get_n_pages(cursor), 2)
+    CU_ASSERT_EQUAL(state.n_keys, 3)
+    CU_ASSERT_STRING_EQUAL(state.keys[0], "k1")
+    CU_ASSERT_STRING_EQUAL(state.keys[2], "k3")
+
+    riak_uint8_t  buf[256];
+    riak_uint32_t len = test_2index_read_frame(server, buf, sizeof(buf));
+    CU_ASSERT_EQUAL(buf[0], 25)
+    CU_ASSERT_FALSE(test_2index_contains(buf, len, "c1"))
+    len = test_2index_read_frame(server, buf, sizeof(buf));
+    CU_ASSERT_EQUAL(buf[0], 25)
+    CU_ASSERT_TRUE(test_2index_contains(buf, len, "c1"))
+
+    riak_2index_cursor_free(&cursor);
+    CU_ASSERT_PTR_NULL(cursor)
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &index);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(server);
+    close(listener);
+    CU_PASS("test_2index_cursor_pages passed")
+}
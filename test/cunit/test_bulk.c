@@ -0,0 +1,161 @@
+/*********************************************************************
+ *
+ * test_bulk.c: Riak C Unit testing for bulk loads
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+#include "test_bulk.h"
+
+// Length 1, RpbPutResp
+static const riak_uint8_t test_bulk_stored[] = { 0, 0, 0, 1, 12 };
+// Length 8, RpbErrorResp "bad", errcode 1
+static const riak_uint8_t test_bulk_error[] = { 0, 0, 0, 8, 0, 0x0a, 0x03, 0x62, 0x61, 0x64, 0x10, 0x01 };
+
+typedef struct _test_bulk_source_data {
+    riak_uint32_t n_objects;
+    riak_uint32_t n_calls;
+} test_bulk_source_data;
+
+static riak_error
+test_bulk_source(riak_config  *cfg,
+                 riak_object **object,
+                 void         *ptr) {
+    test_bulk_source_data *data = (test_bulk_source_data*)ptr;
+    *object = NULL;
+    if (data->n_calls >= data->n_objects) {
+        return ERIAK_OK;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), "key%d", data->n_calls++);
+    riak_object *obj = riak_object_new(cfg);
+    riak_object_set_bucket(obj, riak_binary_copy_from_string(cfg, "b"));
+    riak_object_set_key(obj, riak_binary_copy_from_string(cfg, key));
+    riak_object_set_value(obj, riak_binary_copy_from_string(cfg, "v"));
+    *object = obj;
+    return ERIAK_OK;
+}
+
+/**
+ * @brief Run a three-object load on one connection against canned replies
+ */
+static riak_error
+test_bulk_run(const riak_uint8_t **replies,
+              const riak_size_t   *lens,
+              riak_uint32_t        n_replies,
+              riak_uint32_t        retries,
+              riak_boolean_t       if_none_match,
+              riak_bulk_stats     *stats) {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+    riak_uint32_t i;
+    for(i = 0; i < n_replies; i++) {
+        CU_ASSERT_FATAL(write(server, replies[i], lens[i]) == lens[i])
+    }
+
+    riak_bulk_options opts;
+    riak_bulk_options_init(&opts);
+    opts.concurrency  = 1;
+    opts.window       = 4;
+    opts.retries      = retries;
+    opts.backoff_base = 1;
+    opts.backoff_max  = 1;
+    riak_put_options *put_opts = NULL;
+    if (if_none_match) {
+        put_opts = riak_put_options_new(cfg);
+        CU_ASSERT_FATAL(put_opts != NULL)
+        riak_put_options_set_if_none_match(put_opts, RIAK_TRUE);
+    }
+    test_bulk_source_data data = { 3, 0 };
+    err = riak_bulk_load(pool, put_opts, &opts, test_bulk_source, &data, stats);
+    CU_ASSERT_EQUAL(data.n_calls, 3)
+    // The connection stayed in step and went back to the pool
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 1)
+
+    riak_put_options_free(cfg, &put_opts);
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    close(server);
+    close(listener);
+    return err;
+}
+
+void
+test_bulk_load_retries() {
+    // The second object fails once and goes out again in the next window
+    const riak_uint8_t *replies[] = { test_bulk_stored, test_bulk_error, test_bulk_stored, test_bulk_stored };
+    const riak_size_t   lens[]    = { sizeof(test_bulk_stored), sizeof(test_bulk_error), sizeof(test_bulk_stored), sizeof(test_bulk_stored) };
+    riak_bulk_stats stats;
+    riak_error err = test_bulk_run(replies, lens, 4, 1, RIAK_FALSE, &stats);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(stats.n_stored, 3)
+    CU_ASSERT_EQUAL(stats.n_retries, 1)
+    CU_ASSERT_EQUAL(stats.n_failed, 0)
+    char output[512];
+    riak_bulk_stats_print(&stats, output, sizeof(output));
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "Stored: 3"))
+    CU_PASS("test_bulk_load_retries passed")
+}
+
+void
+test_bulk_load_gives_up() {
+    const riak_uint8_t *replies[] = { test_bulk_stored, test_bulk_error, test_bulk_stored };
+    const riak_size_t   lens[]    = { sizeof(test_bulk_stored), sizeof(test_bulk_error), sizeof(test_bulk_stored) };
+    riak_bulk_stats stats;
+    riak_error err = test_bulk_run(replies, lens, 3, 0, RIAK_FALSE, &stats);
+    CU_ASSERT_EQUAL(err, ERIAK_SERVER_ERROR)
+    CU_ASSERT_EQUAL(stats.n_stored, 2)
+    CU_ASSERT_EQUAL(stats.n_retries, 0)
+    CU_ASSERT_EQUAL(stats.n_failed, 1)
+    CU_PASS("test_bulk_load_gives_up passed")
+}
+
+void
+test_bulk_load_precondition() {
+    // A failed if_none_match is final, retries or not
+    const riak_uint8_t *replies[] = { test_bulk_stored, test_bulk_error, test_bulk_stored };
+    const riak_size_t   lens[]    = { sizeof(test_bulk_stored), sizeof(test_bulk_error), sizeof(test_bulk_stored) };
+    riak_bulk_stats stats;
+    riak_error err = test_bulk_run(replies, lens, 3, 3, RIAK_TRUE, &stats);
+    CU_ASSERT_EQUAL(err, ERIAK_SERVER_ERROR)
+    CU_ASSERT_EQUAL(stats.n_stored, 2)
+    CU_ASSERT_EQUAL(stats.n_retries, 0)
+    CU_ASSERT_EQUAL(stats.n_failed, 1)
+    CU_PASS("test_bulk_load_precondition passed")
+}
@@ -0,0 +1,266 @@
+/*********************************************************************
+ *
+ * test_cache.c: Riak C Unit testing for the object cache
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "test_connection_pool.h"
+#include "test_cache.h"
+
+// Length 3, RpbGetResp with unchanged set
+static const riak_uint8_t test_cache_unchanged[] = { 0, 0, 0, 3, 10, 0x18, 0x01 };
+// Length 1, RpbDelResp
+static const riak_uint8_t test_cache_deleted[] = { 0, 0, 0, 1, 14 };
+
+static riak_size_t
+test_cache_frame(riak_uint8_t *buf,
+                 const char   *value,
+                 const char   *vclock) {
+    RpbContent content;
+    RpbContent *contents[1] = { &content };
+    RpbGetResp msg;
+    rpb_content__init(&content);
+    content.value.data = (uint8_t*)value;
+    content.value.len  = strlen(value);
+    rpb_get_resp__init(&msg);
+    msg.n_content  = 1;
+    msg.content    = contents;
+    msg.has_vclock = 1;
+    msg.vclock.data = (uint8_t*)vclock;
+    msg.vclock.len  = strlen(vclock);
+    riak_uint32_t len = rpb_get_resp__get_packed_size(&msg) + 1;
+    buf[0] = (len >> 24) & 0xff;
+    buf[1] = (len >> 16) & 0xff;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+    buf[4] = MSG_RPBGETRESP;
+    rpb_get_resp__pack(&msg, buf + 5);
+    return len + 4;
+}
+
+static void
+test_cache_reply(int         server,
+                 const char *value,
+                 const char *vclock) {
+    riak_uint8_t frame[256];
+    riak_size_t len = test_cache_frame(frame, value, vclock);
+    CU_ASSERT_FATAL(write(server, frame, len) == len)
+}
+
+/**
+ * @brief Read one request off the wire, returning the vclock it was conditional on
+ */
+static riak_boolean_t
+test_cache_read_request(int         server,
+                        char       *if_modified,
+                        riak_size_t len) {
+    riak_uint8_t header[4];
+    riak_uint8_t body[256];
+    if_modified[0] = '\0';
+    CU_ASSERT_FATAL(read(server, header, sizeof(header)) == sizeof(header))
+    riak_uint32_t frame_len = (header[2] << 8) | header[3];
+    CU_ASSERT_FATAL(frame_len <= sizeof(body))
+    CU_ASSERT_FATAL(read(server, body, frame_len) == frame_len)
+    CU_ASSERT_EQUAL_FATAL(body[0], MSG_RPBGETREQ)
+    RpbGetReq *req = rpb_get_req__unpack(NULL, frame_len - 1, body + 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    riak_boolean_t conditional = req->has_if_modified;
+    if (conditional) {
+        snprintf(if_modified, len, "%.*s", (int)req->if_modified.len, req->if_modified.data);
+    }
+    rpb_get_req__free_unpacked(req, NULL);
+    return conditional;
+}
+
+static riak_boolean_t
+test_cache_value_is(riak_get_response *response,
+                    const char        *value) {
+    if (response == NULL || riak_get_get_n_content(response) != 1) {
+        return RIAK_FALSE;
+    }
+    riak_binary *bin = riak_object_get_value(riak_get_get_content(response)[0]);
+    return (riak_binary_len(bin) == strlen(value) &&
+            memcmp(riak_binary_data(bin), value, strlen(value)) == 0);
+}
+
+void
+test_cache_revalidates() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "pages");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "home");
+    riak_get_response *response = NULL;
+    char if_modified[16];
+
+    // A long TTL answers the second fetch without a round trip
+    riak_cache *cache = NULL;
+    err = riak_cache_new(cfg, &cache, 4, 64, 64 * 1024, 60000);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    test_cache_reply(server, "v1", "vc1");
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_FALSE(test_cache_read_request(server, if_modified, sizeof(if_modified)))
+    riak_get_response_free(cfg, &response);
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(test_cache_value_is(response, "v1"))
+    CU_ASSERT_EQUAL(riak_cache_get_hits(cache), 1)
+    CU_ASSERT_EQUAL(riak_cache_get_misses(cache), 1)
+    CU_ASSERT_EQUAL(riak_cache_get_n_entries(cache), 1)
+    riak_get_response_free(cfg, &response);
+
+    // Deleting through the cache drops the copy
+    CU_ASSERT_FATAL(write(server, test_cache_deleted, sizeof(test_cache_deleted)) == sizeof(test_cache_deleted))
+    err = riak_cache_delete(cxn, cache, bucket, key, NULL);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_cache_get_n_entries(cache), 0)
+    CU_ASSERT_EQUAL(riak_cache_get_n_bytes(cache), 0)
+    riak_uint8_t skip[64];
+    CU_ASSERT_FATAL(read(server, skip, sizeof(skip)) > 0)
+    riak_cache_free(&cache);
+    CU_ASSERT_PTR_NULL(cache)
+
+    // With no TTL every fetch sends the cached vclock
+    err = riak_cache_new(cfg, &cache, 1, 64, 64 * 1024, 0);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    test_cache_reply(server, "v1", "vc1");
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    test_cache_read_request(server, if_modified, sizeof(if_modified));
+    riak_get_response_free(cfg, &response);
+
+    // Unchanged on the server, so the body comes from the cache
+    CU_ASSERT_FATAL(write(server, test_cache_unchanged, sizeof(test_cache_unchanged)) == sizeof(test_cache_unchanged))
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(test_cache_read_request(server, if_modified, sizeof(if_modified)))
+    CU_ASSERT_STRING_EQUAL(if_modified, "vc1")
+    CU_ASSERT_TRUE(test_cache_value_is(response, "v1"))
+    CU_ASSERT_EQUAL(riak_cache_get_revalidated(cache), 1)
+    riak_get_response_free(cfg, &response);
+
+    // Changed on the server, so the new body replaces the copy
+    test_cache_reply(server, "v2", "vc2");
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(test_cache_read_request(server, if_modified, sizeof(if_modified)))
+    CU_ASSERT_TRUE(test_cache_value_is(response, "v2"))
+    CU_ASSERT_EQUAL(riak_cache_get_misses(cache), 2)
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_FATAL(write(server, test_cache_unchanged, sizeof(test_cache_unchanged)) == sizeof(test_cache_unchanged))
+    err = riak_cache_get(cxn, cache, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(test_cache_read_request(server, if_modified, sizeof(if_modified)))
+    CU_ASSERT_STRING_EQUAL(if_modified, "vc2")
+    CU_ASSERT_TRUE(test_cache_value_is(response, "v2"))
+    riak_get_response_free(cfg, &response);
+
+    riak_cache_free(&cache);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_connection_free(&cxn);
+    close(server);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_cache_revalidates passed")
+}
+
+void
+test_cache_evicts_oldest() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+    riak_cache *cache = NULL;
+    err = riak_cache_new(cfg, &cache, 1, 2, 64 * 1024, 60000);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "pages");
+    riak_binary *keys[3];
+    keys[0] = riak_binary_copy_from_string(cfg, "a");
+    keys[1] = riak_binary_copy_from_string(cfg, "b");
+    keys[2] = riak_binary_copy_from_string(cfg, "c");
+    riak_get_response *response = NULL;
+    char if_modified[16];
+    int i;
+    for(i = 0; i < 3; i++) {
+        test_cache_reply(server, "value", "vc");
+        err = riak_cache_get(cxn, cache, bucket, keys[i], NULL, &response);
+        CU_ASSERT_EQUAL(err, ERIAK_OK)
+        test_cache_read_request(server, if_modified, sizeof(if_modified));
+        riak_get_response_free(cfg, &response);
+    }
+    CU_ASSERT_EQUAL(riak_cache_get_n_entries(cache), 2)
+
+    // "b" and "c" are still held; "a" was the least recently used
+    err = riak_cache_get(cxn, cache, bucket, keys[1], NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_EQUAL(riak_cache_get_hits(cache), 1)
+    test_cache_reply(server, "value", "vc");
+    err = riak_cache_get(cxn, cache, bucket, keys[0], NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_FALSE(test_cache_read_request(server, if_modified, sizeof(if_modified)))
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_EQUAL(riak_cache_get_misses(cache), 4)
+
+    // Fetching "a" again pushed out "c", not the recently read "b"
+    err = riak_cache_get(cxn, cache, bucket, keys[1], NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_EQUAL(riak_cache_get_hits(cache), 2)
+    riak_cache_invalidate(cache, bucket, keys[1]);
+    CU_ASSERT_EQUAL(riak_cache_get_n_entries(cache), 1)
+    CU_ASSERT(riak_cache_get_n_bytes(cache) > 0)
+
+    riak_cache_free(&cache);
+    for(i = 0; i < 3; i++) {
+        riak_binary_free(cfg, &keys[i]);
+    }
+    riak_binary_free(cfg, &bucket);
+    riak_connection_free(&cxn);
+    close(server);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_cache_evicts_oldest passed")
+}
@@ -0,0 +1,283 @@
+/*********************************************************************
+ *
+ * test_cluster.c: Riak C Unit testing for Riak Clusters
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+
+void
+test_cluster_round_robin() {
+    char port1[16];
+    char port2[16];
+    int listener1 = test_listen_on_loopback(port1, sizeof(port1));
+    int listener2 = test_listen_on_loopback(port2, sizeof(port2));
+    CU_ASSERT_FATAL(listener1 >= 0 && listener2 >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster *cluster = NULL;
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_ROUND_ROBIN);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port1, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port2, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    riak_cluster_node *node1 = NULL;
+    riak_cluster_node *node2 = NULL;
+    riak_cluster_node *node3 = NULL;
+    riak_connection   *cxn   = NULL;
+    err = riak_cluster_checkout(cluster, &node1, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster_checkin(cluster, node1, &cxn, ERIAK_OK);
+    err = riak_cluster_checkout(cluster, &node2, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster_checkin(cluster, node2, &cxn, ERIAK_OK);
+    err = riak_cluster_checkout(cluster, &node3, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster_checkin(cluster, node3, &cxn, ERIAK_OK);
+    CU_ASSERT_PTR_NOT_EQUAL(node1, node2)
+    CU_ASSERT_PTR_EQUAL(node1, node3)
+
+    riak_cluster_free(&cluster);
+    riak_config_free(&cfg);
+    close(listener1);
+    close(listener2);
+    CU_PASS("test_cluster_round_robin passed")
+}
+
+void
+test_cluster_least_outstanding() {
+    char port1[16];
+    char port2[16];
+    int listener1 = test_listen_on_loopback(port1, sizeof(port1));
+    int listener2 = test_listen_on_loopback(port2, sizeof(port2));
+    CU_ASSERT_FATAL(listener1 >= 0 && listener2 >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster *cluster = NULL;
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_LEAST_OUTSTANDING);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port1, NULL, 4);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port2, NULL, 4);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // Holding a connection on one node steers work to the other
+    riak_cluster_node *busy = NULL;
+    riak_cluster_node *node = NULL;
+    riak_connection   *held = NULL;
+    riak_connection   *cxn  = NULL;
+    err = riak_cluster_checkout(cluster, &busy, &held);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_NOT_EQUAL(busy, node)
+    riak_cluster_checkin(cluster, node, &cxn, ERIAK_OK);
+    riak_cluster_node *again = NULL;
+    err = riak_cluster_checkout(cluster, &again, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_EQUAL(again, node)
+    riak_cluster_checkin(cluster, again, &cxn, ERIAK_OK);
+    riak_cluster_checkin(cluster, busy, &held, ERIAK_OK);
+
+    riak_cluster_free(&cluster);
+    riak_config_free(&cfg);
+    close(listener1);
+    close(listener2);
+    CU_PASS("test_cluster_least_outstanding passed")
+}
+
+void
+test_cluster_marks_node_down() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster *cluster = NULL;
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_LATENCY_WEIGHTED);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    // Nothing listens on port 1
+    err = riak_cluster_add_node(cluster, "127.0.0.1", "1", NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", portnum, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_cluster_get_n_up(cluster), 2)
+
+    riak_cluster_node *node = NULL;
+    riak_connection   *cxn  = NULL;
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_cluster_get_n_up(cluster), 1)
+
+    // A read error on the good node takes it out of rotation too
+    riak_cluster_checkin(cluster, node, &cxn, ERIAK_READ);
+    CU_ASSERT_PTR_NULL(cxn)
+    CU_ASSERT_EQUAL(riak_cluster_get_n_up(cluster), 0)
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_NO_NODES)
+
+    riak_cluster_free(&cluster);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_cluster_marks_node_down passed")
+}
+
+void
+test_cluster_no_nodes() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster *cluster = NULL;
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_ROUND_ROBIN);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_cluster_node *node = NULL;
+    riak_connection   *cxn  = NULL;
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_NO_NODES)
+    riak_get_response *response = NULL;
+    err = riak_cluster_get(cluster, NULL, NULL, NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_NO_NODES)
+
+    // A node that refuses connections reports why, then stays down
+    err = riak_cluster_add_node(cluster, "127.0.0.1", "1", NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_CONNECT)
+    err = riak_cluster_checkout(cluster, &node, &cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_NO_NODES)
+    riak_cluster_set_retry_interval(cluster, 0);
+
+    riak_cluster_free(&cluster);
+    riak_config_free(&cfg);
+    CU_PASS("test_cluster_no_nodes passed")
+}
+
+// Length 4, RpbListKeysResp with key "a" and no done flag
+static const riak_uint8_t test_listkeys_partial[] = { 0, 0, 0, 4, 18, 0x0a, 0x01, 0x61 };
+// Length 6, RpbListKeysResp with key "b" and done set
+static const riak_uint8_t test_listkeys_done[] = { 0, 0, 0, 6, 18, 0x0a, 0x01, 0x62, 0x10, 0x01 };
+
+typedef struct _test_listkeys_server {
+    int                 listener;
+    const riak_uint8_t *reply;
+    riak_size_t         reply_len;
+} test_listkeys_server;
+
+/**
+ * @brief Answer one request with a canned reply, then hang up
+ */
+static void*
+test_serve_listkeys(void *ptr) {
+    test_listkeys_server *server = (test_listkeys_server*)ptr;
+    int fd = accept(server->listener, NULL, NULL);
+    if (fd < 0) return NULL;
+    riak_uint8_t request[256];
+    if (read(fd, request, sizeof(request)) > 0) {
+        // A short write only looks like one more failed node
+        riak_ssize_t wrote = write(fd, server->reply, server->reply_len);
+        (void)wrote;
+    }
+    close(fd);
+    return NULL;
+}
+
+void
+test_cluster_failover_mid_stream() {
+    test_listkeys_server servers[2] = {
+        { -1, test_listkeys_partial, sizeof(test_listkeys_partial) },
+        { -1, test_listkeys_partial, sizeof(test_listkeys_partial) }
+    };
+    char port1[16];
+    char port2[16];
+    servers[0].listener = test_listen_on_loopback(port1, sizeof(port1));
+    servers[1].listener = test_listen_on_loopback(port2, sizeof(port2));
+    CU_ASSERT_FATAL(servers[0].listener >= 0 && servers[1].listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "bucket");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(bucket)
+
+    // Both nodes hang up partway through, so nothing partial comes back
+    pthread_t threads[2];
+    int i;
+    for(i = 0; i < 2; i++) {
+        CU_ASSERT_FATAL(pthread_create(&threads[i], NULL, test_serve_listkeys, &servers[i]) == 0)
+    }
+    riak_cluster *cluster = NULL;
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_ROUND_ROBIN);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port1, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port2, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_listkeys_response *response = NULL;
+    err = riak_cluster_listkeys(cluster, bucket, 0, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_READ)
+    CU_ASSERT_PTR_NULL(response)
+    for(i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    riak_cluster_free(&cluster);
+
+    // The first node fails mid-stream and only the second node's keys survive
+    servers[1].reply     = test_listkeys_done;
+    servers[1].reply_len = sizeof(test_listkeys_done);
+    for(i = 0; i < 2; i++) {
+        CU_ASSERT_FATAL(pthread_create(&threads[i], NULL, test_serve_listkeys, &servers[i]) == 0)
+    }
+    err = riak_cluster_new(cfg, &cluster, RIAK_CLUSTER_ROUND_ROBIN);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port1, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_add_node(cluster, "127.0.0.1", port2, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_cluster_listkeys(cluster, bucket, 0, &response);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(response)
+    CU_ASSERT_EQUAL_FATAL(riak_listkeys_get_n_keys(response), 1)
+    riak_binary *key = riak_listkeys_get_keys(response)[0];
+    CU_ASSERT_EQUAL(riak_binary_len(key), 1)
+    CU_ASSERT_EQUAL(riak_binary_data(key)[0], 'b')
+    riak_listkeys_response_free(cfg, &response);
+    riak_cluster_free(&cluster);
+
+    for(i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+        close(servers[i].listener);
+    }
+    riak_binary_free(cfg, &bucket);
+    riak_config_free(&cfg);
+    CU_PASS("test_cluster_failover_mid_stream passed")
+}
@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <CUnit/CUnit.h>
 #include <CUnit/Automated.h>
 #include <CUnit/Basic.h>
@@ -31,6 +33,7 @@
 #include "riak.pb-c.h"
 #include "riak_config-internal.h"
 #include "riak_connection-internal.h"
+#include "test_connection_pool.h"
 
 void
 test_build_config() {
@@ -136,3 +139,258 @@ test_config_free() {
     CU_ASSERT_FATAL(passes == RIAK_TRUE)
     CU_PASS("test_config_free passed")
 }
+
+void
+test_config_arena() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_config *arena = NULL;
+    err = riak_config_new_arena(cfg, &arena, 256);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_config_get_arena_used(arena), 0)
+
+    // Small allocations are carved from one block, each suitably aligned
+    void *first  = riak_config_allocate(arena, 10);
+    void *second = riak_config_clean_allocate(arena, 10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(second)
+    CU_ASSERT_EQUAL((riak_uint8_t*)second - (riak_uint8_t*)first, RIAK_ARENA_ALIGN)
+    CU_ASSERT_EQUAL(memcmp(second, "\0\0\0\0\0\0\0\0\0\0", 10), 0)
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, first))
+
+    // Too big for a block, but still owned by the arena
+    void *big = riak_config_allocate(arena, 1000);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(big)
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, big))
+    CU_ASSERT_EQUAL(riak_config_get_arena_used(arena), 2*RIAK_ARENA_ALIGN + 1008)
+
+    // Freeing arena memory is a no-op; heap memory is still released
+    void *start = first;
+    riak_free(arena, &first);
+    CU_ASSERT_PTR_NULL(first)
+    void *heap = riak_config_allocate(cfg, 10);
+    CU_ASSERT_FALSE(riak_config_arena_owns(arena, heap))
+    riak_free(arena, &heap);
+    CU_ASSERT_PTR_NULL(heap)
+
+    riak_config_arena_reset(arena);
+    CU_ASSERT_EQUAL(riak_config_get_arena_used(arena), 0)
+    CU_ASSERT_FALSE(riak_config_arena_owns(arena, big))
+    // The first block is kept and handed out again from the start
+    CU_ASSERT_EQUAL(riak_config_allocate(arena, 10), start)
+
+    riak_config_free(&arena);
+    CU_ASSERT_PTR_NULL(arena)
+    riak_config_free(&cfg);
+    CU_PASS("test_config_arena passed")
+}
+
+void
+test_config_arena_protobuf() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_config *arena = NULL;
+    err = riak_config_new_arena(cfg, &arena, 0);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    RpbErrorResp msg;
+    rpb_error_resp__init(&msg);
+    msg.errmsg.data = (uint8_t*)"not found";
+    msg.errmsg.len  = strlen("not found");
+    msg.errcode     = 42;
+    riak_uint8_t packed[64];
+    riak_size_t  len = rpb_error_resp__pack(&msg, packed);
+
+    // Unpacked messages land in the arena rather than the default allocator
+    RpbErrorResp *unpacked = rpb_error_resp__unpack(arena->pb_allocator, len, packed);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unpacked)
+    CU_ASSERT_EQUAL(unpacked->errcode, 42)
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, unpacked))
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, unpacked->errmsg.data))
+    CU_ASSERT_TRUE(riak_config_get_arena_used(arena) > 0)
+    rpb_error_resp__free_unpacked(unpacked, arena->pb_allocator);
+
+    // Operations on a connection with an arena allocate from it
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_set_arena(cxn, arena);
+    riak_operation *rop = NULL;
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_EQUAL(riak_operation_get_config(rop), arena)
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, rop))
+    riak_binary *bucket = riak_binary_new(cfg, 6, (riak_uint8_t*)"bucket");
+    riak_operation_set_bucket(rop, bucket);
+    CU_ASSERT_TRUE(riak_config_arena_owns(arena, riak_operation_get_bucket(rop)))
+    riak_operation_free(&rop);
+    riak_config_arena_reset(arena);
+    CU_ASSERT_EQUAL(riak_config_get_arena_used(arena), 0)
+
+    riak_binary_free(cfg, &bucket);
+    riak_connection_free(&cxn);
+    close(listener);
+    riak_config_free(&arena);
+    riak_config_free(&cfg);
+    CU_PASS("test_config_arena_protobuf passed")
+}
+
+static void*
+test_config_pb_alloc(void  *allocator_data,
+                     size_t size) {
+    return malloc(size);
+}
+
+static void
+test_config_pb_free(void *allocator_data,
+                    void *pointer) {
+    free(pointer);
+}
+
+void
+test_config_pb_allocator_private() {
+    ProtobufCAllocator before = protobuf_c_default_allocator;
+    riak_config *cfg;
+    riak_error err = riak_config_new(&cfg, NULL, NULL, NULL,
+                                     test_config_pb_alloc,
+                                     test_config_pb_free);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_NOT_EQUAL(cfg->pb_allocator, &protobuf_c_default_allocator)
+    CU_ASSERT_PTR_EQUAL(cfg->pb_allocator->alloc, test_config_pb_alloc)
+    CU_ASSERT_PTR_EQUAL(cfg->pb_allocator->free, test_config_pb_free)
+    // Nobody else sees our allocator
+    CU_ASSERT_PTR_EQUAL(protobuf_c_default_allocator.alloc, before.alloc)
+    CU_ASSERT_PTR_EQUAL(protobuf_c_default_allocator.free, before.free)
+    riak_config_free(&cfg);
+    CU_PASS("test_config_pb_allocator_private passed")
+}
+
+static void*
+test_config_thread_worker(void *ptr) {
+    riak_config       *cfg   = (riak_config*)ptr;
+    riak_thread_stats *stats = (riak_thread_stats*)riak_config_allocate(cfg, sizeof(riak_thread_stats));
+    riak_config_get_thread_stats(cfg, stats);
+    return stats;
+}
+
+void
+test_config_thread_context() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // A retired operation is handed back to the same thread
+    riak_operation *rop = NULL;
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_operation *first = rop;
+    riak_operation_free(&rop);
+    CU_ASSERT_PTR_NULL(rop)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_EQUAL(rop, first)
+    CU_ASSERT_PTR_NULL(riak_operation_get_bucket(rop))
+    riak_operation_free(&rop);
+
+    riak_thread_stats stats;
+    err = riak_config_get_thread_stats(cfg, &stats);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(stats.operations, 2)
+    CU_ASSERT_EQUAL(stats.operations_reused, 1)
+
+    // Other threads start with their own, empty, context
+    pthread_t thread;
+    void *result = NULL;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_config_thread_worker, cfg) == 0)
+    pthread_join(thread, &result);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(result)
+    CU_ASSERT_EQUAL(((riak_thread_stats*)result)->operations, 0)
+    riak_free(cfg, &result);
+
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_config_thread_context passed")
+}
+
+static riak_int32_t test_config_live_allocations = 0;
+
+static void*
+test_config_counting_alloc(size_t bytes) {
+    __sync_add_and_fetch(&test_config_live_allocations, 1);
+    return malloc(bytes);
+}
+
+static void
+test_config_counting_free(void *ptr) {
+    if (ptr) {
+        __sync_sub_and_fetch(&test_config_live_allocations, 1);
+    }
+    free(ptr);
+}
+
+typedef struct {
+    riak_config    *cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    riak_boolean_t  started;
+    riak_boolean_t  release;
+} test_config_waiter;
+
+static void*
+test_config_thread_waiter(void *ptr) {
+    test_config_waiter *waiter = (test_config_waiter*)ptr;
+    riak_thread_stats stats;
+    riak_config_get_thread_stats(waiter->cfg, &stats);
+    pthread_mutex_lock(&(waiter->lock));
+    waiter->started = RIAK_TRUE;
+    pthread_cond_broadcast(&(waiter->cond));
+    while (!waiter->release) {
+        pthread_cond_wait(&(waiter->cond), &(waiter->lock));
+    }
+    pthread_mutex_unlock(&(waiter->lock));
+    return NULL;
+}
+
+void
+test_config_free_thread_contexts() {
+    test_config_waiter waiter;
+    memset(&waiter, '\0', sizeof(waiter));
+    pthread_mutex_init(&(waiter.lock), NULL);
+    pthread_cond_init(&(waiter.cond), NULL);
+    riak_error err = riak_config_new(&(waiter.cfg), test_config_counting_alloc, NULL, test_config_counting_free, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_thread_stats stats;
+    riak_config_get_thread_stats(waiter.cfg, &stats);
+
+    // The other thread holds a context and is still running when the config goes
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_config_thread_waiter, &waiter) == 0)
+    pthread_mutex_lock(&(waiter.lock));
+    while (!waiter.started) {
+        pthread_cond_wait(&(waiter.cond), &(waiter.lock));
+    }
+    pthread_mutex_unlock(&(waiter.lock));
+    riak_config_free(&(waiter.cfg));
+    CU_ASSERT_EQUAL(test_config_live_allocations, 0)
+
+    pthread_mutex_lock(&(waiter.lock));
+    waiter.release = RIAK_TRUE;
+    pthread_cond_broadcast(&(waiter.cond));
+    pthread_mutex_unlock(&(waiter.lock));
+    pthread_join(thread, NULL);
+    pthread_cond_destroy(&(waiter.cond));
+    pthread_mutex_destroy(&(waiter.lock));
+    CU_PASS("test_config_free_thread_contexts passed")
+}
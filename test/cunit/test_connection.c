@@ -24,12 +24,15 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <string.h>
+#include <unistd.h>
 #include <CUnit/CUnit.h>
 #include <CUnit/Automated.h>
 #include <CUnit/Basic.h>
 #include "riak.h"
 #include "riak.pb-c.h"
 #include "riak_connection-internal.h"
+#include "riak_utils-internal.h"
+#include "test_connection_pool.h"
 
 static int
 test_connection_bad_resolver(const char          *nodename,
@@ -103,3 +106,104 @@ test_connection_with_good_resolver() {
     riak_config_free(&cfg);
     CU_PASS("test_config_with_connection passed")
 }
+
+// Put an address nobody listens on ahead of the real one
+static int
+test_connection_two_address_resolver(const char          *nodename,
+                                     const char          *servname,
+                                     const riak_addrinfo *hints_in,
+                                     riak_addrinfo      **res) {
+    riak_addrinfo *dead = NULL;
+    riak_addrinfo *live = NULL;
+    int err = getaddrinfo("127.0.0.1", "1", hints_in, &dead);
+    if (err != 0) {
+        return err;
+    }
+    err = getaddrinfo("127.0.0.1", servname, hints_in, &live);
+    if (err != 0) {
+        freeaddrinfo(dead);
+        return err;
+    }
+    dead->ai_next = live;
+    *res = dead;
+    return 0;
+}
+
+void
+test_connection_tries_every_address() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "localhost", portnum, test_connection_two_address_resolver);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(riak_connection_get_fd(cxn) >= 0)
+
+    // Reconnecting goes through the same list again
+    err = riak_connection_reconnect(cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_TRUE(riak_connection_get_fd(cxn) >= 0)
+
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_tries_every_address passed")
+}
+
+void
+test_connection_read_timeout() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_options opts;
+    riak_connection_options_init(&opts);
+    opts.read_timeout = 50;
+    riak_connection *cxn = NULL;
+    err = riak_connection_new_with_options(cfg, &cxn, "127.0.0.1", portnum, NULL, &opts);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // Nobody ever answers the ping
+    riak_uint64_t start = riak_get_time_ms();
+    err = riak_ping(cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_TIMEOUT)
+    CU_ASSERT_TRUE(riak_get_time_ms() - start < 2000)
+
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_read_timeout passed")
+}
+
+void
+test_connection_retry_backoff() {
+    // Doubles from the base, capped, and never less than half
+    CU_ASSERT_TRUE(riak_backoff_ms(0, 100, 1000) >= 50)
+    CU_ASSERT_TRUE(riak_backoff_ms(0, 100, 1000) <= 100)
+    CU_ASSERT_TRUE(riak_backoff_ms(2, 100, 1000) >= 200)
+    CU_ASSERT_TRUE(riak_backoff_ms(2, 100, 1000) <= 400)
+    CU_ASSERT_TRUE(riak_backoff_ms(20, 100, 1000) >= 500)
+    CU_ASSERT_TRUE(riak_backoff_ms(20, 100, 1000) <= 1000)
+
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_options opts;
+    riak_connection_options_init(&opts);
+    opts.connect_retries = 2;
+    opts.backoff_base    = 10;
+    riak_connection *cxn = NULL;
+    riak_uint64_t start = riak_get_time_ms();
+    err = riak_connection_new_with_options(cfg, &cxn, "127.0.0.1", "1", NULL, &opts);
+    CU_ASSERT_EQUAL(err, ERIAK_CONNECT)
+    // Waited 5-10 ms, then 10-20 ms between the three attempts
+    CU_ASSERT_TRUE(riak_get_time_ms() - start >= 15)
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_connection_retry_backoff passed")
+}
@@ -0,0 +1,286 @@
+/*********************************************************************
+ *
+ * test_connection_pool.c: Riak C Unit testing for Connection Pools
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+
+int
+test_listen_on_loopback(char       *portnum,
+                        riak_size_t len) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    memset(&addr, '\0', sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = 0;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 8) < 0 ||
+        getsockname(fd, (struct sockaddr*)&addr, &addrlen) < 0) {
+        close(fd);
+        return -1;
+    }
+    snprintf(portnum, len, "%d", ntohs(addr.sin_port));
+    return fd;
+}
+
+// Length 1, RpbGetResp with nothing found
+static const riak_uint8_t test_reply_notfound[] = { 0, 0, 0, 1, 10 };
+// Length 8, RpbErrorResp "bad", errcode 1
+static const riak_uint8_t test_reply_error[] = { 0, 0, 0, 8, 0, 0x0a, 0x03, 0x62, 0x61, 0x64, 0x10, 0x01 };
+
+static riak_boolean_t
+test_read_full(int           fd,
+               riak_uint8_t *buf,
+               riak_size_t   len) {
+    riak_size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, buf + got, len - got);
+        if (n <= 0) return RIAK_FALSE;
+        got += n;
+    }
+    return RIAK_TRUE;
+}
+
+void*
+test_serve_replies(void *ptr) {
+    test_reply_server *server = (test_reply_server*)ptr;
+    struct pollfd fds[TEST_SERVER_MAX_CONNECTIONS];
+    int n_fds  = server->n_connections;
+    int n_open = 0;
+    int i;
+    for(i = 0; i < n_fds; i++) {
+        fds[i].fd     = accept(server->listener, NULL, NULL);
+        fds[i].events = POLLIN;
+        if (fds[i].fd >= 0) n_open++;
+    }
+    while (n_open > 0 && poll(fds, n_fds, 5000) > 0) {
+        for(i = 0; i < n_fds; i++) {
+            if (fds[i].fd < 0 || fds[i].revents == 0) continue;
+            riak_uint8_t header[4];
+            riak_uint8_t body[256];
+            riak_uint32_t len = 0;
+            if (test_read_full(fds[i].fd, header, sizeof(header))) {
+                len = ((riak_uint32_t)header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+            }
+            if (len == 0 || len > sizeof(body) || !test_read_full(fds[i].fd, body, len)) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                n_open--;
+                continue;
+            }
+            server->n_requests++;
+            if (server->silent) continue;
+            const riak_uint8_t *reply = test_reply_notfound;
+            riak_size_t reply_len = sizeof(test_reply_notfound);
+            if (server->error_every && server->n_requests % server->error_every == 0) {
+                reply     = test_reply_error;
+                reply_len = sizeof(test_reply_error);
+            }
+            if (write(fds[i].fd, reply, reply_len) != reply_len) {
+                break;
+            }
+        }
+    }
+    for(i = 0; i < n_fds; i++) {
+        if (fds[i].fd >= 0) close(fds[i].fd);
+    }
+    return NULL;
+}
+
+void
+test_connection_pool_checkout_checkin() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 4);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    err = riak_connection_pool_warm(pool, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 2)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 2)
+
+    riak_connection *cxn = NULL;
+    err = riak_connection_pool_checkout(pool, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cxn)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 1)
+    riak_connection *reused = cxn;
+    riak_connection_pool_checkin(pool, &cxn);
+    CU_ASSERT_PTR_NULL(cxn)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 2)
+
+    // Most recently returned connection comes back first
+    err = riak_connection_pool_checkout(pool, &cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(cxn, reused)
+    riak_connection_pool_checkin(pool, &cxn);
+
+    riak_connection_pool_free(&pool);
+    CU_ASSERT_PTR_NULL(pool)
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_pool_checkout_checkin passed")
+}
+
+void
+test_connection_pool_exhausted() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // Nothing is warmed, so both of these connect lazily
+    riak_connection *cxn1 = NULL;
+    riak_connection *cxn2 = NULL;
+    riak_connection *cxn3 = NULL;
+    err = riak_connection_pool_checkout(pool, &cxn1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_checkout(pool, &cxn2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_checkout(pool, &cxn3);
+    CU_ASSERT_EQUAL(err, ERIAK_POOL_EXHAUSTED)
+    CU_ASSERT_PTR_NULL(cxn3)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 2)
+
+    // Evicting frees a slot for a fresh connection
+    riak_connection_pool_evict(pool, &cxn2);
+    CU_ASSERT_PTR_NULL(cxn2)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 1)
+    err = riak_connection_pool_checkout(pool, &cxn3);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    riak_connection_pool_checkin(pool, &cxn1);
+    riak_connection_pool_checkin(pool, &cxn3);
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_pool_exhausted passed")
+}
+
+void
+test_connection_pool_checkin_beyond_capacity() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 2)
+
+    // A full pool has nowhere to park a connection it never handed out
+    riak_connection *foreign = NULL;
+    err = riak_connection_new(cfg, &foreign, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool_checkin(pool, &foreign);
+    CU_ASSERT_PTR_NULL(foreign)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 2)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 2)
+
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_pool_checkin_beyond_capacity passed")
+}
+
+void
+test_connection_pool_connect_failure() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", "1", NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_pool_checkout(pool, &cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_CONNECT)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    err = riak_connection_pool_warm(pool, 1);
+    CU_ASSERT_EQUAL(err, ERIAK_CONNECT)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    CU_PASS("test_connection_pool_connect_failure passed")
+}
+
+void
+test_connection_pool_evicts_dead() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 2);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // Recently used connections are not pinged
+    CU_ASSERT_EQUAL(riak_connection_pool_check_health(pool, 60000), 0)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 1)
+
+    // Server side hangs up, so the ping cannot succeed
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+    close(server);
+    CU_ASSERT_EQUAL(riak_connection_pool_check_health(pool, 0), 1)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 0)
+
+    err = riak_connection_pool_start_health_check(pool, 10);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_connection_pool_stop_health_check(pool);
+
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_connection_pool_evicts_dead passed")
+}
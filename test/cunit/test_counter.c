@@ -0,0 +1,354 @@
+/*********************************************************************
+ *
+ * test_counter.c: Riak C Unit testing for Legacy Counters
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_operation-internal.h"
+#include "test_connection_pool.h"
+#include "test_counter.h"
+
+#define TEST_COUNTER_N_THREADS   4
+#define TEST_COUNTER_N_INCREMENT 10000
+#define TEST_COUNTER_N_KEYS      3
+
+void
+test_counter_update_encode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "hits");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "home");
+    riak_counter_update_options *opts = riak_counter_update_options_new(cfg);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(opts)
+    riak_counter_update_options_set_w(opts, 2);
+    riak_counter_update_options_set_returnvalue(opts, RIAK_TRUE);
+
+    err = riak_counter_update_request_encode(rop, bucket, key, -7, opts, &(rop->pb_request));
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(rop->pb_request->msgid, MSG_RPBCOUNTERUPDATEREQ)
+    RpbCounterUpdateReq *req = rpb_counter_update_req__unpack(NULL, rop->pb_request->len, rop->pb_request->data);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    CU_ASSERT_EQUAL(req->bucket.len, 4)
+    CU_ASSERT_NSTRING_EQUAL(req->bucket.data, "hits", 4)
+    CU_ASSERT_EQUAL(req->key.len, 4)
+    CU_ASSERT_NSTRING_EQUAL(req->key.data, "home", 4)
+    CU_ASSERT_EQUAL(req->amount, -7)
+    CU_ASSERT_EQUAL(req->has_w, RIAK_TRUE)
+    CU_ASSERT_EQUAL(req->w, 2)
+    CU_ASSERT_EQUAL(req->has_dw, RIAK_FALSE)
+    CU_ASSERT_EQUAL(req->has_returnvalue, RIAK_TRUE)
+    CU_ASSERT_EQUAL(req->returnvalue, RIAK_TRUE)
+    rpb_counter_update_req__free_unpacked(req, NULL);
+
+    riak_counter_update_options_free(cfg, &opts);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_counter_update_encode passed")
+}
+
+void
+test_counter_get_decode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+
+    RpbCounterGetResp msg = RPB_COUNTER_GET_RESP__INIT;
+    msg.has_value = 1;
+    msg.value = 1234567890123LL;
+    riak_size_t   len   = rpb_counter_get_resp__get_packed_size(&msg);
+    riak_uint8_t *bytes = (riak_uint8_t*)malloc(len + 1);
+    bytes[0] = MSG_RPBCOUNTERGETRESP;
+    rpb_counter_get_resp__pack(&msg, bytes + 1);
+    riak_pb_message pb_response;
+    pb_response.data = bytes;
+    pb_response.len  = len + 1;
+    riak_counter_get_response *response = NULL;
+    riak_boolean_t             done = RIAK_FALSE;
+    err = riak_counter_get_response_decode(rop, &pb_response, &response, &done);
+    free(bytes);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+    CU_ASSERT_EQUAL(riak_counter_get_get_has_value(response), RIAK_TRUE)
+    CU_ASSERT_EQUAL(riak_counter_get_get_value(response), 1234567890123LL)
+    char output[128];
+    riak_counter_get_response_print(response, output, sizeof(output));
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "1234567890123"))
+    riak_counter_get_response_free(cfg, &response);
+    CU_ASSERT_PTR_NULL(response)
+
+    // A counter that was never updated has no value
+    riak_uint8_t empty[] = { MSG_RPBCOUNTERGETRESP };
+    pb_response.data = empty;
+    pb_response.len  = sizeof(empty);
+    err = riak_counter_get_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_counter_get_get_has_value(response), RIAK_FALSE)
+    riak_counter_get_response_free(cfg, &response);
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_counter_get_decode passed")
+}
+
+typedef struct _test_counter_worker {
+    riak_config     *cfg;
+    riak_aggregator *agg;
+    riak_uint32_t    n_failures;
+} test_counter_worker;
+
+static void*
+test_counter_increment_loop(void *ptr) {
+    test_counter_worker *worker = (test_counter_worker*)ptr;
+    riak_binary *bucket = riak_binary_copy_from_string(worker->cfg, "hits");
+    riak_binary *keys[TEST_COUNTER_N_KEYS];
+    char name[16];
+    int i;
+    for(i = 0; i < TEST_COUNTER_N_KEYS; i++) {
+        snprintf(name, sizeof(name), "page%d", i);
+        keys[i] = riak_binary_copy_from_string(worker->cfg, name);
+    }
+    for(i = 0; i < TEST_COUNTER_N_INCREMENT; i++) {
+        riak_error err = riak_aggregator_increment(worker->agg, bucket, keys[i % TEST_COUNTER_N_KEYS], 1);
+        if (err) worker->n_failures++;
+    }
+    for(i = 0; i < TEST_COUNTER_N_KEYS; i++) {
+        riak_binary_free(worker->cfg, &(keys[i]));
+    }
+    riak_binary_free(worker->cfg, &bucket);
+    return NULL;
+}
+
+void
+test_aggregator_folds_increments() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_FALSE, 0, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    pthread_t server_thread;
+    CU_ASSERT_FATAL(pthread_create(&server_thread, NULL, test_serve_replies, &server) == 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_aggregator *agg = NULL;
+    err = riak_aggregator_new(cfg, &agg, pool, 16, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // Every thread hits the same few keys at once
+    test_counter_worker workers[TEST_COUNTER_N_THREADS];
+    pthread_t threads[TEST_COUNTER_N_THREADS];
+    int i;
+    for(i = 0; i < TEST_COUNTER_N_THREADS; i++) {
+        workers[i].cfg        = cfg;
+        workers[i].agg        = agg;
+        workers[i].n_failures = 0;
+        CU_ASSERT_FATAL(pthread_create(&threads[i], NULL, test_counter_increment_loop, &workers[i]) == 0)
+    }
+    for(i = 0; i < TEST_COUNTER_N_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        CU_ASSERT_EQUAL(workers[i].n_failures, 0)
+    }
+    CU_ASSERT_EQUAL(riak_aggregator_get_n_keys(agg), TEST_COUNTER_N_KEYS)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "hits");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "page0");
+    riak_int64_t expected = (TEST_COUNTER_N_INCREMENT / TEST_COUNTER_N_KEYS + 1) * TEST_COUNTER_N_THREADS;
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key), expected)
+
+    // Forty thousand increments go out as one update per key
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(server.n_requests, TEST_COUNTER_N_KEYS)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key), 0)
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(server.n_requests, TEST_COUNTER_N_KEYS)
+
+    // Reaching the threshold flushes on the incrementing thread
+    riak_aggregator_set_threshold(agg, 100);
+    for(i = 0; i < 100; i++) {
+        riak_aggregator_increment(agg, bucket, key, 2);
+    }
+    CU_ASSERT_EQUAL(server.n_requests, TEST_COUNTER_N_KEYS + 1)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key), 0)
+
+    // The background thread flushes on its timer
+    riak_aggregator_set_threshold(agg, 0);
+    err = riak_aggregator_start(agg, 10);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_aggregator_increment(agg, bucket, key, 5);
+    for(i = 0; i < 200 && riak_aggregator_get_pending(agg, bucket, key) != 0; i++) {
+        usleep(10000);
+    }
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key), 0)
+    riak_aggregator_stop(agg);
+    CU_ASSERT_EQUAL(server.n_requests, TEST_COUNTER_N_KEYS + 2)
+
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_aggregator_free(&agg);
+    CU_ASSERT_PTR_NULL(agg)
+    riak_connection_pool_free(&pool);
+    pthread_join(server_thread, NULL);
+    close(server.listener);
+    riak_config_free(&cfg);
+    CU_PASS("test_aggregator_folds_increments passed")
+}
+
+void
+test_aggregator_keeps_failed_sums() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_FALSE, 1, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    pthread_t server_thread;
+    CU_ASSERT_FATAL(pthread_create(&server_thread, NULL, test_serve_replies, &server) == 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_aggregator *agg = NULL;
+    err = riak_aggregator_new(cfg, &agg, pool, 2, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "hits");
+    riak_binary *key1   = riak_binary_copy_from_string(cfg, "a");
+    riak_binary *key2   = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key3   = riak_binary_copy_from_string(cfg, "c");
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key1, 3), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key2, -4), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key3, 1), ERIAK_AGGREGATOR_FULL)
+    CU_ASSERT_EQUAL(riak_aggregator_get_n_keys(agg), 2)
+
+    // Rejected sums are dropped rather than resent forever, and the connection stays
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_SERVER_ERROR)
+    CU_ASSERT_EQUAL(server.n_requests, 2)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 1)
+    riak_aggregator_increment(agg, bucket, key1, 1);
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key1), 1)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key2), 0)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key3), 0)
+
+    riak_aggregator_free(&agg);
+    riak_connection_pool_free(&pool);
+    pthread_join(server_thread, NULL);
+    close(server.listener);
+
+    // A sum that never reached Riak stays pending for the next flush
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", "1", NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_aggregator_new(cfg, &agg, pool, 2, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key1, 6), ERIAK_OK)
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_CONNECT)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key1), 6)
+
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key1);
+    riak_binary_free(cfg, &key2);
+    riak_binary_free(cfg, &key3);
+    riak_aggregator_free(&agg);
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    CU_PASS("test_aggregator_keeps_failed_sums passed")
+}
+
+void
+test_aggregator_reclaims_idle_keys() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_FALSE, 0, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    pthread_t server_thread;
+    CU_ASSERT_FATAL(pthread_create(&server_thread, NULL, test_serve_replies, &server) == 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_aggregator *agg = NULL;
+    err = riak_aggregator_new(cfg, &agg, pool, 2, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "hits");
+    riak_binary *key1   = riak_binary_copy_from_string(cfg, "a");
+    riak_binary *key2   = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key3   = riak_binary_copy_from_string(cfg, "c");
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key1, 1), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key2, 1), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key3, 1), ERIAK_AGGREGATOR_FULL)
+
+    // Both pairs had something to send, so they survive the first flush
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_get_n_keys(agg), 2)
+
+    // Only the pair counted since then survives the second
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key1, 1), ERIAK_OK)
+    err = riak_aggregator_flush(agg);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_get_n_keys(agg), 1)
+    CU_ASSERT_EQUAL(server.n_requests, 3)
+
+    // The freed slot takes a pair it could not before
+    CU_ASSERT_EQUAL(riak_aggregator_increment(agg, bucket, key3, 1), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_aggregator_get_pending(agg, bucket, key3), 1)
+    CU_ASSERT_EQUAL(riak_aggregator_get_n_keys(agg), 2)
+
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key1);
+    riak_binary_free(cfg, &key2);
+    riak_binary_free(cfg, &key3);
+    riak_aggregator_free(&agg);
+    riak_connection_pool_free(&pool);
+    pthread_join(server_thread, NULL);
+    close(server.listener);
+    riak_config_free(&cfg);
+    CU_PASS("test_aggregator_reclaims_idle_keys passed")
+}
@@ -0,0 +1,292 @@
+/*********************************************************************
+ *
+ * test_csbucket.c: Riak C Unit testing for Bucket Range Folds
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_operation-internal.h"
+#include "test_connection_pool.h"
+#include "test_csbucket.h"
+
+#define TEST_CSBUCKET_PB(F, S) { (F).data = (uint8_t*)(S); (F).len = strlen(S); }
+
+static riak_boolean_t
+test_csbucket_binary_is(riak_binary *bin,
+                        const char  *expected) {
+    return (bin != NULL && riak_binary_len(bin) == strlen(expected) &&
+            memcmp(riak_binary_data(bin), expected, strlen(expected)) == 0);
+}
+
+/**
+ * @brief Frame an RpbCSBucketResp holding `n_keys` objects, each valued "v-<key>"
+ * @returns Bytes written to `buf`, including the length prefix
+ */
+static riak_size_t
+test_csbucket_frame(riak_uint8_t  *buf,
+                    const char   **keys,
+                    int            n_keys,
+                    const char    *continuation,
+                    riak_boolean_t done) {
+    RpbCSBucketResp  msg = RPB_CSBUCKET_RESP__INIT;
+    RpbIndexObject   objects[4];
+    RpbIndexObject  *object_ptrs[4];
+    RpbGetResp       gets[4];
+    RpbContent       contents[4];
+    RpbContent      *content_ptrs[4];
+    char             values[4][16];
+    int i;
+    for(i = 0; i < n_keys; i++) {
+        rpb_index_object__init(&objects[i]);
+        rpb_get_resp__init(&gets[i]);
+        rpb_content__init(&contents[i]);
+        snprintf(values[i], sizeof(values[i]), "v-%s", keys[i]);
+        TEST_CSBUCKET_PB(contents[i].value, values[i])
+        content_ptrs[i]    = &contents[i];
+        gets[i].n_content  = 1;
+        gets[i].content    = &content_ptrs[i];
+        gets[i].has_vclock = 1;
+        TEST_CSBUCKET_PB(gets[i].vclock, "vc")
+        TEST_CSBUCKET_PB(objects[i].key, keys[i])
+        objects[i].object  = &gets[i];
+        object_ptrs[i]     = &objects[i];
+    }
+    msg.n_objects = n_keys;
+    msg.objects   = object_ptrs;
+    if (continuation) {
+        msg.has_continuation = 1;
+        TEST_CSBUCKET_PB(msg.continuation, continuation)
+    }
+    if (done) {
+        msg.has_done = 1;
+        msg.done     = 1;
+    }
+    riak_uint32_t len = rpb_csbucket_resp__get_packed_size(&msg) + 1;
+    buf[0] = (len >> 24) & 0xff;
+    buf[1] = (len >> 16) & 0xff;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+    buf[4] = MSG_RPBCSBUCKETRESP;
+    rpb_csbucket_resp__pack(&msg, buf + 5);
+    return len + 4;
+}
+
+void
+test_csbucket_encode_request() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "logs");
+    riak_binary *start  = riak_binary_copy_from_string(cfg, "2014-01");
+    riak_binary *end    = riak_binary_copy_from_string(cfg, "2014-02");
+    riak_binary *cont   = riak_binary_copy_from_string(cfg, "next");
+    riak_csbucket_options *opts = riak_csbucket_options_new(cfg);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(opts)
+    CU_ASSERT_EQUAL(riak_csbucket_options_set_end_key(cfg, opts, end), ERIAK_OK)
+    riak_csbucket_options_set_end_incl(opts, RIAK_TRUE);
+    CU_ASSERT_EQUAL(riak_csbucket_options_set_continuation(cfg, opts, cont), ERIAK_OK)
+    riak_csbucket_options_set_max_results(opts, 100);
+
+    err = riak_csbucket_request_encode(rop, bucket, start, opts, &(rop->pb_request));
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(rop->pb_request->msgid, MSG_RPBCSBUCKETREQ)
+    RpbCSBucketReq *req = rpb_csbucket_req__unpack(NULL, rop->pb_request->len, rop->pb_request->data);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    CU_ASSERT_NSTRING_EQUAL(req->bucket.data, "logs", 4)
+    CU_ASSERT_NSTRING_EQUAL(req->start_key.data, "2014-01", 7)
+    CU_ASSERT_EQUAL(req->has_end_key, RIAK_TRUE)
+    CU_ASSERT_NSTRING_EQUAL(req->end_key.data, "2014-02", 7)
+    CU_ASSERT_EQUAL(req->has_start_incl, RIAK_FALSE)
+    CU_ASSERT_EQUAL(req->has_end_incl, RIAK_TRUE)
+    CU_ASSERT_EQUAL(req->end_incl, RIAK_TRUE)
+    CU_ASSERT_EQUAL(req->has_continuation, RIAK_TRUE)
+    CU_ASSERT_NSTRING_EQUAL(req->continuation.data, "next", 4)
+    CU_ASSERT_EQUAL(req->has_max_results, RIAK_TRUE)
+    CU_ASSERT_EQUAL(req->max_results, 100)
+    CU_ASSERT_EQUAL(req->has_type, RIAK_FALSE)
+    rpb_csbucket_req__free_unpacked(req, NULL);
+
+    riak_csbucket_options_free(cfg, &opts);
+    CU_ASSERT_PTR_NULL(opts)
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &start);
+    riak_binary_free(cfg, &end);
+    riak_binary_free(cfg, &cont);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_csbucket_encode_request passed")
+}
+
+void
+test_csbucket_decode_response() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b1");
+    riak_operation_set_bucket(rop, bucket);
+
+    // Two streamed messages merge into one response
+    riak_uint8_t buf[512];
+    const char *first[]  = { "k1", "k2" };
+    const char *second[] = { "k3" };
+    riak_pb_message pb_response;
+    riak_csbucket_response *response = NULL;
+    riak_boolean_t          done = RIAK_FALSE;
+    test_csbucket_frame(buf, first, 2, NULL, RIAK_FALSE);
+    pb_response.data = buf + 4;
+    pb_response.len  = (buf[2] << 8) | buf[3];
+    err = riak_csbucket_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_FALSE)
+    test_csbucket_frame(buf, second, 1, "c1", RIAK_TRUE);
+    pb_response.len  = (buf[2] << 8) | buf[3];
+    err = riak_csbucket_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+
+    CU_ASSERT_EQUAL_FATAL(riak_csbucket_get_n_objects(response), 3)
+    riak_binary       **keys    = riak_csbucket_get_keys(response);
+    riak_get_response **objects = riak_csbucket_get_objects(response);
+    CU_ASSERT(test_csbucket_binary_is(keys[0], "k1"))
+    CU_ASSERT(test_csbucket_binary_is(keys[2], "k3"))
+    CU_ASSERT_EQUAL(riak_get_get_has_vclock(objects[1]), RIAK_TRUE)
+    CU_ASSERT(test_csbucket_binary_is(riak_get_get_vclock(objects[1]), "vc"))
+    CU_ASSERT_EQUAL_FATAL(riak_get_get_n_content(objects[1]), 1)
+    CU_ASSERT(test_csbucket_binary_is(riak_object_get_value(riak_get_get_content(objects[1])[0]), "v-k2"))
+    // Each folded object carries the bucket and key it was stored under
+    CU_ASSERT(test_csbucket_binary_is(riak_object_get_bucket(riak_get_get_content(objects[1])[0]), "b1"))
+    CU_ASSERT(test_csbucket_binary_is(riak_object_get_key(riak_get_get_content(objects[1])[0]), "k2"))
+    CU_ASSERT_EQUAL(riak_csbucket_get_has_continuation(response), RIAK_TRUE)
+    CU_ASSERT(test_csbucket_binary_is(riak_csbucket_get_continuation(response), "c1"))
+    CU_ASSERT_EQUAL(riak_csbucket_get_done(response), RIAK_TRUE)
+    char output[512];
+    riak_csbucket_response_print(response, output, sizeof(output));
+    CU_ASSERT_PTR_NOT_NULL(strstr(output, "k3"))
+    riak_csbucket_response_free(cfg, &response);
+    CU_ASSERT_PTR_NULL(response)
+
+    riak_binary_free(cfg, &bucket);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_csbucket_decode_response passed")
+}
+
+typedef struct _test_csbucket_fold_state {
+    riak_config   *cfg;
+    riak_uint32_t  n_chunks;
+    riak_uint32_t  n_objects;
+    char           keys[8][8];
+} test_csbucket_fold_state;
+
+static void
+test_csbucket_fold_cb(riak_csbucket_response *chunk,
+                      void                   *ptr) {
+    test_csbucket_fold_state *state = (test_csbucket_fold_state*)ptr;
+    riak_binary **keys = riak_csbucket_get_keys(chunk);
+    int i;
+    for(i = 0; i < riak_csbucket_get_n_objects(chunk) && state->n_objects < 8; i++) {
+        riak_binary_print(keys[i], state->keys[state->n_objects++], sizeof(state->keys[0]));
+    }
+    state->n_chunks++;
+    riak_csbucket_response_free(state->cfg, &chunk);
+}
+
+void
+test_csbucket_fold_pages() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+
+    // Page 1: "k1","k2" then continuation "c1"; page 2: "k3" and done
+    riak_uint8_t pages[1024];
+    riak_size_t  len = 0;
+    const char *first[] = { "k1", "k2" };
+    const char *last[]  = { "k3" };
+    len += test_csbucket_frame(pages + len, first, 2, NULL, RIAK_FALSE);
+    len += test_csbucket_frame(pages + len, NULL, 0, "c1", RIAK_TRUE);
+    len += test_csbucket_frame(pages + len, last, 1, NULL, RIAK_TRUE);
+    CU_ASSERT_FATAL(write(server, pages, len) == len)
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "logs");
+    riak_binary *start  = riak_binary_copy_from_string(cfg, "k");
+    test_csbucket_fold_state state;
+    memset(&state, '\0', sizeof(state));
+    state.cfg = cfg;
+    err = riak_csbucket_fold(cxn, bucket, start, NULL, 2, test_csbucket_fold_cb, &state);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(state.n_chunks, 3)
+    CU_ASSERT_EQUAL(state.n_objects, 3)
+    CU_ASSERT_STRING_EQUAL(state.keys[0], "k1")
+    CU_ASSERT_STRING_EQUAL(state.keys[2], "k3")
+
+    // One request per page, the second resuming from the continuation
+    riak_uint8_t header[4];
+    riak_uint8_t body[256];
+    int i;
+    for(i = 0; i < 2; i++) {
+        CU_ASSERT_FATAL(read(server, header, sizeof(header)) == sizeof(header))
+        riak_uint32_t frame_len = (header[2] << 8) | header[3];
+        CU_ASSERT_FATAL(frame_len <= sizeof(body))
+        CU_ASSERT_FATAL(read(server, body, frame_len) == frame_len)
+        CU_ASSERT_EQUAL(body[0], MSG_RPBCSBUCKETREQ)
+        RpbCSBucketReq *req = rpb_csbucket_req__unpack(NULL, frame_len - 1, body + 1);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+        CU_ASSERT_EQUAL(req->max_results, 2)
+        CU_ASSERT_EQUAL(req->has_continuation, (i == 1))
+        if (i == 1) {
+            CU_ASSERT_NSTRING_EQUAL(req->continuation.data, "c1", 2)
+        }
+        rpb_csbucket_req__free_unpacked(req, NULL);
+    }
+
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &start);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(server);
+    close(listener);
+    CU_PASS("test_csbucket_fold_pages passed")
+}
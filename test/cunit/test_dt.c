@@ -0,0 +1,434 @@
+/*********************************************************************
+ *
+ * test_dt.c: Riak C Unit testing for Data Types
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_operation-internal.h"
+#include "test_dt.h"
+
+#define TEST_DT_PB(F, S) { (F).data = (uint8_t*)(S); (F).len = strlen(S); }
+
+static riak_boolean_t
+test_dt_pb_is(ProtobufCBinaryData *pb,
+              const char          *expected) {
+    return (pb->len == strlen(expected) && memcmp(pb->data, expected, pb->len) == 0);
+}
+
+static riak_boolean_t
+test_dt_binary_is(riak_binary *bin,
+                  const char  *expected) {
+    return (bin != NULL && riak_binary_len(bin) == strlen(expected) &&
+            memcmp(riak_binary_data(bin), expected, strlen(expected)) == 0);
+}
+
+/**
+ * @brief Encode `op` and unpack the request again, as the server would
+ */
+static DtUpdateReq*
+test_dt_encode(riak_connection *cxn,
+               riak_dt_op      *op) {
+    riak_config *cfg = riak_connection_get_config(cxn);
+    riak_binary *type   = riak_binary_copy_from_string(cfg, "maps");
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "bucket");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "key");
+    riak_operation *rop = NULL;
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    DtUpdateReq *req = NULL;
+    riak_error err = riak_dt_update_request_encode(rop, type, bucket, key, op, NULL, &(rop->pb_request));
+    if (err == ERIAK_OK) {
+        CU_ASSERT_EQUAL(rop->pb_request->msgid, MSG_DTUPDATEREQ)
+        req = dt_update_req__unpack(NULL, rop->pb_request->len, rop->pb_request->data);
+    }
+    riak_operation_free(&rop);
+    riak_binary_free(cfg, &type);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    return req;
+}
+
+void
+test_dt_counter_set_folding() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+
+    riak_dt_op *counter = riak_dt_op_new(cfg, RIAK_DT_COUNTER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(counter)
+    riak_dt_op_counter_increment(counter, 5);
+    riak_dt_op_counter_increment(counter, -2);
+    riak_dt_op_counter_increment(counter, 10);
+    CU_ASSERT_EQUAL(riak_dt_op_get_n_pending(counter), 3)
+    riak_binary *member = riak_binary_copy_from_string(cfg, "a");
+    CU_ASSERT_EQUAL(riak_dt_op_set_add(counter, member), ERIAK_DT_TYPE)
+    DtUpdateReq *req = test_dt_encode(cxn, counter);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req->op->counter_op)
+    CU_ASSERT_PTR_NULL(req->op->set_op)
+    CU_ASSERT_EQUAL(req->op->counter_op->increment, 13)
+    CU_ASSERT(test_dt_pb_is(&(req->type), "maps"))
+    dt_update_req__free_unpacked(req, NULL);
+    riak_dt_op_clear(counter);
+    CU_ASSERT_EQUAL(riak_dt_op_get_n_pending(counter), 0)
+    riak_dt_op_free(cfg, &counter);
+    CU_ASSERT_PTR_NULL(counter)
+
+    // Many members, most of them repeated, fold down to one add or remove each
+    riak_dt_op *set = riak_dt_op_new(cfg, RIAK_DT_SET);
+    char name[16];
+    int i;
+    for(i = 0; i < 3000; i++) {
+        snprintf(name, sizeof(name), "m%d", i % 500);
+        riak_binary *bin = riak_binary_copy_from_string(cfg, name);
+        if (i % 500 < 100) {
+            // Added then removed: only the remove is sent
+            riak_dt_op_set_add(set, bin);
+            err = riak_dt_op_set_remove(set, bin);
+        } else {
+            err = riak_dt_op_set_add(set, bin);
+        }
+        CU_ASSERT_EQUAL(err, ERIAK_OK)
+        riak_binary_free(cfg, &bin);
+    }
+    CU_ASSERT_EQUAL(riak_dt_op_counter_increment(set, 1), ERIAK_DT_TYPE)
+    req = test_dt_encode(cxn, set);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req->op->set_op)
+    CU_ASSERT_EQUAL(req->op->set_op->n_adds, 400)
+    CU_ASSERT_EQUAL(req->op->set_op->n_removes, 100)
+    CU_ASSERT(test_dt_pb_is(&(req->op->set_op->removes[0]), "m0"))
+    CU_ASSERT(test_dt_pb_is(&(req->op->set_op->adds[0]), "m100"))
+    dt_update_req__free_unpacked(req, NULL);
+
+    // A later add wins over the earlier remove
+    riak_dt_op_set_add(set, member);
+    riak_dt_op_set_remove(set, member);
+    riak_dt_op_set_add(set, member);
+    req = test_dt_encode(cxn, set);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    CU_ASSERT_EQUAL(req->op->set_op->n_adds, 401)
+    CU_ASSERT(test_dt_pb_is(&(req->op->set_op->adds[400]), "a"))
+    dt_update_req__free_unpacked(req, NULL);
+
+    riak_dt_op_free(cfg, &set);
+    riak_binary_free(cfg, &member);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_dt_counter_set_folding passed")
+}
+
+static MapUpdate*
+test_dt_find_update(MapOp      *op,
+                    const char *name) {
+    int i;
+    for(i = 0; i < op->n_updates; i++) {
+        if (test_dt_pb_is(&(op->updates[i]->field->name), name)) return op->updates[i];
+    }
+    return NULL;
+}
+
+void
+test_dt_map_encode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_binary *visits  = riak_binary_copy_from_string(cfg, "visits");
+    riak_binary *tags    = riak_binary_copy_from_string(cfg, "tags");
+    riak_binary *email   = riak_binary_copy_from_string(cfg, "email");
+    riak_binary *admin   = riak_binary_copy_from_string(cfg, "admin");
+    riak_binary *address = riak_binary_copy_from_string(cfg, "address");
+    riak_binary *friends = riak_binary_copy_from_string(cfg, "friends");
+    riak_binary *old     = riak_binary_copy_from_string(cfg, "old@example.com");
+    riak_binary *current = riak_binary_copy_from_string(cfg, "me@example.com");
+
+    riak_dt_op *map = riak_dt_op_new(cfg, RIAK_DT_MAP);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map)
+    riak_dt_op *field = NULL;
+    riak_dt_op *again = NULL;
+    CU_ASSERT_EQUAL(riak_dt_op_map_update(map, visits, RIAK_DT_FIELD_COUNTER, &field), ERIAK_OK)
+    riak_dt_op_counter_increment(field, 1);
+    riak_dt_op_counter_increment(field, 1);
+    // The same field comes back, folding into the same CounterOp
+    riak_dt_op_map_update(map, visits, RIAK_DT_FIELD_COUNTER, &again);
+    CU_ASSERT_EQUAL(again, field)
+    riak_dt_op_counter_increment(again, 3);
+    CU_ASSERT_EQUAL(riak_dt_op_map_update(map, email, RIAK_DT_FIELD_REGISTER, &field), ERIAK_DT_TYPE)
+    riak_dt_op_map_update(map, tags, RIAK_DT_FIELD_SET, &field);
+    riak_dt_op_set_add(field, admin);
+    riak_dt_op_map_set_register(map, email, old);
+    riak_dt_op_map_set_register(map, email, current);
+    riak_dt_op_map_set_flag(map, admin, RIAK_TRUE);
+    riak_dt_op_map_set_flag(map, admin, RIAK_FALSE);
+    // Nested map with one flag; an untouched field is only created
+    riak_dt_op_map_update(map, address, RIAK_DT_FIELD_MAP, &field);
+    riak_dt_op_map_set_flag(field, admin, RIAK_TRUE);
+    riak_dt_op_map_update(map, friends, RIAK_DT_FIELD_SET, &field);
+    // Removing drops the pending updates of the field
+    riak_dt_op_map_update(map, tags, RIAK_DT_FIELD_COUNTER, &field);
+    riak_dt_op_counter_increment(field, 7);
+    CU_ASSERT_EQUAL(riak_dt_op_map_remove(map, tags, RIAK_DT_FIELD_COUNTER), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_dt_op_get_n_pending(map), 15)
+    CU_ASSERT_EQUAL(riak_dt_op_map_remove(map, tags, (riak_dt_field_type)0), ERIAK_DT_TYPE)
+    CU_ASSERT_EQUAL(riak_dt_op_set_add(map, admin), ERIAK_DT_TYPE)
+
+    DtUpdateReq *req = test_dt_encode(cxn, map);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(req)
+    MapOp *mapop = req->op->map_op;
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapop)
+    CU_ASSERT_EQUAL(mapop->n_updates, 5)
+    CU_ASSERT_EQUAL_FATAL(mapop->n_adds, 1)
+    CU_ASSERT(test_dt_pb_is(&(mapop->adds[0]->name), "friends"))
+    CU_ASSERT_EQUAL(mapop->adds[0]->type, MAP_FIELD__MAP_FIELD_TYPE__SET)
+    CU_ASSERT_EQUAL_FATAL(mapop->n_removes, 1)
+    CU_ASSERT(test_dt_pb_is(&(mapop->removes[0]->name), "tags"))
+    CU_ASSERT_EQUAL(mapop->removes[0]->type, MAP_FIELD__MAP_FIELD_TYPE__COUNTER)
+
+    MapUpdate *update = test_dt_find_update(mapop, "visits");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update->counter_op)
+    CU_ASSERT_EQUAL(update->counter_op->increment, 5)
+    update = test_dt_find_update(mapop, "tags");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update)
+    CU_ASSERT_EQUAL(update->field->type, MAP_FIELD__MAP_FIELD_TYPE__SET)
+    CU_ASSERT_EQUAL_FATAL(update->set_op->n_adds, 1)
+    CU_ASSERT(test_dt_pb_is(&(update->set_op->adds[0]), "admin"))
+    update = test_dt_find_update(mapop, "email");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update)
+    CU_ASSERT_EQUAL(update->has_register_op, RIAK_TRUE)
+    CU_ASSERT(test_dt_pb_is(&(update->register_op), "me@example.com"))
+    update = test_dt_find_update(mapop, "admin");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update)
+    CU_ASSERT_EQUAL(update->flag_op, MAP_UPDATE__FLAG_OP__DISABLE)
+    update = test_dt_find_update(mapop, "address");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(update->map_op)
+    CU_ASSERT_EQUAL_FATAL(update->map_op->n_updates, 1)
+    CU_ASSERT_EQUAL(update->map_op->updates[0]->flag_op, MAP_UPDATE__FLAG_OP__ENABLE)
+    dt_update_req__free_unpacked(req, NULL);
+
+    // Field operations cannot be sent on their own
+    riak_operation *rop = NULL;
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    riak_dt_op_map_update(map, visits, RIAK_DT_FIELD_COUNTER, &field);
+    err = riak_dt_update_request_encode(rop, admin, admin, admin, field, NULL, &(rop->pb_request));
+    CU_ASSERT_EQUAL(err, ERIAK_DT_TYPE)
+    riak_operation_free(&rop);
+
+    riak_dt_op_free(cfg, &map);
+    riak_binary_free(cfg, &visits);
+    riak_binary_free(cfg, &tags);
+    riak_binary_free(cfg, &email);
+    riak_binary_free(cfg, &admin);
+    riak_binary_free(cfg, &address);
+    riak_binary_free(cfg, &friends);
+    riak_binary_free(cfg, &old);
+    riak_binary_free(cfg, &current);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_dt_map_encode passed")
+}
+
+void
+test_dt_fetch_decode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+
+    // { visits: 12, tags: {a, b}, email: "me", address: { admin: true } }
+    MapField visits_field = MAP_FIELD__INIT;
+    MapField tags_field   = MAP_FIELD__INIT;
+    MapField email_field  = MAP_FIELD__INIT;
+    MapField addr_field   = MAP_FIELD__INIT;
+    MapField admin_field  = MAP_FIELD__INIT;
+    TEST_DT_PB(visits_field.name, "visits")
+    visits_field.type = MAP_FIELD__MAP_FIELD_TYPE__COUNTER;
+    TEST_DT_PB(tags_field.name, "tags")
+    tags_field.type = MAP_FIELD__MAP_FIELD_TYPE__SET;
+    TEST_DT_PB(email_field.name, "email")
+    email_field.type = MAP_FIELD__MAP_FIELD_TYPE__REGISTER;
+    TEST_DT_PB(addr_field.name, "address")
+    addr_field.type = MAP_FIELD__MAP_FIELD_TYPE__MAP;
+    TEST_DT_PB(admin_field.name, "admin")
+    admin_field.type = MAP_FIELD__MAP_FIELD_TYPE__FLAG;
+    MapEntry visits = MAP_ENTRY__INIT;
+    MapEntry tags   = MAP_ENTRY__INIT;
+    MapEntry email  = MAP_ENTRY__INIT;
+    MapEntry addr   = MAP_ENTRY__INIT;
+    MapEntry admin  = MAP_ENTRY__INIT;
+    visits.field = &visits_field;
+    visits.has_counter_value = 1;
+    visits.counter_value = -12;
+    ProtobufCBinaryData members[2];
+    TEST_DT_PB(members[0], "a")
+    TEST_DT_PB(members[1], "b")
+    tags.field = &tags_field;
+    tags.n_set_value = 2;
+    tags.set_value = members;
+    email.field = &email_field;
+    email.has_register_value = 1;
+    TEST_DT_PB(email.register_value, "me")
+    admin.field = &admin_field;
+    admin.has_flag_value = 1;
+    admin.flag_value = 1;
+    MapEntry *nested[1] = { &admin };
+    addr.field = &addr_field;
+    addr.n_map_value = 1;
+    addr.map_value = nested;
+    MapEntry *entries[4] = { &visits, &tags, &email, &addr };
+    DtValue value = DT_VALUE__INIT;
+    value.n_map_value = 4;
+    value.map_value = entries;
+    DtFetchResp msg = DT_FETCH_RESP__INIT;
+    msg.has_context = 1;
+    TEST_DT_PB(msg.context, "ctx")
+    msg.type = DT_FETCH_RESP__DATA_TYPE__MAP;
+    msg.value = &value;
+    riak_size_t   len   = dt_fetch_resp__get_packed_size(&msg);
+    riak_uint8_t *bytes = (riak_uint8_t*)malloc(len + 1);
+    bytes[0] = MSG_DTFETCHRESP;
+    dt_fetch_resp__pack(&msg, bytes + 1);
+
+    riak_pb_message pb_response;
+    pb_response.data = bytes;
+    pb_response.len  = len + 1;
+    riak_dt_fetch_response *response = NULL;
+    riak_boolean_t          done = RIAK_FALSE;
+    err = riak_dt_fetch_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+    // Everything was copied out of the message
+    memset(bytes, 0xff, len + 1);
+    free(bytes);
+    CU_ASSERT_EQUAL(riak_dt_fetch_get_type(response), RIAK_DT_MAP)
+    CU_ASSERT_EQUAL(riak_dt_fetch_get_has_context(response), RIAK_TRUE)
+    CU_ASSERT(test_dt_binary_is(riak_dt_fetch_get_context(response), "ctx"))
+    riak_dt_value *map = riak_dt_fetch_get_value(response);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(map)
+    CU_ASSERT_EQUAL(riak_dt_value_get_n_map(map), 4)
+    riak_binary *name = riak_binary_copy_from_string(cfg, "visits");
+    riak_dt_map_entry *entry = riak_dt_value_find(map, name, RIAK_DT_FIELD_COUNTER);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(entry)
+    CU_ASSERT_EQUAL(riak_dt_value_get_has_counter(riak_dt_map_entry_get_value(entry)), RIAK_TRUE)
+    CU_ASSERT_EQUAL(riak_dt_value_get_counter(riak_dt_map_entry_get_value(entry)), -12)
+    CU_ASSERT_PTR_NULL(riak_dt_value_find(map, name, RIAK_DT_FIELD_SET))
+    riak_binary_free(cfg, &name);
+    entry = riak_dt_value_get_map(map)[1];
+    CU_ASSERT_EQUAL(riak_dt_map_entry_get_type(entry), RIAK_DT_FIELD_SET)
+    CU_ASSERT_EQUAL_FATAL(riak_dt_value_get_n_set(riak_dt_map_entry_get_value(entry)), 2)
+    CU_ASSERT(test_dt_binary_is(riak_dt_value_get_set(riak_dt_map_entry_get_value(entry))[1], "b"))
+    entry = riak_dt_value_get_map(map)[2];
+    CU_ASSERT_EQUAL(riak_dt_map_entry_get_has_register(entry), RIAK_TRUE)
+    CU_ASSERT(test_dt_binary_is(riak_dt_map_entry_get_register(entry), "me"))
+    CU_ASSERT_PTR_NULL(riak_dt_map_entry_get_value(entry))
+    entry = riak_dt_value_get_map(map)[3];
+    CU_ASSERT(test_dt_binary_is(riak_dt_map_entry_get_name(entry), "address"))
+    riak_dt_value *inner = riak_dt_map_entry_get_value(entry);
+    CU_ASSERT_EQUAL_FATAL(riak_dt_value_get_n_map(inner), 1)
+    entry = riak_dt_value_get_map(inner)[0];
+    CU_ASSERT_EQUAL(riak_dt_map_entry_get_has_flag(entry), RIAK_TRUE)
+    CU_ASSERT_EQUAL(riak_dt_map_entry_get_flag(entry), RIAK_TRUE)
+    char output[4096];
+    CU_ASSERT(riak_dt_fetch_response_print(response, output, sizeof(output)) > 0)
+    riak_dt_fetch_response_free(cfg, &response);
+    CU_ASSERT_PTR_NULL(response)
+
+    // Not found has no value at all
+    riak_uint8_t notfound[] = { MSG_DTFETCHRESP, 0x10, 0x01 };
+    pb_response.data = notfound;
+    pb_response.len  = sizeof(notfound);
+    err = riak_dt_fetch_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_dt_fetch_get_type(response), RIAK_DT_COUNTER)
+    CU_ASSERT_PTR_NULL(riak_dt_fetch_get_value(response))
+    riak_dt_fetch_response_free(cfg, &response);
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_dt_fetch_decode passed")
+}
+
+void
+test_dt_update_decode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+
+    DtUpdateResp msg = DT_UPDATE_RESP__INIT;
+    msg.has_key = 1;
+    TEST_DT_PB(msg.key, "Assigned")
+    msg.has_counter_value = 1;
+    msg.counter_value = 42;
+    riak_size_t   len   = dt_update_resp__get_packed_size(&msg);
+    riak_uint8_t *bytes = (riak_uint8_t*)malloc(len + 1);
+    bytes[0] = MSG_DTUPDATERESP;
+    dt_update_resp__pack(&msg, bytes + 1);
+    riak_pb_message pb_response;
+    pb_response.data = bytes;
+    pb_response.len  = len + 1;
+    riak_dt_update_response *response = NULL;
+    riak_boolean_t           done = RIAK_FALSE;
+    err = riak_dt_update_response_decode(rop, &pb_response, &response, &done);
+    free(bytes);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+    CU_ASSERT_EQUAL(riak_dt_update_get_has_key(response), RIAK_TRUE)
+    CU_ASSERT(test_dt_binary_is(riak_dt_update_get_key(response), "Assigned"))
+    CU_ASSERT_EQUAL(riak_dt_update_get_has_context(response), RIAK_FALSE)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(riak_dt_update_get_value(response))
+    CU_ASSERT_EQUAL(riak_dt_value_get_counter(riak_dt_update_get_value(response)), 42)
+    riak_dt_update_response_free(cfg, &response);
+
+    // Without Return Body the response is empty
+    riak_uint8_t empty[] = { MSG_DTUPDATERESP };
+    pb_response.data = empty;
+    pb_response.len  = sizeof(empty);
+    err = riak_dt_update_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_dt_update_get_has_key(response), RIAK_FALSE)
+    CU_ASSERT_PTR_NULL(riak_dt_update_get_value(response))
+    riak_dt_update_response_free(cfg, &response);
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_dt_update_decode passed")
+}
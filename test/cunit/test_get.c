@@ -298,3 +298,57 @@ test_get_decode_response() {
     riak_config_free(&cfg);
     CU_PASS("test_get_decode_response passed")
 }
+
+void
+test_get_template_matches_encode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "bucket");
+    riak_binary *vclock = riak_binary_copy_from_string(cfg, "vclock");
+    riak_get_options *opt = riak_get_options_new(cfg);
+    riak_get_options_set_r(opt, 2);
+    riak_get_options_set_if_modified(cfg, opt, vclock);
+    riak_get_options_set_timeout(opt, 1000);
+    riak_get_template *tmpl = NULL;
+    err = riak_get_template_new(cfg, &tmpl, bucket, opt);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    // The template keeps its own copy of the bucket
+    riak_binary_free(cfg, &bucket);
+    bucket = riak_binary_copy_from_string(cfg, "bucket");
+
+    const char *keys[] = { "", "key", "a much longer key to splice in" };
+    int i;
+    for(i = 0; i < 3; i++) {
+        riak_binary *key = riak_binary_copy_from_string(cfg, keys[i]);
+        riak_operation *expected = NULL;
+        riak_operation *prepared = NULL;
+        riak_operation_new(cxn, &expected, NULL, NULL, NULL);
+        riak_operation_new(cxn, &prepared, NULL, NULL, NULL);
+        err = riak_get_request_encode(expected, bucket, key, opt, &(expected->pb_request));
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        err = riak_get_template_request_encode(prepared, tmpl, key, &(prepared->pb_request));
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        CU_ASSERT_EQUAL(prepared->pb_request->msgid, MSG_RPBGETREQ)
+        CU_ASSERT_EQUAL_FATAL(prepared->pb_request->len, expected->pb_request->len)
+        CU_ASSERT_EQUAL(memcmp(prepared->pb_request->data, expected->pb_request->data, expected->pb_request->len), 0)
+        riak_binary *op_bucket = riak_operation_get_bucket(prepared);
+        CU_ASSERT_EQUAL_FATAL(riak_binary_len(op_bucket), riak_binary_len(bucket))
+        CU_ASSERT_EQUAL(memcmp(riak_binary_data(op_bucket), riak_binary_data(bucket), riak_binary_len(bucket)), 0)
+        CU_ASSERT_EQUAL(riak_binary_len(riak_operation_get_key(prepared)), strlen(keys[i]))
+        riak_operation_free(&expected);
+        riak_operation_free(&prepared);
+        riak_binary_free(cfg, &key);
+    }
+
+    riak_get_template_free(cfg, &tmpl);
+    CU_ASSERT_PTR_NULL(tmpl)
+    riak_get_options_free(cfg, &opt);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &vclock);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_get_template_matches_encode passed")
+}
@@ -0,0 +1,204 @@
+/*********************************************************************
+ *
+ * test_libevent.c: Riak C Unit testing for the libevent engine
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_libevent.h"
+#include "test_connection_pool.h"
+#include "test_libevent.h"
+
+#define TEST_LIBEVENT_N_OPS     500
+#define TEST_LIBEVENT_N_SERVER  2
+
+typedef struct _test_libevent_seen {
+    riak_config       *cfg;
+    struct event_base *base;
+    riak_uint32_t      n_expected;
+    riak_uint32_t      n_responses;
+    riak_uint32_t      n_errors;
+    riak_uint32_t      n_timeouts;
+} test_libevent_seen;
+
+static test_libevent_seen test_libevent_state;
+
+static void
+test_libevent_done() {
+    test_libevent_seen *seen = &test_libevent_state;
+    if (seen->n_responses + seen->n_errors == seen->n_expected) {
+        event_base_loopexit(seen->base, NULL);
+    }
+}
+
+static void
+test_libevent_get_cb(riak_get_response *response,
+                     void              *ptr) {
+    test_libevent_state.n_responses++;
+    riak_get_response_free(test_libevent_state.cfg, &response);
+    test_libevent_done();
+}
+
+static void
+test_libevent_error_cb(void *response,
+                       void *ptr) {
+    riak_operation *rop = (riak_operation*)ptr;
+    riak_server_error *error = riak_operation_get_server_error(rop);
+    test_libevent_state.n_errors++;
+    if (error && riak_server_error_get_errcode(error) == ERIAK_TIMEOUT) {
+        test_libevent_state.n_timeouts++;
+    }
+    riak_free_error_response(test_libevent_state.cfg, (riak_error_response**)&response);
+    test_libevent_done();
+}
+
+static riak_error
+test_libevent_send_get(riak_libevent_engine *engine,
+                       riak_binary          *bucket,
+                       riak_binary          *key) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_libevent_engine_operation_new(engine, &rop, NULL, test_libevent_error_cb, NULL);
+    if (err) return err;
+    riak_operation_set_cb_data(rop, rop);
+    err = riak_async_register_get(rop, bucket, key, NULL, (riak_response_callback)test_libevent_get_cb);
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_libevent_engine_send(engine, rop);
+}
+
+void
+test_libevent_engine_many_ops() {
+    char portnum[16];
+    test_reply_server server = { -1, TEST_LIBEVENT_N_SERVER, RIAK_FALSE, 10, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, TEST_LIBEVENT_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_serve_replies, &server) == 0)
+
+    struct event_base *base = event_base_new();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(base)
+    riak_libevent_engine *engine = NULL;
+    err = riak_libevent_engine_new(cfg, &engine, base, pool, TEST_LIBEVENT_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    memset(&test_libevent_state, '\0', sizeof(test_libevent_state));
+    test_libevent_state.cfg        = cfg;
+    test_libevent_state.base       = base;
+    test_libevent_state.n_expected = TEST_LIBEVENT_N_OPS;
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+    int i;
+    for(i = 0; i < TEST_LIBEVENT_N_OPS; i++) {
+        err = test_libevent_send_get(engine, bucket, key);
+        CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    }
+    CU_ASSERT_EQUAL(riak_libevent_engine_get_n_pending(engine), TEST_LIBEVENT_N_OPS)
+    event_base_dispatch(base);
+
+    // Server errors reach error_cb without disturbing their neighbours
+    CU_ASSERT_EQUAL(test_libevent_state.n_errors, TEST_LIBEVENT_N_OPS / 10)
+    CU_ASSERT_EQUAL(test_libevent_state.n_responses, TEST_LIBEVENT_N_OPS - TEST_LIBEVENT_N_OPS / 10)
+    CU_ASSERT_EQUAL(test_libevent_state.n_timeouts, 0)
+    CU_ASSERT_EQUAL(riak_libevent_engine_get_n_pending(engine), 0)
+
+    // Connections stay open and return to the pool
+    riak_libevent_engine_free(&engine);
+    CU_ASSERT_PTR_NULL(engine)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), TEST_LIBEVENT_N_SERVER)
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL(server.n_requests, TEST_LIBEVENT_N_OPS)
+    event_base_free(base);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_libevent_engine_many_ops passed")
+}
+
+void
+test_libevent_engine_timeout() {
+    char portnum[16];
+    test_reply_server server = { -1, TEST_LIBEVENT_N_SERVER, RIAK_TRUE, 0, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, TEST_LIBEVENT_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_serve_replies, &server) == 0)
+
+    struct event_base *base = event_base_new();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(base)
+    riak_libevent_engine *engine = NULL;
+    err = riak_libevent_engine_new(cfg, &engine, base, pool, TEST_LIBEVENT_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_libevent_engine_set_timeout(engine, 50);
+
+    memset(&test_libevent_state, '\0', sizeof(test_libevent_state));
+    test_libevent_state.cfg        = cfg;
+    test_libevent_state.base       = base;
+    test_libevent_state.n_expected = 4;
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+    int i;
+    for(i = 0; i < 4; i++) {
+        err = test_libevent_send_get(engine, bucket, key);
+        CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    }
+    event_base_dispatch(base);
+
+    // Every operation hears about the timeout exactly once
+    CU_ASSERT_EQUAL(test_libevent_state.n_responses, 0)
+    CU_ASSERT_EQUAL(test_libevent_state.n_errors, 4)
+    CU_ASSERT_EQUAL(test_libevent_state.n_timeouts, 4)
+    CU_ASSERT_EQUAL(riak_libevent_engine_get_n_pending(engine), 0)
+
+    // Timed-out connections are evicted rather than reused
+    riak_libevent_engine_free(&engine);
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    event_base_free(base);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_libevent_engine_timeout passed")
+}
@@ -71,3 +71,105 @@ test_listkeys_response_decode() {
     riak_config_free(&cfg);
     CU_PASS("test_liskeys_response_decode passed")
 }
+
+typedef struct {
+    riak_uint32_t n_calls;
+    riak_uint32_t n_keys;
+    char          last[32];
+} test_listkeys_stream_state;
+
+static void
+test_listkeys_stream_cb(riak_binary  **keys,
+                        riak_uint32_t  n_keys,
+                        void          *ptr) {
+    test_listkeys_stream_state *state = (test_listkeys_stream_state*)ptr;
+    state->n_calls++;
+    state->n_keys += n_keys;
+    riak_binary_print(keys[n_keys-1], state->last, sizeof(state->last));
+}
+
+void
+test_listkeys_response_stream() {
+    riak_config     *cfg;
+    riak_operation  *rop = NULL;
+    riak_connection *cxn = NULL;
+
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    test_listkeys_stream_state state;
+    memset(&state, '\0', sizeof(state));
+    riak_listkeys_set_stream_cb(rop, test_listkeys_stream_cb, &state);
+
+    riak_uint8_t bytes0[] = { 0x12,0x0a,0x12,0x33,0x39,0x33,0x33,0x31,0x30,0x30,0x31,0x33,0x38,0x36,0x35,0x30,0x36,0x36,0x34,0x39,0x36 };
+    riak_uint8_t bytes1[] = { 0x12,0x0a,0x03,0x62,0x61,0x6d };
+    riak_uint8_t bytes2[] = { 0x12,0x10,0x01 };
+    riak_uint8_t *bytes[] = { bytes0, bytes1, bytes2 };
+    riak_int32_t len[]    = { sizeof(bytes0), sizeof(bytes1), sizeof(bytes2) };
+
+    riak_pb_message         pb_response;
+    riak_listkeys_response *response = NULL;
+    riak_boolean_t          done = RIAK_FALSE;
+    for(int i = 0; i < 3; i++) {
+        pb_response.data = bytes[i];
+        pb_response.len  = len[i];
+        err = riak_listkeys_response_decode(rop, &pb_response, &response, &done);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+    }
+    CU_ASSERT_TRUE(done)
+    // The empty final chunk is not passed on
+    CU_ASSERT_EQUAL(state.n_calls, 2)
+    CU_ASSERT_EQUAL(state.n_keys, 2)
+    CU_ASSERT_STRING_EQUAL(state.last, "bam")
+    // Only the count is kept
+    CU_ASSERT_EQUAL(riak_listkeys_get_n_keys(response), 2)
+    CU_ASSERT_PTR_NULL(riak_listkeys_get_keys(response))
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_listkeys_response_free(cfg, &response);
+    riak_config_free(&cfg);
+    CU_PASS("test_listkeys_response_stream passed")
+}
+
+void
+test_listkeys_response_growth() {
+    riak_config     *cfg;
+    riak_operation  *rop = NULL;
+    riak_connection *cxn = NULL;
+
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    // 100 single-key chunks
+    riak_uint8_t bytes[] = { 0x12,0x0a,0x03,0x62,0x61,0x6d };
+    riak_pb_message         pb_response;
+    riak_listkeys_response *response = NULL;
+    riak_boolean_t          done = RIAK_FALSE;
+    pb_response.data = bytes;
+    pb_response.len  = sizeof(bytes);
+    for(int i = 0; i < 100; i++) {
+        err = riak_listkeys_response_decode(rop, &pb_response, &response, &done);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+    }
+    CU_ASSERT_FALSE(done)
+    CU_ASSERT_EQUAL(riak_listkeys_get_n_keys(response), 100)
+    // Capacity doubles rather than tracking every chunk
+    CU_ASSERT_EQUAL(response->keys_capacity, 128)
+    riak_binary **keys = riak_listkeys_get_keys(response);
+    CU_ASSERT_EQUAL(memcmp(riak_binary_data(keys[99]), "bam", riak_binary_len(keys[99])), 0)
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_listkeys_response_free(cfg, &response);
+    riak_config_free(&cfg);
+    CU_PASS("test_listkeys_response_growth passed")
+}
@@ -75,3 +75,105 @@ test_mapreduce_response_decode() {
     CU_ASSERT_EQUAL_FATAL(riak_mapreduce_message_get_has_done(msgs[4]), RIAK_TRUE)
     CU_ASSERT_EQUAL_FATAL(riak_mapreduce_message_get_done(msgs[4]), RIAK_TRUE)
 }
+
+typedef struct _test_mapreduce_stream_state {
+    riak_uint32_t n_calls;
+    riak_uint32_t phases[4];
+    char          last[16];
+} test_mapreduce_stream_state;
+
+static void
+test_mapreduce_stream_cb(riak_uint32_t phase,
+                         riak_binary  *result,
+                         void         *ptr) {
+    test_mapreduce_stream_state *state = (test_mapreduce_stream_state*)ptr;
+    if (state->n_calls < 4) {
+        state->phases[state->n_calls] = phase;
+    }
+    state->n_calls++;
+    snprintf(state->last, sizeof(state->last), "%.*s",
+             (int)riak_binary_len(result), (char*)riak_binary_data(result));
+}
+
+void
+test_mapreduce_response_stream() {
+    riak_config     *cfg;
+    riak_operation  *rop = NULL;
+    riak_connection *cxn = NULL;
+
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    test_mapreduce_stream_state state;
+    memset(&state, '\0', sizeof(state));
+    riak_mapreduce_set_stream_cb(rop, test_mapreduce_stream_cb, &state);
+
+    // Phase 0 "[[\"foo\",1]]", phase 1 "[3]", then done
+    riak_uint8_t bytes0[] = { 0x18,0x08,0x00,0x12,0x0b,0x5b,0x5b,0x22,0x66,0x6f,0x6f,0x22,0x2c,0x31,0x5d,0x5d };
+    riak_uint8_t bytes1[] = { 0x18,0x08,0x01,0x12,0x03,0x5b,0x33,0x5d };
+    riak_uint8_t bytes2[] = { 0x18,0x18,0x01 };
+    riak_uint8_t *bytes[] = { bytes0, bytes1, bytes2 };
+    riak_int32_t len[]    = { sizeof(bytes0), sizeof(bytes1), sizeof(bytes2) };
+
+    riak_pb_message          pb_response;
+    riak_mapreduce_response *response = NULL;
+    riak_boolean_t           done = RIAK_FALSE;
+    for(int i = 0; i < 3; i++) {
+        pb_response.data = bytes[i];
+        pb_response.len  = len[i];
+        err = riak_mapreduce_response_decode(rop, &pb_response, &response, &done);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+    }
+    CU_ASSERT_TRUE(done)
+    // The done marker carries no result and is not passed on
+    CU_ASSERT_EQUAL(state.n_calls, 2)
+    CU_ASSERT_EQUAL(state.phases[0], 0)
+    CU_ASSERT_EQUAL(state.phases[1], 1)
+    CU_ASSERT_STRING_EQUAL(state.last, "[3]")
+    CU_ASSERT_EQUAL(riak_mapreduce_get_n_responses(response), 2)
+    CU_ASSERT_PTR_NULL(riak_mapreduce_get_messages(response))
+
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_mapreduce_response_free(cfg, &response);
+    riak_config_free(&cfg);
+    CU_PASS("test_mapreduce_response_stream passed")
+}
+
+void
+test_mapreduce_register_streaming() {
+    riak_config     *cfg;
+    riak_operation  *rop = NULL;
+    riak_connection *cxn = NULL;
+
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *content_type = riak_binary_copy_from_string(cfg, "application/json");
+    riak_binary *job          = riak_binary_copy_from_string(cfg, "{}");
+
+    // Nowhere to stream to yet
+    err = riak_async_register_mapreduce(rop, content_type, job, RIAK_TRUE, NULL);
+    CU_ASSERT_EQUAL(err, ERIAK_UNINITIALIZED)
+    CU_ASSERT_PTR_NULL(rop->pb_request)
+
+    test_mapreduce_stream_state state;
+    memset(&state, '\0', sizeof(state));
+    riak_mapreduce_set_stream_cb(rop, test_mapreduce_stream_cb, &state);
+    err = riak_async_register_mapreduce(rop, content_type, job, RIAK_TRUE, NULL);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL(rop->stream_cb)
+
+    riak_binary_free(cfg, &content_type);
+    riak_binary_free(cfg, &job);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_mapreduce_register_streaming passed")
+}
@@ -0,0 +1,276 @@
+/*********************************************************************
+ *
+ * test_multiget.c: Riak C Unit testing for batched fetches
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+#include "test_multiget.h"
+
+#define TEST_MULTIGET_N_KEYS   50
+#define TEST_MULTIGET_N_SERVER 2
+
+// Length 1, RpbGetResp with nothing found
+static const riak_uint8_t test_multiget_notfound[] = { 0, 0, 0, 1, 10 };
+// Length 8, RpbErrorResp "bad", errcode 1
+static const riak_uint8_t test_multiget_error[] = { 0, 0, 0, 8, 0, 0x0a, 0x03, 0x62, 0x61, 0x64, 0x10, 0x01 };
+
+static riak_binary**
+test_multiget_keys(riak_config  *cfg,
+                   riak_uint32_t n_keys) {
+    riak_binary **keys = (riak_binary**)calloc(n_keys, sizeof(riak_binary*));
+    char name[16];
+    riak_uint32_t i;
+    for(i = 0; i < n_keys; i++) {
+        snprintf(name, sizeof(name), "key%d", i);
+        keys[i] = riak_binary_copy_from_string(cfg, name);
+    }
+    return keys;
+}
+
+static void
+test_multiget_free_keys(riak_config   *cfg,
+                        riak_binary  **keys,
+                        riak_uint32_t  n_keys) {
+    riak_uint32_t i;
+    for(i = 0; i < n_keys; i++) {
+        riak_binary_free(cfg, &keys[i]);
+    }
+    free(keys);
+}
+
+void
+test_multiget_per_key_errors() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+
+    // The middle key fails on the server; its neighbours must not
+    CU_ASSERT_FATAL(write(server, test_multiget_notfound, sizeof(test_multiget_notfound)) == sizeof(test_multiget_notfound))
+    CU_ASSERT_FATAL(write(server, test_multiget_error, sizeof(test_multiget_error)) == sizeof(test_multiget_error))
+    CU_ASSERT_FATAL(write(server, test_multiget_notfound, sizeof(test_multiget_notfound)) == sizeof(test_multiget_notfound))
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary **keys = test_multiget_keys(cfg, 3);
+    riak_multiget_options opts;
+    riak_multiget_options_init(&opts);
+    opts.concurrency = 1;
+    riak_get_response *responses[3];
+    riak_error         errors[3];
+    err = riak_multiget(pool, bucket, keys, 3, NULL, &opts, responses, errors);
+    CU_ASSERT_EQUAL(err, ERIAK_SERVER_ERROR)
+    CU_ASSERT_EQUAL(errors[0], ERIAK_OK)
+    CU_ASSERT_EQUAL(errors[1], ERIAK_SERVER_ERROR)
+    CU_ASSERT_EQUAL(errors[2], ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL(responses[0])
+    CU_ASSERT_PTR_NULL(responses[1])
+    CU_ASSERT_PTR_NOT_NULL(responses[2])
+    // The connection stayed usable and went back to the pool
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 1)
+
+    riak_get_response_free(cfg, &responses[0]);
+    riak_get_response_free(cfg, &responses[2]);
+    test_multiget_free_keys(cfg, keys, 3);
+    riak_binary_free(cfg, &bucket);
+    riak_connection_pool_free(&pool);
+    riak_config_free(&cfg);
+    close(server);
+    close(listener);
+    CU_PASS("test_multiget_per_key_errors passed")
+}
+
+typedef struct _test_multiget_server {
+    int           listener;
+    int           n_connections; // At most TEST_MULTIGET_N_SERVER
+    riak_uint32_t n_requests;
+} test_multiget_server;
+
+/**
+ * @brief Answer every request on `n_connections` connections with "not found"
+ */
+static void*
+test_multiget_serve(void *ptr) {
+    test_multiget_server *server = (test_multiget_server*)ptr;
+    struct pollfd fds[TEST_MULTIGET_N_SERVER];
+    int n_open = 0;
+    int i;
+    for(i = 0; i < server->n_connections; i++) {
+        fds[i].fd     = accept(server->listener, NULL, NULL);
+        fds[i].events = POLLIN;
+        if (fds[i].fd >= 0) n_open++;
+    }
+    while (n_open > 0 && poll(fds, server->n_connections, 5000) > 0) {
+        for(i = 0; i < server->n_connections; i++) {
+            if (fds[i].fd < 0 || fds[i].revents == 0) continue;
+            riak_uint8_t header[4];
+            riak_uint8_t body[256];
+            if (read(fds[i].fd, header, sizeof(header)) != sizeof(header)) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                n_open--;
+                continue;
+            }
+            riak_uint32_t len = ((riak_uint32_t)header[0] << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+            if (len > sizeof(body) || read(fds[i].fd, body, len) != len) {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                n_open--;
+                continue;
+            }
+            server->n_requests++;
+            if (write(fds[i].fd, test_multiget_notfound, sizeof(test_multiget_notfound)) != sizeof(test_multiget_notfound)) {
+                break;
+            }
+        }
+    }
+    for(i = 0; i < server->n_connections; i++) {
+        if (fds[i].fd >= 0) close(fds[i].fd);
+    }
+    return NULL;
+}
+
+typedef struct _test_multiget_seen {
+    riak_config  *cfg;
+    riak_uint32_t n_calls;
+    riak_uint32_t n_errors;
+    riak_uint8_t  seen[TEST_MULTIGET_N_KEYS];
+} test_multiget_seen;
+
+static void
+test_multiget_cb(riak_uint32_t      index,
+                 riak_error         err,
+                 riak_get_response *response,
+                 void              *ptr) {
+    test_multiget_seen *seen = (test_multiget_seen*)ptr;
+    seen->n_calls++;
+    seen->seen[index]++;
+    if (err) seen->n_errors++;
+    riak_get_response_free(seen->cfg, &response);
+}
+
+void
+test_multiget_parallel() {
+    char portnum[16];
+    test_multiget_server server = { -1, TEST_MULTIGET_N_SERVER, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, TEST_MULTIGET_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, TEST_MULTIGET_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_multiget_serve, &server) == 0)
+
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary **keys = test_multiget_keys(cfg, TEST_MULTIGET_N_KEYS);
+    riak_multiget_options opts;
+    riak_multiget_options_init(&opts);
+    opts.concurrency = TEST_MULTIGET_N_SERVER;
+    opts.depth       = 8;
+    test_multiget_seen seen;
+    memset(&seen, '\0', sizeof(seen));
+    seen.cfg = cfg;
+    err = riak_multiget_cb(pool, bucket, keys, TEST_MULTIGET_N_KEYS, NULL, &opts, test_multiget_cb, &seen);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(seen.n_calls, TEST_MULTIGET_N_KEYS)
+    CU_ASSERT_EQUAL(seen.n_errors, 0)
+    int i;
+    for(i = 0; i < TEST_MULTIGET_N_KEYS; i++) {
+        CU_ASSERT_EQUAL(seen.seen[i], 1)
+    }
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), TEST_MULTIGET_N_SERVER)
+
+    // Closing the pool lets the server thread finish
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL(server.n_requests, TEST_MULTIGET_N_KEYS)
+    test_multiget_free_keys(cfg, keys, TEST_MULTIGET_N_KEYS);
+    riak_binary_free(cfg, &bucket);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_multiget_parallel passed")
+}
+
+void
+test_multiget_small_pool() {
+    char portnum[16];
+    test_multiget_server server = { -1, 1, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_connection_pool_warm(pool, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_multiget_serve, &server) == 0)
+
+    // More workers asked for than the pool can hand connections to
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary **keys = test_multiget_keys(cfg, TEST_MULTIGET_N_KEYS);
+    riak_multiget_options opts;
+    riak_multiget_options_init(&opts);
+    opts.concurrency = 4;
+    opts.depth       = 4;
+    test_multiget_seen seen;
+    memset(&seen, '\0', sizeof(seen));
+    seen.cfg = cfg;
+    err = riak_multiget_cb(pool, bucket, keys, TEST_MULTIGET_N_KEYS, NULL, &opts, test_multiget_cb, &seen);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(seen.n_calls, TEST_MULTIGET_N_KEYS)
+    CU_ASSERT_EQUAL(seen.n_errors, 0)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), 1)
+
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL(server.n_requests, TEST_MULTIGET_N_KEYS)
+    test_multiget_free_keys(cfg, keys, TEST_MULTIGET_N_KEYS);
+    riak_binary_free(cfg, &bucket);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_multiget_small_pool passed")
+}
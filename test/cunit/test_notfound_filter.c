@@ -0,0 +1,154 @@
+/*********************************************************************
+ *
+ * test_notfound_filter.c: Riak C Unit testing for the negative-lookup cache
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+#include "test_notfound_filter.h"
+
+#define TEST_NOTFOUND_N_KEYS 1000
+
+void
+test_notfound_filter_membership() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_notfound_filter *filter = NULL;
+    err = riak_notfound_filter_new(cfg, &filter, 0, 1000);
+    CU_ASSERT_EQUAL(err, ERIAK_UNINITIALIZED)
+    err = riak_notfound_filter_new(cfg, &filter, TEST_NOTFOUND_N_KEYS, 60000);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "users");
+    riak_binary *key = NULL;
+    char name[32];
+    int i;
+    for(i = 0; i < TEST_NOTFOUND_N_KEYS; i++) {
+        snprintf(name, sizeof(name), "missing%d", i);
+        key = riak_binary_copy_from_string(cfg, name);
+        riak_notfound_filter_add(filter, bucket, key);
+        riak_binary_free(cfg, &key);
+    }
+    int n_false = 0;
+    for(i = 0; i < TEST_NOTFOUND_N_KEYS; i++) {
+        snprintf(name, sizeof(name), "missing%d", i);
+        key = riak_binary_copy_from_string(cfg, name);
+        CU_ASSERT_TRUE(riak_notfound_filter_contains(filter, bucket, key))
+        riak_binary_free(cfg, &key);
+        snprintf(name, sizeof(name), "present%d", i);
+        key = riak_binary_copy_from_string(cfg, name);
+        if (riak_notfound_filter_contains(filter, bucket, key)) n_false++;
+        riak_binary_free(cfg, &key);
+    }
+    // Sized for about 1%
+    CU_ASSERT(n_false < TEST_NOTFOUND_N_KEYS / 20)
+
+    // Counted twice, removed once, still forgotten
+    key = riak_binary_copy_from_string(cfg, "missing0");
+    riak_notfound_filter_add(filter, bucket, key);
+    riak_notfound_filter_remove(filter, bucket, key);
+    CU_ASSERT_FALSE(riak_notfound_filter_contains(filter, bucket, key))
+    riak_notfound_filter_free(&filter);
+    CU_ASSERT_PTR_NULL(filter)
+
+    // Keys are forgotten once the TTL passes
+    err = riak_notfound_filter_new(cfg, &filter, 16, 40);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_notfound_filter_add(filter, bucket, key);
+    CU_ASSERT_TRUE(riak_notfound_filter_contains(filter, bucket, key))
+    usleep(60000);
+    CU_ASSERT_FALSE(riak_notfound_filter_contains(filter, bucket, key))
+    riak_notfound_filter_free(&filter);
+
+    riak_binary_free(cfg, &key);
+    riak_binary_free(cfg, &bucket);
+    riak_config_free(&cfg);
+    CU_PASS("test_notfound_filter_membership passed")
+}
+
+void
+test_notfound_filter_answers_locally() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_FALSE, 0, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    pthread_t server_thread;
+    CU_ASSERT_FATAL(pthread_create(&server_thread, NULL, test_serve_replies, &server) == 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_notfound_filter *filter = NULL;
+    err = riak_notfound_filter_new(cfg, &filter, 64, 60000);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "users");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "nobody");
+    riak_get_response *response = NULL;
+
+    // The first probe goes out; the repeat is answered here
+    err = riak_notfound_filter_get(cxn, filter, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_get_get_n_content(response), 0)
+    riak_get_response_free(cfg, &response);
+    err = riak_notfound_filter_get(cxn, filter, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL(response)
+    CU_ASSERT_EQUAL(riak_get_get_n_content(response), 0)
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_EQUAL(server.n_requests, 1)
+    CU_ASSERT_EQUAL(riak_notfound_filter_get_hits(filter), 1)
+
+    // Storing the key through the filter sends the next probe to the server
+    riak_object *obj = riak_object_new(cfg);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(obj)
+    riak_object_set_bucket(obj, riak_binary_copy(cfg, bucket));
+    riak_object_set_key(obj, riak_binary_copy(cfg, key));
+    riak_object_set_value(obj, riak_binary_copy_from_string(cfg, "{}"));
+    riak_put_response *put_response = NULL;
+    err = riak_notfound_filter_put(cxn, filter, obj, NULL, &put_response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_put_response_free(cfg, &put_response);
+    CU_ASSERT_FALSE(riak_notfound_filter_contains(filter, bucket, key))
+    err = riak_notfound_filter_get(cxn, filter, bucket, key, NULL, &response);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    riak_get_response_free(cfg, &response);
+    CU_ASSERT_EQUAL(server.n_requests, 3)
+
+    riak_object_free(cfg, &obj);
+    riak_notfound_filter_free(&filter);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_connection_free(&cxn);
+    pthread_join(server_thread, NULL);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_notfound_filter_answers_locally passed")
+}
@@ -0,0 +1,291 @@
+/*********************************************************************
+ *
+ * test_pipeline.c: Riak C Unit testing for pipelined requests
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "test_connection_pool.h"
+
+#define TEST_PIPELINE_DEPTH 3
+#define TEST_PIPELINE_BIG_FRAME 20000
+
+// Length 1, RpbPingResp
+static const riak_uint8_t test_pipeline_pong[] = { 0, 0, 0, 1, 2 };
+
+typedef struct _test_pipeline_state {
+    riak_config  *cfg;
+    riak_uint32_t n_answered;
+    riak_uint32_t n_failed;
+    riak_uint32_t order[TEST_PIPELINE_DEPTH];
+} test_pipeline_state;
+
+typedef struct _test_pipeline_request {
+    test_pipeline_state *state;
+    riak_uint32_t        id;
+} test_pipeline_request;
+
+static void
+test_pipeline_ping_cb(void *response,
+                      void *ptr) {
+    test_pipeline_request *request = (test_pipeline_request*)ptr;
+    test_pipeline_state   *state   = request->state;
+    riak_ping_response    *pong    = (riak_ping_response*)response;
+    state->order[state->n_answered++] = request->id;
+    riak_free_ping_response(state->cfg, &pong);
+}
+
+static void
+test_pipeline_error_cb(void *response,
+                       void *ptr) {
+    test_pipeline_request *request = (test_pipeline_request*)ptr;
+    request->state->n_failed++;
+}
+
+/**
+ * @brief Queue TEST_PIPELINE_DEPTH pings and accept the connection they went to
+ * @returns Server side of the connection
+ */
+static int
+test_pipeline_send_pings(riak_connection       *cxn,
+                         int                    listener,
+                         test_pipeline_request *requests) {
+    riak_error err;
+    int i;
+    for(i = 0; i < TEST_PIPELINE_DEPTH; i++) {
+        riak_operation *rop = NULL;
+        err = riak_operation_new(cxn, &rop, NULL, test_pipeline_error_cb, &requests[i]);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        err = riak_async_register_ping(rop, test_pipeline_ping_cb);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        err = riak_pipeline_send(rop);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+    }
+    CU_ASSERT_EQUAL(riak_connection_get_n_pending(cxn), TEST_PIPELINE_DEPTH)
+    err = riak_pipeline_flush(cxn);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+    // All requests are on the wire before any response comes back
+    riak_uint8_t  inbuf[sizeof(test_pipeline_pong)*TEST_PIPELINE_DEPTH];
+    riak_size_t   total = 0;
+    while (total < sizeof(inbuf)) {
+        riak_ssize_t got = read(server, inbuf + total, sizeof(inbuf) - total);
+        CU_ASSERT_FATAL(got > 0)
+        total += got;
+    }
+    return server;
+}
+
+void
+test_pipeline_in_order() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    test_pipeline_state   state = { cfg, 0, 0, { 0 } };
+    test_pipeline_request requests[TEST_PIPELINE_DEPTH];
+    int i;
+    for(i = 0; i < TEST_PIPELINE_DEPTH; i++) {
+        requests[i].state = &state;
+        requests[i].id    = i;
+    }
+    int server = test_pipeline_send_pings(cxn, listener, requests);
+    for(i = 0; i < TEST_PIPELINE_DEPTH; i++) {
+        CU_ASSERT_FATAL(write(server, test_pipeline_pong, sizeof(test_pipeline_pong)) == sizeof(test_pipeline_pong))
+    }
+
+    err = riak_pipeline_drain(cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(state.n_answered, TEST_PIPELINE_DEPTH)
+    CU_ASSERT_EQUAL(state.n_failed, 0)
+    for(i = 0; i < TEST_PIPELINE_DEPTH; i++) {
+        CU_ASSERT_EQUAL(state.order[i], i)
+    }
+    CU_ASSERT_EQUAL(riak_connection_get_n_pending(cxn), 0)
+    CU_ASSERT_EQUAL(riak_pipeline_receive(cxn), ERIAK_UNINITIALIZED)
+
+    close(server);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_pipeline_in_order passed")
+}
+
+void
+test_pipeline_peer_closed() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    test_pipeline_state   state = { cfg, 0, 0, { 0 } };
+    test_pipeline_request requests[TEST_PIPELINE_DEPTH];
+    int i;
+    for(i = 0; i < TEST_PIPELINE_DEPTH; i++) {
+        requests[i].state = &state;
+        requests[i].id    = i;
+    }
+    int server = test_pipeline_send_pings(cxn, listener, requests);
+    // Answer only the first request, then hang up
+    CU_ASSERT_FATAL(write(server, test_pipeline_pong, sizeof(test_pipeline_pong)) == sizeof(test_pipeline_pong))
+    close(server);
+
+    err = riak_pipeline_receive(cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_connection_get_n_pending(cxn), TEST_PIPELINE_DEPTH-1)
+    err = riak_pipeline_receive(cxn);
+    CU_ASSERT_EQUAL(err, ERIAK_READ)
+    CU_ASSERT_EQUAL(state.n_answered, 1)
+    // Every request dropped with the connection hears about it
+    CU_ASSERT_EQUAL(state.n_failed, TEST_PIPELINE_DEPTH-1)
+    CU_ASSERT_EQUAL(riak_connection_get_n_pending(cxn), 0)
+
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_pipeline_peer_closed passed")
+}
+
+typedef struct _test_writev_capture {
+    riak_uint32_t n_calls;
+    riak_size_t   len;
+    riak_uint8_t  data[64];
+} test_writev_capture;
+
+static riak_ssize_t
+test_writev_capture_cb(void         *ptr,
+                       struct iovec *iov,
+                       int           iovcnt) {
+    test_writev_capture *capture = (test_writev_capture*)ptr;
+    riak_ssize_t total = 0;
+    int i;
+    capture->n_calls++;
+    for(i = 0; i < iovcnt; i++) {
+        memcpy(capture->data + capture->len, iov[i].iov_base, iov[i].iov_len);
+        capture->len += iov[i].iov_len;
+        total        += iov[i].iov_len;
+    }
+    return total;
+}
+
+void
+test_writev_single_call() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    CU_ASSERT_FATAL(err == ERIAK_CONNECT)
+    riak_operation *rop = NULL;
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+    err = riak_async_register_get(rop, bucket, key, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    test_writev_capture capture;
+    memset(&capture, '\0', sizeof(capture));
+    err = riak_writev(rop, test_writev_capture_cb, &capture);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(capture.n_calls, 1)
+    // RpbGetReq { bucket: "b", key: "k" }
+    riak_uint8_t expected[] = { 0, 0, 0, 7, 9, 0x0a, 1, 'b', 0x12, 1, 'k' };
+    CU_ASSERT_EQUAL(capture.len, sizeof(expected))
+    CU_ASSERT_EQUAL(memcmp(capture.data, expected, sizeof(expected)), 0)
+
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_writev_single_call passed")
+}
+
+void
+test_read_buffered_frames() {
+    char portnum[16];
+    int listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    int server = accept(listener, NULL, NULL);
+    CU_ASSERT_FATAL(server >= 0)
+
+    // Two responses in one segment; the second is served from the buffer
+    riak_uint8_t pongs[sizeof(test_pipeline_pong)*2];
+    memcpy(pongs, test_pipeline_pong, sizeof(test_pipeline_pong));
+    memcpy(pongs + sizeof(test_pipeline_pong), test_pipeline_pong, sizeof(test_pipeline_pong));
+    CU_ASSERT_FATAL(write(server, pongs, sizeof(pongs)) == sizeof(pongs))
+    CU_ASSERT_EQUAL(riak_ping(cxn), ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_ping(cxn), ERIAK_OK)
+
+    // A frame larger than the initial buffer makes it grow
+    riak_size_t   biglen = TEST_PIPELINE_BIG_FRAME;
+    riak_uint8_t *big    = (riak_uint8_t*)calloc(1, biglen + 4);
+    CU_ASSERT_FATAL(big != NULL)
+    riak_uint32_t netlen = htonl(biglen);
+    memcpy(big, &netlen, sizeof(netlen));
+    big[4] = 2;
+    CU_ASSERT_FATAL(write(server, big, biglen + 4) == biglen + 4)
+    CU_ASSERT_EQUAL(riak_ping(cxn), ERIAK_OK)
+    free(big);
+
+    // Half a frame, then the server hangs up (after reading the three
+    // pings, so the close is an orderly FIN rather than a reset)
+    riak_uint8_t requests[sizeof(test_pipeline_pong)*3];
+    riak_size_t  total = 0;
+    while (total < sizeof(requests)) {
+        riak_ssize_t got = read(server, requests + total, sizeof(requests) - total);
+        CU_ASSERT_FATAL(got > 0)
+        total += got;
+    }
+    CU_ASSERT_FATAL(write(server, test_pipeline_pong, 2) == 2)
+    close(server);
+    CU_ASSERT_EQUAL(riak_ping(cxn), ERIAK_READ)
+
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    close(listener);
+    CU_PASS("test_read_buffered_frames passed")
+}
@@ -0,0 +1,206 @@
+/*********************************************************************
+ *
+ * test_runtime.c: Riak C Unit testing for the per-core runtime
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_runtime.h"
+#include "test_connection_pool.h"
+#include "test_runtime.h"
+
+#ifdef __linux__
+
+#define TEST_RUNTIME_N_LOOPS      2
+#define TEST_RUNTIME_N_CHANNELS   2
+#define TEST_RUNTIME_N_SUBMITTERS 4
+#define TEST_RUNTIME_N_OPS        250
+
+typedef struct _test_runtime_state {
+    riak_config              *cfg;
+    riak_runtime             *rt;
+    riak_runtime_completions *completions;
+    pthread_t                 drainer;
+    riak_uint32_t             n_responses;
+    riak_uint32_t             n_errors;
+    riak_uint32_t             n_wrong_thread;
+    riak_uint32_t             n_submit_failures;
+} test_runtime_state;
+
+static void
+test_runtime_get_cb(riak_error         err,
+                    riak_get_response *response,
+                    void              *ptr) {
+    test_runtime_state *state = (test_runtime_state*)ptr;
+    if (!pthread_equal(pthread_self(), state->drainer)) {
+        state->n_wrong_thread++;
+    }
+    if (err == ERIAK_OK) {
+        state->n_responses++;
+        riak_get_response_free(state->cfg, &response);
+    } else {
+        state->n_errors++;
+    }
+}
+
+static void*
+test_runtime_submitter(void *ptr) {
+    test_runtime_state *state = (test_runtime_state*)ptr;
+    riak_binary *bucket = riak_binary_copy_from_string(state->cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(state->cfg, "k");
+    int i;
+    for(i = 0; i < TEST_RUNTIME_N_OPS; i++) {
+        riak_error err = riak_runtime_get(state->rt, bucket, key, NULL, state->completions, test_runtime_get_cb, state);
+        if (err) {
+            __atomic_fetch_add(&(state->n_submit_failures), 1, __ATOMIC_RELAXED);
+        }
+    }
+    riak_binary_free(state->cfg, &bucket);
+    riak_binary_free(state->cfg, &key);
+    return NULL;
+}
+
+static riak_error
+test_runtime_start(test_runtime_state    *state,
+                   test_reply_server     *server,
+                   pthread_t             *server_thread,
+                   riak_runtime_sharding  sharding) {
+    char portnum[16];
+    memset(state, '\0', sizeof(test_runtime_state));
+    server->listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    if (server->listener < 0) return ERIAK_CONNECT;
+    riak_error err = riak_config_new_default(&(state->cfg));
+    if (err) return err;
+    if (pthread_create(server_thread, NULL, test_serve_replies, server) != 0) return ERIAK_EVENT;
+    riak_runtime_options opts;
+    riak_runtime_options_init(&opts);
+    opts.n_loops    = TEST_RUNTIME_N_LOOPS;
+    opts.n_channels = TEST_RUNTIME_N_CHANNELS;
+    opts.sharding   = sharding;
+    err = riak_runtime_new(state->cfg, &(state->rt), "127.0.0.1", portnum, NULL, &opts);
+    if (err) return err;
+    state->drainer = pthread_self();
+    return riak_runtime_completions_new(state->cfg, &(state->completions));
+}
+
+static void
+test_runtime_stop(test_runtime_state *state,
+                  test_reply_server  *server,
+                  pthread_t           server_thread) {
+    riak_runtime_free(&(state->rt));
+    CU_ASSERT_PTR_NULL(state->rt)
+    riak_runtime_completions_free(&(state->completions));
+    pthread_join(server_thread, NULL);
+    close(server->listener);
+    riak_config_free(&(state->cfg));
+}
+
+void
+test_runtime_many_threads() {
+    test_runtime_state state;
+    test_reply_server server = { -1, TEST_RUNTIME_N_LOOPS * TEST_RUNTIME_N_CHANNELS, RIAK_FALSE, 10, 0 };
+    pthread_t server_thread;
+    riak_error err = test_runtime_start(&state, &server, &server_thread, RIAK_RUNTIME_ROUND_ROBIN);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_runtime_get_n_loops(state.rt), TEST_RUNTIME_N_LOOPS)
+
+    pthread_t submitters[TEST_RUNTIME_N_SUBMITTERS];
+    int i;
+    for(i = 0; i < TEST_RUNTIME_N_SUBMITTERS; i++) {
+        CU_ASSERT_FATAL(pthread_create(&submitters[i], NULL, test_runtime_submitter, &state) == 0)
+    }
+
+    // Every callback runs here, on the draining thread
+    riak_uint32_t expected = TEST_RUNTIME_N_SUBMITTERS * TEST_RUNTIME_N_OPS;
+    riak_uint32_t n_done   = 0;
+    while (n_done < expected) {
+        riak_uint32_t n = riak_runtime_completions_drain(state.completions, 5000);
+        if (n == 0) break;
+        n_done += n;
+    }
+    for(i = 0; i < TEST_RUNTIME_N_SUBMITTERS; i++) {
+        pthread_join(submitters[i], NULL);
+    }
+    CU_ASSERT_EQUAL(state.n_submit_failures, 0)
+    CU_ASSERT_EQUAL(n_done, expected)
+    CU_ASSERT_EQUAL(state.n_errors, expected / 10)
+    CU_ASSERT_EQUAL(state.n_responses, expected - expected / 10)
+    CU_ASSERT_EQUAL(state.n_wrong_thread, 0)
+
+    test_runtime_stop(&state, &server, server_thread);
+    CU_ASSERT_EQUAL(server.n_requests, expected)
+    CU_PASS("test_runtime_many_threads passed")
+}
+
+static void
+test_runtime_note_loop(riak_epoll *ep,
+                       void       *ptr) {
+    riak_epoll **seen = (riak_epoll**)ptr;
+    *seen = ep;
+}
+
+void
+test_runtime_key_hash() {
+    test_runtime_state state;
+    test_reply_server server = { -1, TEST_RUNTIME_N_LOOPS * TEST_RUNTIME_N_CHANNELS, RIAK_FALSE, 0, 0 };
+    pthread_t server_thread;
+    riak_error err = test_runtime_start(&state, &server, &server_thread, RIAK_RUNTIME_KEY_HASH);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+
+    // The same key always lands on the same loop
+    riak_binary *key   = riak_binary_copy_from_string(state.cfg, "k");
+    riak_epoll  *first = NULL;
+    riak_epoll  *again = NULL;
+    err = riak_runtime_submit(state.rt, key, test_runtime_note_loop, &first);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    err = riak_runtime_submit(state.rt, key, test_runtime_note_loop, &again);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+
+    riak_binary *bucket = riak_binary_copy_from_string(state.cfg, "b");
+    int i;
+    for(i = 0; i < TEST_RUNTIME_N_OPS; i++) {
+        err = riak_runtime_get(state.rt, bucket, key, NULL, state.completions, test_runtime_get_cb, &state);
+        CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    }
+    riak_uint32_t n_done = 0;
+    while (n_done < TEST_RUNTIME_N_OPS) {
+        riak_uint32_t n = riak_runtime_completions_drain(state.completions, 5000);
+        if (n == 0) break;
+        n_done += n;
+    }
+    CU_ASSERT_EQUAL(state.n_responses, TEST_RUNTIME_N_OPS)
+    CU_ASSERT_PTR_NOT_NULL(first)
+    CU_ASSERT_EQUAL(first, again)
+
+    riak_binary_free(state.cfg, &bucket);
+    riak_binary_free(state.cfg, &key);
+    test_runtime_stop(&state, &server, server_thread);
+    CU_PASS("test_runtime_key_hash passed")
+}
+
+#endif // __linux__
@@ -0,0 +1,190 @@
+/*********************************************************************
+ *
+ * test_uring.c: Riak C Unit testing for the io_uring transport
+ *
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_uring.h"
+#include "riak_utils-internal.h"
+#include "test_connection_pool.h"
+#include "test_uring.h"
+
+#ifdef RIAK_USE_IO_URING
+
+#define TEST_URING_N_OPS     500
+#define TEST_URING_N_SERVER  2
+
+typedef struct _test_uring_seen {
+    riak_config  *cfg;
+    riak_uint32_t n_responses;
+    riak_uint32_t n_errors;
+    riak_uint32_t n_timeouts;
+} test_uring_seen;
+
+static test_uring_seen test_uring_state;
+
+static void
+test_uring_get_cb(riak_get_response *response,
+                  void              *ptr) {
+    test_uring_state.n_responses++;
+    riak_get_response_free(test_uring_state.cfg, &response);
+}
+
+static void
+test_uring_error_cb(void *response,
+                    void *ptr) {
+    riak_operation *rop = (riak_operation*)ptr;
+    riak_server_error *error = riak_operation_get_server_error(rop);
+    test_uring_state.n_errors++;
+    if (error && riak_server_error_get_errcode(error) == ERIAK_TIMEOUT) {
+        test_uring_state.n_timeouts++;
+    }
+    riak_free_error_response(test_uring_state.cfg, (riak_error_response**)&response);
+}
+
+static riak_error
+test_uring_send_get(riak_uring  *ur,
+                    riak_binary *bucket,
+                    riak_binary *key) {
+    riak_operation *rop = NULL;
+    riak_error err = riak_uring_operation_new(ur, &rop, NULL, test_uring_error_cb, NULL);
+    if (err) return err;
+    riak_operation_set_cb_data(rop, rop);
+    err = riak_async_register_get(rop, bucket, key, NULL, (riak_response_callback)test_uring_get_cb);
+    if (err) {
+        riak_operation_free(&rop);
+        return err;
+    }
+    return riak_uring_send(ur, rop);
+}
+
+void
+test_uring_many_ops() {
+    char portnum[16];
+    test_reply_server server = { -1, TEST_URING_N_SERVER, RIAK_FALSE, 10, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, TEST_URING_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_serve_replies, &server) == 0)
+
+    riak_uring *ur = NULL;
+    err = riak_uring_new(cfg, &ur, pool, TEST_URING_N_SERVER);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    memset(&test_uring_state, '\0', sizeof(test_uring_state));
+    test_uring_state.cfg = cfg;
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+    int i;
+    for(i = 0; i < TEST_URING_N_OPS; i++) {
+        err = test_uring_send_get(ur, bucket, key);
+        CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    }
+    CU_ASSERT_EQUAL(riak_uring_get_n_pending(ur), TEST_URING_N_OPS)
+
+    // Every request goes out in the first run's single submission
+    err = riak_uring_run(ur);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+
+    // Server errors reach error_cb without disturbing their neighbours
+    CU_ASSERT_EQUAL(test_uring_state.n_errors, TEST_URING_N_OPS / 10)
+    CU_ASSERT_EQUAL(test_uring_state.n_responses, TEST_URING_N_OPS - TEST_URING_N_OPS / 10)
+    CU_ASSERT_EQUAL(test_uring_state.n_timeouts, 0)
+    CU_ASSERT_EQUAL(riak_uring_get_n_pending(ur), 0)
+
+    // Connections stay open and return to the pool
+    riak_uring_free(&ur);
+    CU_ASSERT_PTR_NULL(ur)
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_idle(pool), TEST_URING_N_SERVER)
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL(server.n_requests, TEST_URING_N_OPS)
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_uring_many_ops passed")
+}
+
+void
+test_uring_timeout() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_TRUE, 0, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection_pool *pool = NULL;
+    err = riak_connection_pool_new(cfg, &pool, "127.0.0.1", portnum, NULL, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_serve_replies, &server) == 0)
+
+    riak_uring *ur = NULL;
+    err = riak_uring_new(cfg, &ur, pool, 1);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_uring_set_timeout(ur, 50);
+    memset(&test_uring_state, '\0', sizeof(test_uring_state));
+    test_uring_state.cfg = cfg;
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+    int i;
+    for(i = 0; i < 3; i++) {
+        err = test_uring_send_get(ur, bucket, key);
+        CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    }
+    riak_uint64_t start = riak_get_time_ms();
+    err = riak_uring_run(ur);
+    CU_ASSERT_EQUAL(err, ERIAK_OK)
+    CU_ASSERT(riak_get_time_ms() - start >= 40)
+
+    // Every operation hears about the timeout exactly once
+    CU_ASSERT_EQUAL(test_uring_state.n_responses, 0)
+    CU_ASSERT_EQUAL(test_uring_state.n_errors, 3)
+    CU_ASSERT_EQUAL(test_uring_state.n_timeouts, 3)
+
+    // Timed-out connections are evicted rather than reused
+    riak_uring_free(&ur);
+    CU_ASSERT_EQUAL(riak_connection_pool_get_n_open(pool), 0)
+    riak_connection_pool_free(&pool);
+    pthread_join(thread, NULL);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    close(server.listener);
+    CU_PASS("test_uring_timeout passed")
+}
+
+#endif // RIAK_USE_IO_URING
@@ -0,0 +1,279 @@
+/*********************************************************************
+ *
+ * test_view.c: Riak C Unit testing for lazily decoded fetches
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_view-internal.h"
+#include "test_connection_pool.h"
+#include "test_view.h"
+
+#define TEST_VIEW_PB(F, S) { (F).data = (uint8_t*)(S); (F).len = strlen(S); }
+
+static riak_boolean_t
+test_view_same(riak_binary *a,
+               riak_binary *b) {
+    if (a == NULL || b == NULL) return (a == b);
+    return (riak_binary_len(a) == riak_binary_len(b) &&
+            (riak_binary_len(a) == 0 || memcmp(riak_binary_data(a), riak_binary_data(b), riak_binary_len(a)) == 0));
+}
+
+static riak_boolean_t
+test_view_same_pairs(riak_pair  **a,
+                     riak_pair  **b,
+                     riak_int32_t n) {
+    riak_int32_t i;
+    for(i = 0; i < n; i++) {
+        if (!test_view_same(riak_pair_get_key(a[i]), riak_pair_get_key(b[i])) ||
+            riak_pair_get_has_value(a[i]) != riak_pair_get_has_value(b[i]) ||
+            !test_view_same(riak_pair_get_value(a[i]), riak_pair_get_value(b[i]))) {
+            return RIAK_FALSE;
+        }
+    }
+    return RIAK_TRUE;
+}
+
+// Message code followed by an RpbGetResp with two siblings
+static riak_uint8_t*
+test_view_encode(riak_size_t *len) {
+    RpbLink   link = RPB_LINK__INIT;
+    RpbLink  *links[1] = { &link };
+    RpbPair   meta[2] = { RPB_PAIR__INIT, RPB_PAIR__INIT };
+    RpbPair  *metas[2] = { &meta[0], &meta[1] };
+    RpbPair   index = RPB_PAIR__INIT;
+    RpbPair  *indexes[1] = { &index };
+    link.has_bucket = 1; TEST_VIEW_PB(link.bucket, "people")
+    link.has_key    = 1; TEST_VIEW_PB(link.key, "alice")
+    link.has_tag    = 1; TEST_VIEW_PB(link.tag, "friend")
+    TEST_VIEW_PB(meta[0].key, "color")
+    meta[0].has_value = 1; TEST_VIEW_PB(meta[0].value, "blue")
+    TEST_VIEW_PB(meta[1].key, "flag")
+    TEST_VIEW_PB(index.key, "age_int")
+    index.has_value = 1; TEST_VIEW_PB(index.value, "42")
+
+    RpbContent first = RPB_CONTENT__INIT;
+    TEST_VIEW_PB(first.value, "{\"bar\":\"baz\"}")
+    first.has_content_type = 1; TEST_VIEW_PB(first.content_type, "application/json")
+    first.has_charset      = 1; TEST_VIEW_PB(first.charset, "utf-8")
+    first.has_vtag         = 1; TEST_VIEW_PB(first.vtag, "1pfIv8QRtl16edLBQkhTzc")
+    first.has_last_mod       = 1; first.last_mod       = 1386540290;
+    first.has_last_mod_usecs = 1; first.last_mod_usecs = 817644;
+    first.n_links    = 1; first.links    = links;
+    first.n_usermeta = 2; first.usermeta = metas;
+    first.n_indexes  = 1; first.indexes  = indexes;
+    RpbContent second = RPB_CONTENT__INIT;
+    TEST_VIEW_PB(second.value, "")
+    second.has_content_encoding = 1; TEST_VIEW_PB(second.content_encoding, "gzip")
+    second.has_deleted = 1; second.deleted = 1;
+    RpbContent *contents[2] = { &first, &second };
+
+    RpbGetResp msg = RPB_GET_RESP__INIT;
+    msg.n_content  = 2;
+    msg.content    = contents;
+    msg.has_vclock = 1; TEST_VIEW_PB(msg.vclock, "a85hYGBgzGDKBVIcR8M2cgel")
+    riak_size_t packed = rpb_get_resp__get_packed_size(&msg);
+    riak_uint8_t *bytes = (riak_uint8_t*)malloc(packed + 1);
+    bytes[0] = MSG_RPBGETRESP;
+    rpb_get_resp__pack(&msg, bytes + 1);
+    *len = packed + 1;
+    return bytes;
+}
+
+void
+test_view_matches_eager_decode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "test");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "riakc");
+    riak_operation_set_bucket(rop, bucket);
+    riak_operation_set_key(rop, key);
+
+    riak_size_t     len;
+    riak_pb_message pb_response;
+    pb_response.data = test_view_encode(&len);
+    pb_response.len  = len;
+    riak_get_response *response = NULL;
+    riak_get_view     *view     = NULL;
+    riak_boolean_t     done     = RIAK_FALSE;
+    err = riak_get_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    done = RIAK_FALSE;
+    err = riak_get_view_decode(rop, &pb_response, &view, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+    // The view owns its copy of the bytes
+    memset(pb_response.data, 0xff, pb_response.len);
+    free(pb_response.data);
+
+    CU_ASSERT_EQUAL(riak_get_view_get_has_vclock(view), riak_get_get_has_vclock(response))
+    CU_ASSERT(test_view_same(riak_get_view_get_vclock(view), riak_get_get_vclock(response)))
+    CU_ASSERT_EQUAL(riak_get_view_get_has_unmodified(view), RIAK_FALSE)
+    CU_ASSERT_EQUAL_FATAL(riak_get_view_get_n_content(view), riak_get_get_n_content(response))
+    CU_ASSERT_PTR_NULL(riak_get_view_get_content(view, 2))
+
+    // Nothing below the outer message is decoded until asked for
+    riak_object_view *lazy = riak_get_view_get_content(view, 0);
+    CU_ASSERT_EQUAL(lazy->scanned, RIAK_FALSE)
+    CU_ASSERT(test_view_same(riak_object_view_get_value(lazy), riak_object_get_value(riak_get_get_content(response)[0])))
+    CU_ASSERT_EQUAL(lazy->scanned, RIAK_TRUE)
+    CU_ASSERT_PTR_NULL(lazy->links)
+
+    riak_int32_t i;
+    for(i = 0; i < riak_get_view_get_n_content(view); i++) {
+        riak_object_view *ov  = riak_get_view_get_content(view, i);
+        riak_object      *obj = riak_get_get_content(response)[i];
+        CU_ASSERT(test_view_same(riak_object_view_get_bucket(ov), riak_object_get_bucket(obj)))
+        CU_ASSERT(test_view_same(riak_object_view_get_key(ov), riak_object_get_key(obj)))
+        CU_ASSERT(test_view_same(riak_object_view_get_value(ov), riak_object_get_value(obj)))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_charset(ov), riak_object_get_has_charset(obj))
+        CU_ASSERT(test_view_same(riak_object_view_get_charset(ov), riak_object_get_charset(obj)))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_content_type(ov), riak_object_get_has_content_type(obj))
+        CU_ASSERT(test_view_same(riak_object_view_get_content_type(ov), riak_object_get_content_type(obj)))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_content_encoding(ov), riak_object_get_has_content_encoding(obj))
+        CU_ASSERT(test_view_same(riak_object_view_get_encoding(ov), riak_object_get_encoding(obj)))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_vtag(ov), riak_object_get_has_vtag(obj))
+        CU_ASSERT(test_view_same(riak_object_view_get_vtag(ov), riak_object_get_vtag(obj)))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_last_mod(ov), riak_object_get_has_last_mod(obj))
+        CU_ASSERT_EQUAL(riak_object_view_get_last_mod(ov), riak_object_get_last_mod(obj))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_last_mod_usecs(ov), riak_object_get_has_last_mod_usecs(obj))
+        CU_ASSERT_EQUAL(riak_object_view_get_last_mod_usecs(ov), riak_object_get_last_mod_usecs(obj))
+        CU_ASSERT_EQUAL(riak_object_view_get_has_deleted(ov), riak_object_get_has_deleted(obj))
+        CU_ASSERT_EQUAL(riak_object_view_get_deleted(ov), riak_object_get_deleted(obj))
+
+        CU_ASSERT_EQUAL_FATAL(riak_object_view_get_n_links(ov), riak_object_get_n_links(obj))
+        riak_int32_t j;
+        for(j = 0; j < riak_object_view_get_n_links(ov); j++) {
+            riak_link *a = riak_object_view_get_links(ov)[j];
+            riak_link *b = riak_object_get_links(obj)[j];
+            CU_ASSERT(test_view_same(riak_link_get_bucket(a), riak_link_get_bucket(b)))
+            CU_ASSERT(test_view_same(riak_link_get_key(a), riak_link_get_key(b)))
+            CU_ASSERT(test_view_same(riak_link_get_tag(a), riak_link_get_tag(b)))
+        }
+        CU_ASSERT_EQUAL_FATAL(riak_object_view_get_n_usermeta(ov), riak_object_get_n_usermeta(obj))
+        CU_ASSERT(test_view_same_pairs(riak_object_view_get_usermeta(ov), riak_object_get_usermeta(obj), riak_object_get_n_usermeta(obj)))
+        CU_ASSERT_EQUAL_FATAL(riak_object_view_get_n_indexes(ov), riak_object_get_n_indexes(obj))
+        CU_ASSERT(test_view_same_pairs(riak_object_view_get_indexes(ov), riak_object_get_indexes(obj), riak_object_get_n_indexes(obj)))
+    }
+    CU_ASSERT_EQUAL(riak_object_view_get_n_links(lazy), 1)
+    CU_ASSERT_EQUAL(riak_object_view_get_n_usermeta(lazy), 2)
+
+    riak_get_view_free(cfg, &view);
+    CU_ASSERT_PTR_NULL(view)
+    riak_get_response_free(cfg, &response);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    CU_PASS("test_view_matches_eager_decode passed")
+}
+
+void
+test_view_malformed() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_get_view *view = NULL;
+
+    // Outer content field claims more bytes than remain
+    riak_uint8_t truncated[] = { 0x0a, 0x10, 0x0a, 0x01, 0x61 };
+    err = riak_get_view_new(cfg, &view, NULL, NULL, truncated, sizeof(truncated));
+    CU_ASSERT_EQUAL(err, ERIAK_MESSAGE_FORMAT)
+    CU_ASSERT_PTR_NULL(view)
+
+    // Outer framing is sound, but the content inside is not
+    riak_uint8_t inner[] = { 0x0a, 0x03, 0x0a, 0x05, 0x61, 0x18, 0x01 };
+    err = riak_get_view_new(cfg, &view, NULL, NULL, inner, sizeof(inner));
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_get_view_get_n_content(view), 1)
+    CU_ASSERT_EQUAL(riak_get_view_get_unmodified(view), RIAK_TRUE)
+    riak_object_view *ov = riak_get_view_get_content(view, 0);
+    CU_ASSERT_EQUAL(riak_binary_len(riak_object_view_get_value(ov)), 0)
+    CU_ASSERT_PTR_NULL(riak_object_view_get_bucket(ov))
+    CU_ASSERT_EQUAL(riak_object_view_get_has_key(ov), RIAK_FALSE)
+    CU_ASSERT_EQUAL(riak_object_view_get_n_links(ov), 0)
+    CU_ASSERT_PTR_NULL(riak_object_view_get_links(ov))
+    riak_get_view_free(cfg, &view);
+
+    // Not found is an empty message
+    err = riak_get_view_new(cfg, &view, NULL, NULL, NULL, 0);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(riak_get_view_get_n_content(view), 0)
+    CU_ASSERT_EQUAL(riak_get_view_get_has_vclock(view), RIAK_FALSE)
+    CU_ASSERT_PTR_NULL(riak_get_view_get_vclock(view))
+    riak_get_view_free(cfg, &view);
+    riak_config_free(&cfg);
+    CU_PASS("test_view_malformed passed")
+}
+
+void
+test_view_fetch() {
+    char portnum[16];
+    test_reply_server server = { -1, 1, RIAK_FALSE, 2, 0 };
+    server.listener = test_listen_on_loopback(portnum, sizeof(portnum));
+    CU_ASSERT_FATAL(server.listener >= 0)
+    pthread_t thread;
+    CU_ASSERT_FATAL(pthread_create(&thread, NULL, test_serve_replies, &server) == 0)
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    err = riak_connection_new(cfg, &cxn, "127.0.0.1", portnum, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "b");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "k");
+
+    riak_get_view *view = NULL;
+    err = riak_get_lazy(cxn, bucket, key, NULL, &view);
+    CU_ASSERT_EQUAL_FATAL(err, ERIAK_OK)
+    CU_ASSERT_PTR_NOT_NULL_FATAL(view)
+    CU_ASSERT_EQUAL(riak_get_view_get_n_content(view), 0)
+    riak_get_view_free(cfg, &view);
+
+    // Every second reply is an error response
+    err = riak_get_lazy(cxn, bucket, key, NULL, &view);
+    CU_ASSERT_EQUAL(err, ERIAK_SERVER_ERROR)
+    CU_ASSERT_PTR_NULL(view)
+
+    riak_connection_free(&cxn);
+    pthread_join(thread, NULL);
+    close(server.listener);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_config_free(&cfg);
+    CU_PASS("test_view_fetch passed")
+}
@@ -0,0 +1,316 @@
+/*********************************************************************
+ *
+ * test_wire.c: Riak C Unit testing for the hand-written Get/Put codec
+ *
+ * Copyright (c) 2007-2014 Basho Technologies, Inc.  All Rights Reserved.
+ *
+ * This file is provided to you under the Apache License,
+ * Version 2.0 (the "License"); you may not use this file
+ * except in compliance with the License.  You may obtain
+ * a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ *
+ *********************************************************************/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <CUnit/CUnit.h>
+#include <CUnit/Automated.h>
+#include <CUnit/Basic.h>
+#include "riak.h"
+#include "riak_messages-internal.h"
+#include "riak_binary-internal.h"
+#include "riak_object-internal.h"
+#include "riak_operation-internal.h"
+#include "riak_wire-internal.h"
+#include "test_wire.h"
+
+#define TEST_WIRE_PB(F, B) { (F).data = riak_binary_data(B); (F).len = riak_binary_len(B); }
+
+static riak_boolean_t
+test_wire_same(riak_binary *a,
+               riak_binary *b) {
+    if (a == NULL || b == NULL) return (a == b);
+    return (riak_binary_len(a) == riak_binary_len(b) &&
+            (riak_binary_len(a) == 0 || memcmp(riak_binary_data(a), riak_binary_data(b), riak_binary_len(a)) == 0));
+}
+
+void
+test_wire_varint() {
+    riak_uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xffffffffULL, 0xffffffffffffffffULL };
+    riak_uint8_t  buffer[16];
+    riak_uint32_t i;
+    for(i = 0; i < sizeof(values)/sizeof(values[0]); i++) {
+        riak_uint8_t *end = riak_wire_put_varint(buffer, values[i]);
+        CU_ASSERT_EQUAL((riak_size_t)(end - buffer), riak_wire_varint_size(values[i]))
+        riak_wire_reader reader;
+        riak_uint64_t    value = 0;
+        riak_wire_reader_init(&reader, buffer, end - buffer);
+        CU_ASSERT_EQUAL(riak_wire_read_varint(&reader, &value), RIAK_TRUE)
+        CU_ASSERT_EQUAL(value, values[i])
+        CU_ASSERT_EQUAL(reader.pos, end)
+
+        // Any truncation is caught
+        riak_wire_reader_init(&reader, buffer, (end - buffer) - 1);
+        CU_ASSERT_EQUAL(riak_wire_read_varint(&reader, &value), RIAK_FALSE)
+        CU_ASSERT_EQUAL(reader.failed, RIAK_TRUE)
+    }
+    CU_PASS("test_wire_varint passed")
+}
+
+void
+test_wire_get_request_matches_protobuf() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_binary *bucket = riak_binary_copy_from_string(cfg, "bucket");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "a key");
+    riak_binary *vclock = riak_binary_copy_from_string(cfg, "a85hYGBgzGDKBVIcR8M2cgel");
+    riak_get_options *opts = riak_get_options_new(cfg);
+    riak_get_options_set_r(opts, 2);
+    riak_get_options_set_pr(opts, 300);
+    riak_get_options_set_basic_quorum(opts, RIAK_TRUE);
+    riak_get_options_set_notfound_ok(opts, RIAK_FALSE);
+    riak_get_options_set_if_modified(cfg, opts, vclock);
+    riak_get_options_set_head(opts, RIAK_TRUE);
+    riak_get_options_set_deletedvclock(opts, RIAK_TRUE);
+    riak_get_options_set_timeout(opts, 70000);
+    riak_get_options_set_sloppy_quorum(opts, RIAK_FALSE);
+    riak_get_options_set_n_val(opts, 3);
+
+    RpbGetReq msg = RPB_GET_REQ__INIT;
+    TEST_WIRE_PB(msg.bucket, bucket)
+    TEST_WIRE_PB(msg.key, key)
+    msg.has_r = 1;             msg.r = 2;
+    msg.has_pr = 1;            msg.pr = 300;
+    msg.has_basic_quorum = 1;  msg.basic_quorum = 1;
+    msg.has_notfound_ok = 1;   msg.notfound_ok = 0;
+    msg.has_if_modified = 1;   TEST_WIRE_PB(msg.if_modified, vclock)
+    msg.has_head = 1;          msg.head = 1;
+    msg.has_deletedvclock = 1; msg.deletedvclock = 1;
+    msg.has_timeout = 1;       msg.timeout = 70000;
+    msg.has_sloppy_quorum = 1; msg.sloppy_quorum = 0;
+    msg.has_n_val = 1;         msg.n_val = 3;
+    riak_size_t   expected_len = rpb_get_req__get_packed_size(&msg);
+    riak_uint8_t *expected     = (riak_uint8_t*)malloc(expected_len);
+    rpb_get_req__pack(&msg, expected);
+
+    // With every option, and with none
+    int pass;
+    for(pass = 0; pass < 2; pass++) {
+        riak_operation *rop = NULL;
+        err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        err = riak_async_register_get(rop, bucket, key, pass ? NULL : opts, NULL);
+        CU_ASSERT_FATAL(err == ERIAK_OK)
+        if (pass == 1) {
+            RpbGetReq bare = RPB_GET_REQ__INIT;
+            TEST_WIRE_PB(bare.bucket, bucket)
+            TEST_WIRE_PB(bare.key, key)
+            expected_len = rpb_get_req__get_packed_size(&bare);
+            rpb_get_req__pack(&bare, expected);
+        }
+        CU_ASSERT_EQUAL(rop->pb_request->msgid, MSG_RPBGETREQ)
+        CU_ASSERT_EQUAL_FATAL(rop->pb_request->len, expected_len)
+        CU_ASSERT_EQUAL(memcmp(rop->pb_request->data, expected, expected_len), 0)
+        riak_operation_free(&rop);
+    }
+
+    free(expected);
+    riak_get_options_free(cfg, &opts);
+    riak_binary_free(cfg, &bucket);
+    riak_binary_free(cfg, &key);
+    riak_binary_free(cfg, &vclock);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_wire_get_request_matches_protobuf passed")
+}
+
+void
+test_wire_put_request_matches_protobuf() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    riak_object *obj = riak_object_new(cfg);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(obj)
+    riak_object_set_bucket(obj, riak_binary_copy_from_string(cfg, "bucket"));
+    riak_object_set_key(obj, riak_binary_copy_from_string(cfg, "a key"));
+    riak_object_set_value(obj, riak_binary_copy_from_string(cfg, "{\"bar\":\"baz\"}"));
+    riak_object_set_content_type(obj, riak_binary_copy_from_string(cfg, "application/json"));
+    riak_object_set_charset(obj, riak_binary_copy_from_string(cfg, "utf-8"));
+    riak_object_set_last_mod(obj, 1386540290);
+    riak_object_set_deleted(obj, RIAK_FALSE);
+    // Links and indexes own only their structs, as when decoded
+    riak_link **links = NULL;
+    riak_link_new_array(cfg, &links, 1);
+    links[0] = riak_link_new(cfg);
+    links[0]->has_bucket = RIAK_TRUE;
+    links[0]->bucket     = riak_binary_new_shallow(cfg, 6, (riak_uint8_t*)"people");
+    links[0]->has_tag    = RIAK_TRUE;
+    links[0]->tag        = riak_binary_new_shallow(cfg, 6, (riak_uint8_t*)"friend");
+    obj->n_links = 1;
+    obj->links   = links;
+    riak_pair **pairs = NULL;
+    riak_pair_new_array(cfg, &pairs, 2);
+    pairs[0] = riak_pair_new(cfg);
+    pairs[0]->key       = riak_binary_new_shallow(cfg, 7, (riak_uint8_t*)"age_int");
+    pairs[0]->has_value = RIAK_TRUE;
+    pairs[0]->value     = riak_binary_new_shallow(cfg, 2, (riak_uint8_t*)"42");
+    pairs[1] = riak_pair_new(cfg);
+    pairs[1]->key       = riak_binary_new_shallow(cfg, 8, (riak_uint8_t*)"flag_bin");
+    riak_object_set_n_indexes(obj, 2);
+    riak_object_set_indexes(obj, pairs);
+    riak_binary *vclock = riak_binary_copy_from_string(cfg, "a85hYGBgzGDKBVIcR8M2cgel");
+    riak_put_options *opts = riak_put_options_new(cfg);
+    riak_put_options_set_vclock(cfg, opts, vclock);
+    riak_put_options_set_w(opts, 2);
+    riak_put_options_set_dw(opts, 1);
+    riak_put_options_set_return_body(opts, RIAK_TRUE);
+    riak_put_options_set_if_none_match(opts, RIAK_TRUE);
+    riak_put_options_set_timeout(opts, 200);
+    riak_put_options_set_n_val(opts, 3);
+
+    RpbLink  link = RPB_LINK__INIT;
+    RpbLink *pblinks[1] = { &link };
+    link.has_bucket = 1; TEST_WIRE_PB(link.bucket, links[0]->bucket)
+    link.has_tag    = 1; TEST_WIRE_PB(link.tag, links[0]->tag)
+    RpbPair  index[2] = { RPB_PAIR__INIT, RPB_PAIR__INIT };
+    RpbPair *pbindexes[2] = { &index[0], &index[1] };
+    TEST_WIRE_PB(index[0].key, pairs[0]->key)
+    index[0].has_value = 1; TEST_WIRE_PB(index[0].value, pairs[0]->value)
+    TEST_WIRE_PB(index[1].key, pairs[1]->key)
+    RpbContent content = RPB_CONTENT__INIT;
+    TEST_WIRE_PB(content.value, riak_object_get_value(obj))
+    content.has_content_type = 1; TEST_WIRE_PB(content.content_type, riak_object_get_content_type(obj))
+    content.has_charset = 1;      TEST_WIRE_PB(content.charset, riak_object_get_charset(obj))
+    content.has_last_mod = 1;     content.last_mod = 1386540290;
+    content.has_deleted = 1;      content.deleted = 0;
+    content.n_links   = 1; content.links   = pblinks;
+    content.n_indexes = 2; content.indexes = pbindexes;
+    RpbPutReq msg = RPB_PUT_REQ__INIT;
+    TEST_WIRE_PB(msg.bucket, riak_object_get_bucket(obj))
+    msg.has_key = 1;           TEST_WIRE_PB(msg.key, riak_object_get_key(obj))
+    msg.has_vclock = 1;        TEST_WIRE_PB(msg.vclock, vclock)
+    msg.content = &content;
+    msg.has_w = 1;             msg.w = 2;
+    msg.has_dw = 1;            msg.dw = 1;
+    msg.has_return_body = 1;   msg.return_body = 1;
+    msg.has_if_none_match = 1; msg.if_none_match = 1;
+    msg.has_timeout = 1;       msg.timeout = 200;
+    msg.has_n_val = 1;         msg.n_val = 3;
+    riak_size_t   expected_len = rpb_put_req__get_packed_size(&msg);
+    riak_uint8_t *expected     = (riak_uint8_t*)malloc(expected_len);
+    rpb_put_req__pack(&msg, expected);
+
+    riak_operation *rop = NULL;
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    err = riak_async_register_put(rop, obj, opts, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(rop->pb_request->msgid, MSG_RPBPUTREQ)
+    CU_ASSERT_EQUAL_FATAL(rop->pb_request->len, expected_len)
+    CU_ASSERT_EQUAL(memcmp(rop->pb_request->data, expected, expected_len), 0)
+    riak_operation_free(&rop);
+
+    free(expected);
+    riak_put_options_free(cfg, &opts);
+    riak_binary_free(cfg, &vclock);
+    riak_object_free(cfg, &obj);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_wire_put_request_matches_protobuf passed")
+}
+
+void
+test_wire_put_response_decode() {
+    riak_config *cfg;
+    riak_error err = riak_config_new_default(&cfg);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    riak_connection *cxn = NULL;
+    riak_operation  *rop = NULL;
+    riak_connection_new(cfg, &cxn, "localhost", "1", NULL);
+    err = riak_operation_new(cxn, &rop, NULL, NULL, NULL);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+
+    riak_binary *value  = riak_binary_copy_from_string(cfg, "stored");
+    riak_binary *vtag   = riak_binary_copy_from_string(cfg, "3KZWwj1iTcQpoX7t6PlrTS");
+    riak_binary *vclock = riak_binary_copy_from_string(cfg, "a85hYGBgzGDKBVIcR8M2cgel");
+    riak_binary *key    = riak_binary_copy_from_string(cfg, "GeneratedKey");
+    RpbPair  meta = RPB_PAIR__INIT;
+    RpbPair *metas[1] = { &meta };
+    TEST_WIRE_PB(meta.key, vtag)
+    RpbContent  content = RPB_CONTENT__INIT;
+    RpbContent *contents[1] = { &content };
+    TEST_WIRE_PB(content.value, value)
+    content.has_vtag = 1;           TEST_WIRE_PB(content.vtag, vtag)
+    content.has_last_mod_usecs = 1; content.last_mod_usecs = 817644;
+    content.n_usermeta = 1;         content.usermeta = metas;
+    RpbPutResp msg = RPB_PUT_RESP__INIT;
+    msg.n_content  = 1;
+    msg.content    = contents;
+    msg.has_vclock = 1; TEST_WIRE_PB(msg.vclock, vclock)
+    msg.has_key    = 1; TEST_WIRE_PB(msg.key, key)
+    riak_size_t   len   = rpb_put_resp__get_packed_size(&msg);
+    riak_uint8_t *bytes = (riak_uint8_t*)malloc(len + 1);
+    bytes[0] = MSG_RPBPUTRESP;
+    rpb_put_resp__pack(&msg, bytes + 1);
+
+    riak_pb_message pb_response;
+    pb_response.data = bytes;
+    pb_response.len  = len + 1;
+    riak_put_response *response = NULL;
+    riak_boolean_t     done = RIAK_FALSE;
+    err = riak_put_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_FATAL(err == ERIAK_OK)
+    CU_ASSERT_EQUAL(done, RIAK_TRUE)
+    // Nothing points into the receive buffer
+    memset(bytes, 0xff, len + 1);
+    free(bytes);
+    CU_ASSERT_EQUAL(riak_put_get_has_vclock(response), RIAK_TRUE)
+    CU_ASSERT(test_wire_same(riak_put_get_vclock(response), vclock))
+    CU_ASSERT_EQUAL(riak_put_get_has_key(response), RIAK_TRUE)
+    CU_ASSERT(test_wire_same(riak_put_get_key(response), key))
+    CU_ASSERT_EQUAL_FATAL(riak_put_get_n_content(response), 1)
+    riak_object *obj = riak_put_get_content(response)[0];
+    CU_ASSERT(test_wire_same(riak_object_get_value(obj), value))
+    CU_ASSERT_EQUAL(riak_object_get_has_vtag(obj), RIAK_TRUE)
+    CU_ASSERT(test_wire_same(riak_object_get_vtag(obj), vtag))
+    CU_ASSERT_EQUAL(riak_object_get_has_last_mod(obj), RIAK_FALSE)
+    CU_ASSERT_EQUAL(riak_object_get_last_mod_usecs(obj), 817644)
+    CU_ASSERT_EQUAL(riak_object_get_has_key(obj), RIAK_FALSE)
+    CU_ASSERT_EQUAL_FATAL(riak_object_get_n_usermeta(obj), 1)
+    CU_ASSERT(test_wire_same(riak_pair_get_key(riak_object_get_usermeta(obj)[0]), vtag))
+    CU_ASSERT_EQUAL(riak_pair_get_has_value(riak_object_get_usermeta(obj)[0]), RIAK_FALSE)
+    riak_put_response_free(cfg, &response);
+
+    // A truncated sibling fails the whole response, as protobuf-c would
+    riak_uint8_t truncated[] = { MSG_RPBPUTRESP, 0x0a, 0x03, 0x0a, 0x05, 0x61 };
+    pb_response.data = truncated;
+    pb_response.len  = sizeof(truncated);
+    err = riak_put_response_decode(rop, &pb_response, &response, &done);
+    CU_ASSERT_EQUAL(err, ERIAK_MESSAGE_FORMAT)
+
+    riak_binary_free(cfg, &value);
+    riak_binary_free(cfg, &vtag);
+    riak_binary_free(cfg, &vclock);
+    riak_binary_free(cfg, &key);
+    riak_operation_free(&rop);
+    riak_connection_free(&cxn);
+    riak_config_free(&cfg);
+    CU_PASS("test_wire_put_response_decode passed")
+}